@@ -0,0 +1,428 @@
+/***************************************************************
+ * Alarm dispatcher
+ *
+ * Alarm sources report the current condition of each alarm
+ * every time they evaluate it (level-triggered), under a
+ * dedup key such as "<fridge address>/temp_high". Only state
+ * changes produce events, so a condition that stays true is
+ * one raise, however often it is reported.
+ *
+ * Events (raise, clear, escalate) go to a queue and from
+ * there to every registered target (MQTT, webhook):
+ *
+ *  - A key queues at most one event per keyMinIntervalMs.
+ *    Changes inside that interval are held back and only
+ *    the final state is sent, so a flapping sensor that
+ *    returns to the state already delivered sends nothing.
+ *  - An alarm still raised after escalateAfterMs is sent
+ *    again with a higher level, every escalateAfterMs, up
+ *    to maxLevel.
+ *  - Each target has a token bucket (burst events, one
+ *    more every refillMs) on top of the per-key limit.
+ *  - A target that is not ready (Wi-Fi or broker down) or
+ *    fails a send keeps its events queued, in order, and
+ *    is retried with exponential backoff. The queue and
+ *    the delivered state of every key are saved through
+ *    AlarmStore_t after every poll that changed them, so
+ *    they also survive a reboot. When the queue is full
+ *    the oldest event is dropped.
+ *
+ * Plain C++ without Arduino dependencies; the firmware,
+ * 'fridgetool alarmbench' and test/test_alarm_dispatch run
+ * the same code. Only loop() calls into a dispatcher.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "clock.h"
+
+#define ALARM_KEY_LEN 32
+#define ALARM_MAX_KEYS 12             // least recently reported inactive key is reused
+#define ALARM_QUEUE_LEN 16
+#define ALARM_MAX_TARGETS 2
+#define ALARM_JSON_MAX_LEN 192
+#define ALARM_IMAGE_MAGIC 0x414C5201  // "ALR" + layout version
+
+enum AlarmType_t : uint8_t {
+  ALARM_STALE,          // published reading older than the freshness bound
+  ALARM_SLO,            // freshness SLO missed in the current window
+  ALARM_TEMP_HIGH,      // fridge warmer than its target by a margin
+  ALARM_BATTERY_LOW,
+  ALARM_TYPE_COUNT
+};
+
+static const char* const ALARM_TYPE_NAMES[ALARM_TYPE_COUNT] = {
+  "stale", "slo", "temp_high", "battery_low"
+};
+
+enum AlarmAction_t : uint8_t { ALARM_RAISE, ALARM_CLEAR, ALARM_ESCALATE };
+
+static const char* const ALARM_ACTION_NAMES[] = { "raise", "clear", "escalate" };
+
+struct AlarmConfig_t {
+  uint32_t keyMinIntervalMs;
+  uint32_t escalateAfterMs;
+  uint8_t maxLevel;
+  uint8_t burst;                      // token bucket per target
+  uint32_t refillMs;
+  uint32_t retryMs;                   // first retry after a failed send, doubles
+  uint32_t retryMaxMs;
+};
+
+#define ALARM_DEFAULT_CONFIG { 60000, 1800000, 3, 6, 60000, 5000, 300000 }
+
+/** --------------------------------------------------
+ * A queued event. 'pending' has a bit per target still
+ * to deliver it; eventMillis is when the source changed
+ * state, so delivery latency includes every hold-back.
+ * -------------------------------------------------- */
+struct AlarmEvent_t {
+  char key[ALARM_KEY_LEN];
+  uint8_t type;
+  uint8_t action;
+  uint8_t level;
+  uint8_t pending;
+  uint8_t throttled;                  // bit per target: waited for a token
+  uint8_t attempts[ALARM_MAX_TARGETS];
+  int32_t value;
+  uint32_t seq;
+  uint32_t eventMillis;
+  uint32_t retryMillis[ALARM_MAX_TARGETS];
+};
+
+struct AlarmKey_t {
+  char key[ALARM_KEY_LEN];            // "" = free slot
+  uint8_t type;
+  uint8_t level;                      // escalation level while delivered raised
+  bool active;                        // latest state reported by the source
+  bool delivered;                     // state of the last queued raise/clear
+  uint16_t changes;                   // state changes not queued yet
+  int32_t value;
+  uint32_t changedMillis;
+  uint32_t reportedMillis;
+  uint32_t queuedMillis;
+  uint32_t escalateMillis;
+};
+
+/** --------------------------------------------------
+ * Everything that is saved: key states plus the queue.
+ * -------------------------------------------------- */
+struct AlarmImage_t {
+  uint32_t magic;
+  uint32_t seq;
+  uint8_t head;
+  uint8_t count;
+  AlarmKey_t keys[ALARM_MAX_KEYS];
+  AlarmEvent_t queue[ALARM_QUEUE_LEN];
+};
+
+/** --------------------------------------------------
+ * A delivery target. ready() says whether the transport
+ * is up right now; send() delivers one event (json is its
+ * rendering by alarmFormatJson) and returns false on
+ * failure.
+ * -------------------------------------------------- */
+struct AlarmTarget_t {
+  const char* name;
+  void* ctx;
+  bool (*ready)(void* ctx);
+  bool (*send)(void* ctx, const AlarmEvent_t &event, const char* json);
+};
+
+struct AlarmTargetStats_t {
+  uint32_t sent;
+  uint32_t failures;
+  uint32_t throttled;                 // events that waited for a token
+  uint32_t latencyMsMax;
+  uint64_t latencyMsSum;
+};
+
+/** --------------------------------------------------
+ * Persistence (NVS on the device). load() returns false
+ * if nothing usable was stored.
+ * -------------------------------------------------- */
+struct AlarmStore_t {
+  void* ctx;
+  bool (*load)(void* ctx, void* data, size_t len);
+  bool (*save)(void* ctx, const void* data, size_t len);
+};
+
+struct AlarmStats_t {
+  uint32_t reports;
+  uint32_t changes;                   // state changes reported by sources
+  uint32_t raised;
+  uint32_t cleared;
+  uint32_t escalated;
+  uint32_t coalesced;                 // changes that cancelled out inside the interval
+  uint32_t dropped;                   // events lost to a full queue or a full key table
+  uint32_t saves;
+  uint32_t restored;                  // events found in the store at begin
+};
+
+struct AlarmDispatcher_t {
+  AlarmConfig_t config;
+  AlarmStore_t store;
+  AlarmTarget_t targets[ALARM_MAX_TARGETS];
+  AlarmTargetStats_t targetStats[ALARM_MAX_TARGETS];
+  uint8_t tokens[ALARM_MAX_TARGETS];
+  uint32_t refillMillis[ALARM_MAX_TARGETS];
+  uint8_t targetCount;
+  bool dirty;                         // image changed since the last save
+  AlarmImage_t image;
+  AlarmStats_t stats;
+};
+
+inline AlarmEvent_t &alarmQueueAt(AlarmDispatcher_t &d, uint8_t i) {
+  return d.image.queue[(d.image.head + i) % ALARM_QUEUE_LEN];
+}
+
+/** --------------------------------------------------
+ * Renders an event as the JSON body sent to targets.
+ * -------------------------------------------------- */
+inline size_t alarmFormatJson(const AlarmEvent_t &e, char* buf, size_t size, unsigned long now) {
+  int n = snprintf(buf, size,
+                   "{\"key\":\"%s\",\"alarm\":\"%s\",\"state\":\"%s\",\"level\":%u,"
+                   "\"value\":%ld,\"seq\":%lu,\"age_ms\":%lu}",
+                   e.key, e.type < ALARM_TYPE_COUNT ? ALARM_TYPE_NAMES[e.type] : "?",
+                   e.action <= ALARM_ESCALATE ? ALARM_ACTION_NAMES[e.action] : "?", (unsigned)e.level, (long)e.value,
+                   (unsigned long)e.seq, (unsigned long)(now - e.eventMillis));
+  return n < 0 ? 0 : ((size_t)n < size ? (size_t)n : size - 1);
+}
+
+/** --------------------------------------------------
+ * Starts a dispatcher and restores what 'store' holds.
+ * Timestamps from before a reboot mean nothing, so
+ * restored keys and events restart their timers now.
+ * -------------------------------------------------- */
+inline void alarmDispatchBegin(AlarmDispatcher_t &d, const AlarmConfig_t &config, const AlarmStore_t &store) {
+  memset(&d, 0, sizeof(d));
+  d.config = config;
+  d.store = store;
+
+  AlarmImage_t &im = d.image;
+  if (store.load == nullptr || !store.load(store.ctx, &im, sizeof(im)) ||
+      im.magic != ALARM_IMAGE_MAGIC || im.count > ALARM_QUEUE_LEN || im.head >= ALARM_QUEUE_LEN) {
+    memset(&im, 0, sizeof(im));
+    im.magic = ALARM_IMAGE_MAGIC;
+    return;
+  }
+  uint32_t now = clockMillis();
+  for (AlarmKey_t &k : im.keys) {
+    k.key[ALARM_KEY_LEN - 1] = '\0';
+    k.active = k.delivered;
+    k.changes = 0;
+    k.changedMillis = k.reportedMillis = now;
+    k.queuedMillis = now - config.keyMinIntervalMs;
+    k.escalateMillis = now + config.escalateAfterMs;
+  }
+  for (uint8_t i = 0; i < im.count; i++) {
+    AlarmEvent_t &e = alarmQueueAt(d, i);
+    e.key[ALARM_KEY_LEN - 1] = '\0';
+    e.eventMillis = now;
+    memset(e.attempts, 0, sizeof(e.attempts));
+    memset(e.retryMillis, 0, sizeof(e.retryMillis));
+  }
+  d.stats.restored = im.count;
+}
+
+/** --------------------------------------------------
+ * Adds a delivery target. Events queued before it was
+ * added are not sent to it. Returns false when full.
+ * -------------------------------------------------- */
+inline bool alarmDispatchAddTarget(AlarmDispatcher_t &d, const AlarmTarget_t &target) {
+  if (d.targetCount >= ALARM_MAX_TARGETS) return false;
+  uint8_t t = d.targetCount++;
+  d.targets[t] = target;
+  d.tokens[t] = d.config.burst;
+  d.refillMillis[t] = clockMillis();
+  return true;
+}
+
+/** --------------------------------------------------
+ * Source side: the current condition of alarm 'key'.
+ * 'value' (a temperature, a percentage) travels with the
+ * next event. Returns false if the key table is full of
+ * active alarms.
+ * -------------------------------------------------- */
+inline bool alarmReport(AlarmDispatcher_t &d, const char* key, AlarmType_t type, bool active, int32_t value) {
+  uint32_t now = clockMillis();
+  d.stats.reports++;
+  AlarmKey_t* slot = nullptr;
+  AlarmKey_t* spare = nullptr;
+  for (AlarmKey_t &k : d.image.keys) {
+    if (strncmp(k.key, key, ALARM_KEY_LEN - 1) == 0 && k.key[0] != '\0') {
+      slot = &k;
+      break;
+    }
+    // Free slots first, then the idle key reported least recently
+    bool free = k.key[0] == '\0';
+    if (!free && (k.active || k.delivered || k.changes != 0)) continue;
+    if (spare == nullptr || (free && spare->key[0] != '\0') ||
+        (!free && spare->key[0] != '\0' && now - k.reportedMillis > now - spare->reportedMillis)) {
+      spare = &k;
+    }
+  }
+  if (slot == nullptr) {
+    if (!active) return true;         // never raised: nothing to clear
+    if (spare == nullptr) {
+      d.stats.dropped++;
+      return false;
+    }
+    slot = spare;
+    memset(slot, 0, sizeof(*slot));
+    strncpy(slot->key, key, ALARM_KEY_LEN - 1);
+    slot->type = type;
+    slot->queuedMillis = now - d.config.keyMinIntervalMs;
+    d.dirty = true;
+  }
+  slot->reportedMillis = now;
+  if (active) slot->value = value;
+  if (active == slot->active) return true;
+  slot->active = active;
+  slot->changedMillis = now;
+  slot->changes++;
+  d.stats.changes++;
+  return true;
+}
+
+inline void alarmEnqueue(AlarmDispatcher_t &d, const AlarmKey_t &k, AlarmAction_t action, uint32_t eventMillis) {
+  if (d.targetCount == 0) return;
+  if (d.image.count == ALARM_QUEUE_LEN) {
+    d.image.head = (d.image.head + 1) % ALARM_QUEUE_LEN;
+    d.image.count--;
+    d.stats.dropped++;
+  }
+  AlarmEvent_t &e = alarmQueueAt(d, d.image.count++);
+  memset(&e, 0, sizeof(e));
+  memcpy(e.key, k.key, ALARM_KEY_LEN);
+  e.type = k.type;
+  e.action = action;
+  e.level = k.level;
+  e.pending = (uint8_t)((1u << d.targetCount) - 1);
+  e.value = k.value;
+  e.seq = ++d.image.seq;
+  e.eventMillis = eventMillis;
+  d.dirty = true;
+}
+
+/** --------------------------------------------------
+ * Turns key state changes that are due into events and
+ * raises the level of alarms that stayed up.
+ * -------------------------------------------------- */
+inline void alarmUpdateKeys(AlarmDispatcher_t &d, uint32_t now) {
+  for (AlarmKey_t &k : d.image.keys) {
+    if (k.key[0] == '\0') continue;
+    if (k.changes != 0 && now - k.queuedMillis >= d.config.keyMinIntervalMs) {
+      if (k.active == k.delivered) {
+        d.stats.coalesced += k.changes;
+      } else {
+        k.delivered = k.active;
+        k.level = 0;
+        k.queuedMillis = now;
+        k.escalateMillis = k.changedMillis + d.config.escalateAfterMs;
+        alarmEnqueue(d, k, k.active ? ALARM_RAISE : ALARM_CLEAR, k.changedMillis);
+        if (k.active) d.stats.raised++;
+        else d.stats.cleared++;
+        d.stats.coalesced += k.changes - 1;
+      }
+      k.changes = 0;
+      d.dirty = true;
+    }
+    if (k.delivered && k.active && k.level < d.config.maxLevel && (int32_t)(now - k.escalateMillis) >= 0) {
+      k.level++;
+      k.queuedMillis = now;
+      k.escalateMillis = now + d.config.escalateAfterMs;
+      alarmEnqueue(d, k, ALARM_ESCALATE, now);
+      d.stats.escalated++;
+    }
+  }
+}
+
+/** --------------------------------------------------
+ * Sends what each target can take right now. A target
+ * takes events strictly in queue order: the first one it
+ * cannot send (not ready, backing off, out of tokens)
+ * holds back the rest for that target only.
+ * -------------------------------------------------- */
+inline void alarmDeliver(AlarmDispatcher_t &d, uint32_t now) {
+  static char json[ALARM_JSON_MAX_LEN];
+  for (uint8_t t = 0; t < d.targetCount; t++) {
+    AlarmTarget_t &target = d.targets[t];
+    AlarmTargetStats_t &ts = d.targetStats[t];
+    // A full bucket does not bank time
+    if (d.config.refillMs == 0 || d.tokens[t] >= d.config.burst) {
+      d.tokens[t] = d.config.burst;
+      d.refillMillis[t] = now;
+    } else if (now - d.refillMillis[t] >= d.config.refillMs) {
+      uint32_t add = (now - d.refillMillis[t]) / d.config.refillMs;
+      d.tokens[t] = (uint8_t)(d.tokens[t] + add >= d.config.burst ? d.config.burst : d.tokens[t] + add);
+      d.refillMillis[t] += add * d.config.refillMs;
+    }
+    if (!target.ready(target.ctx)) continue;
+
+    for (uint8_t i = 0; i < d.image.count; i++) {
+      AlarmEvent_t &e = alarmQueueAt(d, i);
+      uint8_t bit = (uint8_t)(1u << t);
+      if ((e.pending & bit) == 0) continue;
+      if (e.attempts[t] != 0 && (int32_t)(now - e.retryMillis[t]) < 0) break;
+      if (d.tokens[t] == 0) {
+        if ((e.throttled & bit) == 0) ts.throttled++;
+        e.throttled |= bit;
+        break;
+      }
+      alarmFormatJson(e, json, sizeof(json), now);
+      d.tokens[t]--;
+      if (!target.send(target.ctx, e, json)) {
+        ts.failures++;
+        uint32_t backoff = d.config.retryMs << (e.attempts[t] < 16 ? e.attempts[t] : 16);
+        if (backoff > d.config.retryMaxMs || backoff < d.config.retryMs) backoff = d.config.retryMaxMs;
+        if (e.attempts[t] < 255) e.attempts[t]++;
+        e.retryMillis[t] = clockMillis() + backoff;
+        break;
+      }
+      uint32_t latency = clockMillis() - e.eventMillis;
+      ts.sent++;
+      ts.latencyMsSum += latency;
+      if (latency > ts.latencyMsMax) ts.latencyMsMax = latency;
+      e.pending &= ~bit;
+      d.dirty = true;
+    }
+  }
+  // Bits of targets not registered (after a restore) do not hold the queue
+  uint8_t registered = (uint8_t)((1u << d.targetCount) - 1);
+  while (d.image.count > 0 && (alarmQueueAt(d, 0).pending & registered) == 0) {
+    d.image.head = (d.image.head + 1) % ALARM_QUEUE_LEN;
+    d.image.count--;
+  }
+}
+
+/** --------------------------------------------------
+ * Call every loop: queues due events, delivers, and
+ * saves the image if anything changed.
+ * -------------------------------------------------- */
+inline void alarmDispatchPoll(AlarmDispatcher_t &d) {
+  uint32_t now = clockMillis();
+  alarmUpdateKeys(d, now);
+  alarmDeliver(d, now);
+  if (d.dirty && d.store.save != nullptr) {
+    d.store.save(d.store.ctx, &d.image, sizeof(d.image));
+    d.stats.saves++;
+  }
+  d.dirty = false;
+}
+
+/** --------------------------------------------------
+ * Number of alarms currently delivered as raised.
+ * -------------------------------------------------- */
+inline uint8_t alarmActiveCount(const AlarmDispatcher_t &d) {
+  uint8_t n = 0;
+  for (const AlarmKey_t &k : d.image.keys) {
+    if (k.key[0] != '\0' && k.delivered) n++;
+  }
+  return n;
+}
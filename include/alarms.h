@@ -0,0 +1,54 @@
+/***************************************************************
+ * Alarm delivery
+ *
+ * The device side of the alarm dispatcher (alarm_dispatch.h):
+ * events go to MQTT, as <base topic>/alarm/<type>, and to an
+ * HTTP webhook as a JSON POST. Both can be switched at run
+ * time (remote configuration). The pending queue and the
+ * delivered state of every alarm are kept in NVS, so alarms
+ * raised while Wi-Fi or the broker is down are delivered
+ * once it is back, even across a reboot.
+ *
+ * Only loop() calls into this module.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "alarm_dispatch.h"
+
+class Print;
+
+#define ALARM_WEBHOOK_TIMEOUT_MS 3000   // one POST; blocks loop() at most this long
+#define ALARM_WEBHOOK_URL_LEN 96
+
+/** --------------------------------------------------
+ * Loads the saved queue and registers both targets, then
+ * applies alarmsConfigure().
+ * -------------------------------------------------- */
+void alarmsBegin(const AlarmConfig_t &config, const char* webhookUrl, bool mqttEnabled);
+
+/** --------------------------------------------------
+ * Changes pacing and sinks on the fly. A sink that is off
+ * (empty webhookUrl, mqttEnabled false) drops its events
+ * instead of queueing them; MQTT without a broker is on
+ * but never ready, so its events wait.
+ * -------------------------------------------------- */
+void alarmsConfigure(const AlarmConfig_t &config, const char* webhookUrl, bool mqttEnabled);
+
+/** --------------------------------------------------
+ * Current condition of one alarm (alarmReport()).
+ * -------------------------------------------------- */
+void alarmsReport(const char* key, AlarmType_t type, bool active, int32_t value);
+
+/** --------------------------------------------------
+ * Queues due events and delivers. Call every loop.
+ * -------------------------------------------------- */
+void alarmsPoll();
+
+/** --------------------------------------------------
+ * Active alarms, queue and per-target delivery stats
+ * (the 'alarms' command).
+ * -------------------------------------------------- */
+void alarmsPrint(Print &out);
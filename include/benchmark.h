@@ -0,0 +1,42 @@
+/***************************************************************
+ * On-device microbenchmarks
+ *
+ * Runs a kernel N times, timing every call in CPU cycles with
+ * ESP.getCycleCount(), and reports min / median / p99 as one
+ * JSON line per kernel so results can be collected per
+ * firmware release. Only built with -DBENCHMARK_MODE.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+typedef void (*BenchKernel)(void* ctx);
+
+/** --------------------------------------------------
+ * Result of one kernel, in cycles per call with the
+ * timing overhead already subtracted.
+ * -------------------------------------------------- */
+struct BenchResult_t {
+  const char* name;
+  uint32_t iterations;
+  uint32_t minCycles;
+  uint32_t medianCycles;
+  uint32_t p99Cycles;
+};
+
+/** --------------------------------------------------
+ * Prints the suite header line (firmware, CPU clock).
+ * -------------------------------------------------- */
+void benchmarkBegin(const char* firmwareVersion, uint32_t iterations);
+
+/** --------------------------------------------------
+ * Runs and reports one kernel. Returns false if the
+ * sample buffer could not be allocated.
+ * -------------------------------------------------- */
+bool benchmarkRun(const char* name, uint32_t iterations, BenchKernel kernel, void* ctx, BenchResult_t &result);
+
+/** --------------------------------------------------
+ * Prints the suite footer line.
+ * -------------------------------------------------- */
+void benchmarkEnd();
@@ -0,0 +1,164 @@
+/***************************************************************
+ * Binary deferred-format log records
+ *
+ * With -DLOG_BINARY the LOG_* macros (log.h) do not format
+ * anything on the device. A record carries a 16-bit format
+ * ID, the time and the raw arguments:
+ *
+ *   0x1E  len  id(2, LE)  millis(varint)  args...  crc8
+ *
+ * len counts the bytes between it and the crc8, the CRC
+ * (poly 0x07) covers the same bytes. Arguments follow the
+ * C++ type of each value:
+ *   integers, bools, enums   zigzag varint of the value as int64
+ *   float, double            4-byte IEEE float, little endian
+ *   strings                  varint length + bytes (max BINLOG_MAX_STRING)
+ *
+ * The ID is FNV-1a over the level and the format string,
+ * folded to 16 bits and computed by the compiler, so the
+ * format string itself never reaches the binary.
+ * tools/log_dictionary.py computes the same IDs from the
+ * sources and writes the dictionary that
+ * 'fridgetool logdecode' uses to render the records.
+ * Text on the same serial stream (console output) is
+ * passed through unchanged.
+ *
+ * Shared by the firmware and the host tool; no Arduino
+ * dependencies.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+#define BINLOG_SYNC 0x1E                 // ASCII record separator, never in log text
+#define BINLOG_MAX_PAYLOAD 160
+#define BINLOG_MAX_STRING 64
+
+/** --------------------------------------------------
+ * Format IDs, evaluated at compile time. The recursion is
+ * C++11 constexpr; keep format strings under ~400 chars.
+ * -------------------------------------------------- */
+constexpr uint32_t binlogFnv(const char* s, uint32_t h) {
+  return *s == '\0' ? h : binlogFnv(s + 1, (h ^ (uint8_t)*s) * 16777619u);
+}
+
+constexpr uint16_t binlogFold(uint32_t h) {
+  return (uint16_t)((h >> 16) ^ (h & 0xFFFF));
+}
+
+constexpr uint16_t binlogFormatId(int level, const char* fmt) {
+  return binlogFold(binlogFnv(fmt, (2166136261u ^ (uint8_t)level) * 16777619u));
+}
+
+// Forces compile-time evaluation, so 'fmt' is not emitted
+#define BINLOG_ID(level, fmt) (std::integral_constant<uint16_t, binlogFormatId(level, fmt)>::value)
+
+inline uint8_t binlogCrc8(const uint8_t* data, size_t len) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+/** --------------------------------------------------
+ * A record being built. Arguments that do not fit are
+ * dropped; the host renders them as '?'.
+ * -------------------------------------------------- */
+struct BinlogRecord_t {
+  uint8_t bytes[2 + BINLOG_MAX_PAYLOAD + 1];   // sync, len, payload, crc8
+  size_t  length;                              // payload bytes so far
+};
+
+inline void binlogPutByte(BinlogRecord_t &r, uint8_t b) {
+  if (r.length < BINLOG_MAX_PAYLOAD) r.bytes[2 + r.length++] = b;
+}
+
+inline void binlogPutVarint(BinlogRecord_t &r, uint64_t v) {
+  while (v >= 0x80) {
+    binlogPutByte(r, (uint8_t)(v | 0x80));
+    v >>= 7;
+  }
+  binlogPutByte(r, (uint8_t)v);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+binlogPut(BinlogRecord_t &r, T value) {
+  int64_t s = (int64_t)value;
+  binlogPutVarint(r, ((uint64_t)s << 1) ^ (uint64_t)(s >> 63));
+}
+
+inline void binlogPut(BinlogRecord_t &r, double value) {
+  float f = (float)value;
+  uint32_t bits;
+  memcpy(&bits, &f, 4);
+  for (int i = 0; i < 4; i++) binlogPutByte(r, (uint8_t)(bits >> (8 * i)));
+}
+
+inline void binlogPut(BinlogRecord_t &r, const char* s) {
+  size_t n = s != nullptr ? strnlen(s, BINLOG_MAX_STRING) : 0;
+  binlogPutVarint(r, n);
+  for (size_t i = 0; i < n; i++) binlogPutByte(r, (uint8_t)s[i]);
+}
+
+inline void binlogPutArgs(BinlogRecord_t &) {
+}
+
+template <typename T, typename... Rest>
+inline void binlogPutArgs(BinlogRecord_t &r, T first, Rest... rest) {
+  binlogPut(r, first);
+  binlogPutArgs(r, rest...);
+}
+
+inline void binlogBegin(BinlogRecord_t &r, uint16_t id, uint32_t millis) {
+  r.bytes[0] = BINLOG_SYNC;
+  r.length = 0;
+  binlogPutByte(r, (uint8_t)id);
+  binlogPutByte(r, (uint8_t)(id >> 8));
+  binlogPutVarint(r, millis);
+}
+
+/** --------------------------------------------------
+ * Closes the record; returns the frame size to write
+ * from r.bytes.
+ * -------------------------------------------------- */
+inline size_t binlogFinish(BinlogRecord_t &r) {
+  r.bytes[1] = (uint8_t)r.length;
+  r.bytes[2 + r.length] = binlogCrc8(&r.bytes[2], r.length);
+  return r.length + 3;
+}
+
+/** --------------------------------------------------
+ * Reading side (host). Return false when the input ends
+ * before the value does.
+ * -------------------------------------------------- */
+inline bool binlogGetVarint(const uint8_t* &p, const uint8_t* end, uint64_t &v) {
+  v = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7) {
+    uint8_t b = *p++;
+    v |= (uint64_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+inline bool binlogGetInt(const uint8_t* &p, const uint8_t* end, int64_t &v) {
+  uint64_t u;
+  if (!binlogGetVarint(p, end, u)) return false;
+  v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+  return true;
+}
+
+inline bool binlogGetFloat(const uint8_t* &p, const uint8_t* end, float &f) {
+  if (end - p < 4) return false;
+  uint32_t bits = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+  memcpy(&f, &bits, 4);
+  p += 4;
+  return true;
+}
@@ -0,0 +1,58 @@
+/***************************************************************
+ * BLE bulk history download
+ *
+ * A GATT service on the relay server that streams the
+ * history ring to a phone as fast as the link allows:
+ *
+ *  Info    (read)    HistoryInfo_t: ring bounds + record size
+ *  Control (write / write without response)
+ *            01 <u32 seq> <u16 credits>  start at seq (resume)
+ *            02 <u16 credits>            grant more credits
+ *            03                          stop
+ *  Data    (notify)  <u32 seq of first record> <records...>
+ *            filled up to the peer's MTU; a notification
+ *            with no records marks the end of the data.
+ *
+ * Every notification costs one credit, so the phone paces
+ * the transfer and never gets more than it can buffer.
+ * Each connected phone has its own transfer and only gets
+ * its own notifications (history_transfer.h). After a
+ * disconnect the phone restarts at the next seq it has
+ * not received. All values little endian.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+#define HISTORY_SERVICE_UUID      "6e7a0010-5ab1-4c0f-9f3c-7d1b2a3c4d5e"
+#define HISTORY_INFO_CHAR_UUID    "6e7a0011-5ab1-4c0f-9f3c-7d1b2a3c4d5e"
+#define HISTORY_CONTROL_CHAR_UUID "6e7a0012-5ab1-4c0f-9f3c-7d1b2a3c4d5e"
+#define HISTORY_DATA_CHAR_UUID    "6e7a0013-5ab1-4c0f-9f3c-7d1b2a3c4d5e"
+
+#define HISTORY_CTRL_START  0x01
+#define HISTORY_CTRL_CREDIT 0x02
+#define HISTORY_CTRL_STOP   0x03
+
+/** --------------------------------------------------
+ * Info characteristic value (little endian, 12 bytes).
+ * -------------------------------------------------- */
+struct __attribute__((packed)) HistoryInfo_t {
+  uint8_t  version;        // HISTORY_VERSION
+  uint8_t  recordSize;     // sizeof(HistoryRecord_t)
+  uint16_t reserved;
+  uint32_t firstSeq;       // oldest record still held
+  uint32_t endSeq;         // one past the newest record
+};
+
+/** --------------------------------------------------
+ * Adds the service to the relay GATT server. Call after
+ * relayServerBegin().
+ * -------------------------------------------------- */
+void bleHistoryServiceBegin();
+
+/** --------------------------------------------------
+ * Sends pending notifications while credits remain.
+ * Call from loop().
+ * -------------------------------------------------- */
+void bleHistoryServiceLoop();
@@ -0,0 +1,93 @@
+/***************************************************************
+ * Clock abstraction
+ *
+ * All firmware timing goes through clockMillis(),
+ * clockMicros() and clockDelay() instead of the Arduino
+ * calls, so a different time source can be installed with
+ * clockInstall(). On the device nothing is installed and
+ * the calls fall through to millis() / micros() / delay();
+ * on the host they fall through to std::chrono's
+ * steady_clock and a real sleep. Host-side simulations
+ * install a VirtualClock_t (see virtual_clock.h).
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+/** --------------------------------------------------
+ * A time source. ctx is passed back to every call.
+ * -------------------------------------------------- */
+struct Clock_t {
+  void* ctx;
+  unsigned long (*millis)(void* ctx);
+  unsigned long (*micros)(void* ctx);
+  void (*delay)(void* ctx, unsigned long ms);
+};
+
+inline const Clock_t*& clockSlot() {
+  static const Clock_t* installed = nullptr;
+  return installed;
+}
+
+/** --------------------------------------------------
+ * Installs a time source; nullptr restores the default.
+ * -------------------------------------------------- */
+inline void clockInstall(const Clock_t* clock) {
+  clockSlot() = clock;
+}
+
+#ifndef ARDUINO
+/** --------------------------------------------------
+ * Host default: microseconds on the steady clock, full
+ * 64 bits (clockMicros() wraps like the device's).
+ * -------------------------------------------------- */
+inline uint64_t clockSteadyMicros() {
+  using namespace std::chrono;
+  return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+inline unsigned long clockMillis() {
+  const Clock_t* c = clockSlot();
+  if (c == nullptr) {
+#ifdef ARDUINO
+    return millis();
+#else
+    return (unsigned long)(clockSteadyMicros() / 1000);
+#endif
+  }
+  return c->millis(c->ctx);
+}
+
+inline unsigned long clockMicros() {
+  const Clock_t* c = clockSlot();
+  if (c == nullptr) {
+#ifdef ARDUINO
+    return micros();
+#else
+    return (unsigned long)clockSteadyMicros();
+#endif
+  }
+  return c->micros(c->ctx);
+}
+
+inline void clockDelay(unsigned long ms) {
+  const Clock_t* c = clockSlot();
+  if (c == nullptr) {
+#ifdef ARDUINO
+    delay(ms);
+#else
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+#endif
+    return;
+  }
+  c->delay(c->ctx, ms);
+}
@@ -0,0 +1,65 @@
+/***************************************************************
+ * Configuration store and remote updates
+ *
+ * Keeps the active FridgeConfig_t (remote_config.h) and its
+ * copy in NVS. Patches arrive on <base topic>/config/set;
+ * each is validated and applied as a whole, written to NVS,
+ * and only then made active and handed to the reload
+ * handler, so RAM and flash never disagree and a rejected
+ * patch changes nothing. A patch that changes nothing is
+ * not written. After every patch the outcome is published to
+ * config/result, and the full document (retained) to
+ * config/state, which is also published on every connect.
+ *
+ * Intervals, thresholds and sinks take effect immediately;
+ * the fridge name and UUIDs at the next BLE connection, so
+ * the current session is never restarted.
+ *
+ * configCurrent() is for loop() only; the BLE task uses
+ * configCopyDeviceName() and configCopyServiceUuid().
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "remote_config.h"
+
+class Print;
+
+/** --------------------------------------------------
+ * Called on loop() after a patch was applied, with the
+ * new document and a mask of the fields that changed.
+ * -------------------------------------------------- */
+typedef void (*ConfigReloadHandler)(const FridgeConfig_t &config, uint32_t changedMask);
+
+/** --------------------------------------------------
+ * Loads the document from NVS, or uses 'defaults' if
+ * none is stored or it does not validate, and subscribes
+ * to patches. Call before anything reads the config.
+ * -------------------------------------------------- */
+void configStoreBegin(const FridgeConfig_t &defaults, ConfigReloadHandler onReload);
+
+const FridgeConfig_t &configCurrent();
+
+/** --------------------------------------------------
+ * Copies the fridge name under the lock (any task).
+ * -------------------------------------------------- */
+void configCopyDeviceName(char* out, size_t size);
+
+/** --------------------------------------------------
+ * Copies the fridge service UUID under the lock (any task).
+ * -------------------------------------------------- */
+void configCopyServiceUuid(char* out, size_t size);
+
+/** --------------------------------------------------
+ * Applies one patch (what a config/set message does).
+ * -------------------------------------------------- */
+bool configStoreApply(const char* json, size_t len, ConfigResult_t &result);
+
+/** --------------------------------------------------
+ * The document, apply latency and NVS write counts (the
+ * 'config' command).
+ * -------------------------------------------------- */
+void configStorePrint(Print &out);
@@ -0,0 +1,53 @@
+/***************************************************************
+ * Connection lifecycle accounting
+ *
+ * loop() reports every step of getting from "no fridge" to
+ * usable data as a state transition. Per fridge address
+ * this module keeps the cumulative time spent in each
+ * state, a count for every from -> to transition, a latency
+ * histogram per state visit, and a histogram of the time
+ * from scan start to the first decoded frame.
+ *
+ * Time spent scanning is charged to the fridge the scan
+ * found. Everything is exported as Prometheus text on
+ * GET /metrics and by the 'conn' serial command.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+class Print;
+
+#define CONN_STATS_MAX_DEVICES 4
+// Histogram bucket i holds durations below 2^(i + 4) ms (16 ms .. ~9 min), plus +Inf
+#define CONN_HIST_BUCKETS 16
+
+enum ConnState_t {
+  CONN_DISCONNECTED = 0,   // boot, failed connect, link lost
+  CONN_SCANNING,           // looking for the fridge
+  CONN_CONNECTING,         // BLEClient::connect()
+  CONN_DISCOVERING,        // service / characteristic lookup, notify registration
+  CONN_BINDING,            // BIND sent, waiting for the first frame
+  CONN_READY,              // first frame decoded, data flowing
+  CONN_STATE_COUNT
+};
+
+/** --------------------------------------------------
+ * Enters 'next'. address is the fridge the new state is
+ * about (nullptr: keep the current one); the time spent
+ * in the state being left is charged to it as well.
+ * Transitions to the current state are ignored.
+ * -------------------------------------------------- */
+void connStatsTransition(ConnState_t next, const uint8_t* address);
+
+ConnState_t connStatsState();
+
+const char* connStateName(ConnState_t state);
+
+/** --------------------------------------------------
+ * Writes all counters in Prometheus text format. Safe to
+ * call from any task.
+ * -------------------------------------------------- */
+void connStatsWrite(Print &out);
@@ -0,0 +1,111 @@
+// Generated by tools/embed_dashboard.py from data/dashboard.html - do not edit
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DASHBOARD_ETAG "\"5917a967f3b6d9b1\""
+
+// 3067 bytes of HTML, 1562 bytes gzip
+static const size_t DASHBOARD_HTML_GZ_LEN = 1562;
+static const uint8_t DASHBOARD_HTML_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x85, 0x56, 0x5b, 0x6f, 0xdb, 0x36,
+  0x14, 0x7e, 0xf7, 0xaf, 0x60, 0x94, 0xae, 0xa0, 0x16, 0x5b, 0xbe, 0xc4, 0xf5, 0x32, 0xcb, 0x72,
+  0xb1, 0xa6, 0x19, 0xda, 0x21, 0x59, 0x0a, 0x34, 0x6b, 0x37, 0x04, 0x79, 0xa0, 0x25, 0x4a, 0x62,
+  0x23, 0x51, 0x1e, 0x49, 0xdf, 0xe6, 0xfa, 0xbf, 0xef, 0x1c, 0x52, 0xf2, 0xa5, 0x1d, 0x30, 0xc0,
+  0xb0, 0xc8, 0x73, 0xbf, 0x7c, 0x3c, 0xe4, 0xe4, 0xec, 0xed, 0xfd, 0xf5, 0xc3, 0x5f, 0x1f, 0x6e,
+  0x48, 0x6e, 0xca, 0x62, 0xda, 0x9a, 0xe0, 0x87, 0x14, 0x4c, 0x66, 0x91, 0xc7, 0xa5, 0x87, 0x04,
+  0xce, 0x12, 0xf8, 0x94, 0xdc, 0x30, 0x12, 0xe7, 0x4c, 0x69, 0x6e, 0x22, 0x6f, 0x61, 0xd2, 0xce,
+  0x95, 0xd7, 0x90, 0x25, 0x2b, 0x79, 0xe4, 0x2d, 0x05, 0x5f, 0xcd, 0x2b, 0x65, 0x3c, 0x12, 0x57,
+  0xd2, 0x70, 0x09, 0x62, 0x2b, 0x91, 0x98, 0x3c, 0x4a, 0xf8, 0x52, 0xc4, 0xbc, 0x63, 0x37, 0x6d,
+  0x22, 0xa4, 0x30, 0x82, 0x15, 0x1d, 0x1d, 0xb3, 0x82, 0x47, 0x7d, 0x34, 0x62, 0x84, 0x29, 0xf8,
+  0xf4, 0x57, 0x25, 0x92, 0x8c, 0x4f, 0xba, 0x6e, 0xd7, 0x9a, 0x68, 0xb3, 0xc1, 0xef, 0xac, 0x4a,
+  0x36, 0xdb, 0x14, 0x2c, 0x76, 0x52, 0x56, 0x8a, 0x62, 0x33, 0xd6, 0x4c, 0xea, 0x8e, 0xe6, 0x4a,
+  0xa4, 0x61, 0xc9, 0x54, 0x26, 0xe4, 0xb8, 0x17, 0xce, 0x59, 0x92, 0x08, 0x99, 0x8d, 0xfb, 0xbc,
+  0x0c, 0x67, 0x2c, 0x7e, 0xce, 0x54, 0xb5, 0x90, 0xc9, 0xf8, 0x3c, 0x1d, 0xa6, 0xa3, 0xf4, 0x2a,
+  0x8c, 0xab, 0xa2, 0x52, 0xe3, 0xf3, 0xc1, 0x60, 0xb0, 0x6b, 0xe5, 0x7d, 0x67, 0x4d, 0x8b, 0x7f,
+  0xf8, 0xb8, 0x1f, 0x0c, 0x40, 0xa3, 0x31, 0x43, 0x7a, 0x24, 0x78, 0xc5, 0xcb, 0x5d, 0xeb, 0xbc,
+  0x10, 0x4b, 0xbe, 0x4d, 0x84, 0x9e, 0x17, 0x6c, 0x33, 0x4e, 0x0b, 0xbe, 0x0e, 0xf1, 0xaf, 0xb3,
+  0x52, 0x6c, 0x3e, 0xc6, 0xbf, 0x30, 0x83, 0x05, 0xca, 0xd6, 0xba, 0x9d, 0x59, 0x65, 0x4c, 0x55,
+  0xa2, 0xff, 0x5a, 0x9b, 0x24, 0x62, 0xb9, 0x3d, 0x09, 0x25, 0x4d, 0xc3, 0x59, 0xa5, 0x12, 0xae,
+  0x3a, 0x8a, 0x25, 0x62, 0xa1, 0xc7, 0xa3, 0xf9, 0x7a, 0x1f, 0x38, 0xda, 0x22, 0xc1, 0x15, 0x1a,
+  0x04, 0x6b, 0xb6, 0x54, 0xe3, 0xd1, 0xc1, 0xd8, 0x6c, 0x1f, 0xcc, 0xac, 0xa8, 0xe2, 0xe7, 0xf0,
+  0x38, 0x83, 0x21, 0x8a, 0xc5, 0x4c, 0x2e, 0x99, 0xde, 0x3a, 0xc5, 0x7e, 0xaf, 0xf7, 0x43, 0x98,
+  0x73, 0x91, 0xe5, 0x66, 0x3c, 0x18, 0xf5, 0xc0, 0xcd, 0xff, 0x06, 0xb2, 0x6b, 0xe9, 0x92, 0x15,
+  0xc5, 0xb6, 0xae, 0xd4, 0x68, 0x34, 0xda, 0xb5, 0x26, 0xdd, 0xba, 0x05, 0x93, 0x6e, 0x0d, 0x02,
+  0xec, 0x05, 0x42, 0xa2, 0x5f, 0x37, 0x8b, 0xbc, 0x94, 0x09, 0xd3, 0x79, 0x08, 0x80, 0xd1, 0x86,
+  0x0c, 0x86, 0x24, 0x07, 0xd1, 0x3e, 0x48, 0x40, 0xf2, 0x44, 0x24, 0x91, 0x87, 0xc1, 0x7b, 0xd3,
+  0x49, 0x17, 0xf6, 0x40, 0x75, 0x41, 0x5a, 0x06, 0x22, 0xc9, 0x20, 0xc7, 0xd1, 0xb0, 0xdd, 0xe8,
+  0xdf, 0xf2, 0x84, 0x4c, 0x2b, 0x64, 0x59, 0x0a, 0x72, 0x62, 0x25, 0xe6, 0x66, 0xda, 0x02, 0x58,
+  0x81, 0x97, 0x17, 0x24, 0x02, 0x29, 0x12, 0x4d, 0x49, 0x52, 0xc5, 0x8b, 0x12, 0x70, 0x16, 0x64,
+  0xdc, 0xdc, 0x14, 0x1c, 0x97, 0x6f, 0x36, 0xef, 0x13, 0x2a, 0x12, 0x3f, 0xac, 0x85, 0xe1, 0x17,
+  0x91, 0xed, 0x6e, 0xbf, 0xcd, 0xab, 0x15, 0x10, 0x1e, 0x1f, 0xbd, 0x82, 0xa7, 0xe6, 0x7a, 0xa1,
+  0x14, 0xe8, 0x78, 0x6d, 0xaf, 0x59, 0x3d, 0xb5, 0x1d, 0xe7, 0x01, 0x9a, 0xca, 0x91, 0x51, 0x2f,
+  0x90, 0x3e, 0x63, 0xe6, 0x03, 0x57, 0xb1, 0x53, 0x78, 0xc3, 0x8c, 0xe1, 0x6a, 0x43, 0x7e, 0x68,
+  0x58, 0x9f, 0xaa, 0xe2, 0xfd, 0x09, 0xe7, 0x93, 0xe5, 0xa8, 0x85, 0xbc, 0xab, 0x12, 0x0e, 0x74,
+  0xfb, 0xb1, 0xf6, 0xa1, 0x7f, 0x3c, 0x01, 0xca, 0xad, 0x5b, 0x3c, 0x3d, 0x85, 0xad, 0x56, 0xba,
+  0x90, 0xb1, 0x11, 0x95, 0x24, 0x10, 0x06, 0x34, 0xe6, 0x16, 0xca, 0x46, 0x7d, 0xb2, 0x6d, 0x11,
+  0xf2, 0x82, 0xba, 0x22, 0xfa, 0x81, 0x90, 0x92, 0xab, 0x77, 0x0f, 0x77, 0xb7, 0x90, 0x01, 0x26,
+  0x12, 0x94, 0x6c, 0x4e, 0xe9, 0xe3, 0x73, 0x9b, 0xc8, 0x27, 0x1f, 0xeb, 0x81, 0xe2, 0x84, 0x14,
+  0xdc, 0x90, 0x25, 0x8a, 0x98, 0xc7, 0x67, 0x30, 0x8d, 0x24, 0x91, 0x12, 0xfa, 0x4c, 0xa2, 0x88,
+  0x1c, 0x45, 0x4a, 0x5e, 0xbe, 0x04, 0xb1, 0x33, 0x20, 0x02, 0x28, 0x78, 0x2a, 0x24, 0x4f, 0x7c,
+  0xab, 0xb7, 0x24, 0x17, 0xc4, 0x0b, 0x3c, 0xf8, 0xd7, 0x26, 0x70, 0xf2, 0x6f, 0x79, 0xfc, 0xad,
+  0xa1, 0x26, 0xb1, 0x46, 0x07, 0x68, 0x7d, 0xf2, 0x9a, 0x78, 0x37, 0xd7, 0xf7, 0x1e, 0x19, 0x3b,
+  0x42, 0x0f, 0x09, 0x77, 0xbf, 0xfc, 0x69, 0x09, 0xdf, 0x1a, 0xa8, 0xcb, 0xd0, 0xe8, 0x83, 0xe4,
+  0x86, 0x6b, 0x94, 0xf4, 0x64, 0xe5, 0x39, 0x61, 0xc5, 0xcd, 0x42, 0x49, 0xe2, 0x21, 0x9a, 0xa6,
+  0x18, 0x90, 0xc4, 0xd0, 0x26, 0x33, 0xbb, 0xa6, 0xe8, 0xe2, 0x28, 0x78, 0xb4, 0xd0, 0xb1, 0x9e,
+  0x7c, 0x2b, 0xd5, 0x9d, 0xd5, 0xb0, 0xb3, 0xc6, 0x76, 0x7e, 0xf0, 0xa5, 0x12, 0x92, 0x7a, 0x1e,
+  0x40, 0x63, 0x77, 0x54, 0x6f, 0xc0, 0x85, 0xe4, 0xb1, 0xa9, 0x8b, 0xed, 0x50, 0xb2, 0xd2, 0x10,
+  0x92, 0xe4, 0x2b, 0xf2, 0x99, 0xcf, 0x3e, 0x62, 0x98, 0x86, 0x7a, 0x2b, 0x3d, 0xee, 0x76, 0xd1,
+  0x2f, 0xc4, 0xcd, 0x50, 0x33, 0xc8, 0x2b, 0x10, 0x05, 0x4f, 0xdd, 0x95, 0x46, 0xa3, 0xae, 0xf0,
+  0x9a, 0xff, 0x0d, 0xba, 0x9d, 0x3e, 0xee, 0x57, 0x3a, 0xa8, 0x64, 0xc9, 0xb5, 0x66, 0x70, 0x50,
+  0x22, 0xc2, 0x0f, 0x2d, 0x72, 0x6e, 0x4a, 0x20, 0xfe, 0xf6, 0xf1, 0xfe, 0xf7, 0x60, 0x8e, 0x43,
+  0x95, 0xf2, 0x20, 0x61, 0x86, 0xf9, 0x87, 0x3a, 0x95, 0x81, 0xd9, 0xcc, 0xb9, 0x2d, 0x56, 0xc2,
+  0x0b, 0xc3, 0x6c, 0xcb, 0xd0, 0xc1, 0x14, 0x4b, 0x0b, 0xeb, 0x32, 0xc0, 0xdd, 0x59, 0x64, 0x89,
+  0x17, 0xa4, 0x0f, 0x39, 0xa0, 0x53, 0x0d, 0x10, 0xa2, 0x9e, 0x96, 0x6c, 0x0e, 0x28, 0x31, 0x10,
+  0x5b, 0x5d, 0xc8, 0x90, 0xec, 0xac, 0xed, 0xfb, 0xd9, 0x17, 0xc8, 0x38, 0x60, 0x5a, 0x8b, 0x4c,
+  0x52, 0x6d, 0xda, 0x68, 0xc8, 0x30, 0xb3, 0xd0, 0xe4, 0xeb, 0x57, 0x58, 0xc3, 0xd1, 0x94, 0x19,
+  0xb7, 0x9b, 0xed, 0xae, 0x8e, 0xc7, 0xe5, 0x65, 0x1d, 0x36, 0xbd, 0x39, 0xe0, 0xd4, 0x16, 0x78,
+  0x9f, 0x71, 0x5c, 0x54, 0x1a, 0xf3, 0xa5, 0x16, 0x93, 0x70, 0x5b, 0x3c, 0x88, 0x92, 0x57, 0x0b,
+  0x43, 0xeb, 0x52, 0xb7, 0xc9, 0x65, 0xaf, 0xd7, 0x73, 0x6d, 0x60, 0x7a, 0x23, 0x63, 0xb2, 0x6f,
+  0x46, 0x51, 0xb1, 0xe4, 0x9d, 0xd0, 0xa6, 0x52, 0x9b, 0x93, 0x86, 0x28, 0x30, 0xc7, 0x56, 0x4c,
+  0x18, 0x92, 0x72, 0x13, 0xe7, 0xd4, 0xeb, 0xb2, 0xb9, 0xe8, 0xe6, 0x4e, 0xf2, 0x75, 0xaa, 0xaa,
+  0x32, 0xea, 0xb9, 0x1e, 0x38, 0xf9, 0x59, 0xdd, 0xbf, 0xb7, 0x50, 0xd0, 0x4f, 0x70, 0x2b, 0x51,
+  0xa7, 0xac, 0x02, 0xa6, 0x14, 0xdb, 0xbc, 0x59, 0xa4, 0x29, 0x57, 0xd4, 0x3f, 0x52, 0xc0, 0x49,
+  0x0a, 0x3a, 0x33, 0x9c, 0x24, 0x7f, 0x08, 0x69, 0xae, 0xe8, 0xa5, 0x0f, 0xc7, 0xca, 0x0e, 0x8b,
+  0x3d, 0xf1, 0x72, 0x40, 0x87, 0x6d, 0x62, 0xd4, 0x82, 0x1f, 0x69, 0xe2, 0x7c, 0x79, 0x7c, 0x6a,
+  0x93, 0x78, 0xa1, 0xea, 0x95, 0xc9, 0x1c, 0x0d, 0x65, 0xd2, 0x4a, 0x11, 0x8a, 0xb8, 0xa8, 0x80,
+  0x74, 0x15, 0xc2, 0xe7, 0xc2, 0xf9, 0x9a, 0xa0, 0xdd, 0xd9, 0xc6, 0xf0, 0x5b, 0x2e, 0x33, 0x93,
+  0x5b, 0x4e, 0x64, 0x59, 0xfe, 0x09, 0x46, 0x0c, 0xd4, 0xee, 0x9b, 0x18, 0xaa, 0xa3, 0x18, 0x1c,
+  0x50, 0x30, 0xce, 0x8e, 0x13, 0x9d, 0x92, 0xab, 0xd1, 0x10, 0xaa, 0x6b, 0xaf, 0x60, 0x21, 0x17,
+  0xdc, 0x49, 0x99, 0x60, 0xbe, 0xd0, 0x39, 0xb5, 0x22, 0x1d, 0xcc, 0x0b, 0x40, 0x01, 0x11, 0x3b,
+  0xaa, 0x35, 0xfe, 0x1e, 0x93, 0xc6, 0xf0, 0x86, 0x50, 0x17, 0xcc, 0xe1, 0xbf, 0x78, 0xaf, 0x5c,
+  0xcd, 0x10, 0x46, 0x89, 0x62, 0x2b, 0x6a, 0x6c, 0xde, 0x36, 0x65, 0xcb, 0x80, 0x59, 0x65, 0x67,
+  0xb7, 0x1f, 0x18, 0xbe, 0x36, 0xd7, 0xee, 0x15, 0x00, 0xe1, 0x9b, 0xa0, 0xb0, 0x69, 0xe2, 0x71,
+  0x01, 0xe4, 0x30, 0xbc, 0xf1, 0x74, 0x9b, 0xe0, 0x71, 0x3a, 0xae, 0x82, 0x65, 0xe3, 0x56, 0x7b,
+  0xa7, 0x87, 0xf4, 0x3b, 0x67, 0x47, 0xd8, 0x88, 0xc1, 0x3e, 0xf8, 0x75, 0xf7, 0x09, 0x34, 0x2d,
+  0x83, 0x7d, 0x8c, 0x51, 0x5b, 0xf7, 0x6b, 0x38, 0xba, 0x83, 0xa4, 0xc6, 0x46, 0x60, 0x6f, 0x47,
+  0xcb, 0x8f, 0x0b, 0x01, 0xa1, 0x7d, 0xc6, 0x3d, 0x54, 0x22, 0x70, 0x77, 0xe5, 0x11, 0xe7, 0x9d,
+  0x25, 0xa0, 0x16, 0x16, 0xf8, 0xac, 0x49, 0xc0, 0x6f, 0x8e, 0xd2, 0xde, 0x3d, 0xde, 0x59, 0x91,
+  0xad, 0x25, 0xec, 0x61, 0x32, 0x50, 0x0c, 0xaf, 0x0d, 0x48, 0x06, 0xea, 0x1d, 0x33, 0x79, 0x00,
+  0xd7, 0x39, 0x0d, 0x82, 0x00, 0xe4, 0x7c, 0x28, 0xfd, 0xa0, 0x4d, 0x72, 0xb1, 0x67, 0xb1, 0xf5,
+  0x9e, 0x75, 0x41, 0x06, 0x07, 0xa3, 0x6b, 0x37, 0x52, 0xa7, 0x38, 0xe4, 0x2e, 0x9a, 0x8e, 0x76,
+  0xdd, 0x82, 0xfc, 0x48, 0x68, 0x93, 0x49, 0x87, 0x0c, 0x7b, 0xa8, 0x7a, 0xd9, 0x3b, 0xe8, 0x6e,
+  0x1a, 0xdd, 0x7d, 0x56, 0xe0, 0xb5, 0x07, 0x7f, 0x60, 0xab, 0x03, 0x71, 0xa1, 0x21, 0x0a, 0x31,
+  0xb8, 0xb5, 0x35, 0xb6, 0x97, 0xbb, 0xec, 0xd9, 0x42, 0x65, 0x01, 0x3e, 0x2f, 0xc0, 0x8e, 0xd7,
+  0xef, 0xcf, 0xd7, 0xe4, 0xf0, 0xde, 0xf2, 0x42, 0xe4, 0x89, 0xa2, 0xf8, 0x88, 0xef, 0x02, 0x14,
+  0xc0, 0x87, 0x82, 0x77, 0x82, 0xf4, 0x65, 0x93, 0x5d, 0xcc, 0x45, 0x41, 0xc1, 0x47, 0x08, 0x24,
+  0x80, 0x7b, 0x2e, 0x70, 0x71, 0x71, 0x94, 0x7a, 0xbf, 0xed, 0xd6, 0xf6, 0x59, 0x42, 0x0f, 0x31,
+  0x75, 0xc9, 0xc8, 0xf7, 0xfd, 0xda, 0xd3, 0x03, 0xb6, 0x70, 0xd9, 0xc6, 0xc2, 0x6d, 0xa8, 0x1d,
+  0xed, 0xc3, 0xa3, 0xd3, 0x57, 0xc0, 0xe4, 0xc7, 0x51, 0xb3, 0x64, 0x05, 0xe0, 0xc9, 0xbe, 0x5d,
+  0x8e, 0x6e, 0xc2, 0x0c, 0xc6, 0x9a, 0xaa, 0x9e, 0x79, 0x13, 0xad, 0xe5, 0x63, 0x0a, 0x33, 0x0e,
+  0x4f, 0xb6, 0x0f, 0xe0, 0x9b, 0xd6, 0xa7, 0x08, 0xf5, 0x21, 0x69, 0x75, 0xc3, 0x60, 0xba, 0xa0,
+  0x3b, 0x61, 0xcd, 0x08, 0xb8, 0x54, 0xb2, 0x00, 0x9d, 0x3c, 0x54, 0x74, 0x4d, 0xcd, 0xa3, 0x78,
+  0xf2, 0x5d, 0x1c, 0x3e, 0x5c, 0x34, 0x59, 0x50, 0x56, 0xcb, 0xef, 0x39, 0xb5, 0xc9, 0xc6, 0xf9,
+  0xd1, 0x78, 0x44, 0x43, 0x88, 0x0f, 0x40, 0xfe, 0x39, 0x63, 0x0c, 0x27, 0xb3, 0x25, 0x59, 0x58,
+  0x7b, 0xe7, 0xfd, 0x9f, 0x7f, 0x1a, 0x25, 0x83, 0xfa, 0x82, 0x3a, 0x9d, 0xaf, 0xfb, 0x5b, 0x2a,
+  0x6c, 0x9d, 0xcc, 0xc8, 0xb0, 0xa5, 0xed, 0xf1, 0xe4, 0x0a, 0x32, 0xa0, 0x47, 0xac, 0x36, 0x19,
+  0xf5, 0xdc, 0x94, 0x85, 0x67, 0x54, 0xfd, 0x7c, 0x82, 0x2b, 0xd1, 0x3d, 0xdf, 0xba, 0xee, 0xa9,
+  0xff, 0x2f, 0x7e, 0x9a, 0x0e, 0xfd, 0xfb, 0x0b, 0x00, 0x00,
+};
@@ -0,0 +1,41 @@
+/***************************************************************
+ * Decode error statistics
+ *
+ * Counts every notification frame per fridge address and
+ * FridgeDecodeResult_t reason, and keeps a few offending
+ * frames per reason (reservoir sampled, so they represent
+ * the whole run rather than the first or last failures).
+ * Bad-checksum and too-short counts point at the radio;
+ * wrong-opcode counts point at a protocol variant the
+ * parser does not handle yet.
+ *
+ * Only loop() calls into this module.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fridge_protocol.h"
+
+#define DECODE_STATS_MAX_DEVICES 4      // least recently used address is replaced
+#define DECODE_SAMPLES_PER_REASON 3
+#define DECODE_SAMPLE_MAX_LEN 32        // longer frames are stored truncated
+
+/** --------------------------------------------------
+ * Counts one frame from the fridge at 'address'.
+ * -------------------------------------------------- */
+void decodeStatsRecord(const uint8_t address[6], FridgeDecodeResult_t result,
+                       const uint8_t* frame, size_t length);
+
+/** --------------------------------------------------
+ * Frames of 'result' seen from 'address' so far.
+ * -------------------------------------------------- */
+uint32_t decodeStatsCount(const uint8_t address[6], FridgeDecodeResult_t result);
+
+/** --------------------------------------------------
+ * Prints the counters and sampled frames of every device
+ * to Serial (the 'decode' console command).
+ * -------------------------------------------------- */
+void decodeStatsPrint();
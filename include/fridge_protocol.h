@@ -0,0 +1,206 @@
+/***************************************************************
+ * WT-0001 / Alpicool BLE protocol
+ *
+ * Frame layout, checksum, status decoding and command
+ * builders. Plain C++ without Arduino dependencies so the
+ * same code can be used by host-side tools.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/** --------------------------------------------------
+ * Data structure for a single-zone fridge query result
+ * (after decoding the BLE response).
+ * -------------------------------------------------- */
+struct FridgeStatus_t {
+  bool locked;
+  bool poweredOn;
+  uint8_t runMode;     // 0=MAX, 1=ECO
+  uint8_t batSaver;    // 0=Low, 1=Mid, 2=High
+  int8_t  leftTarget;
+  int8_t  tempMax;
+  int8_t  tempMin;
+  uint8_t leftRetDiff;
+  uint8_t startDelay;
+  uint8_t unit;        // 0 = Celsius, 1 = Fahrenheit
+  int8_t  leftTCHot;
+  int8_t  leftTCMid;
+  int8_t  leftTCCold;
+  int8_t  leftTCHalt;
+  int8_t  leftCurrent;
+  uint8_t batPercent;
+  uint8_t batVolInt;
+  uint8_t batVolDec;
+};
+
+/** --------------------------------------------------
+ * Function: Calculates a simple checksum for standard
+ * "FE FE" frames.
+ * -------------------------------------------------- */
+inline uint16_t calculateChecksum(const uint8_t* buf, size_t len) {
+  uint32_t sum = 0;
+  for (size_t i = 0; i < len; i++) {
+    sum += buf[i];
+  }
+  return (uint16_t)(sum & 0xFFFF);
+}
+
+/** --------------------------------------------------
+ * Why a frame did not decode. The reasons separate radio
+ * trouble (short, bad header, bad checksum) from frames
+ * that are intact but not what we parse (wrong opcode).
+ * -------------------------------------------------- */
+enum FridgeDecodeResult_t {
+  DECODE_OK = 0,
+  DECODE_TOO_SHORT,      // fewer than 24 bytes
+  DECODE_BAD_HEADER,     // no FE FE preamble
+  DECODE_WRONG_OPCODE,   // intact (checksum ok), but not a query response
+  DECODE_BAD_CHECKSUM,   // bytes changed in flight
+  DECODE_RESULT_COUNT
+};
+
+inline const char* decodeResultName(FridgeDecodeResult_t result) {
+  switch (result) {
+    case DECODE_OK:           return "ok";
+    case DECODE_TOO_SHORT:    return "too_short";
+    case DECODE_BAD_HEADER:   return "bad_header";
+    case DECODE_WRONG_OPCODE: return "wrong_opcode";
+    case DECODE_BAD_CHECKSUM: return "bad_checksum";
+    default:                  return "?";
+  }
+}
+
+/** --------------------------------------------------
+ * Function: Decodes a "query response" frame (0x01)
+ *   FE FE [length] [0x01] [payload] [2-byte checksum]
+ * For a single-zone fridge (18 bytes payload). status is
+ * only written for DECODE_OK.
+ * -------------------------------------------------- */
+inline FridgeDecodeResult_t decodeFridgeQuery(const uint8_t* data, size_t length, FridgeStatus_t &status) {
+  // Minimum length ~24 bytes: FE FE + length + code + 18 payload + 2 checksum
+  if (length < 24) return DECODE_TOO_SHORT;
+  if (data[0] != 0xFE || data[1] != 0xFE) return DECODE_BAD_HEADER;
+
+  // Last 2 bytes = checksum. Checked before the opcode, so a
+  // corrupted byte 3 counts as corruption, not as a variant
+  uint16_t offsetSum = length - 2;
+  uint16_t sumPacket = (data[offsetSum] << 8) | data[offsetSum + 1];
+  uint16_t sumCalc = calculateChecksum(data, offsetSum);
+  if (sumCalc != sumPacket) return DECODE_BAD_CHECKSUM;
+
+  // data[2] is the declared length; some firmwares count differently, so it is not checked
+  if (data[3] != 0x01) return DECODE_WRONG_OPCODE;
+
+  // Payload: bytes 4..21 (18 bytes)
+  const uint8_t* payload = &data[4];
+
+  status.locked       = (payload[0] == 1);
+  status.poweredOn    = (payload[1] == 1);
+  status.runMode      = payload[2];
+  status.batSaver     = payload[3];
+  status.leftTarget   = (int8_t)payload[4];
+  status.tempMax      = (int8_t)payload[5];
+  status.tempMin      = (int8_t)payload[6];
+  status.leftRetDiff  = payload[7];
+  status.startDelay   = payload[8];
+  status.unit         = payload[9];
+  status.leftTCHot    = (int8_t)payload[10];
+  status.leftTCMid    = (int8_t)payload[11];
+  status.leftTCCold   = (int8_t)payload[12];
+  status.leftTCHalt   = (int8_t)payload[13];
+  status.leftCurrent  = (int8_t)payload[14];
+  status.batPercent   = payload[15];
+  status.batVolInt    = payload[16];
+  status.batVolDec    = payload[17];
+
+  return DECODE_OK;
+}
+
+/** --------------------------------------------------
+ * Function: Same as decodeFridgeQuery(), for callers that
+ * only need to know whether it worked.
+ * -------------------------------------------------- */
+inline bool decodeFridgeQuerySingleZone(const uint8_t* data, size_t length, FridgeStatus_t &status) {
+  return decodeFridgeQuery(data, length, status) == DECODE_OK;
+}
+
+/** --------------------------------------------------
+ * Function: buildQueryCommand
+ *   In my scenario: FEFE03010200
+ * -------------------------------------------------- */
+inline void buildQueryCommand(std::vector<uint8_t> &packet) {
+  // Using the literal bytes: FE FE 03 01 02 00
+  packet.clear();
+  packet.push_back(0xFE);
+  packet.push_back(0xFE);
+  packet.push_back(0x03);
+  packet.push_back(0x01);
+  packet.push_back(0x02);
+  packet.push_back(0x00);
+}
+
+/** --------------------------------------------------
+ * Function: buildBindCommand
+ *   In my scenario: "FEFE03010200FF"
+ * -------------------------------------------------- */
+inline void buildBindCommand(std::vector<uint8_t> &packet) {
+  // Using the literal bytes: FE FE 03 01 02 00 FF
+  packet.clear();
+  packet.push_back(0xFE);
+  packet.push_back(0xFE);
+  packet.push_back(0x03);
+  packet.push_back(0x01);
+  packet.push_back(0x02);
+  packet.push_back(0x00);
+  packet.push_back(0xFF);
+}
+
+/** --------------------------------------------------
+ * Command opcodes (byte 3), as documented by
+ * BrassMonkeyFridgeMonitor.
+ * -------------------------------------------------- */
+#define FRIDGE_CMD_SET_OTHER 0x02    // every setting of a single-zone fridge
+#define FRIDGE_CMD_SET_LEFT 0x05     // target temperature only
+
+/** --------------------------------------------------
+ * Function: finishCommand
+ *   FE FE [length] [opcode] [data...] [2-byte checksum]:
+ *   fills in the length (opcode, data and checksum) and
+ *   appends the checksum.
+ * -------------------------------------------------- */
+inline void finishCommand(std::vector<uint8_t> &packet) {
+  packet[2] = (uint8_t)(packet.size() - 1);
+  uint16_t sum = calculateChecksum(packet.data(), packet.size());
+  packet.push_back((uint8_t)(sum >> 8));
+  packet.push_back((uint8_t)(sum & 0xFF));
+}
+
+/** --------------------------------------------------
+ * Function: buildSetTargetCommand
+ *   FE FE 04 05 [target] [checksum]
+ * -------------------------------------------------- */
+inline void buildSetTargetCommand(std::vector<uint8_t> &packet, int8_t target) {
+  packet.assign({ 0xFE, 0xFE, 0x00, FRIDGE_CMD_SET_LEFT, (uint8_t)target });
+  finishCommand(packet);
+}
+
+/** --------------------------------------------------
+ * Function: buildSetOtherCommand
+ *   Writes back the settings part of a status (the
+ *   query payload up to leftTCHalt), so one field is
+ *   changed by sending the last status with that field
+ *   modified. 20 bytes.
+ * -------------------------------------------------- */
+inline void buildSetOtherCommand(std::vector<uint8_t> &packet, const FridgeStatus_t &s) {
+  packet.assign({ 0xFE, 0xFE, 0x00, FRIDGE_CMD_SET_OTHER,
+                  (uint8_t)s.locked, (uint8_t)s.poweredOn, s.runMode, s.batSaver,
+                  (uint8_t)s.leftTarget, (uint8_t)s.tempMax, (uint8_t)s.tempMin,
+                  s.leftRetDiff, s.startDelay, s.unit,
+                  (uint8_t)s.leftTCHot, (uint8_t)s.leftTCMid, (uint8_t)s.leftTCCold,
+                  (uint8_t)s.leftTCHalt });
+  finishCommand(packet);
+}
@@ -0,0 +1,348 @@
+/***************************************************************
+ * Home Assistant MQTT discovery
+ *
+ * Describes the fridge to Home Assistant as seven entities:
+ * temperature, battery % and voltage (sensors), target
+ * (number), mode (select), lock and power (switches). Each
+ * gets a retained config message under
+ *
+ *   homeassistant/<component>/<node>/<entity>/config
+ *
+ * and its own retained state topic <base>/ha/<entity>.
+ * States are published only when the value changes, so a
+ * steady fridge costs one message per changed entity rather
+ * than seven per query, and a state topic always holds the
+ * last value for Home Assistant to pick up after a restart.
+ * The voltage is published on every 0.1 V step: a wider
+ * deadband would hide a large part of a 12 V battery's
+ * usable range ('fridgetool hatest' measures the resulting
+ * rate).
+ *
+ * Discovery is sent once per broker connection, as soon as
+ * a reading is there (the temperature unit and the target
+ * range come from the fridge), followed by every state.
+ * It is sent again if the unit or range changes.
+ *
+ * All commands arrive on one topic, <base>/ha/set, as
+ * "<entity>=<value>" (built by each entity's command
+ * template) and become the fridge's own set frames
+ * (fridge_protocol.h). <base>/ha/availability is "online"
+ * while readings are fresh; the broker sets it "offline"
+ * (last will) when the gateway drops off.
+ *
+ * Plain C++ without Arduino dependencies, shared with
+ * 'fridgetool hatest'.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "fridge_protocol.h"
+
+#define HA_DISCOVERY_PREFIX "homeassistant"
+#define HA_TOPIC_MAX_LEN 96
+#define HA_DISCOVERY_MAX_LEN 640      // longest config message
+#define HA_NODE_LEN 24
+#define HA_ERROR_LEN 64
+
+enum HaEntityId_t : uint8_t {
+  HA_TEMPERATURE = 0,
+  HA_TARGET,
+  HA_BATTERY,
+  HA_VOLTAGE,
+  HA_MODE,
+  HA_LOCK,
+  HA_POWER,
+  HA_ENTITY_COUNT
+};
+
+/** --------------------------------------------------
+ * One entity. 'extra' is the component-specific part of
+ * the config message; %U in it becomes the temperature
+ * unit, %L / %H the target range. Keys use the
+ * abbreviations Home Assistant accepts, to keep the
+ * retained messages small.
+ * -------------------------------------------------- */
+struct HaEntity_t {
+  const char* object;       // topic level and command key
+  const char* component;
+  const char* name;
+  const char* extra;
+  uint8_t deadband;         // publish only when the value moved this much
+};
+
+static const HaEntity_t HA_ENTITIES[HA_ENTITY_COUNT] = {
+  { "temperature", "sensor", "Temperature",
+    "\"dev_cla\":\"temperature\",\"stat_cla\":\"measurement\",\"unit_of_meas\":\"%U\"", 0 },
+  { "target", "number", "Target",
+    "\"dev_cla\":\"temperature\",\"unit_of_meas\":\"%U\",\"min\":%L,\"max\":%H,\"step\":1,"
+    "\"cmd_t\":\"~/ha/set\",\"cmd_tpl\":\"target={{value|int}}\"", 0 },
+  { "battery", "sensor", "Battery",
+    "\"dev_cla\":\"battery\",\"stat_cla\":\"measurement\",\"unit_of_meas\":\"%\"", 0 },
+  { "voltage", "sensor", "Voltage",
+    "\"dev_cla\":\"voltage\",\"stat_cla\":\"measurement\",\"unit_of_meas\":\"V\"", 1 },
+  { "mode", "select", "Mode",
+    "\"ops\":[\"MAX\",\"ECO\"],\"cmd_t\":\"~/ha/set\",\"cmd_tpl\":\"mode={{value}}\"", 0 },
+  { "lock", "switch", "Lock",
+    "\"ic\":\"mdi:lock\",\"stat_on\":\"ON\",\"stat_off\":\"OFF\",\"cmd_t\":\"~/ha/set\","
+    "\"pl_on\":\"lock=ON\",\"pl_off\":\"lock=OFF\"", 0 },
+  { "power", "switch", "Power",
+    "\"ic\":\"mdi:power\",\"stat_on\":\"ON\",\"stat_off\":\"OFF\",\"cmd_t\":\"~/ha/set\","
+    "\"pl_on\":\"power=ON\",\"pl_off\":\"power=OFF\"", 0 },
+};
+
+/** --------------------------------------------------
+ * Sends one message to a full topic name. Returns false
+ * if it did not go out (it is then retried).
+ * -------------------------------------------------- */
+typedef bool (*HaPublishFn)(void* ctx, const char* topic, const char* payload, bool retain);
+
+struct HaStats_t {
+  uint32_t discovery;       // config messages
+  uint32_t states;          // state messages
+  uint32_t availability;
+  uint32_t commands;
+  uint32_t rejected;
+  uint32_t failures;
+  uint32_t perEntity[HA_ENTITY_COUNT];
+  uint64_t bytes;           // topic + payload, everything sent
+};
+
+struct HaPublisher_t {
+  HaPublishFn publish;
+  void* ctx;
+  char base[32];            // "fridge/<chip id>"
+  char node[HA_NODE_LEN];   // "fridge_<chip id>"
+  const char* firmware;
+  bool discoveryPending;    // set on connect
+  uint8_t unit;             // what the last discovery was built with
+  int8_t tempMin, tempMax;
+  uint8_t statePending;     // entities to publish regardless of value
+  int32_t last[HA_ENTITY_COUNT];
+  int8_t available;         // -1 = not published on this connection
+  HaStats_t stats;
+};
+
+inline void haBegin(HaPublisher_t &p, const char* base, const char* firmware, HaPublishFn publish, void* ctx) {
+  memset(&p, 0, sizeof(p));
+  p.publish = publish;
+  p.ctx = ctx;
+  p.firmware = firmware;
+  strncpy(p.base, base, sizeof(p.base) - 1);
+  // The node id is the chip id part of the base topic
+  const char* id = strrchr(base, '/');
+  snprintf(p.node, sizeof(p.node), "fridge_%s", id != nullptr ? id + 1 : base);
+  p.available = -1;
+}
+
+/** --------------------------------------------------
+ * After every (re)connect: discovery, all states and the
+ * availability go out again, in case the broker lost its
+ * retained messages.
+ * -------------------------------------------------- */
+inline void haConnected(HaPublisher_t &p) {
+  p.discoveryPending = true;
+  p.statePending = (1u << HA_ENTITY_COUNT) - 1;
+  p.available = -1;
+}
+
+/** --------------------------------------------------
+ * The value an entity is compared and published by.
+ * -------------------------------------------------- */
+inline int32_t haEntityValue(HaEntityId_t id, const FridgeStatus_t &s) {
+  switch (id) {
+    case HA_TEMPERATURE: return s.leftCurrent;
+    case HA_TARGET:      return s.leftTarget;
+    case HA_BATTERY:     return s.batPercent;
+    case HA_VOLTAGE:     return s.batVolInt * 10 + s.batVolDec;  // decivolts
+    case HA_MODE:        return s.runMode;
+    case HA_LOCK:        return s.locked;
+    case HA_POWER:       return s.poweredOn;
+    default:             return 0;
+  }
+}
+
+inline void haFormatState(HaEntityId_t id, int32_t value, char* buf, size_t size) {
+  switch (id) {
+    case HA_VOLTAGE: snprintf(buf, size, "%ld.%ld", (long)(value / 10), (long)(value % 10)); break;
+    case HA_MODE:    snprintf(buf, size, "%s", value == 1 ? "ECO" : "MAX"); break;
+    case HA_LOCK:
+    case HA_POWER:   snprintf(buf, size, "%s", value ? "ON" : "OFF"); break;
+    default:         snprintf(buf, size, "%ld", (long)value); break;
+  }
+}
+
+/** --------------------------------------------------
+ * The config message of one entity. Returns its length,
+ * or 0 if it did not fit.
+ * -------------------------------------------------- */
+inline size_t haFormatDiscovery(const HaPublisher_t &p, HaEntityId_t id, const char* deviceName,
+                                const FridgeStatus_t &s, char* buf, size_t size) {
+  const HaEntity_t &e = HA_ENTITIES[id];
+  int n = snprintf(buf, size,
+                   "{\"~\":\"%s\",\"name\":\"%s\",\"uniq_id\":\"%s_%s\",\"stat_t\":\"~/ha/%s\","
+                   "\"avty_t\":\"~/ha/availability\",",
+                   p.base, e.name, p.node, e.object, e.object);
+  if (n < 0 || (size_t)n >= size) return 0;
+  size_t len = (size_t)n;
+  for (const char* c = e.extra; *c != '\0'; c++) {
+    char piece[8] = { *c, '\0' };
+    const char* text = piece;
+    if (c[0] == '%' && c[1] == 'U') {
+      text = s.unit == 1 ? "\xC2\xB0" "F" : "\xC2\xB0" "C";
+      c++;
+    } else if (c[0] == '%' && (c[1] == 'L' || c[1] == 'H')) {
+      snprintf(piece, sizeof(piece), "%d", c[1] == 'L' ? s.tempMin : s.tempMax);
+      c++;
+    }
+    size_t tl = strlen(text);
+    if (len + tl >= size) return 0;
+    memcpy(buf + len, text, tl);
+    len += tl;
+  }
+  // The name is free text from the remote configuration
+  char name[32];
+  size_t i = 0;
+  for (; deviceName[i] != '\0' && i < sizeof(name) - 1; i++) {
+    name[i] = deviceName[i] == '"' || deviceName[i] == '\\' ? '\'' : deviceName[i];
+  }
+  name[i] = '\0';
+  n = snprintf(buf + len, size - len,
+               ",\"dev\":{\"ids\":\"%s\",\"name\":\"%s\",\"mf\":\"Alpicool\",\"mdl\":\"BLE fridge\",\"sw\":\"%s\"}}",
+               p.node, name, p.firmware);
+  if (n < 0 || (size_t)n >= size - len) return 0;
+  return len + (size_t)n;
+}
+
+inline bool haSend(HaPublisher_t &p, const char* topic, const char* payload) {
+  if (!p.publish(p.ctx, topic, payload, true)) {
+    p.stats.failures++;
+    return false;
+  }
+  p.stats.bytes += strlen(topic) + strlen(payload);
+  return true;
+}
+
+/** --------------------------------------------------
+ * Publishes whatever is due for the latest status; cheap
+ * to call every loop, an unchanged status sends nothing.
+ * 'status' is null before the first reading, 'fresh'
+ * drives the availability topic. A failed publish stops
+ * the pass and is retried by the next one. Returns the
+ * number of messages sent.
+ * -------------------------------------------------- */
+inline uint32_t haUpdate(HaPublisher_t &p, const FridgeStatus_t* status, bool fresh, const char* deviceName) {
+  char topic[HA_TOPIC_MAX_LEN];
+  uint32_t sent = 0;
+
+  if (p.available != (int8_t)fresh) {
+    snprintf(topic, sizeof(topic), "%s/ha/availability", p.base);
+    if (!haSend(p, topic, fresh ? "online" : "offline")) return sent;
+    p.available = (int8_t)fresh;
+    p.stats.availability++;
+    sent++;
+  }
+  if (status == nullptr) return sent;
+  const FridgeStatus_t &s = *status;
+
+  // Discovery carries the unit and target range: resend if they change
+  if (!p.discoveryPending && (s.unit != p.unit || s.tempMin != p.tempMin || s.tempMax != p.tempMax)) {
+    p.discoveryPending = true;
+  }
+  if (p.discoveryPending) {
+    static char payload[HA_DISCOVERY_MAX_LEN];
+    for (uint8_t i = 0; i < HA_ENTITY_COUNT; i++) {
+      const HaEntity_t &e = HA_ENTITIES[i];
+      snprintf(topic, sizeof(topic), HA_DISCOVERY_PREFIX "/%s/%s/%s/config", e.component, p.node, e.object);
+      if (haFormatDiscovery(p, (HaEntityId_t)i, deviceName, s, payload, sizeof(payload)) == 0) continue;
+      if (!haSend(p, topic, payload)) return sent;
+      p.stats.discovery++;
+      sent++;
+    }
+    p.discoveryPending = false;
+    p.unit = s.unit;
+    p.tempMin = s.tempMin;
+    p.tempMax = s.tempMax;
+  }
+
+  for (uint8_t i = 0; i < HA_ENTITY_COUNT; i++) {
+    const HaEntity_t &e = HA_ENTITIES[i];
+    int32_t value = haEntityValue((HaEntityId_t)i, s);
+    bool pending = p.statePending & (1u << i);
+    long moved = labs((long)(value - p.last[i]));
+    if (!pending && moved < (e.deadband ? e.deadband : 1)) continue;
+    char payload[12];
+    haFormatState((HaEntityId_t)i, value, payload, sizeof(payload));
+    snprintf(topic, sizeof(topic), "%s/ha/%s", p.base, e.object);
+    if (!haSend(p, topic, payload)) return sent;
+    p.last[i] = value;
+    p.statePending &= ~(1u << i);
+    p.stats.states++;
+    p.stats.perEntity[i]++;
+    sent++;
+  }
+  return sent;
+}
+
+/** --------------------------------------------------
+ * Turns a "<entity>=<value>" command into the fridge
+ * frame that carries it. 'current' holds the settings the
+ * fridge will have once everything already queued is
+ * applied: a set-other frame writes every setting, so it
+ * must start from those. On success the command's change
+ * is applied to 'current' as well, so a command queued
+ * right after this one keeps it.
+ * -------------------------------------------------- */
+inline bool haBuildCommand(const char* payload, size_t len, FridgeStatus_t &current,
+                           std::vector<uint8_t> &packet, char* error, size_t size) {
+  char text[32];
+  if (len >= sizeof(text)) {
+    snprintf(error, size, "command too long");
+    return false;
+  }
+  memcpy(text, payload, len);
+  text[len] = '\0';
+  char* value = strchr(text, '=');
+  if (value == nullptr) {
+    snprintf(error, size, "expected <entity>=<value>");
+    return false;
+  }
+  *value++ = '\0';
+
+  FridgeStatus_t s = current;
+  bool on = strcmp(value, "ON") == 0;
+  bool isSwitch = on || strcmp(value, "OFF") == 0;
+  if (strcmp(text, "target") == 0) {
+    char* end;
+    long t = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || t < current.tempMin || t > current.tempMax) {
+      snprintf(error, size, "target: '%s' outside %d..%d", value, current.tempMin, current.tempMax);
+      return false;
+    }
+    buildSetTargetCommand(packet, (int8_t)t);
+    current.leftTarget = (int8_t)t;
+    return true;
+  } else if (strcmp(text, "mode") == 0) {
+    if (strcmp(value, "MAX") == 0) s.runMode = 0;
+    else if (strcmp(value, "ECO") == 0) s.runMode = 1;
+    else {
+      snprintf(error, size, "mode: '%s' is not MAX or ECO", value);
+      return false;
+    }
+  } else if ((strcmp(text, "lock") == 0 || strcmp(text, "power") == 0) && isSwitch) {
+    if (text[0] == 'l') s.locked = on;
+    else s.poweredOn = on;
+  } else {
+    snprintf(error, size, "unknown command '%s=%s'", text, value);
+    return false;
+  }
+  buildSetOtherCommand(packet, s);
+  current = s;
+  return true;
+}
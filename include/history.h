@@ -0,0 +1,136 @@
+/***************************************************************
+ * Status history
+ *
+ * A RAM ring of compact per-reading records (24 h at one
+ * reading per minute). Records are addressed by a sequence
+ * number that keeps counting across ring wrap-around, so a
+ * reader can resume where it stopped and detect records it
+ * lost to overwriting.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fridge_protocol.h"
+
+#define HISTORY_CAPACITY 1440
+// Records examined per hold of the history lock by historyCopyRange()
+#define HISTORY_SCAN_PER_LOCK 64
+
+// Binary export format: a HistoryHeader_t followed by HistoryRecord_t's
+#define HISTORY_MAGIC   0x4846  // "FH"
+#define HISTORY_VERSION 1
+
+// Serial export framing (the 'export' console command). Log lines
+// from other tasks can land between frames but never inside one (each
+// frame is a single write), so a reader scans for the sync bytes and
+// drops any frame whose checksum does not match:
+//   A5 5A <u16 length> <length bytes> <u16 historyFrameChecksum>
+// A frame of length 0 ends the export.
+#define HISTORY_FRAME_SYNC0    0xA5
+#define HISTORY_FRAME_SYNC1    0x5A
+#define HISTORY_FRAME_OVERHEAD 6
+#define HISTORY_FRAME_MAX_LEN  1024
+
+/** --------------------------------------------------
+ * Fletcher-16 over the length bytes and the payload of
+ * an export frame.
+ * -------------------------------------------------- */
+inline uint16_t historyFrameChecksum(const uint8_t* payload, size_t len) {
+  uint16_t a = 0, b = 0;
+  uint8_t lenBytes[2] = { (uint8_t)(len & 0xFF), (uint8_t)(len >> 8) };
+  for (size_t i = 0; i < 2 + len; i++) {
+    a = (a + (i < 2 ? lenBytes[i] : payload[i - 2])) % 255;
+    b = (b + a) % 255;
+  }
+  return (uint16_t)((b << 8) | a);
+}
+
+/** --------------------------------------------------
+ * One stored reading (little endian, 10 bytes).
+ * -------------------------------------------------- */
+struct __attribute__((packed)) HistoryRecord_t {
+  uint32_t time;           // seconds since boot at notify time
+  int8_t   leftCurrent;
+  int8_t   leftTarget;
+  uint8_t  batPercent;
+  uint8_t  flags;          // HISTORY_FLAG_*
+  uint16_t batMillivolts;
+};
+
+#define HISTORY_FLAG_LOCKED     0x01
+#define HISTORY_FLAG_POWERED    0x02
+#define HISTORY_FLAG_ECO        0x04
+#define HISTORY_FLAG_FAHRENHEIT 0x08
+
+/** --------------------------------------------------
+ * Export header (little endian, 8 bytes).
+ * -------------------------------------------------- */
+struct __attribute__((packed)) HistoryHeader_t {
+  uint16_t magic;          // HISTORY_MAGIC
+  uint8_t  version;        // HISTORY_VERSION
+  uint8_t  recordSize;     // sizeof(HistoryRecord_t)
+  uint32_t deviceTime;     // seconds since boot when the export started
+};
+
+/** --------------------------------------------------
+ * Builds a record from a decoded status.
+ * -------------------------------------------------- */
+HistoryRecord_t historyMakeRecord(const FridgeStatus_t &status, uint32_t time);
+
+/** --------------------------------------------------
+ * Appends a record, overwriting the oldest when full.
+ * -------------------------------------------------- */
+void historyAppend(const HistoryRecord_t &record);
+
+/** --------------------------------------------------
+ * Sequence numbers currently held: [first, end).
+ * -------------------------------------------------- */
+void historyBounds(uint32_t &firstSeq, uint32_t &endSeq);
+
+/** --------------------------------------------------
+ * Copies whole records with from <= time <= to into buf,
+ * starting at sequence number *cursor (bumped to the
+ * oldest record still held if it was overwritten) and
+ * advancing it past every record examined. Returns the
+ * number of bytes written; 0 once the range is exhausted
+ * (or if maxLen cannot hold one record). Safe to call
+ * from another task than historyAppend(); the lock is
+ * held for at most HISTORY_SCAN_PER_LOCK records.
+ * -------------------------------------------------- */
+size_t historyCopyRange(uint32_t from, uint32_t to, uint32_t &cursor, uint8_t* buf, size_t maxLen);
+
+/** --------------------------------------------------
+ * State of one range export. The same streamer feeds the
+ * HTTP endpoint and the Serial command; memory use is this
+ * struct plus the caller's chunk buffer, whatever the range.
+ * -------------------------------------------------- */
+struct HistoryExport_t {
+  uint32_t from;
+  uint32_t to;
+  uint32_t cursor;
+  bool headerSent;
+  bool done;               // every record of the range was sent
+  size_t bytesSent;
+  unsigned long startMillis;
+  // Heap low-water mark while the export was in flight, sampled by
+  // the caller on every chunk (0 if it doesn't)
+  uint32_t heapAtStart;
+  uint32_t heapLowest;
+  uint32_t largestBlockLowest;
+};
+
+/** --------------------------------------------------
+ * Starts an export of records with from <= time <= to.
+ * -------------------------------------------------- */
+void historyExportBegin(HistoryExport_t &exp, uint32_t from, uint32_t to);
+
+/** --------------------------------------------------
+ * Fills buf with the next part of the export (header
+ * first, then whole records). Returns 0 when done, and
+ * also when buf is too small for the next piece (header
+ * or one record); exp.done tells the two apart.
+ * -------------------------------------------------- */
+size_t historyExportChunk(HistoryExport_t &exp, uint8_t* buf, size_t maxLen);
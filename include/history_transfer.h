@@ -0,0 +1,185 @@
+/***************************************************************
+ * Per-connection state of BLE history downloads
+ *
+ * Every phone that writes START to the history control
+ * characteristic gets its own transfer: cursor, credits,
+ * payload size (its MTU - 3) and statistics, keyed by the
+ * GATT connection id. loop() serves the ready transfers in
+ * turn and notifies each packet to its own phone only; a
+ * congested connection is skipped until the stack reports
+ * it clear again, so one slow phone does not hold up the
+ * others. The protocol itself is in ble_history_service.h.
+ *
+ * Plain C++ without Arduino dependencies; the caller holds
+ * its lock around every call (the control writes arrive on
+ * the BLE task, packets are sent from loop()).
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "history.h"
+#include "ble_history_service.h"
+
+#define HISTORY_XFER_MAX_CONN 4
+// Largest ATT MTU we negotiate; notifications carry MTU - 3 bytes
+#define HISTORY_MAX_MTU 517
+#define HISTORY_XFER_MIN_PAYLOAD 20
+#define HISTORY_XFER_MAX_PAYLOAD (HISTORY_MAX_MTU - 3)
+
+struct HistoryXfer_t {
+  bool inUse;                // slot belongs to connId
+  bool active;               // START received, end not sent yet
+  bool congested;            // the stack ran out of buffers for this link
+  uint16_t connId;
+  uint32_t generation;       // which START this transfer belongs to
+  uint32_t cursor;           // next record sequence number to send
+  uint32_t credits;          // notifications the phone still accepts
+  uint16_t payload;          // MTU - 3 of this phone
+  unsigned long startMillis;
+  uint32_t bytes;
+  uint32_t notifications;
+};
+
+struct HistoryXferTable_t {
+  HistoryXfer_t conns[HISTORY_XFER_MAX_CONN];
+  uint8_t next;              // round-robin position of historyXferPick()
+  uint32_t starts;           // START count, numbers the generations
+};
+
+// Copies whole records from *cursor on into buf (historyCopyRange() on
+// the device); returns the bytes written, 0 at the end of the history
+typedef size_t (*HistoryXferCopy)(uint32_t &cursor, uint8_t* buf, size_t maxLen);
+
+static inline uint32_t historyXferLe32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint16_t historyXferLe16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/** --------------------------------------------------
+ * The transfer of connId, or nullptr. With 'create' a
+ * free slot is taken for a new connection.
+ * -------------------------------------------------- */
+inline HistoryXfer_t* historyXferFind(HistoryXferTable_t &table, uint16_t connId, bool create) {
+  HistoryXfer_t* unused = nullptr;
+  for (size_t i = 0; i < HISTORY_XFER_MAX_CONN; i++) {
+    HistoryXfer_t &x = table.conns[i];
+    if (x.inUse && x.connId == connId) return &x;
+    if (!x.inUse && unused == nullptr) unused = &x;
+  }
+  if (!create || unused == nullptr) return nullptr;
+  memset(unused, 0, sizeof(*unused));
+  unused->inUse = true;
+  unused->connId = connId;
+  return unused;
+}
+
+/** --------------------------------------------------
+ * One write to the control characteristic. Returns false
+ * if it was malformed, or a START found every slot taken.
+ * -------------------------------------------------- */
+inline bool historyXferControl(HistoryXferTable_t &table, uint16_t connId, const uint8_t* data, size_t len,
+                               uint16_t mtu, unsigned long now) {
+  if (len == 0) return false;
+
+  if (data[0] == HISTORY_CTRL_START && len >= 7) {
+    HistoryXfer_t* x = historyXferFind(table, connId, true);
+    if (x == nullptr) return false;
+    int payload = (int)mtu - 3;
+    x->active = true;
+    x->generation = ++table.starts;
+    x->cursor = historyXferLe32(data + 1);
+    x->credits = historyXferLe16(data + 5);
+    x->payload = (uint16_t)(payload < HISTORY_XFER_MIN_PAYLOAD ? HISTORY_XFER_MIN_PAYLOAD :
+                            payload > HISTORY_XFER_MAX_PAYLOAD ? HISTORY_XFER_MAX_PAYLOAD : payload);
+    x->startMillis = now;
+    x->bytes = 0;
+    x->notifications = 0;
+    return true;
+  }
+
+  HistoryXfer_t* x = historyXferFind(table, connId, false);
+  if (data[0] == HISTORY_CTRL_CREDIT && len >= 3) {
+    if (x != nullptr) x->credits += historyXferLe16(data + 1);
+    return x != nullptr;
+  }
+  if (data[0] == HISTORY_CTRL_STOP) {
+    if (x != nullptr) x->active = false;
+    return x != nullptr;
+  }
+  return false;
+}
+
+inline void historyXferDisconnected(HistoryXferTable_t &table, uint16_t connId) {
+  HistoryXfer_t* x = historyXferFind(table, connId, false);
+  if (x != nullptr) x->inUse = false;
+}
+
+inline void historyXferCongested(HistoryXferTable_t &table, uint16_t connId, bool congested) {
+  HistoryXfer_t* x = historyXferFind(table, connId, false);
+  if (x != nullptr) x->congested = congested;
+}
+
+/** --------------------------------------------------
+ * Copies the next transfer that may send (active, has a
+ * credit, not congested), taking turns between phones.
+ * Returns false if none can.
+ * -------------------------------------------------- */
+inline bool historyXferPick(HistoryXferTable_t &table, HistoryXfer_t &out) {
+  for (size_t n = 0; n < HISTORY_XFER_MAX_CONN; n++) {
+    HistoryXfer_t &x = table.conns[(table.next + n) % HISTORY_XFER_MAX_CONN];
+    if (!x.inUse || !x.active || x.credits == 0 || x.congested) continue;
+    table.next = (uint8_t)((table.next + n + 1) % HISTORY_XFER_MAX_CONN);
+    out = x;
+    return true;
+  }
+  return false;
+}
+
+/** --------------------------------------------------
+ * Builds the next notification of 'x' (a copy from
+ * historyXferPick()): <u32 seq of first record> and as
+ * many whole records as the phone's payload holds. An
+ * overwritten cursor jumps to the oldest record held.
+ * Advances 'cursor' and returns the packet length; 4
+ * means no records, the end of the data.
+ * -------------------------------------------------- */
+inline size_t historyXferBuildPacket(const HistoryXfer_t &x, uint32_t &cursor, uint8_t* packet,
+                                     HistoryXferCopy copy) {
+  cursor = x.cursor;
+  size_t recordRoom = (size_t)(x.payload - 4) / sizeof(HistoryRecord_t) * sizeof(HistoryRecord_t);
+  size_t len = copy(cursor, packet + 4, recordRoom);
+  uint32_t firstSeq = cursor - (uint32_t)(len / sizeof(HistoryRecord_t));
+  packet[0] = firstSeq & 0xFF;
+  packet[1] = (firstSeq >> 8) & 0xFF;
+  packet[2] = (firstSeq >> 16) & 0xFF;
+  packet[3] = (firstSeq >> 24) & 0xFF;
+  return len + 4;
+}
+
+/** --------------------------------------------------
+ * The packet built from 'sent' went out. Unless the phone
+ * disconnected or restarted meanwhile (a START wins over
+ * what was just sent), the transfer moves on to 'cursor'.
+ * Returns true when that was the end of the data; 'done'
+ * then holds the final statistics.
+ * -------------------------------------------------- */
+inline bool historyXferSent(HistoryXferTable_t &table, const HistoryXfer_t &sent, uint32_t cursor,
+                            size_t packetLen, HistoryXfer_t &done) {
+  HistoryXfer_t* x = historyXferFind(table, sent.connId, false);
+  if (x == nullptr || x->generation != sent.generation || !x->active) return false;
+  x->cursor = cursor;
+  x->credits--;
+  x->bytes += (uint32_t)(packetLen - 4);
+  x->notifications++;
+  if (packetLen > 4) return false;
+  x->active = false;
+  done = *x;
+  return true;
+}
@@ -0,0 +1,49 @@
+/***************************************************************
+ * Home Assistant integration
+ *
+ * The device side of ha_discovery.h: publishes discovery,
+ * change-only retained states and availability through the
+ * shared MQTT connection, and turns commands from
+ * <base>/ha/set into fridge frames handed to the command
+ * queue. The 'ha' command reports the message rate.
+ *
+ * Only loop() calls into this module.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fridge_protocol.h"
+
+class Print;
+
+/** --------------------------------------------------
+ * Queues a frame for the fridge; false if it was not
+ * accepted (not connected, queue full).
+ * -------------------------------------------------- */
+typedef bool (*HomeAssistantCommandSink)(const uint8_t* data, size_t length);
+
+/** --------------------------------------------------
+ * Registers the topics, last will and connect handler.
+ * Call after mqttLinkBegin().
+ * -------------------------------------------------- */
+void homeAssistantBegin(const char* firmwareVersion, HomeAssistantCommandSink sink);
+
+/** --------------------------------------------------
+ * A new decoded reading.
+ * -------------------------------------------------- */
+void homeAssistantReading(const FridgeStatus_t &status);
+
+/** --------------------------------------------------
+ * Publishes what is due. Call every loop; 'fresh' is
+ * whether the last reading is within the freshness bound.
+ * -------------------------------------------------- */
+void homeAssistantLoop(bool fresh, const char* deviceName);
+
+/** --------------------------------------------------
+ * Messages sent, steady-state rate per hour and
+ * commands (the 'ha' command).
+ * -------------------------------------------------- */
+void homeAssistantPrint(Print &out);
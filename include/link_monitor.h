@@ -0,0 +1,294 @@
+/***************************************************************
+ * Link cadence, response timeouts, link score and the
+ * freshness SLO
+ *
+ * The timing decisions of the main loop: when the next
+ * query is due, when an unanswered query becomes a miss,
+ * when to sample RSSI, when a degrading link should be
+ * reconnected, and how fresh the published reading has
+ * been over the current window. Every function takes
+ * 'now' from the caller (clockMillis()) and only reports
+ * what happened; the BLE calls and the log lines stay in
+ * src/main.cpp.
+ *
+ * Plain C++ without Arduino dependencies; the firmware and
+ * 'fridgetool simulate' run the same code. Only loop()
+ * touches this state.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "remote_config.h"
+
+// We will send a "query" command every 60 seconds (remote)
+const unsigned long QUERY_INTERVAL_MS = 60000;
+
+// Freshness SLO: a reading counts as fresh while it is younger than
+// FRESHNESS_BOUND_MS. We want that to hold FRESHNESS_SLO_PERCENT of the
+// time, measured over windows of FRESHNESS_WINDOW_MS. (bound: remote)
+const unsigned long FRESHNESS_BOUND_MS = 2 * QUERY_INTERVAL_MS + 10000;
+const float FRESHNESS_SLO_PERCENT = 99.0f;
+const unsigned long FRESHNESS_WINDOW_MS = 3600000;
+
+// Link quality: RSSI is sampled every RSSI_SAMPLE_INTERVAL_MS and a query
+// without a notification after RESPONSE_TIMEOUT_MS counts as a miss.
+// If the score stays below LINK_SCORE_RECONNECT for LINK_LOW_SAMPLES samples
+// in a row we reconnect straight to the known address, before the
+// supervision timeout drops the link and forces a full re-scan. A low
+// RSSI alone is not enough: queries must be going unanswered, or the
+// RSSI average must have fallen LINK_RSSI_FALL_DB below its slow trend.
+// A weak but steady link is left alone. (interval, timeout and
+// threshold: remote; threshold 0 turns proactive reconnects off)
+const unsigned long RSSI_SAMPLE_INTERVAL_MS = 5000;
+const unsigned long RESPONSE_TIMEOUT_MS = 5000;
+const uint8_t LINK_SCORE_RECONNECT = 30;
+const uint8_t LINK_LOW_SAMPLES = 3;
+const float LINK_RSSI_FALL_DB = 4.0f;
+
+// After a proactive reconnect the next one waits at least the backoff.
+// It starts at the minimum and doubles, up to the maximum, every time a
+// reconnect did not help (the new link was low again before it scored
+// good once). A reconnect that helped resets it.
+const unsigned long LINK_RECONNECT_BACKOFF_MIN_MS = 60000;
+const unsigned long LINK_RECONNECT_BACKOFF_MAX_MS = 3600000;
+
+/** --------------------------------------------------
+ * Link-quality state for the connected fridge.
+ * -------------------------------------------------- */
+struct LinkQuality_t {
+  unsigned long lastQueryMillis;   // last time we queued a query
+  bool haveRssi;
+  float rssiAvg;                   // EWMA of sampled RSSI, dBm
+  float rssiTrend;                 // slow EWMA: what "falling" is judged against
+  unsigned long lastSampleMillis;
+  unsigned long querySentMillis;   // 0 = no response outstanding
+  uint8_t consecutiveMisses;       // timeouts + write failures since last response
+  uint8_t lowScoreSamples;
+  uint8_t score;                   // 0 (dead) .. 100 (excellent)
+  uint32_t writeFailures;
+  uint32_t responseTimeouts;
+  uint32_t proactiveReconnects;
+  // Proactive reconnect backoff; kept across connections
+  unsigned long lastReconnectMillis;
+  unsigned long reconnectBackoffMs;
+  bool reconnectOutcomePending;    // the last reconnect is not judged yet
+  bool lastReconnectHelped;
+  uint32_t reconnectsHeldOff;      // low long enough, but held back
+};
+
+enum LinkVerdict_t : uint8_t {
+  LINK_GOOD,        // score at or above the threshold
+  LINK_LOW,         // below it, not for long enough yet
+  LINK_HELD_OFF,    // below it for long enough, but steady or in backoff
+  LINK_RECONNECT    // below it for LINK_LOW_SAMPLES samples and degrading: reconnect now
+};
+
+/** --------------------------------------------------
+ * Freshness SLO monitor state (one window at a time).
+ * -------------------------------------------------- */
+struct FreshnessSlo_t {
+  unsigned long windowStartMillis;
+  unsigned long lastUpdateMillis;
+  unsigned long freshMs;     // time inside the window with a fresh reading
+  unsigned long totalMs;     // time elapsed inside the window
+  bool stale;                // current state of the reading
+  bool alertActive;          // window percentage is below the SLO
+  uint32_t staleEvents;      // fresh -> stale transitions in this window
+};
+
+// What one freshnessSloUpdate() call saw (bit mask)
+#define SLO_WENT_STALE   0x01
+#define SLO_FRESH_AGAIN  0x02
+#define SLO_ALERT        0x04
+#define SLO_RECOVERED    0x08
+#define SLO_WINDOW_END   0x10
+
+struct FreshnessReport_t {
+  uint8_t events;
+  float percent;             // window percentage (SLO_ALERT / _RECOVERED / _WINDOW_END)
+  uint32_t staleEvents;      // of the window that just ended (SLO_WINDOW_END)
+};
+
+/** --------------------------------------------------
+ * The link fields of the compile-time default
+ * configuration (see defaultConfig() in src/main.cpp).
+ * -------------------------------------------------- */
+inline void linkDefaultConfig(FridgeConfig_t &c) {
+  c.queryIntervalMs = QUERY_INTERVAL_MS;
+  c.freshnessBoundMs = FRESHNESS_BOUND_MS;
+  c.responseTimeoutMs = RESPONSE_TIMEOUT_MS;
+  c.rssiSampleIntervalMs = RSSI_SAMPLE_INTERVAL_MS;
+  c.linkScoreReconnect = LINK_SCORE_RECONNECT;
+}
+
+/** --------------------------------------------------
+ * New connection: the link statistics restart, lifetime
+ * counters stay, and the first query is due right away.
+ * -------------------------------------------------- */
+inline void linkConnected(LinkQuality_t &link, unsigned long now, const FridgeConfig_t &config) {
+  link.haveRssi = false;
+  link.lastSampleMillis = 0;
+  link.querySentMillis = 0;
+  link.consecutiveMisses = 0;
+  link.lowScoreSamples = 0;
+  link.score = 100;
+  link.lastQueryMillis = now - config.queryIntervalMs;
+}
+
+/** --------------------------------------------------
+ * True (and the cadence restarts) when the next query is
+ * due.
+ * -------------------------------------------------- */
+inline bool linkQueryDue(LinkQuality_t &link, unsigned long now, const FridgeConfig_t &config) {
+  if (now - link.lastQueryMillis < config.queryIntervalMs) return false;
+  link.lastQueryMillis = now;
+  return true;
+}
+
+inline void linkQuerySent(LinkQuality_t &link, unsigned long now) {
+  link.querySentMillis = now;
+}
+
+inline void linkWriteFailed(LinkQuality_t &link) {
+  link.writeFailures++;
+  link.consecutiveMisses++;
+}
+
+/** --------------------------------------------------
+ * Any answer proves the link is alive. Returns true with
+ * the round trip when a query was outstanding.
+ * -------------------------------------------------- */
+inline bool linkResponse(LinkQuality_t &link, unsigned long at, unsigned long &rttMs) {
+  bool outstanding = link.querySentMillis != 0;
+  if (outstanding) rttMs = at - link.querySentMillis;
+  link.querySentMillis = 0;
+  link.consecutiveMisses = 0;
+  return outstanding;
+}
+
+/** --------------------------------------------------
+ * True when the outstanding query just became a miss.
+ * -------------------------------------------------- */
+inline bool linkCheckTimeout(LinkQuality_t &link, unsigned long now, const FridgeConfig_t &config) {
+  if (link.querySentMillis == 0 || now - link.querySentMillis <= config.responseTimeoutMs) return false;
+  link.querySentMillis = 0;
+  link.responseTimeouts++;
+  link.consecutiveMisses++;
+  return true;
+}
+
+inline bool linkRssiSampleDue(LinkQuality_t &link, unsigned long now, const FridgeConfig_t &config) {
+  if (link.lastSampleMillis != 0 && now - link.lastSampleMillis < config.rssiSampleIntervalMs) return false;
+  link.lastSampleMillis = now;
+  return true;
+}
+
+/** --------------------------------------------------
+ * Folds one RSSI sample (0 = the controller had none)
+ * into the score and says whether to reconnect. Also
+ * judges the last proactive reconnect: it helped if the
+ * new link scores good before it is low for
+ * LINK_LOW_SAMPLES samples.
+ * -------------------------------------------------- */
+inline LinkVerdict_t linkScoreSample(LinkQuality_t &link, int rssi, unsigned long now,
+                                     const FridgeConfig_t &config) {
+  if (rssi != 0) {
+    link.rssiAvg = link.haveRssi ? (0.75f * link.rssiAvg + 0.25f * rssi) : (float)rssi;
+    link.rssiTrend = link.haveRssi ? (0.98f * link.rssiTrend + 0.02f * rssi) : (float)rssi;
+    link.haveRssi = true;
+  }
+
+  // -95 dBm and below maps to 0, -50 dBm and above to 100;
+  // every consecutive miss costs a quarter of the scale.
+  int score = link.haveRssi ? (int)((link.rssiAvg + 95.0f) * 100.0f / 45.0f) : 100;
+  score = (score < 0 ? 0 : score > 100 ? 100 : score) - 25 * link.consecutiveMisses;
+  link.score = (uint8_t)(score < 0 ? 0 : score > 100 ? 100 : score);
+
+  if (link.score >= config.linkScoreReconnect) {
+    link.lowScoreSamples = 0;
+    if (link.reconnectOutcomePending) {
+      link.reconnectOutcomePending = false;
+      link.lastReconnectHelped = true;
+      link.reconnectBackoffMs = LINK_RECONNECT_BACKOFF_MIN_MS;
+    }
+    return LINK_GOOD;
+  }
+  if (link.lowScoreSamples < 255) link.lowScoreSamples++;
+  if (link.lowScoreSamples < LINK_LOW_SAMPLES) return LINK_LOW;
+
+  if (link.reconnectOutcomePending) {
+    link.reconnectOutcomePending = false;
+    link.lastReconnectHelped = false;
+    link.reconnectBackoffMs = link.reconnectBackoffMs * 2 > LINK_RECONNECT_BACKOFF_MAX_MS ?
+                              LINK_RECONNECT_BACKOFF_MAX_MS : link.reconnectBackoffMs * 2;
+  }
+  bool degrading = link.consecutiveMisses > 0 ||
+                   (link.haveRssi && link.rssiAvg < link.rssiTrend - LINK_RSSI_FALL_DB);
+  bool inBackoff = link.proactiveReconnects > 0 && now - link.lastReconnectMillis < link.reconnectBackoffMs;
+  if (!degrading || inBackoff) {
+    link.reconnectsHeldOff++;
+    return LINK_HELD_OFF;
+  }
+
+  link.proactiveReconnects++;
+  link.lastReconnectMillis = now;
+  if (link.reconnectBackoffMs == 0) link.reconnectBackoffMs = LINK_RECONNECT_BACKOFF_MIN_MS;
+  link.reconnectOutcomePending = true;
+  return LINK_RECONNECT;
+}
+
+/** --------------------------------------------------
+ * Called every loop with the age of the published
+ * reading. Nothing is measured before the first reading:
+ * the scan and connect after boot are not staleness. The
+ * percentage is only judged once a full bound has elapsed
+ * in the window, otherwise the first missed query trips
+ * the alert instantly.
+ * -------------------------------------------------- */
+inline void freshnessSloUpdate(FreshnessSlo_t &slo, unsigned long now, bool haveReading,
+                               unsigned long ageMs, unsigned long boundMs, FreshnessReport_t &report) {
+  report.events = 0;
+  if (slo.lastUpdateMillis == 0 || !haveReading) {
+    slo.windowStartMillis = now;
+    slo.lastUpdateMillis = now;
+    return;
+  }
+
+  unsigned long dt = now - slo.lastUpdateMillis;
+  slo.lastUpdateMillis = now;
+
+  bool stale = ageMs > boundMs;
+  if (!stale) slo.freshMs += dt;
+  slo.totalMs += dt;
+
+  if (stale && !slo.stale) {
+    slo.staleEvents++;
+    report.events |= SLO_WENT_STALE;
+  } else if (!stale && slo.stale) {
+    report.events |= SLO_FRESH_AGAIN;
+  }
+  slo.stale = stale;
+
+  report.percent = slo.totalMs ? 100.0f * slo.freshMs / slo.totalMs : 0.0f;
+  if (slo.totalMs >= boundMs) {
+    if (!slo.alertActive && report.percent < FRESHNESS_SLO_PERCENT) {
+      slo.alertActive = true;
+      report.events |= SLO_ALERT;
+    } else if (slo.alertActive && report.percent >= FRESHNESS_SLO_PERCENT) {
+      slo.alertActive = false;
+      report.events |= SLO_RECOVERED;
+    }
+  }
+
+  if (now - slo.windowStartMillis >= FRESHNESS_WINDOW_MS) {
+    report.events |= SLO_WINDOW_END;
+    report.staleEvents = slo.staleEvents;
+    slo.windowStartMillis = now;
+    slo.freshMs = 0;
+    slo.totalMs = 0;
+    slo.staleEvents = 0;
+    slo.alertActive = false;
+  }
+}
@@ -0,0 +1,88 @@
+/***************************************************************
+ * Compile-time log levels
+ *
+ *   LOG_ERROR / LOG_WARN / LOG_INFO / LOG_DEBUG (fmt, ...)
+ *
+ * print one printf-style line to Serial (the newline is
+ * added). Levels above LOG_LEVEL expand to nothing: no
+ * code, no format string in flash, and the arguments are
+ * not evaluated, so never put side effects in them. Wrap
+ * work done only to build a log line in
+ * `if (LOG_ENABLED(LOG_LEVEL_INFO)) { ... }`, which the
+ * compiler removes just as completely.
+ *
+ * Set the level with build_flags, e.g.
+ *   -DLOG_LEVEL=LOG_LEVEL_WARN
+ *
+ * With -DLOG_BINARY the enabled lines are not formatted on
+ * the device: only a format ID, the time and the raw
+ * arguments are written (binlog.h), and the host tool
+ * renders them ('fridgetool logdecode'). The records also
+ * go to the SD card when one is in use (sd_log.h). Format strings
+ * must then be literals, and "%s" arguments are cut at
+ * BINLOG_MAX_STRING characters.
+ *
+ * Console command output (export, bench, decode, ...) is
+ * not logging and always goes to Serial directly.
+ ***************************************************************/
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifdef LOG_BINARY
+#include "binlog.h"
+#include "clock.h"
+#include "sd_log.h"
+#endif
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#define LOG_ENABLED(level) (LOG_LEVEL >= (level))
+
+#ifdef LOG_BINARY
+template <typename... Args>
+inline void binlogWrite(uint16_t id, Args... args) {
+  BinlogRecord_t r;
+  binlogBegin(r, id, (uint32_t)clockMillis());
+  binlogPutArgs(r, args...);
+  size_t len = binlogFinish(r);
+  Serial.write(r.bytes, len);
+  sdLogRecord(SD_RECORD_LOG, r.bytes, len);
+}
+#define LOG_EMIT(level, fmt, ...) binlogWrite(BINLOG_ID(level, fmt), ##__VA_ARGS__)
+#else
+#define LOG_EMIT(level, fmt, ...) Serial.printf(fmt "\n", ##__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(fmt, ...) LOG_EMIT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(fmt, ...) LOG_EMIT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(fmt, ...) LOG_EMIT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(fmt, ...) LOG_EMIT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) do {} while (0)
+#endif
@@ -0,0 +1,96 @@
+/***************************************************************
+ * MQTT broker connection
+ *
+ * One PubSubClient connection shared by every module that
+ * talks MQTT. Topics live under a per-board base topic,
+ * "fridge/<chip id>". While Wi-Fi is up, mqttLinkLoop()
+ * reconnects with exponential backoff and re-subscribes
+ * everything registered with mqttLinkSubscribe(); incoming
+ * messages are handed to their handler from inside
+ * mqttLinkLoop(), i.e. on the loop() task.
+ *
+ * Only loop() calls into this module.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+class Print;
+
+#define MQTT_DEFAULT_PORT 1883
+#define MQTT_BUFFER_SIZE 1280           // largest message in or out
+#define MQTT_TOPIC_MAX_LEN 96
+#define MQTT_MAX_SUBSCRIPTIONS 4
+#define MQTT_MAX_CONNECT_HANDLERS 4
+#define MQTT_RECONNECT_MIN_MS 2000
+#define MQTT_RECONNECT_MAX_MS 60000
+#define MQTT_SOCKET_TIMEOUT_S 3         // bounds a blocking connect or publish
+
+/** --------------------------------------------------
+ * Called for a message on a subscribed topic.
+ * -------------------------------------------------- */
+typedef void (*MqttMessageHandler)(const char* topic, const uint8_t* payload, size_t len);
+
+/** --------------------------------------------------
+ * Called after every (re)connect, for retained state.
+ * -------------------------------------------------- */
+typedef void (*MqttConnectHandler)();
+
+/** --------------------------------------------------
+ * Sets the broker. Nothing connects until Wi-Fi is up
+ * and mqttLinkLoop() runs. An empty host keeps MQTT off.
+ * -------------------------------------------------- */
+void mqttLinkBegin(const char* host, uint16_t port, const char* user, const char* password);
+
+/** --------------------------------------------------
+ * Reconnects when due and pumps incoming messages.
+ * Call every loop.
+ * -------------------------------------------------- */
+void mqttLinkLoop();
+
+bool mqttLinkConnected();
+
+/** --------------------------------------------------
+ * "fridge/<chip id>", without a trailing slash.
+ * -------------------------------------------------- */
+const char* mqttLinkBaseTopic();
+
+/** --------------------------------------------------
+ * Publishes to base topic + "/" + subtopic. Returns
+ * false when not connected or the client refused it.
+ * -------------------------------------------------- */
+bool mqttLinkPublish(const char* subtopic, const char* payload, bool retain);
+
+/** --------------------------------------------------
+ * Same, to a full topic name outside the base topic
+ * (e.g. Home Assistant discovery).
+ * -------------------------------------------------- */
+bool mqttLinkPublishTopic(const char* topic, const char* payload, bool retain);
+
+/** --------------------------------------------------
+ * Subscribes to base topic + "/" + subtopic, now if
+ * connected and again after every reconnect. Returns
+ * false when MQTT_MAX_SUBSCRIPTIONS are in use.
+ * -------------------------------------------------- */
+bool mqttLinkSubscribe(const char* subtopic, MqttMessageHandler handler);
+
+/** --------------------------------------------------
+ * Registers a handler for every future connect. Returns
+ * false when MQTT_MAX_CONNECT_HANDLERS are in use.
+ * -------------------------------------------------- */
+bool mqttLinkOnConnect(MqttConnectHandler handler);
+
+/** --------------------------------------------------
+ * Last will for every future connect: the broker
+ * publishes 'payload' (retained) to base topic + "/" +
+ * subtopic when the connection is lost. 'payload' must
+ * stay valid. Call after mqttLinkBegin().
+ * -------------------------------------------------- */
+void mqttLinkSetWill(const char* subtopic, const char* payload);
+
+/** --------------------------------------------------
+ * Connection and traffic counters (the 'mqtt' command).
+ * -------------------------------------------------- */
+void mqttLinkPrint(Print &out);
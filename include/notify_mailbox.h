@@ -0,0 +1,98 @@
+/***************************************************************
+ * Notification mailbox
+ *
+ * Hands notification frames from the BLE task (notify
+ * callback) to loop(). The callback posts a copy under a
+ * short lock; loop() takes the latest frame out under the
+ * same lock and works on its own copy. If loop() falls
+ * behind, a newer frame replaces the unread one and the
+ * overwrite is counted, so neither side ever sees a
+ * half-written frame.
+ *
+ * On the device the lock is a portMUX critical section;
+ * host builds (fridgetool stress, run under ThreadSanitizer)
+ * use a std::mutex with the same contract.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <mutex>
+#endif
+
+// Longest frame kept; longer notifications are truncated and counted
+#define NOTIFY_MAILBOX_MAX_LEN 128
+
+struct NotifyMailbox_t {
+  uint8_t bytes[NOTIFY_MAILBOX_MAX_LEN];
+  size_t length;
+  unsigned long millis;     // arrival time of the frame
+  bool full;                // a frame is waiting for loop()
+  uint32_t posted;
+  uint32_t overwritten;     // replaced before loop() took them
+  uint32_t truncated;
+#ifdef ARDUINO
+  portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+#else
+  std::mutex lock;
+#endif
+};
+
+#ifdef ARDUINO
+#define NOTIFY_MAILBOX_LOCK(mb)   portENTER_CRITICAL(&(mb).lock)
+#define NOTIFY_MAILBOX_UNLOCK(mb) portEXIT_CRITICAL(&(mb).lock)
+#else
+#define NOTIFY_MAILBOX_LOCK(mb)   (mb).lock.lock()
+#define NOTIFY_MAILBOX_UNLOCK(mb) (mb).lock.unlock()
+#endif
+
+/** --------------------------------------------------
+ * Producer side (BLE task): stores a copy of the frame.
+ * -------------------------------------------------- */
+inline void notifyMailboxPost(NotifyMailbox_t &mb, const uint8_t* data, size_t length, unsigned long millis) {
+  size_t n = length < NOTIFY_MAILBOX_MAX_LEN ? length : NOTIFY_MAILBOX_MAX_LEN;
+  NOTIFY_MAILBOX_LOCK(mb);
+  memcpy(mb.bytes, data, n);
+  mb.length = n;
+  mb.millis = millis;
+  if (mb.full) mb.overwritten++;
+  if (n < length) mb.truncated++;
+  mb.full = true;
+  mb.posted++;
+  NOTIFY_MAILBOX_UNLOCK(mb);
+}
+
+/** --------------------------------------------------
+ * Consumer side (loop): copies the waiting frame out and
+ * empties the mailbox. Returns false if nothing is waiting.
+ * 'out' must hold NOTIFY_MAILBOX_MAX_LEN bytes.
+ * -------------------------------------------------- */
+inline bool notifyMailboxTake(NotifyMailbox_t &mb, uint8_t* out, size_t &length, unsigned long &millis) {
+  bool taken = false;
+  NOTIFY_MAILBOX_LOCK(mb);
+  if (mb.full) {
+    memcpy(out, mb.bytes, mb.length);
+    length = mb.length;
+    millis = mb.millis;
+    mb.full = false;
+    taken = true;
+  }
+  NOTIFY_MAILBOX_UNLOCK(mb);
+  return taken;
+}
+
+/** --------------------------------------------------
+ * Drops a waiting frame, e.g. one left over from a
+ * previous connection.
+ * -------------------------------------------------- */
+inline void notifyMailboxClear(NotifyMailbox_t &mb) {
+  NOTIFY_MAILBOX_LOCK(mb);
+  mb.full = false;
+  NOTIFY_MAILBOX_UNLOCK(mb);
+}
@@ -0,0 +1,92 @@
+/***************************************************************
+ * BLE GATT relay server
+ *
+ * The fridge accepts a single central connection. While the
+ * ESP32 holds it, phones connect to the ESP32 instead: it
+ * advertises a relay service exposing the latest decoded
+ * status (read + notify). Optionally it also exposes a
+ * command characteristic whose writes are handed back to
+ * the sketch for forwarding; those reach the fridge, so
+ * they are only accepted over an encrypted link bonded
+ * with a static passkey.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fridge_protocol.h"
+
+class BLEServer;
+class Print;
+
+// Relay service and characteristic UUIDs
+#define RELAY_SERVICE_UUID      "6e7a0001-5ab1-4c0f-9f3c-7d1b2a3c4d5e"
+#define RELAY_STATUS_CHAR_UUID  "6e7a0002-5ab1-4c0f-9f3c-7d1b2a3c4d5e"
+#define RELAY_COMMAND_CHAR_UUID "6e7a0003-5ab1-4c0f-9f3c-7d1b2a3c4d5e"
+
+/** --------------------------------------------------
+ * Status as seen by relay clients (little endian, 12 bytes).
+ * -------------------------------------------------- */
+struct __attribute__((packed)) RelayStatus_t {
+  uint8_t  version;        // RELAY_STATUS_VERSION
+  uint8_t  flags;          // bit0 = locked, bit1 = powered on
+  uint8_t  runMode;        // 0=MAX, 1=ECO
+  uint8_t  batSaver;       // 0=Low, 1=Mid, 2=High
+  int8_t   leftTarget;
+  int8_t   leftCurrent;
+  uint8_t  unit;           // 0 = Celsius, 1 = Fahrenheit
+  uint8_t  batPercent;
+  uint16_t batMillivolts;
+  uint16_t ageSeconds;     // age of the reading when the value was set
+};
+
+#define RELAY_STATUS_VERSION 1
+
+// Called on the BLE task with the raw bytes a phone wrote to the command characteristic
+typedef void (*RelayCommandHandler)(const uint8_t* data, size_t length);
+
+/** --------------------------------------------------
+ * Notification fan-out and command counters.
+ * -------------------------------------------------- */
+struct RelayStats_t {
+  uint32_t notifications;       // notify() calls
+  uint32_t phoneNotifications;  // sum of the phones each one went to
+  uint64_t notifyMicros;        // time spent in notify()
+  uint32_t maxNotifyMicros;
+  uint32_t maxPhones;           // most phones connected at one notify()
+  uint32_t commandWrites;       // writes to the command characteristic
+};
+
+/** --------------------------------------------------
+ * Creates the relay service and starts advertising.
+ * Call once after BLEDevice::init(). With onCommand ==
+ * nullptr the relay is read-only and has no command
+ * characteristic; otherwise phones must pair with
+ * 'passkey' (6 digits) before they can write commands.
+ * -------------------------------------------------- */
+void relayServerBegin(RelayCommandHandler onCommand, uint32_t passkey);
+
+/** --------------------------------------------------
+ * Updates the status characteristic. Subscribers are
+ * notified only when a status field changed; the age
+ * alone never triggers a notification.
+ * -------------------------------------------------- */
+void relayServerPublish(const FridgeStatus_t &status, unsigned long ageMs);
+
+/** --------------------------------------------------
+ * Number of phones currently connected to the relay.
+ * -------------------------------------------------- */
+uint32_t relayServerSubscriberCount();
+
+/** --------------------------------------------------
+ * Fan-out and command counters ('relay' command).
+ * -------------------------------------------------- */
+void relayServerPrint(Print &out);
+
+/** --------------------------------------------------
+ * The underlying GATT server, so other services can be
+ * added to it. nullptr before relayServerBegin().
+ * -------------------------------------------------- */
+BLEServer* relayServerHandle();
@@ -0,0 +1,452 @@
+/***************************************************************
+ * Runtime configuration document
+ *
+ * What used to be compile-time constants (fridge name and
+ * UUIDs, query and link intervals, alarm thresholds, alarm
+ * sinks) in one POD struct. It is stored in NVS and changed
+ * over MQTT with delta patches. A patch is a flat JSON
+ * object with any subset of the fields:
+ *
+ *   {"base_rev":7,"query_interval_ms":30000,"webhook_url":""}
+ *
+ * A patch applies as a whole or not at all: it is applied to
+ * a copy of the current document, every field is range
+ * checked and the cross-field rules are validated, and only
+ * then does the copy replace the document (rev + 1). An
+ * optional base_rev must equal the current rev, so two
+ * operators cannot overwrite each other's change unseen.
+ * Values are integers, true/false or strings; nested objects,
+ * arrays, fractions and null are rejected.
+ *
+ * CONFIG_FIELDS is the one table behind parsing, range
+ * checks, comparison and the JSON rendering, so a new field
+ * is one struct member plus one table row.
+ *
+ * Plain C++ without Arduino dependencies, shared with
+ * 'fridgetool config'.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CONFIG_MAGIC 0x43464701       // "CFG" + layout version
+#define CONFIG_NAME_LEN 24
+#define CONFIG_UUID_LEN 37            // 128-bit UUID text plus NUL
+#define CONFIG_URL_LEN 96
+#define CONFIG_FIELD_NAME_LEN 32
+#define CONFIG_JSON_MAX_LEN 1024      // the full document
+#define CONFIG_ERROR_LEN 80
+
+struct FridgeConfig_t {
+  uint32_t magic;
+  uint32_t rev;                       // bumped by every patch that changes something
+  // Device
+  char deviceName[CONFIG_NAME_LEN];
+  char serviceUuid[CONFIG_UUID_LEN];
+  char writeUuid[CONFIG_UUID_LEN];
+  char notifyUuid[CONFIG_UUID_LEN];
+  // Intervals
+  uint32_t queryIntervalMs;
+  uint32_t freshnessBoundMs;
+  uint32_t responseTimeoutMs;
+  uint32_t rssiSampleIntervalMs;
+  uint8_t linkScoreReconnect;
+  // Alarm thresholds and pacing (alarm_dispatch.h)
+  uint8_t alarmTempMargin;
+  uint8_t alarmBatteryLowPercent;
+  uint8_t alarmBurst;
+  uint32_t alarmMinIntervalMs;
+  uint32_t alarmEscalateAfterMs;
+  uint32_t alarmRefillMs;
+  // Sinks
+  char webhookUrl[CONFIG_URL_LEN];    // "" = off
+  bool mqttAlarms;
+  bool sdHistory;
+};
+
+enum ConfigFieldKind_t : uint8_t { CONFIG_STRING, CONFIG_U32, CONFIG_U8, CONFIG_BOOL };
+
+#define CONFIG_RECONNECT 0x01         // takes effect at the next BLE connection
+#define CONFIG_UUID      0x02         // string must be a UUID
+#define CONFIG_URL       0x04         // string must be "" or an http:// URL
+
+struct ConfigField_t {
+  const char* name;
+  ConfigFieldKind_t kind;
+  uint8_t flags;
+  uint16_t offset;
+  uint16_t size;
+  uint32_t min;                       // numbers: range; strings: minimum length
+  uint32_t max;
+};
+
+#define CONFIG_FIELD(name, kind, flags, member, min, max) \
+  { name, kind, flags, (uint16_t)offsetof(FridgeConfig_t, member), \
+    (uint16_t)sizeof(((FridgeConfig_t*)0)->member), min, max }
+
+static const ConfigField_t CONFIG_FIELDS[] = {
+  CONFIG_FIELD("device_name",             CONFIG_STRING, CONFIG_RECONNECT, deviceName, 1, 0),
+  CONFIG_FIELD("service_uuid",            CONFIG_STRING, CONFIG_RECONNECT | CONFIG_UUID, serviceUuid, 4, 0),
+  CONFIG_FIELD("write_uuid",              CONFIG_STRING, CONFIG_RECONNECT | CONFIG_UUID, writeUuid, 4, 0),
+  CONFIG_FIELD("notify_uuid",             CONFIG_STRING, CONFIG_RECONNECT | CONFIG_UUID, notifyUuid, 4, 0),
+  CONFIG_FIELD("query_interval_ms",       CONFIG_U32, 0, queryIntervalMs, 5000, 3600000),
+  CONFIG_FIELD("freshness_bound_ms",      CONFIG_U32, 0, freshnessBoundMs, 10000, 86400000),
+  CONFIG_FIELD("response_timeout_ms",     CONFIG_U32, 0, responseTimeoutMs, 500, 60000),
+  CONFIG_FIELD("rssi_sample_interval_ms", CONFIG_U32, 0, rssiSampleIntervalMs, 1000, 600000),
+  CONFIG_FIELD("link_score_reconnect",    CONFIG_U8, 0, linkScoreReconnect, 0, 100),
+  CONFIG_FIELD("alarm_temp_margin",       CONFIG_U8, 0, alarmTempMargin, 3, 40),
+  CONFIG_FIELD("alarm_battery_low_percent", CONFIG_U8, 0, alarmBatteryLowPercent, 0, 95),
+  CONFIG_FIELD("alarm_burst",             CONFIG_U8, 0, alarmBurst, 1, 50),
+  CONFIG_FIELD("alarm_min_interval_ms",   CONFIG_U32, 0, alarmMinIntervalMs, 0, 3600000),
+  CONFIG_FIELD("alarm_escalate_after_ms", CONFIG_U32, 0, alarmEscalateAfterMs, 60000, 86400000),
+  CONFIG_FIELD("alarm_refill_ms",         CONFIG_U32, 0, alarmRefillMs, 1000, 3600000),
+  CONFIG_FIELD("webhook_url",             CONFIG_STRING, CONFIG_URL, webhookUrl, 0, 0),
+  CONFIG_FIELD("mqtt_alarms",             CONFIG_BOOL, 0, mqttAlarms, 0, 1),
+  CONFIG_FIELD("sd_history",              CONFIG_BOOL, 0, sdHistory, 0, 1),
+};
+
+#define CONFIG_FIELD_COUNT (sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]))
+
+struct ConfigResult_t {
+  bool ok;
+  uint32_t changedMask;               // bit i: CONFIG_FIELDS[i] changed
+  char error[CONFIG_ERROR_LEN];
+};
+
+inline const ConfigField_t* configFindField(const char* name) {
+  for (const ConfigField_t &f : CONFIG_FIELDS) {
+    if (strcmp(f.name, name) == 0) return &f;
+  }
+  return nullptr;
+}
+
+inline uint32_t configGetNumber(const FridgeConfig_t &c, const ConfigField_t &f) {
+  const uint8_t* p = (const uint8_t*)&c + f.offset;
+  if (f.kind == CONFIG_U32) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+  return *p;
+}
+
+inline void configSetNumber(FridgeConfig_t &c, const ConfigField_t &f, uint32_t v) {
+  uint8_t* p = (uint8_t*)&c + f.offset;
+  if (f.kind == CONFIG_U32) memcpy(p, &v, sizeof(v));
+  else if (f.kind == CONFIG_BOOL) *p = v != 0;
+  else *p = (uint8_t)v;
+}
+
+inline bool configIsUuid(const char* s) {
+  size_t len = strlen(s);
+  if (len != 4 && len != 8 && len != 36) return false;
+  for (size_t i = 0; i < len; i++) {
+    bool dash = len == 36 && (i == 8 || i == 13 || i == 18 || i == 23);
+    if (dash ? s[i] != '-' : !((s[i] >= '0' && s[i] <= '9') || ((s[i] | 0x20) >= 'a' && (s[i] | 0x20) <= 'f'))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/** --------------------------------------------------
+ * Range checks every field, then the rules between them.
+ * Used for patches and for what is loaded from NVS.
+ * -------------------------------------------------- */
+inline bool configValidate(const FridgeConfig_t &c, char* error, size_t size) {
+  for (const ConfigField_t &f : CONFIG_FIELDS) {
+    if (f.kind == CONFIG_STRING) {
+      const char* s = (const char*)&c + f.offset;
+      size_t len = strnlen(s, f.size);
+      if (len == f.size || len < f.min) {
+        snprintf(error, size, "%s: length must be %u..%u", f.name, (unsigned)f.min, (unsigned)f.size - 1);
+        return false;
+      }
+      if ((f.flags & CONFIG_UUID) && !configIsUuid(s)) {
+        snprintf(error, size, "%s: not a 16-, 32- or 128-bit UUID", f.name);
+        return false;
+      }
+      if ((f.flags & CONFIG_URL) && len > 0 && strncmp(s, "http://", 7) != 0 && strncmp(s, "https://", 8) != 0) {
+        snprintf(error, size, "%s: must start with http:// or https://", f.name);
+        return false;
+      }
+    } else {
+      uint32_t v = configGetNumber(c, f);
+      if (v < f.min || v > f.max) {
+        snprintf(error, size, "%s: %lu outside %lu..%lu", f.name, (unsigned long)v,
+                 (unsigned long)f.min, (unsigned long)f.max);
+        return false;
+      }
+    }
+  }
+  if (c.freshnessBoundMs <= c.queryIntervalMs) {
+    snprintf(error, size, "freshness_bound_ms must exceed query_interval_ms");
+    return false;
+  }
+  if (c.responseTimeoutMs >= c.queryIntervalMs) {
+    snprintf(error, size, "response_timeout_ms must be below query_interval_ms");
+    return false;
+  }
+  return true;
+}
+
+/** --------------------------------------------------
+ * One member of a flat JSON object.
+ * -------------------------------------------------- */
+enum ConfigJsonType_t : uint8_t { CONFIG_JSON_NUMBER, CONFIG_JSON_BOOL, CONFIG_JSON_STRING };
+
+struct ConfigJsonValue_t {
+  ConfigJsonType_t type;
+  bool negative;
+  uint64_t number;                    // magnitude, saturated
+  bool truncated;                     // string longer than text
+  char text[CONFIG_URL_LEN];
+};
+
+inline const char* configSkipSpace(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+  return p;
+}
+
+// Reads a string after its opening quote; \" \\ \/ escapes only
+inline const char* configReadString(const char* p, const char* end, char* out, size_t size, bool &truncated) {
+  size_t n = 0;
+  truncated = false;
+  while (p < end && *p != '"') {
+    char c = *p++;
+    if (c == '\\') {
+      if (p == end || (*p != '"' && *p != '\\' && *p != '/')) return nullptr;
+      c = *p++;
+    } else if ((uint8_t)c < 0x20) {
+      return nullptr;
+    }
+    if (n + 1 < size) out[n++] = c;
+    else truncated = true;
+  }
+  if (p == end) return nullptr;
+  out[n] = '\0';
+  return p + 1;
+}
+
+/** --------------------------------------------------
+ * Calls member(name, value) for every member of a flat
+ * JSON object; member returns false to stop. Returns
+ * false on a syntax error (described in 'error') or when
+ * member stopped.
+ * -------------------------------------------------- */
+template <typename F>
+inline bool configParseJson(const char* json, size_t len, F member, char* error, size_t size) {
+  const char* p = json;
+  const char* end = json + len;
+  p = configSkipSpace(p, end);
+  if (p == end || *p++ != '{') {
+    snprintf(error, size, "expected a JSON object");
+    return false;
+  }
+  p = configSkipSpace(p, end);
+  if (p < end && *p == '}') return configSkipSpace(p + 1, end) == end;
+  for (;;) {
+    char name[CONFIG_FIELD_NAME_LEN];
+    bool truncated;
+    ConfigJsonValue_t value;
+    if (p == end || *p != '"' || (p = configReadString(p + 1, end, name, sizeof(name), truncated)) == nullptr) {
+      snprintf(error, size, "bad member name");
+      return false;
+    }
+    p = configSkipSpace(p, end);
+    if (p == end || *p++ != ':') {
+      snprintf(error, size, "expected ':' after '%s'", name);
+      return false;
+    }
+    p = configSkipSpace(p, end);
+    memset(&value, 0, sizeof(value));
+    if (p < end && *p == '"') {
+      value.type = CONFIG_JSON_STRING;
+      p = configReadString(p + 1, end, value.text, sizeof(value.text), value.truncated);
+    } else if (p < end && (*p == '-' || (*p >= '0' && *p <= '9'))) {
+      value.type = CONFIG_JSON_NUMBER;
+      value.negative = *p == '-';
+      if (value.negative) p++;
+      const char* digits = p;
+      while (p < end && *p >= '0' && *p <= '9') {
+        value.number = value.number < 100000000000ULL ? value.number * 10 + (uint64_t)(*p - '0') : value.number;
+        p++;
+      }
+      if (p == digits || (p < end && (*p == '.' || *p == 'e' || *p == 'E'))) p = nullptr;
+    } else if (end - p >= 4 && strncmp(p, "true", 4) == 0) {
+      value.type = CONFIG_JSON_BOOL;
+      value.number = 1;
+      p += 4;
+    } else if (end - p >= 5 && strncmp(p, "false", 5) == 0) {
+      value.type = CONFIG_JSON_BOOL;
+      p += 5;
+    } else {
+      p = nullptr;
+    }
+    if (p == nullptr) {
+      snprintf(error, size, "%s: value must be an integer, true/false or a string", name);
+      return false;
+    }
+    if (!member(name, value)) return false;
+    p = configSkipSpace(p, end);
+    if (p < end && *p == ',') {
+      p = configSkipSpace(p + 1, end);
+      continue;
+    }
+    if (p < end && *p == '}' && configSkipSpace(p + 1, end) == end) return true;
+    snprintf(error, size, "expected ',' or '}' after '%s'", name);
+    return false;
+  }
+}
+
+/** --------------------------------------------------
+ * Stores one value into the field it names.
+ * -------------------------------------------------- */
+inline bool configSetField(FridgeConfig_t &c, const ConfigField_t &f, const ConfigJsonValue_t &v,
+                           char* error, size_t size) {
+  if (f.kind == CONFIG_STRING) {
+    if (v.type != CONFIG_JSON_STRING) {
+      snprintf(error, size, "%s: expected a string", f.name);
+      return false;
+    }
+    if (v.truncated || strlen(v.text) >= f.size) {
+      snprintf(error, size, "%s: longer than %u characters", f.name, (unsigned)f.size - 1);
+      return false;
+    }
+    memset((char*)&c + f.offset, 0, f.size);
+    memcpy((char*)&c + f.offset, v.text, strlen(v.text));
+    return true;
+  }
+  if (f.kind == CONFIG_BOOL ? v.type != CONFIG_JSON_BOOL : v.type != CONFIG_JSON_NUMBER) {
+    snprintf(error, size, "%s: expected %s", f.name, f.kind == CONFIG_BOOL ? "true or false" : "an integer");
+    return false;
+  }
+  // Range is checked by configValidate(); only keep the value representable
+  uint64_t limit = f.kind == CONFIG_U32 ? 0xFFFFFFFFULL : 0xFF;
+  if (v.negative || v.number > limit) {
+    snprintf(error, size, "%s: %s%llu outside %lu..%lu", f.name, v.negative ? "-" : "",
+             (unsigned long long)v.number, (unsigned long)f.min, (unsigned long)f.max);
+    return false;
+  }
+  configSetNumber(c, f, (uint32_t)v.number);
+  return true;
+}
+
+/** --------------------------------------------------
+ * Applies a patch to 'current' and writes the result to
+ * 'out'. On failure 'out' is a copy of 'current' and
+ * result.error says why. With 'document' set, the input
+ * is a full rendering (configFormatJson) and its "rev" is
+ * taken as is; otherwise rev is bumped when anything
+ * changed.
+ * -------------------------------------------------- */
+inline bool configApply(const FridgeConfig_t &current, const char* json, size_t len, bool document,
+                        FridgeConfig_t &out, ConfigResult_t &result) {
+  memset(&result, 0, sizeof(result));
+  out = current;
+  bool haveRev = false;
+  uint32_t rev = 0;
+  bool parsed = configParseJson(json, len, [&](const char* name, const ConfigJsonValue_t &v) {
+    if (strcmp(name, document ? "rev" : "base_rev") == 0) {
+      if (v.type != CONFIG_JSON_NUMBER || v.negative || v.number > 0xFFFFFFFFULL) {
+        snprintf(result.error, sizeof(result.error), "%s: expected an integer", name);
+        return false;
+      }
+      haveRev = true;
+      rev = (uint32_t)v.number;
+      return true;
+    }
+    const ConfigField_t* f = configFindField(name);
+    if (f == nullptr) {
+      snprintf(result.error, sizeof(result.error), "unknown field '%s'", name);
+      return false;
+    }
+    return configSetField(out, *f, v, result.error, sizeof(result.error));
+  }, result.error, sizeof(result.error));
+
+  if (parsed && !document && haveRev && rev != current.rev) {
+    snprintf(result.error, sizeof(result.error), "conflict: base_rev %lu, current rev %lu",
+             (unsigned long)rev, (unsigned long)current.rev);
+    parsed = false;
+  }
+  if (!parsed || !configValidate(out, result.error, sizeof(result.error))) {
+    out = current;
+    return false;
+  }
+
+  for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+    const ConfigField_t &f = CONFIG_FIELDS[i];
+    if (memcmp((const uint8_t*)&out + f.offset, (const uint8_t*)&current + f.offset, f.size) != 0) {
+      result.changedMask |= 1UL << i;
+    }
+  }
+  out.magic = CONFIG_MAGIC;
+  if (document) out.rev = haveRev ? rev : current.rev;
+  else if (result.changedMask != 0) out.rev = current.rev + 1;
+  result.ok = true;
+  return true;
+}
+
+/** --------------------------------------------------
+ * Renders the whole document, rev first. Returns the
+ * length, or 0 if buf was too small.
+ * -------------------------------------------------- */
+inline size_t configFormatJson(const FridgeConfig_t &c, char* buf, size_t size) {
+  size_t n = (size_t)snprintf(buf, size, "{\"rev\":%lu", (unsigned long)c.rev);
+  for (const ConfigField_t &f : CONFIG_FIELDS) {
+    if (n >= size) return 0;
+    n += (size_t)snprintf(buf + n, size - n, ",\"%s\":", f.name);
+    if (n >= size) return 0;
+    if (f.kind == CONFIG_STRING) {
+      const char* s = (const char*)&c + f.offset;
+      buf[n++] = '"';
+      for (size_t i = 0; i < f.size && s[i] != '\0' && n + 3 < size; i++) {
+        if (s[i] == '"' || s[i] == '\\') buf[n++] = '\\';
+        buf[n++] = s[i];
+      }
+      if (n + 2 >= size) return 0;
+      buf[n++] = '"';
+      buf[n] = '\0';
+    } else if (f.kind == CONFIG_BOOL) {
+      n += (size_t)snprintf(buf + n, size - n, "%s", configGetNumber(c, f) ? "true" : "false");
+    } else {
+      n += (size_t)snprintf(buf + n, size - n, "%lu", (unsigned long)configGetNumber(c, f));
+    }
+  }
+  if (n + 2 > size) return 0;
+  buf[n++] = '}';
+  buf[n] = '\0';
+  return n;
+}
+
+/** --------------------------------------------------
+ * Comma-separated names of the fields in 'mask'.
+ * -------------------------------------------------- */
+inline size_t configFormatFieldNames(uint32_t mask, char* buf, size_t size) {
+  size_t n = 0;
+  if (size > 0) buf[0] = '\0';
+  for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+    if ((mask & (1UL << i)) == 0) continue;
+    int w = snprintf(buf + n, size - n, "%s%s", n ? "," : "", CONFIG_FIELDS[i].name);
+    if (w < 0 || (size_t)w >= size - n) break;
+    n += (size_t)w;
+  }
+  return n;
+}
+
+/** --------------------------------------------------
+ * Mask of the fields that only apply at the next BLE
+ * connection.
+ * -------------------------------------------------- */
+inline uint32_t configReconnectMask() {
+  uint32_t mask = 0;
+  for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+    if (CONFIG_FIELDS[i].flags & CONFIG_RECONNECT) mask |= 1UL << i;
+  }
+  return mask;
+}
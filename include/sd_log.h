@@ -0,0 +1,51 @@
+/***************************************************************
+ * SD card logging
+ *
+ * Stores history records, and with -DLOG_BINARY every log
+ * record, on an SD card through the block-aligned sink in
+ * sd_sink.h. Files are /fridge/NNNNN.sdl, SD_LOG_FILE_BYTES
+ * each, allocated in full when created; a new one is
+ * started per boot and whenever one is full. The block
+ * being filled is written and synced every
+ * SD_LOG_SYNC_INTERVAL_MS, which bounds what a power loss
+ * can take.
+ *
+ * sdLogRecord() may be called from any task; the card is
+ * only written from loop() by sdLogPoll().
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sd_sink.h"
+
+class Print;
+
+#define SD_LOG_FILE_BYTES (4UL * 1024 * 1024)
+#define SD_LOG_SYNC_INTERVAL_MS 5000
+#define SD_LOG_DIR "/fridge"
+
+/** --------------------------------------------------
+ * Mounts the card (SPI, chip select on csPin) and opens
+ * the next file. Returns false if there is no card
+ * (everything else then does nothing) or the file could
+ * not be opened (sdLogPoll() retries with backoff).
+ * -------------------------------------------------- */
+bool sdLogBegin(uint8_t csPin);
+
+/** --------------------------------------------------
+ * Queues one record (kind SD_RECORD_*).
+ * -------------------------------------------------- */
+void sdLogRecord(uint8_t kind, const uint8_t* data, size_t len);
+
+/** --------------------------------------------------
+ * Writes full blocks and syncs when due. loop() only.
+ * -------------------------------------------------- */
+void sdLogPoll();
+
+/** --------------------------------------------------
+ * Sink counters and write latency (the 'sd' command).
+ * -------------------------------------------------- */
+void sdLogPrint(Print &out);
@@ -0,0 +1,314 @@
+/***************************************************************
+ * Block-aligned SD card sink
+ *
+ * Collects small records (history records, binary log
+ * records) into 512-byte blocks in RAM and hands the card
+ * whole blocks only, at block-aligned offsets inside a file
+ * that was allocated to its full size when it was created.
+ * The card never sees a partial-sector write, and the FAT
+ * and directory entry are not touched while the file fills.
+ *
+ * Every block starts with a header; records never cross a
+ * block boundary:
+ *
+ *   magic(2) used(2) fileId(4) seq(4) | kind(1) len(1) bytes... | 0...
+ *
+ * seq is the block's index in the file and fileId is random
+ * per file, so a reader stops at the first block that is
+ * missing, stale (left in the clusters by an older file) or
+ * not written yet. For power loss, the block being filled
+ * is written (padded) and the file synced every
+ * syncIntervalMs; it is rewritten in place once it is full.
+ * A file that cannot be opened (card missing or full) is
+ * retried from sdSinkPoll() with exponential backoff;
+ * records keep collecting in RAM meanwhile.
+ *
+ * Any task may append (short lock, as in notify_mailbox.h);
+ * only loop() calls sdSinkPoll(), which does the I/O. The
+ * card is reached through SdBackend_t, so the host tool can
+ * run the same code against a plain file.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "clock.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <mutex>
+#endif
+
+#define SD_BLOCK_SIZE 512
+#define SD_SINK_BLOCKS 4              // RAM ring of blocks waiting for the card
+#define SD_BLOCK_MAGIC 0x4253         // "SB"
+#define SD_SINK_RETRY_MS 1000         // first retry after a failed open, doubles
+#define SD_SINK_RETRY_MAX_MS 60000
+
+#define SD_RECORD_HISTORY 1           // HistoryRecord_t (history.h)
+#define SD_RECORD_LOG     2           // one binlog record (binlog.h)
+
+struct __attribute__((packed)) SdBlockHeader_t {
+  uint16_t magic;
+  uint16_t used;                      // record bytes after the header
+  uint32_t fileId;
+  uint32_t seq;                       // block index in the file
+};
+
+#define SD_BLOCK_PAYLOAD (SD_BLOCK_SIZE - sizeof(SdBlockHeader_t))
+
+/** --------------------------------------------------
+ * The card. open() creates the next file and allocates
+ * all of its 'bytes' up front; write() is always one or
+ * more whole blocks at a block-aligned offset.
+ * -------------------------------------------------- */
+struct SdBackend_t {
+  void* ctx;
+  bool (*open)(void* ctx, uint32_t bytes);
+  bool (*write)(void* ctx, uint32_t offset, const uint8_t* data, size_t len);
+  bool (*sync)(void* ctx);
+};
+
+struct SdSinkStats_t {
+  uint32_t records;
+  uint32_t dropped;                   // records: ring full
+  uint32_t blocksWritten;             // full blocks
+  uint32_t partialWrites;             // padded block written by a sync
+  uint32_t syncs;
+  uint32_t files;
+  uint32_t openFailures;              // retried with backoff
+  uint32_t writeErrors;
+  uint32_t writeMicrosMax;            // one block write
+  uint64_t writeMicrosSum;
+};
+
+struct SdSink_t {
+  SdBackend_t backend;
+  uint32_t fileBlocks;                // blocks per file
+  unsigned long syncIntervalMs;
+  uint32_t fileId;
+  uint32_t nextBlock;                 // index of the next full block in the file
+  unsigned long lastSyncMillis;
+  unsigned long openFailedMillis;
+  unsigned long openRetryMs;          // 0 = the last open worked
+  bool ready;                         // a file is open
+  bool dirty;                         // appended since the last sync
+
+  // Producer side, under lock: blocks[fill] is being filled,
+  // the 'waiting' blocks before it are full
+  uint8_t blocks[SD_SINK_BLOCKS][SD_BLOCK_SIZE] __attribute__((aligned(4)));
+  uint8_t fill;
+  uint8_t waiting;
+  SdSinkStats_t stats;
+#ifdef ARDUINO
+  portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+#else
+  std::mutex lock;
+#endif
+};
+
+#ifdef ARDUINO
+#define SD_SINK_LOCK(s)   portENTER_CRITICAL(&(s).lock)
+#define SD_SINK_UNLOCK(s) portEXIT_CRITICAL(&(s).lock)
+#else
+#define SD_SINK_LOCK(s)   (s).lock.lock()
+#define SD_SINK_UNLOCK(s) (s).lock.unlock()
+#endif
+
+inline SdBlockHeader_t* sdBlockHeader(uint8_t* block) {
+  return (SdBlockHeader_t*)block;
+}
+
+inline bool sdSinkWriteBlock(SdSink_t &s, uint8_t* block, uint32_t index);
+
+/** --------------------------------------------------
+ * Opens the next file and writes its first block empty,
+ * synced: until the first real sync, block 0 of a reused
+ * cluster would otherwise hand a reader the stale blocks
+ * of an older file as this one's records.
+ * -------------------------------------------------- */
+inline bool sdSinkOpenFile(SdSink_t &s) {
+  static uint8_t empty[SD_BLOCK_SIZE] __attribute__((aligned(4)));
+  s.ready = s.backend.open(s.backend.ctx, s.fileBlocks * SD_BLOCK_SIZE);
+  s.fileId = s.fileId * 1103515245u + 12345u;
+  s.nextBlock = 0;
+  if (!s.ready) return false;
+  memset(empty, 0, sizeof(empty));
+  sdBlockHeader(empty)->magic = SD_BLOCK_MAGIC;
+  s.ready = sdSinkWriteBlock(s, empty, 0) && s.backend.sync(s.backend.ctx);
+  if (s.ready) s.stats.files++;
+  return s.ready;
+}
+
+/** --------------------------------------------------
+ * True when a file with room for the next block is open.
+ * Opens one (the first, or the next after a full file)
+ * unless a failed open is still backing off.
+ * -------------------------------------------------- */
+inline bool sdSinkEnsureFile(SdSink_t &s, unsigned long now) {
+  if (s.ready && s.nextBlock < s.fileBlocks) return true;
+  if (s.openRetryMs != 0 && now - s.openFailedMillis < s.openRetryMs) return false;
+  if (sdSinkOpenFile(s)) {
+    s.openRetryMs = 0;
+    return true;
+  }
+  s.stats.openFailures++;
+  s.openFailedMillis = now;
+  s.openRetryMs = s.openRetryMs == 0 ? SD_SINK_RETRY_MS
+                : s.openRetryMs * 2 > SD_SINK_RETRY_MAX_MS ? SD_SINK_RETRY_MAX_MS : s.openRetryMs * 2;
+  return false;
+}
+
+/** --------------------------------------------------
+ * Opens the first file. fileBytes is rounded down to
+ * whole blocks; seed makes the file IDs differ per boot.
+ * Returns false if the file could not be opened; the sink
+ * still collects records and retries from sdSinkPoll().
+ * -------------------------------------------------- */
+inline bool sdSinkBegin(SdSink_t &s, const SdBackend_t &backend, uint32_t fileBytes,
+                        unsigned long syncIntervalMs, uint32_t seed) {
+  SD_SINK_LOCK(s);
+  s.backend = backend;
+  s.fileBlocks = fileBytes / SD_BLOCK_SIZE;
+  s.syncIntervalMs = syncIntervalMs;
+  s.fileId = seed;
+  s.lastSyncMillis = clockMillis();
+  s.openRetryMs = 0;
+  s.ready = false;
+  s.dirty = false;
+  s.fill = 0;
+  s.waiting = 0;
+  memset(&s.stats, 0, sizeof(s.stats));
+  memset(s.blocks[0], 0, SD_BLOCK_SIZE);
+  sdBlockHeader(s.blocks[0])->magic = SD_BLOCK_MAGIC;
+  SD_SINK_UNLOCK(s);
+  return s.fileBlocks > 0 && sdSinkEnsureFile(s, s.lastSyncMillis);
+}
+
+/** --------------------------------------------------
+ * Producer side (any task): copies a record into the
+ * block being filled. Returns false if it was dropped.
+ * -------------------------------------------------- */
+inline bool sdSinkAppend(SdSink_t &s, uint8_t kind, const uint8_t* data, size_t len) {
+  if (len > 255 || len + 2 > SD_BLOCK_PAYLOAD) return false;
+  bool stored = false;
+  SD_SINK_LOCK(s);
+  SdBlockHeader_t* h = sdBlockHeader(s.blocks[s.fill]);
+  if (h->used + 2 + len > SD_BLOCK_PAYLOAD && s.waiting < SD_SINK_BLOCKS - 1) {
+    s.waiting++;
+    s.fill = (s.fill + 1) % SD_SINK_BLOCKS;
+    memset(s.blocks[s.fill], 0, SD_BLOCK_SIZE);
+    h = sdBlockHeader(s.blocks[s.fill]);
+    h->magic = SD_BLOCK_MAGIC;
+  }
+  if (h->used + 2 + len <= SD_BLOCK_PAYLOAD) {
+    uint8_t* p = s.blocks[s.fill] + sizeof(SdBlockHeader_t) + h->used;
+    p[0] = kind;
+    p[1] = (uint8_t)len;
+    memcpy(p + 2, data, len);
+    h->used += 2 + len;
+    s.stats.records++;
+    s.dirty = true;
+    stored = true;
+  } else {
+    s.stats.dropped++;
+  }
+  SD_SINK_UNLOCK(s);
+  return stored;
+}
+
+inline bool sdSinkWriteBlock(SdSink_t &s, uint8_t* block, uint32_t index) {
+  SdBlockHeader_t* h = sdBlockHeader(block);
+  h->fileId = s.fileId;
+  h->seq = index;
+  unsigned long t0 = clockMicros();
+  bool ok = s.backend.write(s.backend.ctx, index * SD_BLOCK_SIZE, block, SD_BLOCK_SIZE);
+  uint32_t us = (uint32_t)(clockMicros() - t0);
+  s.stats.writeMicrosSum += us;
+  if (us > s.stats.writeMicrosMax) s.stats.writeMicrosMax = us;
+  if (!ok) s.stats.writeErrors++;
+  return ok;
+}
+
+/** --------------------------------------------------
+ * Consumer side (loop): writes the full blocks, and every
+ * syncIntervalMs (or when 'force' is set) the partial one
+ * followed by a sync. Returns false on a write error.
+ * -------------------------------------------------- */
+inline bool sdSinkPoll(SdSink_t &s, bool force = false) {
+  static uint8_t block[SD_BLOCK_SIZE] __attribute__((aligned(4)));
+  if (s.fileBlocks == 0) return false;
+  unsigned long now = clockMillis();
+  bool ok = true;
+  for (;;) {
+    // Without a file the full blocks wait in the ring; the
+    // producer drops new records once it is full
+    if (!sdSinkEnsureFile(s, now)) break;
+    SD_SINK_LOCK(s);
+    if (s.waiting == 0) {
+      SD_SINK_UNLOCK(s);
+      break;
+    }
+    memcpy(block, s.blocks[(s.fill + SD_SINK_BLOCKS - s.waiting) % SD_SINK_BLOCKS], SD_BLOCK_SIZE);
+    s.waiting--;
+    SD_SINK_UNLOCK(s);
+
+    ok = sdSinkWriteBlock(s, block, s.nextBlock) && ok;
+    s.nextBlock++;
+    s.stats.blocksWritten++;
+  }
+
+  if (!force && now - s.lastSyncMillis < s.syncIntervalMs) return ok;
+  if (!sdSinkEnsureFile(s, now)) return ok;
+
+  // The partial block belongs at nextBlock only while nothing is waiting
+  SD_SINK_LOCK(s);
+  if (s.waiting != 0) {
+    SD_SINK_UNLOCK(s);
+    return ok;
+  }
+  bool dirty = s.dirty;
+  s.dirty = false;
+  memcpy(block, s.blocks[s.fill], SD_BLOCK_SIZE);
+  SD_SINK_UNLOCK(s);
+  s.lastSyncMillis = now;
+  if (!dirty) return ok;
+
+  if (sdBlockHeader(block)->used > 0) {
+    ok = sdSinkWriteBlock(s, block, s.nextBlock) && ok;
+    s.stats.partialWrites++;
+  }
+  ok = s.backend.sync(s.backend.ctx) && ok;
+  s.stats.syncs++;
+  return ok;
+}
+
+/** --------------------------------------------------
+ * Reading side: calls 'record' for every record of a
+ * file image, in order, up to the first block that does
+ * not continue the file. Returns the number of records.
+ * -------------------------------------------------- */
+template <typename F>
+inline uint32_t sdSinkReadFile(const uint8_t* data, size_t size, F record) {
+  uint32_t count = 0;
+  uint32_t fileId = 0;
+  for (uint32_t index = 0; (size_t)(index + 1) * SD_BLOCK_SIZE <= size; index++) {
+    const uint8_t* block = data + (size_t)index * SD_BLOCK_SIZE;
+    SdBlockHeader_t h;
+    memcpy(&h, block, sizeof(h));
+    if (index == 0) fileId = h.fileId;
+    if (h.magic != SD_BLOCK_MAGIC || h.fileId != fileId || h.seq != index || h.used > SD_BLOCK_PAYLOAD) break;
+    const uint8_t* p = block + sizeof(SdBlockHeader_t);
+    const uint8_t* end = p + h.used;
+    while (end - p >= 2 && p[1] <= end - p - 2) {
+      record(p[0], p + 2, (size_t)p[1]);
+      count++;
+      p += 2 + p[1];
+    }
+  }
+  return count;
+}
@@ -0,0 +1,148 @@
+/***************************************************************
+ * Live status frames for WebSocket subscribers
+ *
+ * A reading is flattened into STATUS_FIELD_COUNT integer
+ * fields. Subscribers get one full snapshot, then deltas
+ * with only the fields that changed, as compact JSON:
+ *
+ *   {"type":"snapshot","seq":7,"age":1200,"status":{"locked":0,...}}
+ *   {"type":"delta","seq":8,"age":40,"changes":{"leftCurrent":3}}
+ *
+ * seq is bumped by every delta, so a subscriber that missed
+ * one (its send queue overflowed) sees the gap and asks for
+ * a fresh snapshot. A delta is serialized once per reading,
+ * whatever the number of subscribers: statusPublishDelta()
+ * hands the one frame to a StatusFanout_t, which is the
+ * WebSocket server on the device and a stand-in in the
+ * native tests.
+ *
+ * Plain C++ without Arduino dependencies, so the native
+ * unit tests exercise the same frames.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "fridge_protocol.h"
+#include "clock.h"
+
+#define STATUS_FIELD_COUNT 18
+#define STATUS_FRAME_MAX_LEN 512
+
+static const char* const STATUS_FIELD_NAMES[STATUS_FIELD_COUNT] = {
+  "locked", "poweredOn", "runMode", "batSaver", "leftTarget", "tempMax",
+  "tempMin", "leftRetDiff", "startDelay", "unit", "leftTCHot", "leftTCMid",
+  "leftTCCold", "leftTCHalt", "leftCurrent", "batPercent", "batVolInt", "batVolDec"
+};
+
+/** --------------------------------------------------
+ * Flattens a status into STATUS_FIELD_NAMES order.
+ * -------------------------------------------------- */
+inline void statusToFields(const FridgeStatus_t &st, int32_t out[STATUS_FIELD_COUNT]) {
+  out[0]  = st.locked;
+  out[1]  = st.poweredOn;
+  out[2]  = st.runMode;
+  out[3]  = st.batSaver;
+  out[4]  = st.leftTarget;
+  out[5]  = st.tempMax;
+  out[6]  = st.tempMin;
+  out[7]  = st.leftRetDiff;
+  out[8]  = st.startDelay;
+  out[9]  = st.unit;
+  out[10] = st.leftTCHot;
+  out[11] = st.leftTCMid;
+  out[12] = st.leftTCCold;
+  out[13] = st.leftTCHalt;
+  out[14] = st.leftCurrent;
+  out[15] = st.batPercent;
+  out[16] = st.batVolInt;
+  out[17] = st.batVolDec;
+}
+
+/** --------------------------------------------------
+ * Marks the fields that differ from the last published
+ * ones (all of them if there were none). Returns how many
+ * changed.
+ * -------------------------------------------------- */
+inline size_t statusDiff(const int32_t last[STATUS_FIELD_COUNT], bool haveLast,
+                         const int32_t fields[STATUS_FIELD_COUNT], bool changed[STATUS_FIELD_COUNT]) {
+  size_t count = 0;
+  for (size_t i = 0; i < STATUS_FIELD_COUNT; i++) {
+    changed[i] = !haveLast || fields[i] != last[i];
+    if (changed[i]) count++;
+  }
+  return count;
+}
+
+/** --------------------------------------------------
+ * Serializes a frame into buf. 'changed' selects which
+ * fields to include (nullptr = all, for snapshots).
+ * Returns the length, or 0 if buf was too small.
+ * -------------------------------------------------- */
+inline size_t statusSerializeFrame(char* buf, size_t size, const char* type, uint32_t seq,
+                                   unsigned long ageMs, const int32_t fields[STATUS_FIELD_COUNT],
+                                   const bool* changed) {
+  int n = snprintf(buf, size, "{\"type\":\"%s\",\"seq\":%lu,\"age\":%lu,\"%s\":{",
+                   type, (unsigned long)seq, ageMs, changed ? "changes" : "status");
+  bool first = true;
+  for (size_t i = 0; i < STATUS_FIELD_COUNT && n > 0 && (size_t)n < size; i++) {
+    if (changed && !changed[i]) continue;
+    n += snprintf(buf + n, size - n, "%s\"%s\":%ld", first ? "" : ",",
+                  STATUS_FIELD_NAMES[i], (long)fields[i]);
+    first = false;
+  }
+  if (n > 0 && (size_t)n < size) n += snprintf(buf + n, size - n, "}}");
+  return (n > 0 && (size_t)n < size) ? (size_t)n : 0;
+}
+
+/** --------------------------------------------------
+ * Where a delta goes: sendAll() gives the same frame to
+ * every subscriber (sharing one buffer) and returns false
+ * if it could not. ctx is passed back to every call.
+ * -------------------------------------------------- */
+struct StatusFanout_t {
+  void* ctx;
+  size_t (*count)(void* ctx);
+  bool (*sendAll)(void* ctx, const char* frame, size_t len);
+};
+
+// Cost of the deltas pushed so far, and of the last one
+struct StatusPushStats_t {
+  uint32_t deltas;
+  uint64_t serializeMicros;
+  uint64_t pushMicros;
+  unsigned long lastSerializeMicros;
+  unsigned long lastPushMicros;
+};
+
+/** --------------------------------------------------
+ * Serializes the delta once and pushes it to every
+ * subscriber. Returns the frame length, 0 if nothing was
+ * sent (no subscribers, nothing changed, or no memory).
+ * -------------------------------------------------- */
+inline size_t statusPublishDelta(const StatusFanout_t &fanout, StatusPushStats_t &stats, uint32_t seq,
+                                 unsigned long ageMs, const int32_t fields[STATUS_FIELD_COUNT],
+                                 const bool changed[STATUS_FIELD_COUNT], size_t changedCount) {
+  if (changedCount == 0 || fanout.count(fanout.ctx) == 0) return 0;
+
+  // Serialize on the stack (the length is only known afterwards); the
+  // fan-out copies it into the one buffer the subscribers share
+  unsigned long t0 = clockMicros();
+  char buf[STATUS_FRAME_MAX_LEN];
+  size_t len = statusSerializeFrame(buf, sizeof(buf), "delta", seq, ageMs, fields, changed);
+  if (len == 0) return 0;
+  unsigned long t1 = clockMicros();
+  if (!fanout.sendAll(fanout.ctx, buf, len)) return 0;
+  unsigned long t2 = clockMicros();
+
+  stats.deltas++;
+  stats.lastSerializeMicros = t1 - t0;
+  stats.lastPushMicros = t2 - t1;
+  stats.serializeMicros += stats.lastSerializeMicros;
+  stats.pushMicros += stats.lastPushMicros;
+  return len;
+}
@@ -0,0 +1,114 @@
+/***************************************************************
+ * Deterministic virtual clock and event scheduler
+ *
+ * Time only moves when the code under test calls
+ * clockDelay() or the simulation calls virtualClockRunNext()
+ * / virtualClockAdvance(); in both cases it jumps straight
+ * to the next scheduled event, so days of operation run in
+ * milliseconds. Events due at the same time fire in the
+ * order they were scheduled, and all randomness comes from
+ * a seeded generator, so a run is fully reproducible from
+ * its seed.
+ *
+ * Plain C++ without Arduino dependencies, for host builds.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+#include <vector>
+
+#include "clock.h"
+
+typedef void (*VirtualEventFn)(void* arg);
+
+struct VirtualEvent_t {
+  uint64_t atUs;
+  uint64_t seq;        // tie-breaker: scheduling order
+  VirtualEventFn fn;
+  void* arg;
+};
+
+struct VirtualClock_t {
+  uint64_t nowUs;
+  uint64_t nextSeq;
+  uint64_t rng;
+  std::vector<VirtualEvent_t> events;  // min-heap on (atUs, seq)
+  Clock_t clock;
+};
+
+inline bool virtualEventLater(const VirtualEvent_t &a, const VirtualEvent_t &b) {
+  return a.atUs != b.atUs ? a.atUs > b.atUs : a.seq > b.seq;
+}
+
+/** --------------------------------------------------
+ * Seeded xorshift64* generator; returns [0, bound).
+ * -------------------------------------------------- */
+inline uint32_t virtualClockRandom(VirtualClock_t &vc, uint32_t bound) {
+  vc.rng ^= vc.rng >> 12;
+  vc.rng ^= vc.rng << 25;
+  vc.rng ^= vc.rng >> 27;
+  uint64_t r = vc.rng * 0x2545F4914F6CDD1DULL;
+  return bound ? (uint32_t)((r >> 32) % bound) : 0;
+}
+
+inline void virtualClockScheduleUs(VirtualClock_t &vc, uint64_t delayUs, VirtualEventFn fn, void* arg) {
+  vc.events.push_back({ vc.nowUs + delayUs, vc.nextSeq++, fn, arg });
+  std::push_heap(vc.events.begin(), vc.events.end(), virtualEventLater);
+}
+
+inline void virtualClockSchedule(VirtualClock_t &vc, unsigned long delayMs, VirtualEventFn fn, void* arg) {
+  virtualClockScheduleUs(vc, (uint64_t)delayMs * 1000, fn, arg);
+}
+
+/** --------------------------------------------------
+ * Jumps to the earliest event and fires it. Returns false
+ * when nothing is scheduled.
+ * -------------------------------------------------- */
+inline bool virtualClockRunNext(VirtualClock_t &vc) {
+  if (vc.events.empty()) return false;
+  std::pop_heap(vc.events.begin(), vc.events.end(), virtualEventLater);
+  VirtualEvent_t ev = vc.events.back();
+  vc.events.pop_back();
+  if (ev.atUs > vc.nowUs) vc.nowUs = ev.atUs;
+  ev.fn(ev.arg);
+  return true;
+}
+
+/** --------------------------------------------------
+ * Fires every event due up to toUs in order, then sets the
+ * time to toUs.
+ * -------------------------------------------------- */
+inline void virtualClockAdvance(VirtualClock_t &vc, uint64_t toUs) {
+  while (!vc.events.empty() && vc.events.front().atUs <= toUs) {
+    virtualClockRunNext(vc);
+  }
+  if (toUs > vc.nowUs) vc.nowUs = toUs;
+}
+
+inline void virtualClockInit(VirtualClock_t &vc, uint64_t seed) {
+  vc.nowUs = 0;
+  vc.nextSeq = 0;
+  vc.rng = seed ? seed : 0x9E3779B97F4A7C15ULL;  // xorshift must not start at 0
+  vc.events.clear();
+  vc.clock.ctx = &vc;
+  vc.clock.millis = [](void* ctx) -> unsigned long {
+    return (unsigned long)(((VirtualClock_t*)ctx)->nowUs / 1000);
+  };
+  vc.clock.micros = [](void* ctx) -> unsigned long {
+    return (unsigned long)((VirtualClock_t*)ctx)->nowUs;
+  };
+  vc.clock.delay = [](void* ctx, unsigned long ms) {
+    VirtualClock_t* v = (VirtualClock_t*)ctx;
+    virtualClockAdvance(*v, v->nowUs + (uint64_t)ms * 1000);
+  };
+}
+
+/** --------------------------------------------------
+ * Makes clockMillis() and friends read this clock.
+ * -------------------------------------------------- */
+inline void virtualClockInstall(VirtualClock_t &vc) {
+  clockInstall(&vc.clock);
+}
@@ -0,0 +1,80 @@
+/***************************************************************
+ * Watchdog and hang diagnosis for blocking BLE calls
+ *
+ * Two layers:
+ *
+ *  - A guard around every blocking BLE client call.
+ *    loop() brackets the call with watchdogCallBegin() /
+ *    watchdogCallEnd(), and a supervisor task checks the
+ *    deadline. When a call overruns, the supervisor
+ *    captures a diagnostic (connection state, the call in
+ *    progress, the last trace events) and runs the teardown
+ *    handler. The handler disconnects the client, so the
+ *    stuck call returns and loop() recovers without a
+ *    reboot.
+ *
+ *  - The ESP-IDF task watchdog on loop() and the supervisor.
+ *    If a task stays stuck for WATCHDOG_TIMEOUT_S anyway, the
+ *    chip reboots. The trace and the call in progress are
+ *    kept in RTC memory and printed on the next boot.
+ *
+ * Recovery time (trip -> first data) is measured against
+ * the boot -> first data time of a full reboot.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+class Print;
+
+#define WATCHDOG_TIMEOUT_S 30        // task watchdog: reboot
+#define WATCHDOG_CHECK_MS 250        // supervisor poll period
+#define WATCHDOG_TRACE_LEN 16
+
+/** --------------------------------------------------
+ * Tears down the BLE link. Runs on the supervisor task
+ * while loop() is blocked in 'call', so it should only
+ * do what unblocks the call; loop() sees the trip in
+ * watchdogCallEnd() and cleans up itself.
+ * -------------------------------------------------- */
+typedef void (*WatchdogTeardownHandler)(const char* call);
+
+/** --------------------------------------------------
+ * Starts the supervisor and subscribes the calling task
+ * (loop) to the task watchdog. Prints the diagnostic
+ * left by a watchdog reboot, if any.
+ * -------------------------------------------------- */
+void watchdogBegin(WatchdogTeardownHandler teardown);
+
+/** --------------------------------------------------
+ * Call once per loop().
+ * -------------------------------------------------- */
+void watchdogFeed();
+
+/** --------------------------------------------------
+ * Brackets a blocking call. 'call' must be a string
+ * literal. watchdogCallEnd() returns true if the call
+ * overran and the client was torn down; its result must
+ * then be treated as a failure.
+ * -------------------------------------------------- */
+void watchdogCallBegin(const char* call, unsigned long timeoutMs);
+bool watchdogCallEnd();
+
+/** --------------------------------------------------
+ * Adds an event to the trace ring. 'event' must be a
+ * string literal.
+ * -------------------------------------------------- */
+void watchdogTrace(const char* event, int32_t arg);
+
+/** --------------------------------------------------
+ * Call when data flows again (first decoded frame of a
+ * connection); closes a pending recovery measurement.
+ * -------------------------------------------------- */
+void watchdogDataFlowing();
+
+/** --------------------------------------------------
+ * Trips, recovery times and the trace (the 'wdt' command).
+ * -------------------------------------------------- */
+void watchdogPrint(Print &out);
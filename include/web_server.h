@@ -0,0 +1,35 @@
+/***************************************************************
+ * HTTP / WebSocket server
+ *
+ * Serves live status over a WebSocket at /ws: a full
+ * snapshot when a client subscribes, then only the fields
+ * that changed with every new decode. One serialized delta
+ * buffer is shared by all subscribers. Also serves the
+ * dashboard and the binary history endpoint.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fridge_protocol.h"
+
+#define WEB_SERVER_PORT 80
+
+/** --------------------------------------------------
+ * Starts the server. Call once Wi-Fi has been started.
+ * -------------------------------------------------- */
+void webServerBegin();
+
+/** --------------------------------------------------
+ * Publishes a new reading. Sends a delta frame with the
+ * changed fields to every subscriber; nothing is sent if
+ * no field changed.
+ * -------------------------------------------------- */
+void webServerPublish(const FridgeStatus_t &status, unsigned long ageMs);
+
+/** --------------------------------------------------
+ * Housekeeping, call from loop().
+ * -------------------------------------------------- */
+void webServerLoop();
@@ -0,0 +1,126 @@
+/***************************************************************
+ * Alarm delivery (see alarms.h)
+ ***************************************************************/
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <Preferences.h>
+
+#include "alarms.h"
+#include "mqtt_link.h"
+#include "clock.h"
+#include "log.h"
+
+#define ALARM_NVS_NAMESPACE "alarms"
+#define ALARM_NVS_KEY "image"
+
+static AlarmDispatcher_t g_alarms;
+static Preferences g_alarmPrefs;
+static char g_webhookUrl[ALARM_WEBHOOK_URL_LEN];
+static bool g_mqttAlarms = true;
+
+/** --------------------------------------------------
+ * NVS store: the whole image as one blob. Saves happen
+ * only in polls that queued or delivered something.
+ * -------------------------------------------------- */
+static bool alarmNvsLoad(void* ctx, void* data, size_t len) {
+  return g_alarmPrefs.getBytesLength(ALARM_NVS_KEY) == len &&
+         g_alarmPrefs.getBytes(ALARM_NVS_KEY, data, len) == len;
+}
+
+static bool alarmNvsSave(void* ctx, const void* data, size_t len) {
+  return g_alarmPrefs.putBytes(ALARM_NVS_KEY, data, len) == len;
+}
+
+/** --------------------------------------------------
+ * MQTT target: <base>/alarm/<type>, not retained.
+ * -------------------------------------------------- */
+static bool mqttTargetReady(void* ctx) {
+  return !g_mqttAlarms || mqttLinkConnected();
+}
+
+static bool mqttTargetSend(void* ctx, const AlarmEvent_t &event, const char* json) {
+  if (!g_mqttAlarms) return true;
+  char subtopic[32];
+  snprintf(subtopic, sizeof(subtopic), "alarm/%s", ALARM_TYPE_NAMES[event.type % ALARM_TYPE_COUNT]);
+  return mqttLinkPublish(subtopic, json, false);
+}
+
+/** --------------------------------------------------
+ * Webhook target: any 2xx answer is a delivery.
+ * -------------------------------------------------- */
+static bool webhookTargetReady(void* ctx) {
+  return g_webhookUrl[0] == '\0' || WiFi.status() == WL_CONNECTED;
+}
+
+static bool webhookTargetSend(void* ctx, const AlarmEvent_t &event, const char* json) {
+  if (g_webhookUrl[0] == '\0') return true;
+  HTTPClient http;
+  http.setTimeout(ALARM_WEBHOOK_TIMEOUT_MS);
+  http.setConnectTimeout(ALARM_WEBHOOK_TIMEOUT_MS);
+  if (!http.begin(g_webhookUrl)) return false;
+  http.addHeader("Content-Type", "application/json");
+  int code = http.POST((uint8_t*)json, strlen(json));
+  http.end();
+  if (code < 200 || code >= 300) {
+    LOG_WARN("[ALARM] Webhook answered %d for %s", code, event.key);
+    return false;
+  }
+  return true;
+}
+
+void alarmsBegin(const AlarmConfig_t &config, const char* webhookUrl, bool mqttEnabled) {
+  g_alarmPrefs.begin(ALARM_NVS_NAMESPACE, false);
+  AlarmStore_t store = { nullptr, alarmNvsLoad, alarmNvsSave };
+  alarmDispatchBegin(g_alarms, config, store);
+
+  AlarmTarget_t mqtt = { "mqtt", nullptr, mqttTargetReady, mqttTargetSend };
+  AlarmTarget_t webhook = { "webhook", nullptr, webhookTargetReady, webhookTargetSend };
+  alarmDispatchAddTarget(g_alarms, mqtt);
+  alarmDispatchAddTarget(g_alarms, webhook);
+  alarmsConfigure(config, webhookUrl, mqttEnabled);
+  if (g_alarms.stats.restored > 0) {
+    LOG_INFO("[ALARM] %u undelivered events restored from NVS", (unsigned)g_alarms.stats.restored);
+  }
+}
+
+void alarmsConfigure(const AlarmConfig_t &config, const char* webhookUrl, bool mqttEnabled) {
+  g_alarms.config = config;
+  strncpy(g_webhookUrl, webhookUrl != nullptr ? webhookUrl : "", sizeof(g_webhookUrl) - 1);
+  g_mqttAlarms = mqttEnabled;
+}
+
+void alarmsReport(const char* key, AlarmType_t type, bool active, int32_t value) {
+  alarmReport(g_alarms, key, type, active, value);
+}
+
+void alarmsPoll() {
+  uint32_t raised = g_alarms.stats.raised, cleared = g_alarms.stats.cleared;
+  alarmDispatchPoll(g_alarms);
+  if (g_alarms.stats.raised != raised || g_alarms.stats.cleared != cleared) {
+    LOG_INFO("[ALARM] %u active, %u events queued", alarmActiveCount(g_alarms), g_alarms.image.count);
+  }
+}
+
+void alarmsPrint(Print &out) {
+  const AlarmStats_t &st = g_alarms.stats;
+  for (const AlarmKey_t &k : g_alarms.image.keys) {
+    if (k.key[0] == '\0' || !k.delivered) continue;
+    out.printf("[ALARM] active %s (%s), level %u, value %ld\n", k.key,
+               ALARM_TYPE_NAMES[k.type % ALARM_TYPE_COUNT], k.level, (long)k.value);
+  }
+  out.printf("[ALARM] raised %lu, cleared %lu, escalated %lu, coalesced %lu, dropped %lu\n",
+             (unsigned long)st.raised, (unsigned long)st.cleared, (unsigned long)st.escalated,
+             (unsigned long)st.coalesced, (unsigned long)st.dropped);
+  out.printf("[ALARM] queued %u, NVS writes %lu, restored %lu\n", g_alarms.image.count,
+             (unsigned long)st.saves, (unsigned long)st.restored);
+  for (uint8_t t = 0; t < g_alarms.targetCount; t++) {
+    const AlarmTargetStats_t &ts = g_alarms.targetStats[t];
+    bool off = t == 0 ? !g_mqttAlarms : g_webhookUrl[0] == '\0';
+    out.printf("[ALARM] %s%s: sent %lu, failed %lu, throttled %lu, latency avg %lu ms, max %lu ms\n",
+               g_alarms.targets[t].name, off ? " (off)" : "", (unsigned long)ts.sent, (unsigned long)ts.failures,
+               (unsigned long)ts.throttled, (unsigned long)(ts.sent ? ts.latencyMsSum / ts.sent : 0),
+               (unsigned long)ts.latencyMsMax);
+  }
+}
@@ -0,0 +1,79 @@
+/***************************************************************
+ * On-device microbenchmarks (see benchmark.h)
+ *
+ * Output, one JSON object per line:
+ *   {"suite":"begin","fw":"1.2.0","cpu_mhz":240,"n":1000}
+ *   {"bench":"checksum","n":1000,"min":310,"median":312,"p99":340,"unit":"cycles"}
+ *   {"suite":"end"}
+ ***************************************************************/
+
+#ifdef BENCHMARK_MODE
+
+#include <Arduino.h>
+#include <stdlib.h>
+
+#include "benchmark.h"
+
+static uint32_t g_benchOverhead = 0;
+
+static int compareCycles(const void* a, const void* b) {
+  uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static void emptyKernel(void* ctx) {
+}
+
+/** --------------------------------------------------
+ * Times 'iterations' calls into samples[] and sorts them.
+ * -------------------------------------------------- */
+static void sampleKernel(uint32_t* samples, uint32_t iterations, BenchKernel kernel, void* ctx) {
+  kernel(ctx);  // warm up caches / flash
+  for (uint32_t i = 0; i < iterations; i++) {
+    uint32_t t0 = ESP.getCycleCount();
+    kernel(ctx);
+    samples[i] = ESP.getCycleCount() - t0;
+  }
+  qsort(samples, iterations, sizeof(uint32_t), compareCycles);
+}
+
+void benchmarkBegin(const char* firmwareVersion, uint32_t iterations) {
+  // Cost of the timing itself, subtracted from every result
+  uint32_t samples[64];
+  sampleKernel(samples, 64, emptyKernel, nullptr);
+  g_benchOverhead = samples[0];
+
+  Serial.printf("{\"suite\":\"begin\",\"fw\":\"%s\",\"cpu_mhz\":%lu,\"n\":%lu,\"overhead\":%lu}\n",
+                firmwareVersion, (unsigned long)ESP.getCpuFreqMHz(),
+                (unsigned long)iterations, (unsigned long)g_benchOverhead);
+}
+
+bool benchmarkRun(const char* name, uint32_t iterations, BenchKernel kernel, void* ctx, BenchResult_t &result) {
+  if (iterations == 0) return false;
+  uint32_t* samples = (uint32_t*)malloc(iterations * sizeof(uint32_t));
+  if (samples == nullptr) {
+    Serial.printf("{\"bench\":\"%s\",\"error\":\"no memory\"}\n", name);
+    return false;
+  }
+
+  sampleKernel(samples, iterations, kernel, ctx);
+
+  result.name = name;
+  result.iterations = iterations;
+  result.minCycles = samples[0] - min(samples[0], g_benchOverhead);
+  result.medianCycles = samples[iterations / 2] - min(samples[iterations / 2], g_benchOverhead);
+  uint32_t p99 = samples[(uint32_t)((iterations - 1) * 0.99f)];
+  result.p99Cycles = p99 - min(p99, g_benchOverhead);
+  free(samples);
+
+  Serial.printf("{\"bench\":\"%s\",\"n\":%lu,\"min\":%lu,\"median\":%lu,\"p99\":%lu,\"unit\":\"cycles\"}\n",
+                name, (unsigned long)iterations, (unsigned long)result.minCycles,
+                (unsigned long)result.medianCycles, (unsigned long)result.p99Cycles);
+  return true;
+}
+
+void benchmarkEnd() {
+  Serial.println("{\"suite\":\"end\"}");
+}
+
+#endif // BENCHMARK_MODE
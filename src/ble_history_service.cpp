@@ -0,0 +1,132 @@
+/***************************************************************
+ * BLE bulk history download (see ble_history_service.h)
+ ***************************************************************/
+
+#include <BLEDevice.h>
+#include <BLEServer.h>
+#include <BLE2902.h>
+#include <Arduino.h>
+
+#include "ble_history_service.h"
+#include "relay_server.h"
+#include "history.h"
+#include "history_transfer.h"
+#include "clock.h"
+#include "log.h"
+
+// Notifications sent per loop() pass at most, so loop() stays responsive.
+// With the 100 ms loop delay and a 517 byte MTU that is ~80 KB/s.
+#define HISTORY_NOTIFY_BURST 16
+
+static BLECharacteristic* pHistoryInfoChar = nullptr;
+static BLECharacteristic* pHistoryDataChar = nullptr;
+
+// One transfer per phone, written on the BLE task and consumed in loop()
+static portMUX_TYPE g_historyXferMux = portMUX_INITIALIZER_UNLOCKED;
+static HistoryXferTable_t g_historyXfers;
+
+/** --------------------------------------------------
+ * Info reads always return the current ring bounds.
+ * -------------------------------------------------- */
+class HistoryInfoCallbacks : public BLECharacteristicCallbacks {
+  void onRead(BLECharacteristic* pCharacteristic) {
+    uint32_t firstSeq, endSeq;
+    historyBounds(firstSeq, endSeq);
+    HistoryInfo_t info = { HISTORY_VERSION, (uint8_t)sizeof(HistoryRecord_t), 0, firstSeq, endSeq };
+    pCharacteristic->setValue((uint8_t*)&info, sizeof(info));
+  }
+};
+
+/** --------------------------------------------------
+ * Control writes: start / credit / stop, for the
+ * transfer of the writing phone only.
+ * -------------------------------------------------- */
+class HistoryControlCallbacks : public BLECharacteristicCallbacks {
+  void onWrite(BLECharacteristic* pCharacteristic, esp_ble_gatts_cb_param_t* param) {
+    uint16_t connId = param->write.conn_id;
+    uint16_t mtu = relayServerHandle()->getPeerMTU(connId);
+    portENTER_CRITICAL(&g_historyXferMux);
+    bool ok = historyXferControl(g_historyXfers, connId, pCharacteristic->getData(),
+                                 pCharacteristic->getLength(), mtu, clockMillis());
+    portEXIT_CRITICAL(&g_historyXferMux);
+    if (!ok) LOG_WARN("[HISTORY] Control write from conn %u ignored", (unsigned)connId);
+  }
+};
+
+/** --------------------------------------------------
+ * GATT server events (BLE task): a phone going away ends
+ * its transfer, congestion pauses it.
+ * -------------------------------------------------- */
+static void historyGattsEvent(esp_gatts_cb_event_t event, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t* param) {
+  if (event == ESP_GATTS_DISCONNECT_EVT) {
+    portENTER_CRITICAL(&g_historyXferMux);
+    historyXferDisconnected(g_historyXfers, param->disconnect.conn_id);
+    portEXIT_CRITICAL(&g_historyXferMux);
+  } else if (event == ESP_GATTS_CONGEST_EVT) {
+    portENTER_CRITICAL(&g_historyXferMux);
+    historyXferCongested(g_historyXfers, param->congest.conn_id, param->congest.congested);
+    portEXIT_CRITICAL(&g_historyXferMux);
+  }
+}
+
+static size_t copyAllHistory(uint32_t &cursor, uint8_t* buf, size_t maxLen) {
+  return historyCopyRange(0, UINT32_MAX, cursor, buf, maxLen);
+}
+
+void bleHistoryServiceBegin() {
+  BLEServer* pServer = relayServerHandle();
+  if (pServer == nullptr) return;
+
+  // Let phones negotiate large packets; the MTU is agreed per connection
+  BLEDevice::setMTU(HISTORY_MAX_MTU);
+  BLEDevice::setCustomGattsHandler(historyGattsEvent);
+
+  BLEService* pService = pServer->createService(BLEUUID(HISTORY_SERVICE_UUID));
+
+  pHistoryInfoChar = pService->createCharacteristic(
+    BLEUUID(HISTORY_INFO_CHAR_UUID), BLECharacteristic::PROPERTY_READ);
+  pHistoryInfoChar->setCallbacks(new HistoryInfoCallbacks());
+
+  BLECharacteristic* pControlChar = pService->createCharacteristic(
+    BLEUUID(HISTORY_CONTROL_CHAR_UUID),
+    BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_WRITE_NR);
+  pControlChar->setCallbacks(new HistoryControlCallbacks());
+
+  pHistoryDataChar = pService->createCharacteristic(
+    BLEUUID(HISTORY_DATA_CHAR_UUID), BLECharacteristic::PROPERTY_NOTIFY);
+  pHistoryDataChar->addDescriptor(new BLE2902());
+
+  pService->start();
+}
+
+void bleHistoryServiceLoop() {
+  static uint8_t packet[HISTORY_XFER_MAX_PAYLOAD];
+  esp_gatt_if_t gattsIf = relayServerHandle()->getGattsIf();
+  uint16_t handle = pHistoryDataChar->getHandle();
+
+  for (int burst = 0; burst < HISTORY_NOTIFY_BURST; burst++) {
+    HistoryXfer_t xfer;
+    portENTER_CRITICAL(&g_historyXferMux);
+    bool go = historyXferPick(g_historyXfers, xfer);
+    portEXIT_CRITICAL(&g_historyXferMux);
+    if (!go) return;
+
+    uint32_t cursor;
+    size_t len = historyXferBuildPacket(xfer, cursor, packet, copyAllHistory);
+    // To this phone only; out of buffers means the links are busy, so the
+    // packet is built again from the same cursor on the next pass
+    if (esp_ble_gatts_send_indicate(gattsIf, xfer.connId, handle, len, packet, false) != ESP_OK) return;
+
+    HistoryXfer_t done;
+    portENTER_CRITICAL(&g_historyXferMux);
+    bool finished = historyXferSent(g_historyXfers, xfer, cursor, len, done);
+    portEXIT_CRITICAL(&g_historyXferMux);
+
+    if (finished) {
+      unsigned long ms = clockMillis() - done.startMillis;
+      LOG_INFO("[HISTORY] BLE transfer to conn %u done: %lu bytes in %lu notifications, %lu ms (%lu B/s)",
+               (unsigned)done.connId, (unsigned long)done.bytes, (unsigned long)done.notifications, ms,
+               (unsigned long)(done.bytes * 1000UL / (ms ? ms : 1)));
+    }
+  }
+}
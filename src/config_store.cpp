@@ -0,0 +1,161 @@
+/***************************************************************
+ * Configuration store and remote updates (see config_store.h)
+ ***************************************************************/
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <nvs.h>
+
+#include "config_store.h"
+#include "mqtt_link.h"
+#include "clock.h"
+#include "log.h"
+
+#define CONFIG_NVS_NAMESPACE "config"
+#define CONFIG_NVS_KEY "doc"
+
+static FridgeConfig_t g_config;
+static portMUX_TYPE g_configMux = portMUX_INITIALIZER_UNLOCKED;
+static Preferences g_configPrefs;
+static ConfigReloadHandler g_configReload = nullptr;
+
+// Counters for the 'config' command
+static uint32_t g_configApplied = 0;
+static uint32_t g_configUnchanged = 0;
+static uint32_t g_configRejected = 0;
+static uint32_t g_configNvsWrites = 0;
+static uint32_t g_configNvsFailures = 0;
+static uint32_t g_configNvsMicrosMax = 0;
+static uint32_t g_configApplyMicrosLast = 0;
+static uint32_t g_configApplyMicrosMax = 0;
+static uint64_t g_configApplyMicrosSum = 0;
+
+static void publishState() {
+  static char json[CONFIG_JSON_MAX_LEN];
+  if (configFormatJson(g_config, json, sizeof(json)) > 0) {
+    mqttLinkPublish("config/state", json, true);
+  }
+}
+
+static void publishResult(const ConfigResult_t &result, uint32_t micros) {
+  char changed[256];
+  configFormatFieldNames(result.changedMask, changed, sizeof(changed));
+  // The error may quote the patch; keep it a valid JSON string
+  char error[CONFIG_ERROR_LEN];
+  strncpy(error, result.error, sizeof(error));
+  error[sizeof(error) - 1] = '\0';
+  for (char* c = error; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\' || (uint8_t)*c < 0x20) *c = '\'';
+  }
+  char json[CONFIG_ERROR_LEN + sizeof(changed) + 96];
+  snprintf(json, sizeof(json), "{\"ok\":%s,\"rev\":%lu,\"changed\":\"%s\",\"error\":\"%s\",\"apply_us\":%lu}",
+           result.ok ? "true" : "false", (unsigned long)g_config.rev, changed, error,
+           (unsigned long)micros);
+  mqttLinkPublish("config/result", json, false);
+}
+
+static void configPatchReceived(const char* topic, const uint8_t* payload, size_t len) {
+  ConfigResult_t result;
+  configStoreApply((const char*)payload, len, result);
+}
+
+void configStoreBegin(const FridgeConfig_t &defaults, ConfigReloadHandler onReload) {
+  g_configReload = onReload;
+  g_configPrefs.begin(CONFIG_NVS_NAMESPACE, false);
+
+  FridgeConfig_t stored;
+  char error[CONFIG_ERROR_LEN] = "older layout";
+  bool loaded = g_configPrefs.getBytesLength(CONFIG_NVS_KEY) == sizeof(stored) &&
+                g_configPrefs.getBytes(CONFIG_NVS_KEY, &stored, sizeof(stored)) == sizeof(stored);
+  if (loaded && stored.magic == CONFIG_MAGIC && configValidate(stored, error, sizeof(error))) {
+    g_config = stored;
+    LOG_INFO("[CONFIG] Loaded rev %lu from NVS", (unsigned long)g_config.rev);
+  } else {
+    g_config = defaults;
+    g_config.magic = CONFIG_MAGIC;
+    if (loaded) LOG_WARN("[CONFIG] Stored document rejected (%s), using defaults", error);
+  }
+
+  mqttLinkSubscribe("config/set", configPatchReceived);
+  mqttLinkOnConnect(publishState);
+}
+
+const FridgeConfig_t &configCurrent() {
+  return g_config;
+}
+
+void configCopyDeviceName(char* out, size_t size) {
+  portENTER_CRITICAL(&g_configMux);
+  strncpy(out, g_config.deviceName, size - 1);
+  portEXIT_CRITICAL(&g_configMux);
+  out[size - 1] = '\0';
+}
+
+void configCopyServiceUuid(char* out, size_t size) {
+  portENTER_CRITICAL(&g_configMux);
+  strncpy(out, g_config.serviceUuid, size - 1);
+  portEXIT_CRITICAL(&g_configMux);
+  out[size - 1] = '\0';
+}
+
+/** --------------------------------------------------
+ * Validate, write NVS, then switch: the candidate only
+ * becomes active once it is safely stored.
+ * -------------------------------------------------- */
+bool configStoreApply(const char* json, size_t len, ConfigResult_t &result) {
+  unsigned long t0 = clockMicros();
+  static FridgeConfig_t candidate;
+  bool ok = configApply(g_config, json, len, false, candidate, result);
+
+  if (ok && result.changedMask != 0) {
+    unsigned long w0 = clockMicros();
+    bool written = g_configPrefs.putBytes(CONFIG_NVS_KEY, &candidate, sizeof(candidate)) == sizeof(candidate);
+    uint32_t us = (uint32_t)(clockMicros() - w0);
+    if (us > g_configNvsMicrosMax) g_configNvsMicrosMax = us;
+    if (written) {
+      g_configNvsWrites++;
+      portENTER_CRITICAL(&g_configMux);
+      g_config = candidate;
+      portEXIT_CRITICAL(&g_configMux);
+      if (g_configReload != nullptr) g_configReload(g_config, result.changedMask);
+    } else {
+      g_configNvsFailures++;
+      snprintf(result.error, sizeof(result.error), "NVS write failed");
+      result.ok = ok = false;
+    }
+  }
+
+  uint32_t us = (uint32_t)(clockMicros() - t0);
+  if (!ok) {
+    g_configRejected++;
+    LOG_WARN("[CONFIG] Patch rejected: %s", result.error);
+  } else if (result.changedMask == 0) {
+    g_configUnchanged++;
+  } else {
+    g_configApplied++;
+    g_configApplyMicrosLast = us;
+    g_configApplyMicrosSum += us;
+    if (us > g_configApplyMicrosMax) g_configApplyMicrosMax = us;
+    LOG_INFO("[CONFIG] Applied rev %lu in %lu us", (unsigned long)g_config.rev, (unsigned long)us);
+  }
+  publishResult(result, us);
+  if (ok && result.changedMask != 0) publishState();
+  return ok;
+}
+
+void configStorePrint(Print &out) {
+  static char json[CONFIG_JSON_MAX_LEN];
+  configFormatJson(g_config, json, sizeof(json));
+  out.printf("[CONFIG] %s\n", json);
+  out.printf("[CONFIG] patches applied %lu, unchanged %lu, rejected %lu\n",
+             (unsigned long)g_configApplied, (unsigned long)g_configUnchanged, (unsigned long)g_configRejected);
+  out.printf("[CONFIG] apply last %lu us, avg %lu us, max %lu us\n", (unsigned long)g_configApplyMicrosLast,
+             (unsigned long)(g_configApplied ? g_configApplyMicrosSum / g_configApplied : 0),
+             (unsigned long)g_configApplyMicrosMax);
+  nvs_stats_t nvs;
+  bool haveStats = nvs_get_stats(nullptr, &nvs) == ESP_OK;
+  out.printf("[CONFIG] NVS writes %lu (max %lu us), %lu failed; partition %u/%u entries used\n",
+             (unsigned long)g_configNvsWrites, (unsigned long)g_configNvsMicrosMax,
+             (unsigned long)g_configNvsFailures, haveStats ? (unsigned)nvs.used_entries : 0,
+             haveStats ? (unsigned)nvs.total_entries : 0);
+}
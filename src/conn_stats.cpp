@@ -0,0 +1,220 @@
+/***************************************************************
+ * Connection lifecycle accounting (see conn_stats.h)
+ ***************************************************************/
+
+#include <Arduino.h>
+
+#include "conn_stats.h"
+#include "clock.h"
+#include "log.h"
+#include "watchdog.h"
+
+static const char* const CONN_STATE_NAMES[CONN_STATE_COUNT] = {
+  "disconnected", "scanning", "connecting", "discovering", "binding", "ready"
+};
+
+struct ConnHistogram_t {
+  uint32_t buckets[CONN_HIST_BUCKETS + 1];   // last one is +Inf
+  uint32_t count;
+  uint64_t sumMs;
+};
+
+struct ConnDeviceStats_t {
+  bool     inUse;
+  uint8_t  address[6];
+  unsigned long lastMillis;
+  uint64_t timeInStateMs[CONN_STATE_COUNT];
+  uint32_t transitions[CONN_STATE_COUNT][CONN_STATE_COUNT];
+  ConnHistogram_t phase[CONN_STATE_COUNT];
+  ConnHistogram_t timeToReady;
+};
+
+// Written by loop() only; the lock covers readers on the web server task
+static portMUX_TYPE g_connStatsMux = portMUX_INITIALIZER_UNLOCKED;
+static ConnDeviceStats_t g_connStats[CONN_STATS_MAX_DEVICES];
+static ConnState_t g_connState = CONN_DISCONNECTED;
+static unsigned long g_connStateMillis = 0;
+static unsigned long g_connScanStartMillis = 0;
+static bool g_connScanPending = false;           // a scan started and has not reached READY yet
+static uint8_t g_connAddress[6] = { 0 };
+static bool g_connHaveAddress = false;
+// Boot and the first scans, before any fridge was found: kept aside and
+// charged to the first fridge, so no 00:00:00:00:00:00 device appears
+static ConnDeviceStats_t g_connUnattributed;
+
+static void histogramAdd(ConnHistogram_t &h, unsigned long ms) {
+  int i = 0;
+  while (i < CONN_HIST_BUCKETS && ms >= (16UL << i)) i++;
+  h.buckets[i]++;
+  h.count++;
+  h.sumMs += ms;
+}
+
+static ConnDeviceStats_t &deviceSlot(const uint8_t address[6], unsigned long now) {
+  ConnDeviceStats_t* slot = nullptr;
+  for (size_t i = 0; i < CONN_STATS_MAX_DEVICES; i++) {
+    ConnDeviceStats_t &d = g_connStats[i];
+    if (d.inUse && memcmp(d.address, address, 6) == 0) {
+      slot = &d;
+      break;
+    }
+    if (slot == nullptr || (slot->inUse && (!d.inUse || d.lastMillis < slot->lastMillis))) {
+      slot = &d;
+    }
+  }
+  if (!slot->inUse || memcmp(slot->address, address, 6) != 0) {
+    memset(slot, 0, sizeof(*slot));
+    memcpy(slot->address, address, 6);
+    slot->inUse = true;
+  }
+  slot->lastMillis = now;
+  return *slot;
+}
+
+static void histogramMerge(ConnHistogram_t &into, const ConnHistogram_t &from) {
+  for (int i = 0; i <= CONN_HIST_BUCKETS; i++) into.buckets[i] += from.buckets[i];
+  into.count += from.count;
+  into.sumMs += from.sumMs;
+}
+
+static void deviceMerge(ConnDeviceStats_t &into, const ConnDeviceStats_t &from) {
+  for (int s = 0; s < CONN_STATE_COUNT; s++) {
+    into.timeInStateMs[s] += from.timeInStateMs[s];
+    for (int t = 0; t < CONN_STATE_COUNT; t++) into.transitions[s][t] += from.transitions[s][t];
+    histogramMerge(into.phase[s], from.phase[s]);
+  }
+  histogramMerge(into.timeToReady, from.timeToReady);
+}
+
+void connStatsTransition(ConnState_t next, const uint8_t* address) {
+  if (next == g_connState && address == nullptr) return;
+  unsigned long now = clockMillis();
+  unsigned long spent = now - g_connStateMillis;
+
+  portENTER_CRITICAL(&g_connStatsMux);
+  if (address != nullptr) memcpy(g_connAddress, address, 6);
+  ConnDeviceStats_t* slot = &g_connUnattributed;
+  if (address != nullptr || g_connHaveAddress) {
+    slot = &deviceSlot(g_connAddress, now);
+    if (!g_connHaveAddress) {
+      deviceMerge(*slot, g_connUnattributed);
+      g_connHaveAddress = true;
+    }
+  }
+  ConnDeviceStats_t &d = *slot;
+  d.timeInStateMs[g_connState] += spent;
+  d.transitions[g_connState][next]++;
+  histogramAdd(d.phase[g_connState], spent);
+  if (next == CONN_READY && g_connScanPending) {
+    histogramAdd(d.timeToReady, now - g_connScanStartMillis);
+    g_connScanPending = false;
+  }
+  ConnState_t previous = g_connState;
+  g_connState = next;
+  portEXIT_CRITICAL(&g_connStatsMux);
+
+  if (next == CONN_SCANNING && !g_connScanPending) {
+    g_connScanStartMillis = now;
+    g_connScanPending = true;
+  }
+  g_connStateMillis = now;
+  watchdogTrace(CONN_STATE_NAMES[next], (int32_t)spent);
+  LOG_INFO("[CONN] %s -> %s after %lu ms", CONN_STATE_NAMES[previous], CONN_STATE_NAMES[next], spent);
+}
+
+ConnState_t connStatsState() {
+  return g_connState;
+}
+
+const char* connStateName(ConnState_t state) {
+  return state < CONN_STATE_COUNT ? CONN_STATE_NAMES[state] : "?";
+}
+
+static void writeHistogram(Print &out, const char* name, const char* labels, const ConnHistogram_t &h) {
+  uint32_t cumulative = 0;
+  for (int i = 0; i < CONN_HIST_BUCKETS; i++) {
+    cumulative += h.buckets[i];
+    out.printf("%s_bucket{%s,le=\"%lu\"} %lu\n", name, labels, 16UL << i, (unsigned long)cumulative);
+  }
+  out.printf("%s_bucket{%s,le=\"+Inf\"} %lu\n", name, labels, (unsigned long)h.count);
+  out.printf("%s_sum{%s} %llu\n", name, labels, (unsigned long long)h.sumMs);
+  out.printf("%s_count{%s} %lu\n", name, labels, (unsigned long)h.count);
+}
+
+enum ConnFamily_t {
+  CONN_FAMILY_STATE_MS,
+  CONN_FAMILY_TRANSITIONS,
+  CONN_FAMILY_PHASE,
+  CONN_FAMILY_TIME_TO_READY,
+  CONN_FAMILY_COUNT
+};
+
+static const char* const CONN_FAMILY_TYPES[CONN_FAMILY_COUNT] = {
+  "fridge_conn_state_ms_total counter",
+  "fridge_conn_transitions_total counter",
+  "fridge_conn_phase_ms histogram",
+  "fridge_conn_time_to_ready_ms histogram"
+};
+
+/** --------------------------------------------------
+ * The samples of one metric family for one device.
+ * -------------------------------------------------- */
+static void writeFamily(Print &out, ConnFamily_t family, const ConnDeviceStats_t &d) {
+  char device[18];
+  snprintf(device, sizeof(device), "%02x:%02x:%02x:%02x:%02x:%02x",
+           d.address[0], d.address[1], d.address[2], d.address[3], d.address[4], d.address[5]);
+  char labels[64];
+  switch (family) {
+    case CONN_FAMILY_STATE_MS:
+      for (int s = 0; s < CONN_STATE_COUNT; s++) {
+        out.printf("fridge_conn_state_ms_total{device=\"%s\",state=\"%s\"} %llu\n",
+                   device, CONN_STATE_NAMES[s], (unsigned long long)d.timeInStateMs[s]);
+      }
+      break;
+    case CONN_FAMILY_TRANSITIONS:
+      for (int from = 0; from < CONN_STATE_COUNT; from++) {
+        for (int to = 0; to < CONN_STATE_COUNT; to++) {
+          if (d.transitions[from][to] == 0) continue;
+          out.printf("fridge_conn_transitions_total{device=\"%s\",from=\"%s\",to=\"%s\"} %lu\n",
+                     device, CONN_STATE_NAMES[from], CONN_STATE_NAMES[to], (unsigned long)d.transitions[from][to]);
+        }
+      }
+      break;
+    case CONN_FAMILY_PHASE:
+      for (int s = 0; s < CONN_STATE_COUNT; s++) {
+        if (d.phase[s].count == 0) continue;
+        snprintf(labels, sizeof(labels), "device=\"%s\",state=\"%s\"", device, CONN_STATE_NAMES[s]);
+        writeHistogram(out, "fridge_conn_phase_ms", labels, d.phase[s]);
+      }
+      break;
+    default:
+      snprintf(labels, sizeof(labels), "device=\"%s\"", device);
+      writeHistogram(out, "fridge_conn_time_to_ready_ms", labels, d.timeToReady);
+      break;
+  }
+}
+
+void connStatsWrite(Print &out) {
+  portENTER_CRITICAL(&g_connStatsMux);
+  ConnState_t state = g_connState;
+  portEXIT_CRITICAL(&g_connStatsMux);
+
+  out.printf("# TYPE fridge_conn_state gauge\n");
+  for (int s = 0; s < CONN_STATE_COUNT; s++) {
+    out.printf("fridge_conn_state{state=\"%s\"} %d\n", CONN_STATE_NAMES[s], state == s);
+  }
+
+  // Prometheus wants each family's samples together: families outside,
+  // devices inside. One device copied at a time (under 1 KB of stack),
+  // so the lock is short.
+  ConnDeviceStats_t d;
+  for (int f = 0; f < CONN_FAMILY_COUNT; f++) {
+    out.printf("# TYPE %s\n", CONN_FAMILY_TYPES[f]);
+    for (size_t i = 0; i < CONN_STATS_MAX_DEVICES; i++) {
+      portENTER_CRITICAL(&g_connStatsMux);
+      d = g_connStats[i];
+      portEXIT_CRITICAL(&g_connStatsMux);
+      if (d.inUse) writeFamily(out, (ConnFamily_t)f, d);
+    }
+  }
+}
@@ -0,0 +1,98 @@
+/***************************************************************
+ * Decode error statistics (see decode_stats.h)
+ ***************************************************************/
+
+#include <Arduino.h>
+
+#include "decode_stats.h"
+#include "clock.h"
+
+struct DecodeSample_t {
+  uint32_t time;       // seconds since boot
+  uint8_t  length;     // original frame length
+  uint8_t  bytes[DECODE_SAMPLE_MAX_LEN];
+};
+
+struct DecodeDeviceStats_t {
+  bool     inUse;
+  uint8_t  address[6];
+  unsigned long lastMillis;
+  uint32_t counts[DECODE_RESULT_COUNT];
+  DecodeSample_t samples[DECODE_RESULT_COUNT][DECODE_SAMPLES_PER_REASON];
+};
+
+static DecodeDeviceStats_t g_decodeStats[DECODE_STATS_MAX_DEVICES];
+
+static DecodeDeviceStats_t* findDevice(const uint8_t address[6], bool create) {
+  DecodeDeviceStats_t* slot = nullptr;
+  for (size_t i = 0; i < DECODE_STATS_MAX_DEVICES; i++) {
+    DecodeDeviceStats_t &d = g_decodeStats[i];
+    if (d.inUse && memcmp(d.address, address, 6) == 0) return &d;
+    if (slot == nullptr || (slot->inUse && (!d.inUse || d.lastMillis < slot->lastMillis))) {
+      slot = &d;
+    }
+  }
+  if (!create) return nullptr;
+
+  memset(slot, 0, sizeof(*slot));
+  memcpy(slot->address, address, 6);
+  slot->inUse = true;
+  return slot;
+}
+
+void decodeStatsRecord(const uint8_t address[6], FridgeDecodeResult_t result,
+                       const uint8_t* frame, size_t length) {
+  DecodeDeviceStats_t* d = findDevice(address, true);
+  d->lastMillis = clockMillis();
+  uint32_t seen = ++d->counts[result];
+  if (result == DECODE_OK) return;
+
+  // Reservoir sampling: the k-th failure replaces a random sample with probability n/k
+  uint32_t index = seen - 1;
+  if (index >= DECODE_SAMPLES_PER_REASON) {
+    index = (uint32_t)random((long)seen);
+    if (index >= DECODE_SAMPLES_PER_REASON) return;
+  }
+  DecodeSample_t &s = d->samples[result][index];
+  s.time = (uint32_t)(clockMillis() / 1000);
+  s.length = (uint8_t)min(length, (size_t)UINT8_MAX);
+  memcpy(s.bytes, frame, min(length, (size_t)DECODE_SAMPLE_MAX_LEN));
+}
+
+uint32_t decodeStatsCount(const uint8_t address[6], FridgeDecodeResult_t result) {
+  DecodeDeviceStats_t* d = findDevice(address, false);
+  return d ? d->counts[result] : 0;
+}
+
+void decodeStatsPrint() {
+  bool any = false;
+  for (size_t i = 0; i < DECODE_STATS_MAX_DEVICES; i++) {
+    const DecodeDeviceStats_t &d = g_decodeStats[i];
+    if (!d.inUse) continue;
+    any = true;
+
+    uint32_t total = 0;
+    for (int r = 0; r < DECODE_RESULT_COUNT; r++) total += d.counts[r];
+    Serial.printf("[DECODE] %02x:%02x:%02x:%02x:%02x:%02x: %lu frames",
+                  d.address[0], d.address[1], d.address[2], d.address[3], d.address[4], d.address[5],
+                  (unsigned long)total);
+    for (int r = 0; r < DECODE_RESULT_COUNT; r++) {
+      Serial.printf(", %s %lu", decodeResultName((FridgeDecodeResult_t)r), (unsigned long)d.counts[r]);
+    }
+    Serial.println();
+
+    for (int r = DECODE_OK + 1; r < DECODE_RESULT_COUNT; r++) {
+      uint32_t kept = min(d.counts[r], (uint32_t)DECODE_SAMPLES_PER_REASON);
+      for (uint32_t k = 0; k < kept; k++) {
+        const DecodeSample_t &s = d.samples[r][k];
+        Serial.printf("  %s @%lus (%u bytes):", decodeResultName((FridgeDecodeResult_t)r),
+                      (unsigned long)s.time, s.length);
+        for (size_t b = 0; b < min((size_t)s.length, (size_t)DECODE_SAMPLE_MAX_LEN); b++) {
+          Serial.printf(" %02X", s.bytes[b]);
+        }
+        Serial.println(s.length > DECODE_SAMPLE_MAX_LEN ? " ..." : "");
+      }
+    }
+  }
+  if (!any) Serial.println("[DECODE] No frames received yet");
+}
@@ -0,0 +1,98 @@
+/***************************************************************
+ * Status history (see history.h)
+ ***************************************************************/
+
+#include <Arduino.h>
+
+#include "history.h"
+#include "clock.h"
+
+static HistoryRecord_t g_history[HISTORY_CAPACITY];
+static uint32_t g_historyEndSeq = 0;   // sequence number of the next append
+static portMUX_TYPE g_historyMux = portMUX_INITIALIZER_UNLOCKED;
+
+HistoryRecord_t historyMakeRecord(const FridgeStatus_t &status, uint32_t time) {
+  HistoryRecord_t r;
+  r.time          = time;
+  r.leftCurrent   = status.leftCurrent;
+  r.leftTarget    = status.leftTarget;
+  r.batPercent    = status.batPercent;
+  r.flags         = (status.locked ? HISTORY_FLAG_LOCKED : 0) |
+                    (status.poweredOn ? HISTORY_FLAG_POWERED : 0) |
+                    (status.runMode == 1 ? HISTORY_FLAG_ECO : 0) |
+                    (status.unit == 1 ? HISTORY_FLAG_FAHRENHEIT : 0);
+  r.batMillivolts = (uint16_t)(status.batVolInt * 1000 + status.batVolDec * 100);
+  return r;
+}
+
+void historyAppend(const HistoryRecord_t &record) {
+  portENTER_CRITICAL(&g_historyMux);
+  g_history[g_historyEndSeq % HISTORY_CAPACITY] = record;
+  g_historyEndSeq++;
+  portEXIT_CRITICAL(&g_historyMux);
+}
+
+void historyBounds(uint32_t &firstSeq, uint32_t &endSeq) {
+  portENTER_CRITICAL(&g_historyMux);
+  endSeq = g_historyEndSeq;
+  portEXIT_CRITICAL(&g_historyMux);
+  firstSeq = endSeq > HISTORY_CAPACITY ? endSeq - HISTORY_CAPACITY : 0;
+}
+
+size_t historyCopyRange(uint32_t from, uint32_t to, uint32_t &cursor, uint8_t* buf, size_t maxLen) {
+  size_t written = 0;
+  bool more = true;
+
+  // Records outside the range are skipped too, so the lock is released
+  // every HISTORY_SCAN_PER_LOCK records examined, copied or not
+  while (more && written + sizeof(HistoryRecord_t) <= maxLen) {
+    portENTER_CRITICAL(&g_historyMux);
+    uint32_t first = g_historyEndSeq > HISTORY_CAPACITY ? g_historyEndSeq - HISTORY_CAPACITY : 0;
+    if (cursor < first) cursor = first;
+    for (int examined = 0; examined < HISTORY_SCAN_PER_LOCK; examined++) {
+      more = cursor < g_historyEndSeq;
+      if (!more || written + sizeof(HistoryRecord_t) > maxLen) break;
+      const HistoryRecord_t &r = g_history[cursor % HISTORY_CAPACITY];
+      cursor++;
+      if (r.time < from || r.time > to) continue;
+      memcpy(buf + written, &r, sizeof(r));
+      written += sizeof(r);
+    }
+    portEXIT_CRITICAL(&g_historyMux);
+  }
+
+  return written;
+}
+
+void historyExportBegin(HistoryExport_t &exp, uint32_t from, uint32_t to) {
+  uint32_t endSeq;
+  exp.from = from;
+  exp.to = to;
+  historyBounds(exp.cursor, endSeq);
+  exp.headerSent = false;
+  exp.done = false;
+  exp.bytesSent = 0;
+  exp.startMillis = clockMillis();
+  exp.heapAtStart = 0;
+  exp.heapLowest = 0;
+  exp.largestBlockLowest = 0;
+}
+
+size_t historyExportChunk(HistoryExport_t &exp, uint8_t* buf, size_t maxLen) {
+  size_t len = 0;
+  if (!exp.headerSent) {
+    if (maxLen < sizeof(HistoryHeader_t)) return 0;
+    HistoryHeader_t header = { HISTORY_MAGIC, HISTORY_VERSION,
+                               (uint8_t)sizeof(HistoryRecord_t), (uint32_t)(clockMillis() / 1000) };
+    memcpy(buf, &header, sizeof(header));
+    len = sizeof(header);
+    exp.headerSent = true;
+  }
+  size_t room = maxLen - len;
+  size_t records = historyCopyRange(exp.from, exp.to, exp.cursor, buf + len, room);
+  // With room for a record, nothing copied means the range is exhausted
+  if (records == 0 && room >= sizeof(HistoryRecord_t)) exp.done = true;
+  len += records;
+  exp.bytesSent += len;
+  return len;
+}
@@ -0,0 +1,115 @@
+/***************************************************************
+ * Home Assistant integration (see home_assistant.h)
+ ***************************************************************/
+
+#include <Arduino.h>
+
+#include "home_assistant.h"
+#include "ha_discovery.h"
+#include "mqtt_link.h"
+#include "clock.h"
+#include "log.h"
+
+static HaPublisher_t g_ha;
+static bool g_haEnabled = false;
+static HomeAssistantCommandSink g_haSink = nullptr;
+static FridgeStatus_t g_haStatus;
+static bool g_haHaveStatus = false;
+
+// Steady state starts after the last discovery burst
+static unsigned long g_haSteadyMillis = 0;
+static uint32_t g_haSteadyMessages = 0;
+static uint64_t g_haSteadyBytes = 0;
+static uint32_t g_haReadings = 0;
+
+static bool haPublish(void* ctx, const char* topic, const char* payload, bool retain) {
+  return mqttLinkPublishTopic(topic, payload, retain);
+}
+
+static void haMqttConnected() {
+  haConnected(g_ha);
+}
+
+static void haCommandReceived(const char* topic, const uint8_t* payload, size_t len) {
+  char error[HA_ERROR_LEN] = "no reading yet";
+  std::vector<uint8_t> packet;
+  FridgeStatus_t settings = g_haStatus;
+  bool ok = g_haHaveStatus &&
+            haBuildCommand((const char*)payload, len, settings, packet, error, sizeof(error));
+  if (ok && !g_haSink(packet.data(), packet.size())) {
+    snprintf(error, sizeof(error), "fridge not connected or queue full");
+    ok = false;
+  }
+  if (!ok) {
+    g_ha.stats.rejected++;
+    LOG_WARN("[HA] Command rejected: %s", error);
+    return;
+  }
+  // Until the next reading confirms it, the queued value is the current
+  // one, so a set-other frame queued next does not write the old one back
+  g_haStatus = settings;
+  g_ha.stats.commands++;
+  char command[32];
+  size_t n = min(len, sizeof(command) - 1);
+  memcpy(command, payload, n);
+  command[n] = '\0';
+  LOG_INFO("[HA] Command %s queued", command);
+}
+
+void homeAssistantBegin(const char* firmwareVersion, HomeAssistantCommandSink sink) {
+  g_haSink = sink;
+  haBegin(g_ha, mqttLinkBaseTopic(), firmwareVersion, haPublish, nullptr);
+  mqttLinkSetWill("ha/availability", "offline");
+  mqttLinkSubscribe("ha/set", haCommandReceived);
+  mqttLinkOnConnect(haMqttConnected);
+  g_haEnabled = true;
+}
+
+void homeAssistantReading(const FridgeStatus_t &status) {
+  g_haStatus = status;
+  g_haHaveStatus = true;
+  g_haReadings++;
+}
+
+void homeAssistantLoop(bool fresh, const char* deviceName) {
+  if (!g_haEnabled || !mqttLinkConnected()) return;
+  uint32_t discovery = g_ha.stats.discovery;
+  uint32_t sent = haUpdate(g_ha, g_haHaveStatus ? &g_haStatus : nullptr, fresh, deviceName);
+  if (g_ha.stats.discovery != discovery) {
+    LOG_INFO("[HA] Discovery published for %s", g_ha.node);
+    g_haSteadyMillis = clockMillis();
+    g_haSteadyMessages = 0;
+    g_haSteadyBytes = g_ha.stats.bytes;
+    g_haReadings = 0;
+  } else {
+    g_haSteadyMessages += sent;
+  }
+}
+
+void homeAssistantPrint(Print &out) {
+  if (!g_haEnabled) {
+    out.println("[HA] off (no MQTT)");
+    return;
+  }
+  const HaStats_t &st = g_ha.stats;
+  out.printf("[HA] node %s: discovery %lu, states %lu, availability %lu, failed %lu, %llu bytes\n", g_ha.node,
+             (unsigned long)st.discovery, (unsigned long)st.states, (unsigned long)st.availability,
+             (unsigned long)st.failures, (unsigned long long)st.bytes);
+  out.print("[HA] states per entity:");
+  for (uint8_t i = 0; i < HA_ENTITY_COUNT; i++) {
+    out.printf(" %s %lu", HA_ENTITIES[i].object, (unsigned long)st.perEntity[i]);
+  }
+  out.println();
+  out.printf("[HA] commands %lu, rejected %lu\n", (unsigned long)st.commands, (unsigned long)st.rejected);
+
+  unsigned long elapsed = g_haSteadyMillis != 0 ? clockMillis() - g_haSteadyMillis : 0;
+  if (elapsed < 60000) {
+    out.println("[HA] steady state: less than a minute since discovery");
+    return;
+  }
+  float hours = elapsed / 3600000.0f;
+  out.printf("[HA] steady state: %.1f msg/h, %.0f B/h over %.2f h; %lu readings would be %.1f msg/h "
+             "publishing every entity\n",
+             g_haSteadyMessages / hours, (st.bytes - g_haSteadyBytes) / hours, hours,
+             (unsigned long)g_haReadings, g_haReadings * HA_ENTITY_COUNT / hours);
+}
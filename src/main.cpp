@@ -17,168 +17,368 @@
 #include <BLEUtils.h>
 #include <BLEScan.h>
 #include <BLEAdvertisedDevice.h>
+#include <WiFi.h>
 #include <Arduino.h>
+#include <limits.h>
+#include <atomic>
+
+#include "fridge_protocol.h"
+#include "relay_server.h"
+#include "ble_history_service.h"
+#include "web_server.h"
+#include "history.h"
+#include "clock.h"
+#include "log.h"
+#include "binlog.h"
+#include "notify_mailbox.h"
+#include "decode_stats.h"
+#include "conn_stats.h"
+#include "watchdog.h"
+#include "sd_log.h"
+#include "mqtt_link.h"
+#include "alarms.h"
+#include "config_store.h"
+#include "link_monitor.h"
+#include "home_assistant.h"
+#include "benchmark.h"
 
 /** -------------------------
  * CONFIGURATION
+ *
+ * Values marked (remote) are only defaults: the live ones
+ * come from configCurrent() and can be changed over MQTT
+ * (config_store.h).
  * ------------------------- */
 
-// The name advertised by the fridge's BLE module
+// Reported by the benchmark suite; set per release with build_flags
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "dev"
+#endif
+
+// The name advertised by the fridge's BLE module (remote)
 #define TARGET_DEVICE_NAME "WT-0001"
 
-// Service and characteristic UUIDs
-static BLEUUID serviceUUID((uint16_t)0x1234);     // 0x1234
-static BLEUUID charUUID_Write((uint16_t)0x1235);  // 0x1235 (Write)
-static BLEUUID charUUID_Notify((uint16_t)0x1236); // 0x1236 (Notify)
+// Set to 1 to only watch which fridges are advertising (passive scan,
+// never connects). Useful for a gateway watching a whole yard.
+// Fridges are matched by name or, failing that, by the advertised
+// service UUID. A fridge that puts both only in its scan response is
+// not seen: passive scans never request it.
+#define PRESENCE_ONLY 0
+
+// Set to 1 to also act as a GATT server so phones can read the status
+// while we hold the fridge's only connection
+#define RELAY_SERVER_ENABLED 1
+
+// Set to 1 to let relay phones send FE FE commands to the fridge. The
+// command characteristic then only accepts writes over a link bonded
+// with RELAY_PASSKEY (6 digits, entered on the phone when pairing)
+#ifndef RELAY_COMMANDS_ENABLED
+#define RELAY_COMMANDS_ENABLED 0
+#endif
+#ifndef RELAY_PASSKEY
+#define RELAY_PASSKEY 246801
+#endif
+
+// Wi-Fi network for the web server / WebSocket live status. Leave the SSID
+// empty to keep Wi-Fi off; both can also be set with build_flags.
+#ifndef WIFI_SSID
+#define WIFI_SSID ""
+#endif
+#ifndef WIFI_PASSWORD
+#define WIFI_PASSWORD ""
+#endif
+
+// Set to 1 on boards with an SD slot to keep history (and, with
+// -DLOG_BINARY, the log) on the card; SD_CS_PIN is its SPI chip select
+#define SD_CARD_ENABLED 0
+#define SD_CS_PIN 5
+
+// MQTT broker (needs Wi-Fi); leave the host empty to keep MQTT off
+#ifndef MQTT_HOST
+#define MQTT_HOST ""
+#endif
+#ifndef MQTT_PORT
+#define MQTT_PORT MQTT_DEFAULT_PORT
+#endif
+#ifndef MQTT_USER
+#define MQTT_USER ""
+#endif
+#ifndef MQTT_PASSWORD
+#define MQTT_PASSWORD ""
+#endif
+
+// Alarms go to MQTT and, if set, are POSTed as JSON to this URL
+// (e.g. "http://192.168.1.10:8080/alarm") (remote)
+#ifndef ALARM_WEBHOOK_URL
+#define ALARM_WEBHOOK_URL ""
+#endif
+
+// Service and characteristic UUIDs (remote)
+#define SERVICE_UUID "1234"
+#define WRITE_CHAR_UUID "1235"
+#define NOTIFY_CHAR_UUID "1236"
 
-// We will send a "query" command every 60 seconds
-const unsigned long QUERY_INTERVAL_MS = 60000;
+// Query cadence, response timeout, link score and freshness SLO defaults:
+// include/link_monitor.h
+
+// Blocking BLE client calls longer than this are cut short by the watchdog
+// supervisor, which tears the client down instead of rebooting
+const unsigned long BLE_CONNECT_TIMEOUT_MS = 10000;
+const unsigned long BLE_DISCOVERY_TIMEOUT_MS = 8000;
+const unsigned long BLE_CALL_TIMEOUT_MS = 3000;
+// How long a reconnect waits for the previous link to close
+const unsigned long BLE_CLOSE_WAIT_MS = 1000;
+
+// Presence: a fridge not heard advertising for PRESENCE_TIMEOUT_MS has left
+const unsigned long PRESENCE_TIMEOUT_MS = 60000;
+#define PRESENCE_MAX_DEVICES 16
+
+// Background scan while connected: BG_SCAN_DURATION_S seconds every
+// BG_SCAN_PERIOD_MS at a low duty cycle (window/interval, in ms), only in
+// the gap between queries so it never overlaps a pending response. Every
+// BG_SCAN_MEASURE_EVERY-th scan is instead started just before a query, so
+// the RTT statistics show what scanning costs the link (0 = never).
+const unsigned long BG_SCAN_PERIOD_MS = 30000;
+const uint32_t BG_SCAN_DURATION_S = 3;
+const uint32_t BG_SCAN_MEASURE_EVERY = 10;
+const uint16_t BG_SCAN_INTERVAL_MS = 500;
+const uint16_t BG_SCAN_WINDOW_MS = 30;
+
+// Alarms, evaluated every ALARM_EVAL_INTERVAL_MS: the fridge is more than
+// ALARM_TEMP_MARGIN degrees above its target, or the battery is below
+// ALARM_BATTERY_LOW_PERCENT. Each clears only once back past the threshold
+// by its hysteresis, so a reading sitting on the threshold does not flap.
+// (thresholds and the dispatcher pacing in ALARM_DEFAULT_CONFIG: remote)
+const unsigned long ALARM_EVAL_INTERVAL_MS = 1000;
+const int ALARM_TEMP_MARGIN = 5;
+const int ALARM_TEMP_HYSTERESIS = 2;
+const uint8_t ALARM_BATTERY_LOW_PERCENT = 20;
+const uint8_t ALARM_BATTERY_HYSTERESIS = 5;
+
+// Outgoing command queue: per-priority ring size and longest command
+#define COMMAND_QUEUE_DEPTH 4
+#define COMMAND_MAX_LEN 20
+
+// Serial console: longest accepted command line, export chunk size
+#define SERIAL_LINE_MAX_LEN 64
+#define SERIAL_EXPORT_CHUNK 256
+
+// Buffer for the human-readable status block
+#define STATUS_TEXT_MAX_LEN 320
+
+// Default iterations per kernel for the 'bench' command (BENCHMARK_MODE)
+#define BENCH_DEFAULT_ITERATIONS 1000
 
 /** -------------------------
  * GLOBAL VARIABLES
  * ------------------------- */
 
+/** --------------------------------------------------
+ * Synchronization contract
+ *
+ * Three contexts touch shared state: loop() on the
+ * Arduino task, the BLE callbacks (notify, scan result,
+ * client disconnect, relay command, scan complete) on the
+ * Bluedroid task, and the async web server on the TCP
+ * task.
+ *
+ *  - connected, doConnect, g_bgScanActive: std::atomic,
+ *    written from both sides, read anywhere.
+ *  - Fridge address: the scan callback stores what it
+ *    found in g_foundAddress (g_foundAddressMux) and sets
+ *    doConnect; loop() copies it into pServerAddress,
+ *    which is allocated once and belongs to loop() alone.
+ *  - Notification frames: g_notifyMailbox (own lock);
+ *    loop() decodes its private copy in g_frame.
+ *  - Command queue, presence table: g_commandMux,
+ *    g_presenceMux.
+ *  - History, relay, BLE history (per-phone transfers
+ *    and their counters), web server, SD sink and
+ *    connection stats: locked inside their modules.
+ *    Decode stats, MQTT, alarms, Home Assistant and the
+ *    configuration:
+ *    loop() only, except the fridge name and service
+ *    UUID, which the scan callback reads with
+ *    configCopyDeviceName() / configCopyServiceUuid().
+ *  - pClient: created once in setup() and never replaced.
+ *    loop() only, except the watchdog teardown, which
+ *    only posts a disconnect while loop() is blocked
+ *    inside a client call; loop() marks the link down
+ *    itself when the call returns (bleCallEnd()).
+ *  - Everything else (g_link, g_lastReading,
+ *    g_frameCache, g_freshnessSlo, RTT stats, ...)
+ *    belongs to loop() alone.
+ * -------------------------------------------------- */
+
 BLEScan* pBLEScan;
 BLEAddress* pServerAddress = nullptr;
 
-bool doConnect = false;
-bool connected = false;
+// Address of the fridge the last scan found, handed from the scan callback to loop()
+static portMUX_TYPE g_foundAddressMux = portMUX_INITIALIZER_UNLOCKED;
+static esp_bd_addr_t g_foundAddress;
+
+std::atomic<bool> doConnect(false);
+std::atomic<bool> connected(false);
 
 BLEClient* pClient = nullptr;
 BLERemoteCharacteristic* pRemoteCharacteristicWrite = nullptr;
 BLERemoteCharacteristic* pRemoteCharacteristicNotify = nullptr;
 
-// Last time we sent a query
-unsigned long lastQueryMillis = 0;
-
-// Buffer for the last notification and a flag for "new data available"
-static std::vector<uint8_t> g_lastNotificationData; 
-static bool g_newDataAvailable = false;
-
-/** --------------------------------------------------
- * Data structure for a single-zone fridge query result
- * (after decoding the BLE response).
- * -------------------------------------------------- */
-struct FridgeStatus_t {
-  bool locked;
-  bool poweredOn;
-  uint8_t runMode;     // 0=MAX, 1=ECO
-  uint8_t batSaver;    // 0=Low, 1=Mid, 2=High
-  int8_t  leftTarget;
-  int8_t  tempMax;
-  int8_t  tempMin;
-  uint8_t leftRetDiff;
-  uint8_t startDelay;
-  uint8_t unit;        // 0 = Celsius, 1 = Fahrenheit
-  int8_t  leftTCHot;
-  int8_t  leftTCMid;
-  int8_t  leftTCCold;
-  int8_t  leftTCHalt;
-  int8_t  leftCurrent;
-  uint8_t batPercent;
-  uint8_t batVolInt;
-  uint8_t batVolDec;
+// Frames from the notify callback, and loop()'s copy of the one being handled
+static NotifyMailbox_t g_notifyMailbox;
+static uint8_t g_frame[NOTIFY_MAILBOX_MAX_LEN];
+static size_t g_frameLen = 0;
+static unsigned long g_frameMillis = 0;   // clockMillis() at which it arrived
+
+/** --------------------------------------------------
+ * Duplicate-frame cache for the connected fridge.
+ * In steady state the fridge answers every query with a
+ * byte-identical frame, so we keep a cheap hash plus a
+ * copy of the last frame that decoded fine. A repeat
+ * skips checksum, decode and printing and only
+ * refreshes the age of the published reading.
+ * -------------------------------------------------- */
+#define FRAME_CACHE_MAX_LEN 64
+
+struct FrameCache_t {
+  bool     valid;
+  uint32_t hash;
+  uint8_t  length;
+  uint8_t  bytes[FRAME_CACHE_MAX_LEN];
+  uint32_t framesTotal;
+  uint32_t framesSuppressed;
 };
 
+static FrameCache_t g_frameCache;
+
 /** --------------------------------------------------
- * Function: Calculates a simple checksum for standard
- * "FE FE" frames.
+ * Latest published reading: the decoded status plus the
+ * notify time of the frame it came from, so every
+ * consumer can tell how old it is.
  * -------------------------------------------------- */
-static uint16_t calculateChecksum(const uint8_t* buf, size_t len) {
-  uint32_t sum = 0;
-  for (size_t i = 0; i < len; i++) {
-    sum += buf[i];
-  }
-  return (uint16_t)(sum & 0xFFFF);
-}
+struct FridgeReading_t {
+  bool valid;
+  FridgeStatus_t status;
+  unsigned long notifyMillis;
+  uint8_t address[6];          // fridge it came from
+};
+
+static FridgeReading_t g_lastReading;
+
+// Freshness SLO window and link quality of the connected fridge (link_monitor.h)
+static FreshnessSlo_t g_freshnessSlo;
+static LinkQuality_t g_link;
 
 /** --------------------------------------------------
- * Function: Decodes a "query response" frame (0x01)
- *   FE FE [length] [0x01] [payload] [2-byte checksum]
- * For a single-zone fridge (18 bytes payload).
+ * Query round-trip statistics, split by whether a
+ * background scan was running when the query was sent.
  * -------------------------------------------------- */
-bool decodeFridgeQuerySingleZone(const uint8_t* data, size_t length, FridgeStatus_t &status) {
-  // Minimum length ~24 bytes: FE FE + length + code + 18 payload + 2 checksum
-  if (length < 24) return false;
-  if (data[0] != 0xFE || data[1] != 0xFE) return false;
+struct RttStats_t {
+  uint32_t count;
+  uint32_t sumMs;
+  uint32_t maxMs;
+};
 
-  uint8_t declaredLen = data[2];
-  uint8_t cmd = data[3];
-  if (cmd != 0x01) {
-    // Not a "query response" frame
-    return false;
-  }
+static RttStats_t g_rttIdle;
+static RttStats_t g_rttDuringScan;
 
-  // Last 2 bytes = checksum
-  if (length < 24) return false;
-  uint16_t offsetSum = length - 2;
-  uint16_t sumPacket = (data[offsetSum] << 8) | data[offsetSum + 1];
-  uint16_t sumCalc = calculateChecksum(data, offsetSum);
-  if (sumCalc != sumPacket) {
-    // Checksum mismatch
-    return false;
-  }
+// Background scan state
+static std::atomic<bool> g_bgScanActive(false);
+static bool g_querySentDuringScan = false;
+static unsigned long g_lastBgScanMillis = 0;
+static uint32_t g_bgScanCount = 0;
 
-  // Payload: bytes 4..21 (18 bytes)
-  const uint8_t* payload = &data[4];
-
-  status.locked       = (payload[0] == 1);
-  status.poweredOn    = (payload[1] == 1);
-  status.runMode      = payload[2];
-  status.batSaver     = payload[3];
-  status.leftTarget   = (int8_t)payload[4];
-  status.tempMax      = (int8_t)payload[5];
-  status.tempMin      = (int8_t)payload[6];
-  status.leftRetDiff  = payload[7];
-  status.startDelay   = payload[8];
-  status.unit         = payload[9];
-  status.leftTCHot    = (int8_t)payload[10];
-  status.leftTCMid    = (int8_t)payload[11];
-  status.leftTCCold   = (int8_t)payload[12];
-  status.leftTCHalt   = (int8_t)payload[13];
-  status.leftCurrent  = (int8_t)payload[14];
-  status.batPercent   = payload[15];
-  status.batVolInt    = payload[16];
-  status.batVolDec    = payload[17];
+/** --------------------------------------------------
+ * Presence table: one entry per fridge address seen
+ * advertising. The scan callback only refreshes
+ * lastSeenMillis/rssi; arrival and departure events are
+ * raised from loop() by updatePresence().
+ * -------------------------------------------------- */
+struct PresenceEntry_t {
+  bool inUse;
+  bool present;                // arrival already reported
+  uint8_t address[6];
+  int8_t rssi;
+  unsigned long lastSeenMillis;
+};
 
-  return true;
+/** --------------------------------------------------
+ * Outgoing command queue. Everything except BIND is
+ * written to the fridge from here, one command per loop,
+ * high priority (commands relayed from phones) first.
+ * Producers may run on the BLE task, hence the lock.
+ * -------------------------------------------------- */
+enum CommandPriority_t {
+  CMD_PRIORITY_HIGH = 0,
+  CMD_PRIORITY_LOW  = 1,
+  CMD_PRIORITY_COUNT
+};
+
+struct QueuedCommand_t {
+  uint8_t length;
+  uint8_t bytes[COMMAND_MAX_LEN];
+  bool    isQuery;             // answer counts for RTT / timeout tracking
+};
+
+struct CommandRing_t {
+  QueuedCommand_t slots[COMMAND_QUEUE_DEPTH];
+  uint8_t head;
+  uint8_t count;
+};
+
+static CommandRing_t g_commandQueue[CMD_PRIORITY_COUNT];
+static portMUX_TYPE g_commandMux = portMUX_INITIALIZER_UNLOCKED;
+
+static PresenceEntry_t g_presence[PRESENCE_MAX_DEVICES];
+static portMUX_TYPE g_presenceMux = portMUX_INITIALIZER_UNLOCKED;
+
+/** --------------------------------------------------
+ * Function: 32-bit FNV-1a hash, used to spot repeated
+ * frames before doing any decoding work.
+ * -------------------------------------------------- */
+static uint32_t hashFrame(const uint8_t* buf, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h ^= buf[i];
+    h *= 16777619u;
+  }
+  return h;
 }
 
 /** --------------------------------------------------
- * Function: buildQueryCommand
- *   In my scenario: FEFE03010200
+ * Function: Returns true if the frame is identical to the
+ * last one that decoded successfully. Always counts the
+ * frame.
  * -------------------------------------------------- */
-void buildQueryCommand(std::vector<uint8_t> &packet) {
-  // Using the literal bytes: FE FE 03 01 02 00
-  packet.clear();
-  packet.push_back(0xFE);
-  packet.push_back(0xFE);
-  packet.push_back(0x03);
-  packet.push_back(0x01);
-  packet.push_back(0x02);
-  packet.push_back(0x00);
+static bool isDuplicateFrame(FrameCache_t &cache, const uint8_t* data, size_t length, uint32_t hash) {
+  cache.framesTotal++;
+  if (!cache.valid || cache.hash != hash || cache.length != length) return false;
+  // Hash matched, confirm byte by byte so a collision can never hide a change
+  if (memcmp(cache.bytes, data, length) != 0) return false;
+
+  cache.framesSuppressed++;
+  return true;
 }
 
 /** --------------------------------------------------
- * Function: buildBindCommand
- *   In my scenario: "FEFE03010200FF"
+ * Function: Remembers a frame that decoded successfully.
+ * Frames longer than the cache are simply never suppressed.
  * -------------------------------------------------- */
-void buildBindCommand(std::vector<uint8_t> &packet) {
-  // Using the literal bytes: FE FE 03 01 02 00 FF
-  packet.clear();
-  packet.push_back(0xFE);
-  packet.push_back(0xFE);
-  packet.push_back(0x03);
-  packet.push_back(0x01);
-  packet.push_back(0x02);
-  packet.push_back(0x00);
-  packet.push_back(0xFF);
+static void rememberFrame(FrameCache_t &cache, const uint8_t* data, size_t length, uint32_t hash) {
+  if (length > FRAME_CACHE_MAX_LEN) {
+    cache.valid = false;
+    return;
+  }
+  memcpy(cache.bytes, data, length);
+  cache.length = (uint8_t)length;
+  cache.hash = hash;
+  cache.valid = true;
 }
 
 /** --------------------------------------------------
  * NOTIFY CALLBACK:
- *  Only saves the raw data into a global buffer
- *  and sets a "new data" flag.
+ *  Only posts a copy of the raw data to the mailbox
+ *  for loop() to pick up.
  * -------------------------------------------------- */
 static void notifyCallback(
   BLERemoteCharacteristic* pBLERemoteCharacteristic,
@@ -186,16 +386,74 @@ static void notifyCallback(
   size_t length,
   bool isNotify) 
 {
-  // Clear previous data
-  g_lastNotificationData.clear();
-  
-  // Copy new bytes
-  for (size_t i = 0; i < length; i++) {
-    g_lastNotificationData.push_back(pData[i]);
+  notifyMailboxPost(g_notifyMailbox, pData, length, clockMillis());
+  watchdogTrace("notify", (int32_t)length);
+}
+
+/** --------------------------------------------------
+ * recordPresence:
+ *  Called from the scan callback for every fridge
+ *  advertisement. Reuses the entry for a known address,
+ *  otherwise takes a free slot or the one heard from
+ *  least recently.
+ * -------------------------------------------------- */
+static void recordPresence(BLEAddress address, int rssi) {
+  const uint8_t* native = *address.getNative();
+  unsigned long now = clockMillis();
+
+  portENTER_CRITICAL(&g_presenceMux);
+  PresenceEntry_t* slot = nullptr;
+  for (size_t i = 0; i < PRESENCE_MAX_DEVICES; i++) {
+    PresenceEntry_t &e = g_presence[i];
+    if (e.inUse && memcmp(e.address, native, 6) == 0) {
+      slot = &e;
+      break;
+    }
+    if (slot == nullptr || (slot->inUse && (!e.inUse || e.lastSeenMillis < slot->lastSeenMillis))) {
+      slot = &e;
+    }
+  }
+  if (!slot->inUse || memcmp(slot->address, native, 6) != 0) {
+    memcpy(slot->address, native, 6);
+    slot->inUse = true;
+    slot->present = false;
+  }
+  slot->rssi = (int8_t)rssi;
+  slot->lastSeenMillis = now;
+  portEXIT_CRITICAL(&g_presenceMux);
+}
+
+/** --------------------------------------------------
+ * updatePresence:
+ *  Raises [PRESENCE] arrival events for new entries and
+ *  departure events for entries that timed out.
+ * -------------------------------------------------- */
+static void updatePresence(unsigned long now) {
+  for (size_t i = 0; i < PRESENCE_MAX_DEVICES; i++) {
+    portENTER_CRITICAL(&g_presenceMux);
+    PresenceEntry_t e = g_presence[i];
+    bool arrived = e.inUse && !e.present;
+    // Signed difference: the scan callback may have stamped an entry after 'now'
+    bool departed = e.inUse && e.present && (long)(now - e.lastSeenMillis) > (long)PRESENCE_TIMEOUT_MS;
+    if (arrived) g_presence[i].present = true;
+    if (departed) g_presence[i].inUse = false;
+    portEXIT_CRITICAL(&g_presenceMux);
+
+    if (arrived) {
+      LOG_INFO("[PRESENCE] Arrived %02x:%02x:%02x:%02x:%02x:%02x RSSI %d dBm",
+               e.address[0], e.address[1], e.address[2],
+               e.address[3], e.address[4], e.address[5], e.rssi);
+      if (connected && pServerAddress != nullptr &&
+          memcmp(e.address, *pServerAddress->getNative(), 6) != 0) {
+        LOG_INFO("[DISCOVERY] -> additional fridge available for onboarding");
+      }
+    } else if (departed) {
+      LOG_INFO("[PRESENCE] Departed %02x:%02x:%02x:%02x:%02x:%02x (last seen %lu s ago)",
+               e.address[0], e.address[1], e.address[2],
+               e.address[3], e.address[4], e.address[5],
+               (now - e.lastSeenMillis) / 1000);
+    }
   }
-  
-  // Flag that new data is available
-  g_newDataAvailable = true;
 }
 
 /** --------------------------------------------------
@@ -203,12 +461,28 @@ static void notifyCallback(
  * -------------------------------------------------- */
 class MyAdvertisedDeviceCallbacks: public BLEAdvertisedDeviceCallbacks {
   void onResult(BLEAdvertisedDevice advertisedDevice) {
-    Serial.print("Found device: ");
-    Serial.println(advertisedDevice.toString().c_str());
+    LOG_DEBUG("Found device: %s", advertisedDevice.toString().c_str());
     
-    if (advertisedDevice.haveName() && advertisedDevice.getName() == TARGET_DEVICE_NAME) {
-      Serial.println("-> This is our fridge, stopping scan and connecting...");
-      pServerAddress = new BLEAddress(advertisedDevice.getAddress());
+    char targetName[CONFIG_NAME_LEN];
+    configCopyDeviceName(targetName, sizeof(targetName));
+    bool match = advertisedDevice.haveName() && advertisedDevice.getName() == targetName;
+    if (!match && advertisedDevice.haveServiceUUID()) {
+      // A passive scan (PRESENCE_ONLY) never sees the scan response,
+      // which is where the name may be; the service UUID may still be
+      // in the advertisement itself
+      char serviceUuid[CONFIG_UUID_LEN];
+      configCopyServiceUuid(serviceUuid, sizeof(serviceUuid));
+      match = advertisedDevice.isAdvertisingService(BLEUUID(serviceUuid));
+    }
+    if (match) {
+      recordPresence(advertisedDevice.getAddress(), advertisedDevice.getRSSI());
+      // Background scans only feed the table, they never steal the connection
+      if (PRESENCE_ONLY || connected || doConnect) return;
+
+      LOG_INFO("-> This is our fridge, stopping scan and connecting...");
+      portENTER_CRITICAL(&g_foundAddressMux);
+      memcpy(g_foundAddress, *advertisedDevice.getAddress().getNative(), sizeof(g_foundAddress));
+      portEXIT_CRITICAL(&g_foundAddressMux);
       doConnect = true;
       pBLEScan->stop();
     }
@@ -220,14 +494,150 @@ class MyAdvertisedDeviceCallbacks: public BLEAdvertisedDeviceCallbacks {
  * -------------------------------------------------- */
 class MyClientCallback : public BLEClientCallbacks {
   void onConnect(BLEClient* pclient) {
-    Serial.println("[BLEClient] Connected to BLE server");
+    LOG_DEBUG("[BLEClient] Connected to BLE server");
   }
   void onDisconnect(BLEClient* pclient) {
-    Serial.println("[BLEClient] Disconnected from BLE server");
+    LOG_WARN("[BLEClient] Disconnected from BLE server");
     connected = false;
+    watchdogTrace("disconnected", 0);
   }
 };
 
+/** --------------------------------------------------
+ * teardownBleClient:
+ *  Watchdog teardown handler, runs on the supervisor task
+ *  while loop() is stuck in a client call. It only posts
+ *  the GATT close (Bluedroid queues it to its own task);
+ *  the resulting event releases the semaphore the call is
+ *  waiting on, so it returns to loop(). The link state is
+ *  left to loop(), see bleCallEnd().
+ * -------------------------------------------------- */
+static void teardownBleClient(const char* call) {
+  pClient->disconnect();
+}
+
+/** --------------------------------------------------
+ * bleCallEnd:
+ *  watchdogCallEnd() for the client calls in loop(). A
+ *  tripped call means the link is being torn down: loop()
+ *  finishes that here, on its own task (the disconnect is
+ *  harmless if the supervisor's close already landed).
+ * -------------------------------------------------- */
+static bool bleCallEnd() {
+  bool tripped = watchdogCallEnd();
+  if (tripped) {
+    connected = false;
+    pClient->disconnect();
+  }
+  return tripped;
+}
+
+/** --------------------------------------------------
+ * writeToFridge:
+ *  Writes a command to 0x1235. The BLE library does not
+ *  report write errors, so a write on a link that is no
+ *  longer up is what we count as a write failure.
+ * -------------------------------------------------- */
+static bool writeToFridge(std::vector<uint8_t> &packet) {
+  if (pClient == nullptr || pRemoteCharacteristicWrite == nullptr || !pClient->isConnected()) {
+    linkWriteFailed(g_link);
+    LOG_WARN("[LINK] Write failed: link is down");
+    return false;
+  }
+  watchdogCallBegin("writeValue", BLE_CALL_TIMEOUT_MS);
+  pRemoteCharacteristicWrite->writeValue(packet.data(), packet.size(), false);
+  if (bleCallEnd()) {
+    linkWriteFailed(g_link);
+    doConnect = (pServerAddress != nullptr);
+    return false;
+  }
+  return true;
+}
+
+/** --------------------------------------------------
+ * enqueueCommand:
+ *  Adds a command to the queue of the given priority.
+ *  Returns false if it is too long or the queue is full.
+ *  'queue' is g_commandQueue except in the benchmark.
+ * -------------------------------------------------- */
+static bool enqueueCommand(const uint8_t* data, size_t length, CommandPriority_t priority, bool isQuery,
+                           CommandRing_t* queue = g_commandQueue) {
+  if (length == 0 || length > COMMAND_MAX_LEN) return false;
+
+  bool queued = false;
+  portENTER_CRITICAL(&g_commandMux);
+  CommandRing_t &ring = queue[priority];
+  if (ring.count < COMMAND_QUEUE_DEPTH) {
+    QueuedCommand_t &cmd = ring.slots[(ring.head + ring.count) % COMMAND_QUEUE_DEPTH];
+    memcpy(cmd.bytes, data, length);
+    cmd.length = (uint8_t)length;
+    cmd.isQuery = isQuery;
+    ring.count++;
+    queued = true;
+  }
+  portEXIT_CRITICAL(&g_commandMux);
+  return queued;
+}
+
+/** --------------------------------------------------
+ * dequeueCommand:
+ *  Takes the oldest command of the highest non-empty
+ *  priority. Returns false if every queue is empty.
+ * -------------------------------------------------- */
+static bool dequeueCommand(QueuedCommand_t &out, CommandRing_t* queue = g_commandQueue) {
+  bool found = false;
+  portENTER_CRITICAL(&g_commandMux);
+  for (int p = 0; p < CMD_PRIORITY_COUNT && !found; p++) {
+    CommandRing_t &ring = queue[p];
+    if (ring.count == 0) continue;
+    out = ring.slots[ring.head];
+    ring.head = (ring.head + 1) % COMMAND_QUEUE_DEPTH;
+    ring.count--;
+    found = true;
+  }
+  portEXIT_CRITICAL(&g_commandMux);
+  return found;
+}
+
+/** --------------------------------------------------
+ * clearCommandQueue:
+ *  Drops everything still queued for a previous link.
+ * -------------------------------------------------- */
+static void clearCommandQueue() {
+  portENTER_CRITICAL(&g_commandMux);
+  memset(g_commandQueue, 0, sizeof(g_commandQueue));
+  portEXIT_CRITICAL(&g_commandMux);
+}
+
+/** --------------------------------------------------
+ * relayCommandReceived:
+ *  A phone wrote to the relay command characteristic
+ *  (BLE task). Only well-formed FE FE frames are queued.
+ * -------------------------------------------------- */
+static void relayCommandReceived(const uint8_t* data, size_t length) {
+  if (length < 4 || data[0] != 0xFE || data[1] != 0xFE) {
+    LOG_WARN("[RELAY] Ignoring malformed command");
+    return;
+  }
+  if (!connected || !enqueueCommand(data, length, CMD_PRIORITY_HIGH, false)) {
+    LOG_WARN("[RELAY] Command dropped: fridge not connected or queue full");
+  }
+}
+
+/** --------------------------------------------------
+ * queueHomeAssistantCommand:
+ *  A Home Assistant command, already a fridge frame
+ *  (loop()). A query follows it so the new state is
+ *  published right away, not at the next minute.
+ * -------------------------------------------------- */
+static bool queueHomeAssistantCommand(const uint8_t* data, size_t length) {
+  if (!connected || !enqueueCommand(data, length, CMD_PRIORITY_HIGH, false)) return false;
+  std::vector<uint8_t> queryCmd;
+  buildQueryCommand(queryCmd);
+  enqueueCommand(queryCmd.data(), queryCmd.size(), CMD_PRIORITY_HIGH, true);
+  return true;
+}
+
 /** --------------------------------------------------
  * connectToServer:
  *  - Connects to the BLE server
@@ -237,180 +647,826 @@ class MyClientCallback : public BLEClientCallbacks {
  *  - Sends BIND (FEFE03010200FF)
  * -------------------------------------------------- */
 bool connectToServer(BLEAddress pAddress) {
-  Serial.print("Connecting to: ");
-  Serial.println(pAddress.toString().c_str());
+  LOG_INFO("Connecting to: %s", pAddress.toString().c_str());
+  connStatsTransition(CONN_CONNECTING, *pAddress.getNative());
 
-  pClient = BLEDevice::createClient();
-  Serial.println("-> Created BLE client");
-  pClient->setClientCallbacks(new MyClientCallback());
+  // The one client is reused; a reconnect may find the old link still closing
+  for (unsigned long waited = 0; pClient->isConnected() && waited < BLE_CLOSE_WAIT_MS; waited += 10) {
+    clockDelay(10);
+  }
 
-  if (!pClient->connect(pAddress)) {
-    Serial.println("-> Connection failed");
+  watchdogCallBegin("connect", BLE_CONNECT_TIMEOUT_MS);
+  bool linkUp = pClient->connect(pAddress);
+  if (bleCallEnd()) linkUp = false;
+  if (!linkUp) {
+    LOG_ERROR("-> Connection failed");
+    connStatsTransition(CONN_DISCONNECTED, nullptr);
     return false;
   }
-  Serial.println("-> Connected to BLE server");
+  LOG_INFO("-> Connected to BLE server");
+  connStatsTransition(CONN_DISCOVERING, nullptr);
 
-  // Find service 0x1234
-  BLERemoteService* pRemoteService = pClient->getService(serviceUUID);
+  // UUIDs are read per connection, so a remote change applies here
+  const FridgeConfig_t &config = configCurrent();
+
+  // Find the service (default 0x1234)
+  watchdogCallBegin("getService", BLE_DISCOVERY_TIMEOUT_MS);
+  BLERemoteService* pRemoteService = pClient->getService(BLEUUID(config.serviceUuid));
+  if (bleCallEnd()) pRemoteService = nullptr;
   if (pRemoteService == nullptr) {
-    Serial.println("-> Service 0x1234 not found");
+    LOG_ERROR("-> Service %s not found", config.serviceUuid);
     pClient->disconnect();
+    connStatsTransition(CONN_DISCONNECTED, nullptr);
     return false;
   }
-  Serial.println("-> Found service 0x1234");
+  LOG_DEBUG("-> Found service %s", config.serviceUuid);
 
-  // Find characteristic Write=0x1235
-  pRemoteCharacteristicWrite = pRemoteService->getCharacteristic(charUUID_Write);
+  // Find the Write characteristic (default 0x1235)
+  pRemoteCharacteristicWrite = pRemoteService->getCharacteristic(BLEUUID(config.writeUuid));
   if (pRemoteCharacteristicWrite == nullptr) {
-    Serial.println("-> Characteristic 0x1235 not found");
+    LOG_ERROR("-> Characteristic %s not found", config.writeUuid);
     pClient->disconnect();
+    connStatsTransition(CONN_DISCONNECTED, nullptr);
     return false;
   }
-  Serial.println("-> Found Write characteristic (0x1235)");
+  LOG_DEBUG("-> Found Write characteristic (%s)", config.writeUuid);
 
-  // Find characteristic Notify=0x1236
-  pRemoteCharacteristicNotify = pRemoteService->getCharacteristic(charUUID_Notify);
+  // Find the Notify characteristic (default 0x1236)
+  pRemoteCharacteristicNotify = pRemoteService->getCharacteristic(BLEUUID(config.notifyUuid));
   if (pRemoteCharacteristicNotify == nullptr) {
-    Serial.println("-> Characteristic 0x1236 not found");
+    LOG_ERROR("-> Characteristic %s not found", config.notifyUuid);
     pClient->disconnect();
+    connStatsTransition(CONN_DISCONNECTED, nullptr);
     return false;
   }
-  Serial.println("-> Found Notify characteristic (0x1236)");
+  LOG_DEBUG("-> Found Notify characteristic (%s)", config.notifyUuid);
 
   // Register notify callback
   if (pRemoteCharacteristicNotify->canNotify()) {
+    watchdogCallBegin("registerForNotify", BLE_CALL_TIMEOUT_MS);
     pRemoteCharacteristicNotify->registerForNotify(notifyCallback);
-    Serial.println("-> Notify callback set");
+    if (bleCallEnd()) {
+      LOG_ERROR("-> Notify registration hung, giving up on this connection");
+      connStatsTransition(CONN_DISCONNECTED, nullptr);
+      return false;
+    }
+    LOG_DEBUG("-> Notify callback set");
   } else {
-    Serial.println("-> WARNING: 0x1236 does not support NOTIFY!");
+    LOG_WARN("-> WARNING: %s does not support NOTIFY!", config.notifyUuid);
   }
 
   connected = true;
 
+  // New connection: never treat the first frame as a repeat of an old one
+  memset(&g_frameCache, 0, sizeof(g_frameCache));
+  notifyMailboxClear(g_notifyMailbox);
+  clearCommandQueue();
+
+  // Link statistics restart with every connection, lifetime counters stay;
+  // the first query goes out right after the bind
+  linkConnected(g_link, clockMillis(), config);
+
   // Send BIND command
   {
     std::vector<uint8_t> bindCmd;
     buildBindCommand(bindCmd);
-    Serial.println("[BIND] Sending FEFE03010200FF...");
-    pRemoteCharacteristicWrite->writeValue(bindCmd.data(), bindCmd.size(), false);
+    connStatsTransition(CONN_BINDING, nullptr);
+    LOG_INFO("[BIND] Sending FEFE03010200FF...");
+    writeToFridge(bindCmd);
   }
 
-  // Prepare to send the first query soon
-  lastQueryMillis = millis() - QUERY_INTERVAL_MS;
-  
   return true;
 }
 
+/** --------------------------------------------------
+ * readingAgeMs():
+ *  Age of a reading relative to 'now'; a reading that
+ *  was never filled is reported as infinitely old.
+ * -------------------------------------------------- */
+static unsigned long readingAgeMs(const FridgeReading_t &reading, unsigned long now) {
+  if (!reading.valid) return ULONG_MAX;
+  return now - reading.notifyMillis;
+}
+
+/** --------------------------------------------------
+ * updateFreshnessSlo():
+ *  Called every loop. Feeds the age of the published
+ *  reading to the SLO monitor (link_monitor.h) and logs
+ *  fresh -> stale transitions, alerts when the window
+ *  percentage drops below FRESHNESS_SLO_PERCENT, and a
+ *  summary at the end of every window.
+ * -------------------------------------------------- */
+static void updateFreshnessSlo(FreshnessSlo_t &slo, unsigned long now) {
+  unsigned long bound = configCurrent().freshnessBoundMs;
+  unsigned long age = readingAgeMs(g_lastReading, now);
+  FreshnessReport_t report;
+  freshnessSloUpdate(slo, now, g_lastReading.valid, age, bound, report);
+
+  if (report.events & SLO_WENT_STALE) {
+    LOG_WARN("[SLO] Reading is stale: age %lu ms > bound %lu ms", age, bound);
+  }
+  if (report.events & SLO_FRESH_AGAIN) {
+    LOG_INFO("[SLO] Reading is fresh again");
+  }
+  if (report.events & SLO_ALERT) {
+    LOG_WARN("[SLO] ALERT: fresh %.2f%% of the time, target %.2f%%", report.percent, FRESHNESS_SLO_PERCENT);
+  }
+  if (report.events & SLO_RECOVERED) {
+    LOG_INFO("[SLO] Recovered: fresh %.2f%% of the time", report.percent);
+  }
+  if (report.events & SLO_WINDOW_END) {
+    LOG_INFO("[SLO] Window summary: fresh %.2f%%, %lu stale events",
+             report.percent, (unsigned long)report.staleEvents);
+  }
+}
+
+/** --------------------------------------------------
+ * updateLinkQuality():
+ *  Called every loop while connected. Detects response
+ *  timeouts, samples RSSI, recomputes the score and
+ *  triggers a controlled reconnect to the known address
+ *  when the link keeps degrading (rules and backoff in
+ *  link_monitor.h).
+ * -------------------------------------------------- */
+static void updateLinkQuality(LinkQuality_t &link, unsigned long now) {
+  const FridgeConfig_t &config = configCurrent();
+  if (linkCheckTimeout(link, now, config)) {
+    LOG_WARN("[LINK] No response within %lu ms (%u in a row)",
+             (unsigned long)config.responseTimeoutMs, link.consecutiveMisses);
+  }
+
+  if (!linkRssiSampleDue(link, now, config)) return;
+
+  watchdogCallBegin("getRssi", BLE_CALL_TIMEOUT_MS);
+  int rssi = pClient->getRssi();
+  if (bleCallEnd()) {
+    doConnect = (pServerAddress != nullptr);
+    return;
+  }
+
+  bool judged = link.reconnectOutcomePending;
+  LinkVerdict_t verdict = linkScoreSample(link, rssi, now, config);
+  if (judged && !link.reconnectOutcomePending) {
+    LOG_INFO("[LINK] Proactive reconnect #%lu %s, backoff now %lu s", (unsigned long)link.proactiveReconnects,
+             link.lastReconnectHelped ? "helped" : "did not help", link.reconnectBackoffMs / 1000);
+  }
+  if (verdict == LINK_GOOD) return;
+
+  LOG_WARN("[LINK] Low link quality: score %u, RSSI %.1f dBm (trend %.1f), %u misses%s",
+           link.score, link.rssiAvg, link.rssiTrend, link.consecutiveMisses,
+           verdict == LINK_HELD_OFF ? ", reconnect held off" : "");
+  if (verdict != LINK_RECONNECT) return;
+
+  // Controlled reconnect: we still know the address, so skip the scan
+  LOG_WARN("[LINK] Proactive reconnect #%lu, next one no sooner than %lu s", (unsigned long)link.proactiveReconnects,
+           link.reconnectBackoffMs / 1000);
+  pClient->disconnect();
+  connected = false;
+  doConnect = (pServerAddress != nullptr);
+}
+
+/** --------------------------------------------------
+ * updateAlarms():
+ *  Reports the current condition of every alarm of the
+ *  fridge behind the latest reading to the dispatcher,
+ *  which turns changes into raise / clear events. Keys
+ *  are "<fridge address>/<alarm type>". Nothing is
+ *  reported before the first reading.
+ * -------------------------------------------------- */
+static void updateAlarms(unsigned long now) {
+  static unsigned long lastEvalMillis = 0;
+  static bool tempHigh = false, batteryLow = false;
+  if (!g_lastReading.valid || now - lastEvalMillis < ALARM_EVAL_INTERVAL_MS) return;
+  lastEvalMillis = now;
+
+  const FridgeConfig_t &config = configCurrent();
+  const FridgeStatus_t &st = g_lastReading.status;
+  const uint8_t* a = g_lastReading.address;
+  char prefix[20];
+  snprintf(prefix, sizeof(prefix), "%02x:%02x:%02x:%02x:%02x:%02x/", a[0], a[1], a[2], a[3], a[4], a[5]);
+  char key[ALARM_KEY_LEN];
+
+  unsigned long age = readingAgeMs(g_lastReading, now);
+  snprintf(key, sizeof(key), "%s%s", prefix, ALARM_TYPE_NAMES[ALARM_STALE]);
+  alarmsReport(key, ALARM_STALE, age > config.freshnessBoundMs, (int32_t)(age / 1000));
+
+  snprintf(key, sizeof(key), "%s%s", prefix, ALARM_TYPE_NAMES[ALARM_SLO]);
+  alarmsReport(key, ALARM_SLO, g_freshnessSlo.alertActive, (int32_t)g_freshnessSlo.staleEvents);
+
+  int over = st.leftCurrent - st.leftTarget;
+  int margin = config.alarmTempMargin;
+  tempHigh = st.poweredOn && over >= (tempHigh ? margin - ALARM_TEMP_HYSTERESIS : margin);
+  snprintf(key, sizeof(key), "%s%s", prefix, ALARM_TYPE_NAMES[ALARM_TEMP_HIGH]);
+  alarmsReport(key, ALARM_TEMP_HIGH, tempHigh, st.leftCurrent);
+
+  int lowPercent = config.alarmBatteryLowPercent;
+  batteryLow = st.batPercent < (batteryLow ? lowPercent + ALARM_BATTERY_HYSTERESIS : lowPercent);
+  snprintf(key, sizeof(key), "%s%s", prefix, ALARM_TYPE_NAMES[ALARM_BATTERY_LOW]);
+  alarmsReport(key, ALARM_BATTERY_LOW, batteryLow, st.batPercent);
+}
+
+/** --------------------------------------------------
+ * recordRtt():
+ *  Adds one query round trip to a statistics bucket and
+ *  prints both buckets every 10 samples so the cost of
+ *  background scanning can be read off the log.
+ * -------------------------------------------------- */
+static void recordRtt(RttStats_t &stats, unsigned long rttMs) {
+  stats.count++;
+  stats.sumMs += rttMs;
+  if (rttMs > stats.maxMs) stats.maxMs = rttMs;
+
+  if ((g_rttIdle.count + g_rttDuringScan.count) % 10 == 0) {
+    LOG_DEBUG("[RTT] idle: n=%lu avg=%lu ms max=%lu ms | during scan: n=%lu avg=%lu ms max=%lu ms",
+              (unsigned long)g_rttIdle.count,
+              (unsigned long)(g_rttIdle.count ? g_rttIdle.sumMs / g_rttIdle.count : 0),
+              (unsigned long)g_rttIdle.maxMs,
+              (unsigned long)g_rttDuringScan.count,
+              (unsigned long)(g_rttDuringScan.count ? g_rttDuringScan.sumMs / g_rttDuringScan.count : 0),
+              (unsigned long)g_rttDuringScan.maxMs);
+  }
+}
+
+/** --------------------------------------------------
+ * Background scan completion (runs on the BLE task).
+ * -------------------------------------------------- */
+static void backgroundScanComplete(BLEScanResults results) {
+  g_bgScanActive = false;
+}
+
+/** --------------------------------------------------
+ * maybeStartBackgroundScan():
+ *  While connected, starts a short non-blocking low
+ *  duty-cycle scan every BG_SCAN_PERIOD_MS, but only when
+ *  no response is outstanding and the next query is not
+ *  due before the scan (plus its response) would end.
+ *  Measuring scans (every BG_SCAN_MEASURE_EVERY-th) wait
+ *  instead until the next query is due within the first
+ *  half of the scan, so it is sent while scanning.
+ * -------------------------------------------------- */
+static void maybeStartBackgroundScan(unsigned long now) {
+  if (g_bgScanActive || now - g_lastBgScanMillis < BG_SCAN_PERIOD_MS) return;
+  if (g_link.querySentMillis != 0) return;
+
+  const FridgeConfig_t &config = configCurrent();
+  unsigned long untilQuery = config.queryIntervalMs - (now - g_link.lastQueryMillis);
+  bool measure = BG_SCAN_MEASURE_EVERY != 0 && g_bgScanCount % BG_SCAN_MEASURE_EVERY == BG_SCAN_MEASURE_EVERY - 1;
+  if (now - g_link.lastQueryMillis >= config.queryIntervalMs) return;
+  if (measure ? untilQuery > BG_SCAN_DURATION_S * 1000 / 2
+              : untilQuery < BG_SCAN_DURATION_S * 1000 + config.responseTimeoutMs) return;
+
+  g_lastBgScanMillis = now;
+  g_bgScanCount++;
+  pBLEScan->clearResults();
+  pBLEScan->setInterval(BG_SCAN_INTERVAL_MS);
+  pBLEScan->setWindow(BG_SCAN_WINDOW_MS);
+  // Set first: the completion callback may run before start() returns
+  g_bgScanActive = true;
+  if (!pBLEScan->start(BG_SCAN_DURATION_S, backgroundScanComplete, false)) {
+    g_bgScanActive = false;
+  }
+}
+
+/** --------------------------------------------------
+ * formatFridgeStatus():
+ *  Renders a decoded status as the human-readable block
+ *  printed after every decode. Returns the text length.
+ * -------------------------------------------------- */
+static size_t formatFridgeStatus(const FridgeStatus_t &st, char* buf, size_t size) {
+  // runMode (0=MAX, 1=ECO)
+  const char* runModeStr = "UNKNOWN";
+  if (st.runMode == 0) runModeStr = "MAX";
+  else if (st.runMode == 1) runModeStr = "ECO";
+
+  // batSaver (0=Low,1=Mid,2=High)
+  const char* saverStr = "Unknown";
+  if (st.batSaver == 0) saverStr = "Low";
+  if (st.batSaver == 1) saverStr = "Mid";
+  if (st.batSaver == 2) saverStr = "High";
+
+  // Temperature unit
+  const char* tempUnit = (st.unit == 0) ? "°C" : "°F";
+
+  // battery voltage: assuming batVolDec is tenths
+  float batVoltage = st.batVolInt + (st.batVolDec / 10.0f);
+
+  int n = snprintf(buf, size,
+    "[DECODE] Single-zone fridge status:\r\n"
+    " -> locked: %s\r\n"
+    " -> poweredOn: %s\r\n"
+    " -> runMode: %s\r\n"
+    " -> batSaver: %s\r\n"
+    " -> leftTarget: %d%s\r\n"
+    " -> leftCurrent: %d%s\r\n"
+    " -> batPercent: %u%%\r\n"
+    " -> batVoltage: %.2f V\r\n",
+    st.locked ? "YES" : "NO",
+    st.poweredOn ? "ON" : "OFF",
+    runModeStr,
+    saverStr,
+    st.leftTarget, tempUnit,
+    st.leftCurrent, tempUnit,
+    st.batPercent,
+    batVoltage);
+  return (n > 0 && (size_t)n < size) ? (size_t)n : (n > 0 ? size - 1 : 0);
+}
+
+/** --------------------------------------------------
+ * storeHistory():
+ *  Appends a reading to the RAM history and, with a
+ *  card and unless turned off remotely, to the SD log.
+ * -------------------------------------------------- */
+static void storeHistory(const HistoryRecord_t &record) {
+  historyAppend(record);
+  if (SD_CARD_ENABLED && configCurrent().sdHistory) {
+    sdLogRecord(SD_RECORD_HISTORY, (const uint8_t*)&record, sizeof(record));
+  }
+}
+
+/** --------------------------------------------------
+ * handleNotification():
+ *  Decodes and displays the last notification frame,
+ *  unless it is a repeat of the previous one.
+ * -------------------------------------------------- */
+static void handleNotification() {
+  // Any answer proves the link is alive
+  unsigned long rttMs;
+  if (linkResponse(g_link, g_frameMillis, rttMs)) {
+    recordRtt(g_querySentDuringScan ? g_rttDuringScan : g_rttIdle, rttMs);
+  }
+
+  const uint8_t* frame = g_frame;
+  size_t frameLen = g_frameLen;
+  uint32_t frameHash = hashFrame(frame, frameLen);
+  static const uint8_t noAddress[6] = { 0 };
+  const uint8_t* address = pServerAddress != nullptr ? (const uint8_t*)*pServerAddress->getNative() : noAddress;
+
+  if (isDuplicateFrame(g_frameCache, frame, frameLen, frameHash)) {
+    decodeStatsRecord(address, DECODE_OK, frame, frameLen);
+    // Same content as the published reading, it is just newer now
+    g_lastReading.notifyMillis = g_frameMillis;
+    storeHistory(historyMakeRecord(g_lastReading.status, g_frameMillis / 1000));
+    homeAssistantReading(g_lastReading.status);
+    LOG_DEBUG("[LOOP] Unchanged frame, decode skipped (%lu/%lu suppressed, %.1f%%)",
+              (unsigned long)g_frameCache.framesSuppressed,
+              (unsigned long)g_frameCache.framesTotal,
+              100.0f * g_frameCache.framesSuppressed / g_frameCache.framesTotal);
+    return;
+  }
+
+  LOG_DEBUG("[LOOP] New notification data received. Decoding...");
+
+  FridgeStatus_t st;
+  FridgeDecodeResult_t result = decodeFridgeQuery(frame, frameLen, st);
+  decodeStatsRecord(address, result, frame, frameLen);
+
+  if (result != DECODE_OK) {
+    // One line only; sampled frames are shown by the 'decode' command
+    LOG_WARN("[DECODE] Frame rejected: %s, %u bytes (#%lu)", decodeResultName(result),
+             (unsigned)frameLen, (unsigned long)decodeStatsCount(address, result));
+  } else {
+    rememberFrame(g_frameCache, frame, frameLen, frameHash);
+    if (connStatsState() == CONN_BINDING) {
+      connStatsTransition(CONN_READY, nullptr);
+      watchdogDataFlowing();
+    }
+
+    g_lastReading.status = st;
+    g_lastReading.notifyMillis = g_frameMillis;
+    memcpy(g_lastReading.address, address, sizeof(g_lastReading.address));
+    g_lastReading.valid = true;
+    storeHistory(historyMakeRecord(st, g_frameMillis / 1000));
+    homeAssistantReading(st);
+
+    if (RELAY_SERVER_ENABLED) {
+      relayServerPublish(st, readingAgeMs(g_lastReading, clockMillis()));
+    }
+    if (WIFI_SSID[0] != '\0') {
+      webServerPublish(st, readingAgeMs(g_lastReading, clockMillis()));
+    }
+
+    // Display the decoded fridge status in a human-readable form
+#ifdef LOG_BINARY
+    // Same block as formatFridgeStatus(), but only the fields go over the wire
+    const char* unit = st.unit == 0 ? "°C" : "°F";
+    LOG_INFO("[DECODE] Single-zone fridge status:\r\n"
+             " -> locked: %s\r\n -> poweredOn: %s\r\n -> runMode: %s\r\n -> batSaver: %s\r\n"
+             " -> leftTarget: %d%s\r\n -> leftCurrent: %d%s\r\n -> batPercent: %u%%\r\n"
+             " -> batVoltage: %u.%u V\r\n -> age: %lu ms",
+             st.locked ? "YES" : "NO", st.poweredOn ? "ON" : "OFF",
+             st.runMode == 0 ? "MAX" : (st.runMode == 1 ? "ECO" : "UNKNOWN"),
+             st.batSaver == 0 ? "Low" : (st.batSaver == 1 ? "Mid" : (st.batSaver == 2 ? "High" : "Unknown")),
+             st.leftTarget, unit, st.leftCurrent, unit, st.batPercent, st.batVolInt, st.batVolDec,
+             readingAgeMs(g_lastReading, clockMillis()));
+#else
+    if (LOG_ENABLED(LOG_LEVEL_INFO)) {
+      char text[STATUS_TEXT_MAX_LEN];
+      formatFridgeStatus(st, text, sizeof(text));
+      LOG_INFO("%s -> age: %lu ms", text, readingAgeMs(g_lastReading, clockMillis()));
+    }
+#endif
+  }
+}
+
+/** --------------------------------------------------
+ * exportHistoryToSerial():
+ *  Streams the history records in [from, to] as binary:
+ *    "[EXPORT] BEGIN\n"
+ *    frames (see history.h), the last one empty
+ *    "[EXPORT] END ...\n"
+ *  The payload is the same HistoryHeader_t + records that
+ *  /api/history serves. Uses one fixed frame buffer.
+ * -------------------------------------------------- */
+static void exportHistoryToSerial(uint32_t from, uint32_t to) {
+  static uint8_t frame[SERIAL_EXPORT_CHUNK + HISTORY_FRAME_OVERHEAD];
+  HistoryExport_t exp;
+  historyExportBegin(exp, from, to);
+
+  Serial.println("[EXPORT] BEGIN");
+  size_t len;
+  do {
+    len = historyExportChunk(exp, frame + 4, SERIAL_EXPORT_CHUNK);
+    uint16_t sum = historyFrameChecksum(frame + 4, len);
+    frame[0] = HISTORY_FRAME_SYNC0;
+    frame[1] = HISTORY_FRAME_SYNC1;
+    frame[2] = (uint8_t)(len & 0xFF);
+    frame[3] = (uint8_t)(len >> 8);
+    frame[4 + len] = (uint8_t)(sum & 0xFF);
+    frame[5 + len] = (uint8_t)(sum >> 8);
+    // One write per frame, so log lines only ever land between frames
+    Serial.write(frame, len + HISTORY_FRAME_OVERHEAD);
+  } while (len > 0);
+  Serial.flush();
+
+  unsigned long ms = clockMillis() - exp.startMillis;
+  Serial.printf("[EXPORT] END %u bytes in %lu ms (%lu B/s)\n", (unsigned)exp.bytesSent, ms,
+                (unsigned long)(exp.bytesSent * 1000UL / (ms ? ms : 1)));
+}
+
+#ifdef BENCHMARK_MODE
+/** --------------------------------------------------
+ * Benchmark kernels. Each works on a sample 0x01 frame
+ * and writes its result somewhere the compiler cannot
+ * optimise away.
+ * -------------------------------------------------- */
+static uint8_t g_benchFrame[24];
+static FridgeStatus_t g_benchStatus;
+static volatile uint32_t g_benchSink;
+
+static void buildBenchFrame() {
+  static const uint8_t payload[18] = { 0, 1, 1, 2, 4, 20, 0xEC, 1, 0, 0, 0, 0, 0, 0, 5, 80, 12, 6 };
+  g_benchFrame[0] = 0xFE;
+  g_benchFrame[1] = 0xFE;
+  g_benchFrame[2] = 21;
+  g_benchFrame[3] = 0x01;
+  memcpy(&g_benchFrame[4], payload, sizeof(payload));
+  uint16_t sum = calculateChecksum(g_benchFrame, 22);
+  g_benchFrame[22] = sum >> 8;
+  g_benchFrame[23] = sum & 0xFF;
+  decodeFridgeQuerySingleZone(g_benchFrame, sizeof(g_benchFrame), g_benchStatus);
+}
+
+static void benchChecksum(void* ctx) {
+  g_benchSink = calculateChecksum(g_benchFrame, 22);
+}
+
+static void benchDecode(void* ctx) {
+  FridgeStatus_t st;
+  g_benchSink = decodeFridgeQuerySingleZone(g_benchFrame, sizeof(g_benchFrame), st) + st.leftCurrent;
+}
+
+static void benchFormat(void* ctx) {
+  char text[STATUS_TEXT_MAX_LEN];
+  g_benchSink = formatFridgeStatus(g_benchStatus, text, sizeof(text));
+}
+
+// The same log line formatted as text, and encoded as a -DLOG_BINARY record
+static void benchLogText(void* ctx) {
+  char text[96];
+  g_benchSink = snprintf(text, sizeof(text), "[LINK] Low link quality: score %u, RSSI %.1f dBm, %u misses\n",
+                         (unsigned)g_benchStatus.batPercent, -71.5f, (unsigned)g_benchStatus.leftTarget);
+}
+
+static void benchLogBinary(void* ctx) {
+  BinlogRecord_t r;
+  binlogBegin(r, BINLOG_ID(LOG_LEVEL_WARN, "[LINK] Low link quality: score %u, RSSI %.1f dBm, %u misses"),
+              (uint32_t)g_benchSink);
+  binlogPutArgs(r, (unsigned)g_benchStatus.batPercent, -71.5f, (unsigned)g_benchStatus.leftTarget);
+  g_benchSink = binlogFinish(r);
+}
+
+// Same code and lock as the real queue, but its own rings: pending
+// commands and relay writes arriving meanwhile are left alone
+static CommandRing_t g_benchQueue[CMD_PRIORITY_COUNT];
+
+static void benchQueue(void* ctx) {
+  QueuedCommand_t cmd;
+  enqueueCommand(g_benchFrame, 6, CMD_PRIORITY_LOW, false, g_benchQueue);
+  g_benchSink = dequeueCommand(cmd, g_benchQueue);
+}
+
+/** --------------------------------------------------
+ * runBenchmarks():
+ *  Runs every kernel 'iterations' times and prints one
+ *  JSON line per kernel (see benchmark.cpp).
+ * -------------------------------------------------- */
+static void runBenchmarks(uint32_t iterations) {
+  buildBenchFrame();
+  memset(g_benchQueue, 0, sizeof(g_benchQueue));
+
+  BenchResult_t result;
+  benchmarkBegin(FIRMWARE_VERSION, iterations);
+  benchmarkRun("checksum", iterations, benchChecksum, nullptr, result);
+  benchmarkRun("decode", iterations, benchDecode, nullptr, result);
+  benchmarkRun("format_status", iterations, benchFormat, nullptr, result);
+  benchmarkRun("queue_push_pop", iterations, benchQueue, nullptr, result);
+  benchmarkRun("log_text", iterations, benchLogText, nullptr, result);
+  benchmarkRun("log_binary", iterations, benchLogBinary, nullptr, result);
+  benchmarkEnd();
+}
+#endif // BENCHMARK_MODE
+
+/** --------------------------------------------------
+ * commandArgs():
+ *  The arguments if 'line' is the command word 'word' on
+ *  its own or followed by a space, else nullptr.
+ * -------------------------------------------------- */
+static const char* commandArgs(const char* line, const char* word) {
+  size_t n = strlen(word);
+  if (strncmp(line, word, n) != 0 || (line[n] != '\0' && line[n] != ' ')) return nullptr;
+  return line + n;
+}
+
+/** --------------------------------------------------
+ * handleSerialCommand():
+ *  Commands typed on the serial console:
+ *    export [from] [to]   history range, seconds since boot
+ *    bench [iterations]   microbenchmarks (BENCHMARK_MODE builds)
+ *    decode               decode error counters and sample frames
+ *    conn                 connection state-time metrics
+ *    wdt                  watchdog trips, recovery times and trace
+ *    sd                   SD card sink counters and write latency
+ *    mqtt                 broker connection and traffic counters
+ *    alarms               active alarms, queue and delivery stats
+ *    config               active configuration and apply/NVS stats
+ *    ha                   Home Assistant messages and rate per hour
+ *    relay                relay phones, notify fan-out and commands
+ * -------------------------------------------------- */
+static void handleSerialCommand(const char* line) {
+  const char* args;
+  if ((args = commandArgs(line, "export")) != nullptr) {
+    unsigned long from = 0, to = UINT32_MAX;
+    sscanf(args, "%lu %lu", &from, &to);
+    exportHistoryToSerial((uint32_t)from, (uint32_t)to);
+  } else if (strcmp(line, "decode") == 0) {
+    decodeStatsPrint();
+  } else if (strcmp(line, "conn") == 0) {
+    connStatsWrite(Serial);
+  } else if (strcmp(line, "wdt") == 0) {
+    watchdogPrint(Serial);
+  } else if (strcmp(line, "sd") == 0) {
+    sdLogPrint(Serial);
+  } else if (strcmp(line, "mqtt") == 0) {
+    mqttLinkPrint(Serial);
+  } else if (strcmp(line, "alarms") == 0) {
+    alarmsPrint(Serial);
+  } else if (strcmp(line, "config") == 0) {
+    configStorePrint(Serial);
+  } else if (strcmp(line, "ha") == 0) {
+    homeAssistantPrint(Serial);
+  } else if (strcmp(line, "relay") == 0) {
+    if (RELAY_SERVER_ENABLED) relayServerPrint(Serial);
+    else Serial.println("[RELAY] off");
+#ifdef BENCHMARK_MODE
+  } else if ((args = commandArgs(line, "bench")) != nullptr) {
+    unsigned long iterations = BENCH_DEFAULT_ITERATIONS;
+    sscanf(args, "%lu", &iterations);
+    runBenchmarks((uint32_t)iterations);
+#endif
+  } else if (line[0] != '\0') {
+    Serial.printf("[CMD] Unknown command: %s\n", line);
+  }
+}
+
+/** --------------------------------------------------
+ * pollSerialCommands():
+ *  Collects console input without blocking and runs a
+ *  command for every complete line.
+ * -------------------------------------------------- */
+static void pollSerialCommands() {
+  static char line[SERIAL_LINE_MAX_LEN];
+  static size_t lineLen = 0;
+
+  while (Serial.available() > 0) {
+    char c = (char)Serial.read();
+    if (c == '\r') continue;
+    if (c == '\n') {
+      line[lineLen] = '\0';
+      handleSerialCommand(line);
+      lineLen = 0;
+    } else if (lineLen < sizeof(line) - 1) {
+      line[lineLen++] = c;
+    }
+  }
+}
+
+/** --------------------------------------------------
+ * defaultConfig():
+ *  The configuration used until a document is stored,
+ *  built from the compile-time defaults above.
+ * -------------------------------------------------- */
+static void defaultConfig(FridgeConfig_t &c) {
+  memset(&c, 0, sizeof(c));
+  strncpy(c.deviceName, TARGET_DEVICE_NAME, sizeof(c.deviceName) - 1);
+  strncpy(c.serviceUuid, SERVICE_UUID, sizeof(c.serviceUuid) - 1);
+  strncpy(c.writeUuid, WRITE_CHAR_UUID, sizeof(c.writeUuid) - 1);
+  strncpy(c.notifyUuid, NOTIFY_CHAR_UUID, sizeof(c.notifyUuid) - 1);
+  linkDefaultConfig(c);
+  c.alarmTempMargin = ALARM_TEMP_MARGIN;
+  c.alarmBatteryLowPercent = ALARM_BATTERY_LOW_PERCENT;
+  const AlarmConfig_t alarm = ALARM_DEFAULT_CONFIG;
+  c.alarmBurst = alarm.burst;
+  c.alarmMinIntervalMs = alarm.keyMinIntervalMs;
+  c.alarmEscalateAfterMs = alarm.escalateAfterMs;
+  c.alarmRefillMs = alarm.refillMs;
+  strncpy(c.webhookUrl, ALARM_WEBHOOK_URL, sizeof(c.webhookUrl) - 1);
+  c.mqttAlarms = true;
+  c.sdHistory = true;
+}
+
+static AlarmConfig_t alarmConfigFrom(const FridgeConfig_t &c) {
+  AlarmConfig_t a = ALARM_DEFAULT_CONFIG;
+  a.keyMinIntervalMs = c.alarmMinIntervalMs;
+  a.escalateAfterMs = c.alarmEscalateAfterMs;
+  a.burst = c.alarmBurst;
+  a.refillMs = c.alarmRefillMs;
+  return a;
+}
+
+/** --------------------------------------------------
+ * configReloaded():
+ *  A remote patch was applied. Everything read through
+ *  configCurrent() follows on its own; the alarm
+ *  dispatcher keeps copies and is told here.
+ * -------------------------------------------------- */
+static void configReloaded(const FridgeConfig_t &config, uint32_t changedMask) {
+  alarmsConfigure(alarmConfigFrom(config), config.webhookUrl, config.mqttAlarms);
+  if (changedMask & configReconnectMask()) {
+    char names[128];
+    configFormatFieldNames(changedMask & configReconnectMask(), names, sizeof(names));
+    LOG_INFO("[CONFIG] %s apply at the next connection", names);
+  }
+}
+
 /** --------------------------------------------------
  * setup()
  * -------------------------------------------------- */
 void setup() {
   Serial.begin(115200);
-  Serial.println("----- [Start] Alpicool BLE Client (English) -----");
+  LOG_INFO("----- [Start] Alpicool BLE Client (English) -----");
+  watchdogBegin(teardownBleClient);
+  {
+    static FridgeConfig_t defaults;
+    defaultConfig(defaults);
+    configStoreBegin(defaults, configReloaded);
+  }
+  if (SD_CARD_ENABLED) {
+    sdLogBegin(SD_CS_PIN);
+  }
 
   BLEDevice::init("ESP32-Alpicool-Client");
 
+  // One client for every connection, so recoveries allocate nothing
+  pClient = BLEDevice::createClient();
+  pClient->setClientCallbacks(new MyClientCallback());
+
   pBLEScan = BLEDevice::getScan();
   pBLEScan->setAdvertisedDeviceCallbacks(new MyAdvertisedDeviceCallbacks());
-  pBLEScan->setActiveScan(true);
+  // Presence-only mode listens passively: no scan requests, no connections
+  pBLEScan->setActiveScan(!PRESENCE_ONLY);
   pBLEScan->setInterval(100);
   pBLEScan->setWindow(99);
+
+  if (RELAY_SERVER_ENABLED) {
+    relayServerBegin(RELAY_COMMANDS_ENABLED ? relayCommandReceived : nullptr, RELAY_PASSKEY);
+    bleHistoryServiceBegin();
+  }
+
+  // Wi-Fi connects in the background; the server starts listening right away
+  if (WIFI_SSID[0] != '\0') {
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(true);
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    webServerBegin();
+    mqttLinkBegin(MQTT_HOST, MQTT_PORT, MQTT_USER, MQTT_PASSWORD);
+    homeAssistantBegin(FIRMWARE_VERSION, queueHomeAssistantCommand);
+    const FridgeConfig_t &config = configCurrent();
+    alarmsBegin(alarmConfigFrom(config), config.webhookUrl, config.mqttAlarms);
+  }
 }
 
 /** --------------------------------------------------
  * loop()
  * -------------------------------------------------- */
 void loop() {
+  watchdogFeed();
+
   // 1) If not connected and not set to connect -> Scan for 5s
+  if (!connected && connStatsState() >= CONN_BINDING) {
+    connStatsTransition(CONN_DISCONNECTED, nullptr);
+  }
   if (!connected && !doConnect) {
-    Serial.println("[SCAN] Starting BLE scan (5s)...");
+    if (g_bgScanActive) {
+      pBLEScan->stop();
+      g_bgScanActive = false;
+    }
+    connStatsTransition(CONN_SCANNING, nullptr);
+    LOG_INFO("[SCAN] Starting BLE scan (5s)...");
+    pBLEScan->setInterval(100);
+    pBLEScan->setWindow(99);
     pBLEScan->start(5);
     pBLEScan->clearResults();
   }
 
   // 2) If doConnect -> connect to the server
   if (doConnect) {
+    esp_bd_addr_t found;
+    portENTER_CRITICAL(&g_foundAddressMux);
+    memcpy(found, g_foundAddress, sizeof(found));
+    portEXIT_CRITICAL(&g_foundAddressMux);
+    if (pServerAddress == nullptr) {
+      pServerAddress = new BLEAddress(found);
+    } else {
+      *pServerAddress = BLEAddress(found);
+    }
     connectToServer(*pServerAddress);
     doConnect = false;
   }
 
   // 3) If connected, send a "query" every minute
   if (connected && pRemoteCharacteristicWrite != nullptr) {
-    unsigned long now = millis();
-    if (now - lastQueryMillis >= QUERY_INTERVAL_MS) {
-      lastQueryMillis = now;
-
+    unsigned long now = clockMillis();
+    if (linkQueryDue(g_link, now, configCurrent())) {
       std::vector<uint8_t> queryCmd;
       buildQueryCommand(queryCmd);
 
-      Serial.println("[QUERY] Sending command  (query)...");
-      pRemoteCharacteristicWrite->writeValue(queryCmd.data(), queryCmd.size(), false);
+      LOG_DEBUG("[QUERY] Queueing command  (query)...");
+      enqueueCommand(queryCmd.data(), queryCmd.size(), CMD_PRIORITY_LOW, true);
+    }
+
+    // Send at most one queued command per loop, highest priority first
+    QueuedCommand_t cmd;
+    if (dequeueCommand(cmd)) {
+      std::vector<uint8_t> packet(cmd.bytes, cmd.bytes + cmd.length);
+      if (writeToFridge(packet) && cmd.isQuery) {
+        linkQuerySent(g_link, now);
+        g_querySentDuringScan = g_bgScanActive;
+      }
     }
   }
 
   // 4) If new notification data has arrived, decode and display it here
-  if (g_newDataAvailable) {
-    g_newDataAvailable = false; // reset the flag
+  if (notifyMailboxTake(g_notifyMailbox, g_frame, g_frameLen, g_frameMillis)) {
+    handleNotification();
+  }
 
-    Serial.println("[LOOP] New notification data received. Decoding...");
+  // 5) Report fridges arriving / leaving radio range
+  updatePresence(clockMillis());
 
-    FridgeStatus_t st;
-    bool ok = decodeFridgeQuerySingleZone(g_lastNotificationData.data(), g_lastNotificationData.size(), st);
+  // 6) Watch the link while we have one, and look for other fridges
+  if (connected && pClient != nullptr) {
+    updateLinkQuality(g_link, clockMillis());
+  }
+  if (connected && !PRESENCE_ONLY) {
+    maybeStartBackgroundScan(clockMillis());
+  }
 
-    if (!ok) {
-      Serial.print("[DECODE] Error decoding or not a query response. Raw bytes: ");
-      for (size_t i = 0; i < g_lastNotificationData.size(); i++) {
-        Serial.printf("%02X ", g_lastNotificationData[i]);
-      }
-      Serial.println();
-    } else {
-      // Display the decoded fridge status in a human-readable form
-      Serial.println("[DECODE] Single-zone fridge status:");
-
-      // locked / poweredOn
-      Serial.print(" -> locked: ");
-      Serial.println(st.locked ? "YES" : "NO");
-
-      Serial.print(" -> poweredOn: ");
-      Serial.println(st.poweredOn ? "ON" : "OFF");
-
-      // runMode (0=MAX, 1=ECO)
-      String runModeStr = "UNKNOWN";
-      if (st.runMode == 0) runModeStr = "MAX";
-      else if (st.runMode == 1) runModeStr = "ECO";
-      Serial.print(" -> runMode: ");
-      Serial.println(runModeStr);
-
-      // batSaver (0=Low,1=Mid,2=High)
-      String saverStr = "Unknown";
-      if (st.batSaver == 0) saverStr = "Low";
-      if (st.batSaver == 1) saverStr = "Mid";
-      if (st.batSaver == 2) saverStr = "High";
-      Serial.print(" -> batSaver: ");
-      Serial.println(saverStr);
-
-      // Temperature unit
-      String tempUnit = (st.unit == 0) ? "°C" : "°F";
-
-      Serial.print(" -> leftTarget: ");
-      Serial.print(st.leftTarget);
-      Serial.println(tempUnit);
-
-      Serial.print(" -> leftCurrent: ");
-      Serial.print(st.leftCurrent);
-      Serial.println(tempUnit);
-
-      Serial.print(" -> batPercent: ");
-      Serial.print(st.batPercent);
-      Serial.println("%");
-
-      // battery voltage: assuming batVolDec is tenths
-      float batVoltage = st.batVolInt + (st.batVolDec / 10.0f);
-      Serial.print(" -> batVoltage: ");
-      Serial.print(batVoltage, 2);
-      Serial.println(" V");
-    }
+  // 7) Track how fresh the published reading is
+  updateFreshnessSlo(g_freshnessSlo, clockMillis());
+
+  // 8) Web server housekeeping (drops closed WebSocket clients), broker
+  //    connection, alarms, Home Assistant states
+  if (WIFI_SSID[0] != '\0') {
+    webServerLoop();
+    mqttLinkLoop();
+    updateAlarms(clockMillis());
+    alarmsPoll();
+    const FridgeConfig_t &config = configCurrent();
+    homeAssistantLoop(readingAgeMs(g_lastReading, clockMillis()) <= config.freshnessBoundMs, config.deviceName);
+  }
+
+  // 9) Serial console commands
+  pollSerialCommands();
+
+  // 10) Bulk history download to a phone, paced by its credits
+  if (RELAY_SERVER_ENABLED) {
+    bleHistoryServiceLoop();
+  }
+
+  // 11) Full blocks to the SD card, periodic sync
+  if (SD_CARD_ENABLED) {
+    sdLogPoll();
   }
 
-  delay(100);
+  clockDelay(100);
 }
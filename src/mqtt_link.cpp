@@ -0,0 +1,179 @@
+/***************************************************************
+ * MQTT broker connection (see mqtt_link.h)
+ ***************************************************************/
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+
+#include "mqtt_link.h"
+#include "clock.h"
+#include "log.h"
+
+struct MqttSubscription_t {
+  char subtopic[MQTT_TOPIC_MAX_LEN];
+  MqttMessageHandler handler;
+};
+
+static WiFiClient g_mqttSocket;
+static PubSubClient g_mqtt(g_mqttSocket);
+static const char* g_mqttUser = nullptr;
+static const char* g_mqttPassword = nullptr;
+static bool g_mqttEnabled = false;
+static char g_mqttBase[32];
+static char g_mqttClientId[32];
+static char g_mqttWillTopic[MQTT_TOPIC_MAX_LEN];
+static const char* g_mqttWillPayload = nullptr;
+
+static MqttSubscription_t g_mqttSubs[MQTT_MAX_SUBSCRIPTIONS];
+static uint8_t g_mqttSubCount = 0;
+static MqttConnectHandler g_mqttConnectHandlers[MQTT_MAX_CONNECT_HANDLERS];
+static uint8_t g_mqttConnectHandlerCount = 0;
+
+static unsigned long g_mqttNextAttemptMillis = 0;
+static unsigned long g_mqttBackoffMs = MQTT_RECONNECT_MIN_MS;
+
+// Counters for the 'mqtt' command
+static uint32_t g_mqttConnects = 0;
+static uint32_t g_mqttConnectFailures = 0;
+static uint32_t g_mqttPublished = 0;
+static uint32_t g_mqttPublishFailures = 0;
+static uint64_t g_mqttPublishedBytes = 0;
+static uint32_t g_mqttReceived = 0;
+
+static void formatTopic(char* buf, size_t size, const char* subtopic) {
+  snprintf(buf, size, "%s/%s", g_mqttBase, subtopic);
+}
+
+/** --------------------------------------------------
+ * PubSubClient callback, runs inside g_mqtt.loop().
+ * -------------------------------------------------- */
+static void mqttMessageReceived(char* topic, uint8_t* payload, unsigned int len) {
+  g_mqttReceived++;
+  size_t baseLen = strlen(g_mqttBase);
+  if (strncmp(topic, g_mqttBase, baseLen) != 0 || topic[baseLen] != '/') return;
+  const char* subtopic = topic + baseLen + 1;
+  for (uint8_t i = 0; i < g_mqttSubCount; i++) {
+    if (strcmp(g_mqttSubs[i].subtopic, subtopic) == 0) {
+      g_mqttSubs[i].handler(topic, payload, len);
+      return;
+    }
+  }
+}
+
+void mqttLinkBegin(const char* host, uint16_t port, const char* user, const char* password) {
+  uint64_t mac = ESP.getEfuseMac();
+  snprintf(g_mqttBase, sizeof(g_mqttBase), "fridge/%06lx", (unsigned long)((mac >> 24) & 0xFFFFFF));
+  snprintf(g_mqttClientId, sizeof(g_mqttClientId), "fridge-%012llx", (unsigned long long)mac);
+  if (host == nullptr || host[0] == '\0') return;
+
+  g_mqttUser = user != nullptr && user[0] != '\0' ? user : nullptr;
+  g_mqttPassword = password;
+  g_mqtt.setServer(host, port);
+  g_mqtt.setBufferSize(MQTT_BUFFER_SIZE);
+  g_mqtt.setSocketTimeout(MQTT_SOCKET_TIMEOUT_S);
+  g_mqtt.setCallback(mqttMessageReceived);
+  g_mqttSocket.setTimeout(MQTT_SOCKET_TIMEOUT_S);
+  g_mqttEnabled = true;
+}
+
+/** --------------------------------------------------
+ * One connection attempt; on success every registered
+ * topic is subscribed again (clean session).
+ * -------------------------------------------------- */
+static void mqttConnect() {
+  unsigned long t0 = clockMillis();
+  bool ok = g_mqttWillPayload != nullptr
+                ? g_mqtt.connect(g_mqttClientId, g_mqttUser, g_mqttPassword, g_mqttWillTopic, 1, true,
+                                 g_mqttWillPayload)
+                : g_mqtt.connect(g_mqttClientId, g_mqttUser, g_mqttPassword);
+  if (!ok) {
+    g_mqttConnectFailures++;
+    LOG_WARN("[MQTT] Connect failed (state %d), retry in %lu ms", g_mqtt.state(), g_mqttBackoffMs);
+    g_mqttNextAttemptMillis = clockMillis() + g_mqttBackoffMs;
+    g_mqttBackoffMs = min(g_mqttBackoffMs * 2, (unsigned long)MQTT_RECONNECT_MAX_MS);
+    return;
+  }
+  g_mqttConnects++;
+  g_mqttBackoffMs = MQTT_RECONNECT_MIN_MS;
+  char topic[MQTT_TOPIC_MAX_LEN];
+  for (uint8_t i = 0; i < g_mqttSubCount; i++) {
+    formatTopic(topic, sizeof(topic), g_mqttSubs[i].subtopic);
+    g_mqtt.subscribe(topic, 1);
+  }
+  LOG_INFO("[MQTT] Connected as %s in %lu ms", g_mqttClientId, clockMillis() - t0);
+  for (uint8_t i = 0; i < g_mqttConnectHandlerCount; i++) {
+    g_mqttConnectHandlers[i]();
+  }
+}
+
+void mqttLinkLoop() {
+  if (!g_mqttEnabled || WiFi.status() != WL_CONNECTED) return;
+  if (!g_mqtt.connected()) {
+    if ((long)(clockMillis() - g_mqttNextAttemptMillis) >= 0) mqttConnect();
+    if (!g_mqtt.connected()) return;
+  }
+  g_mqtt.loop();
+}
+
+bool mqttLinkConnected() {
+  return g_mqttEnabled && g_mqtt.connected();
+}
+
+const char* mqttLinkBaseTopic() {
+  return g_mqttBase;
+}
+
+bool mqttLinkPublish(const char* subtopic, const char* payload, bool retain) {
+  char topic[MQTT_TOPIC_MAX_LEN];
+  formatTopic(topic, sizeof(topic), subtopic);
+  return mqttLinkPublishTopic(topic, payload, retain);
+}
+
+bool mqttLinkPublishTopic(const char* topic, const char* payload, bool retain) {
+  if (!mqttLinkConnected()) return false;
+  if (!g_mqtt.publish(topic, payload, retain)) {
+    g_mqttPublishFailures++;
+    return false;
+  }
+  g_mqttPublished++;
+  g_mqttPublishedBytes += strlen(topic) + strlen(payload);
+  return true;
+}
+
+bool mqttLinkSubscribe(const char* subtopic, MqttMessageHandler handler) {
+  if (g_mqttSubCount >= MQTT_MAX_SUBSCRIPTIONS) return false;
+  MqttSubscription_t &sub = g_mqttSubs[g_mqttSubCount++];
+  strncpy(sub.subtopic, subtopic, sizeof(sub.subtopic) - 1);
+  sub.handler = handler;
+  if (mqttLinkConnected()) {
+    char topic[MQTT_TOPIC_MAX_LEN];
+    formatTopic(topic, sizeof(topic), subtopic);
+    g_mqtt.subscribe(topic, 1);
+  }
+  return true;
+}
+
+void mqttLinkSetWill(const char* subtopic, const char* payload) {
+  formatTopic(g_mqttWillTopic, sizeof(g_mqttWillTopic), subtopic);
+  g_mqttWillPayload = payload;
+}
+
+bool mqttLinkOnConnect(MqttConnectHandler handler) {
+  if (g_mqttConnectHandlerCount >= MQTT_MAX_CONNECT_HANDLERS) return false;
+  g_mqttConnectHandlers[g_mqttConnectHandlerCount++] = handler;
+  return true;
+}
+
+void mqttLinkPrint(Print &out) {
+  if (!g_mqttEnabled) {
+    out.println("[MQTT] off (no broker configured)");
+    return;
+  }
+  out.printf("[MQTT] %s, base topic %s, %lu connects, %lu failed\n",
+             mqttLinkConnected() ? "connected" : "disconnected", g_mqttBase,
+             (unsigned long)g_mqttConnects, (unsigned long)g_mqttConnectFailures);
+  out.printf("[MQTT] published %lu (%llu bytes), %lu failed, received %lu\n",
+             (unsigned long)g_mqttPublished, (unsigned long long)g_mqttPublishedBytes,
+             (unsigned long)g_mqttPublishFailures, (unsigned long)g_mqttReceived);
+}
@@ -0,0 +1,150 @@
+/***************************************************************
+ * BLE GATT relay server (see relay_server.h)
+ ***************************************************************/
+
+#include <BLEDevice.h>
+#include <BLEServer.h>
+#include <BLE2902.h>
+#include <BLESecurity.h>
+#include <Arduino.h>
+
+#include "relay_server.h"
+#include "clock.h"
+#include "log.h"
+
+static BLEServer* pRelayServer = nullptr;
+static BLECharacteristic* pRelayStatusChar = nullptr;
+static RelayCommandHandler g_relayCommandHandler = nullptr;
+
+// Last value that was notified, used to suppress notifications without change
+static RelayStatus_t g_relayLastNotified;
+static bool g_relayHaveNotified = false;
+
+// Fan-out cost of notify(); commandWrites is written on the BLE task, the rest in loop()
+static RelayStats_t g_relayStats;
+
+/** --------------------------------------------------
+ * Server callbacks: keep advertising so that more than
+ * one phone can connect at the same time.
+ * -------------------------------------------------- */
+class RelayServerCallbacks : public BLEServerCallbacks {
+  void onConnect(BLEServer* pServer) {
+    LOG_INFO("[RELAY] Phone connected");
+    BLEDevice::startAdvertising();
+  }
+  void onDisconnect(BLEServer* pServer) {
+    LOG_INFO("[RELAY] Phone disconnected");
+    BLEDevice::startAdvertising();
+  }
+};
+
+/** --------------------------------------------------
+ * Command characteristic: hand the bytes to the sketch,
+ * which queues them for the fridge.
+ * -------------------------------------------------- */
+class RelayCommandCallbacks : public BLECharacteristicCallbacks {
+  void onWrite(BLECharacteristic* pCharacteristic) {
+    g_relayStats.commandWrites++;
+    g_relayCommandHandler(pCharacteristic->getData(), pCharacteristic->getLength());
+  }
+};
+
+void relayServerBegin(RelayCommandHandler onCommand, uint32_t passkey) {
+  g_relayCommandHandler = onCommand;
+
+  pRelayServer = BLEDevice::createServer();
+  pRelayServer->setCallbacks(new RelayServerCallbacks());
+
+  BLEService* pService = pRelayServer->createService(BLEUUID(RELAY_SERVICE_UUID));
+
+  pRelayStatusChar = pService->createCharacteristic(
+    BLEUUID(RELAY_STATUS_CHAR_UUID),
+    BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY);
+  pRelayStatusChar->addDescriptor(new BLE2902());
+
+  if (onCommand != nullptr) {
+    // Commands reach the fridge: the write needs a link encrypted by a
+    // passkey pairing (bonded, MITM protected). A Just Works bond is
+    // encrypted too but unauthenticated, so plain ENCRYPTED is not enough.
+    BLESecurity* pSecurity = new BLESecurity();
+    pSecurity->setStaticPIN(passkey);
+    pSecurity->setAuthenticationMode(ESP_LE_AUTH_REQ_SC_MITM_BOND);
+
+    BLECharacteristic* pCommandChar = pService->createCharacteristic(
+      BLEUUID(RELAY_COMMAND_CHAR_UUID),
+      BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_WRITE_NR);
+    pCommandChar->setAccessPermissions(ESP_GATT_PERM_WRITE_ENC_MITM);
+    pCommandChar->setCallbacks(new RelayCommandCallbacks());
+  }
+
+  pService->start();
+
+  BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
+  pAdvertising->addServiceUUID(BLEUUID(RELAY_SERVICE_UUID));
+  pAdvertising->setScanResponse(true);
+  BLEDevice::startAdvertising();
+
+  LOG_INFO("[RELAY] GATT relay server advertising (%s)", onCommand != nullptr ? "commands need pairing" : "read-only");
+}
+
+void relayServerPublish(const FridgeStatus_t &status, unsigned long ageMs) {
+  if (pRelayStatusChar == nullptr) return;
+
+  RelayStatus_t v;
+  v.version       = RELAY_STATUS_VERSION;
+  v.flags         = (status.locked ? 0x01 : 0) | (status.poweredOn ? 0x02 : 0);
+  v.runMode       = status.runMode;
+  v.batSaver      = status.batSaver;
+  v.leftTarget    = status.leftTarget;
+  v.leftCurrent   = status.leftCurrent;
+  v.unit          = status.unit;
+  v.batPercent    = status.batPercent;
+  v.batMillivolts = (uint16_t)(status.batVolInt * 1000 + status.batVolDec * 100);
+  v.ageSeconds    = (uint16_t)min(ageMs / 1000, 0xFFFFUL);
+
+  // Reads always see the current value, notifications only go out on change
+  pRelayStatusChar->setValue((uint8_t*)&v, sizeof(v));
+
+  bool changed = !g_relayHaveNotified ||
+                 memcmp(&v, &g_relayLastNotified, offsetof(RelayStatus_t, ageSeconds)) != 0;
+  if (!changed) return;
+  g_relayLastNotified = v;
+  g_relayHaveNotified = true;
+
+  uint32_t subscribers = pRelayServer->getConnectedCount();
+  if (subscribers == 0) return;
+
+  // One notify() call fans out to every subscribed phone
+  unsigned long t0 = clockMicros();
+  pRelayStatusChar->notify();
+  unsigned long elapsed = clockMicros() - t0;
+
+  g_relayStats.notifications++;
+  g_relayStats.phoneNotifications += subscribers;
+  g_relayStats.notifyMicros += elapsed;
+  if (elapsed > g_relayStats.maxNotifyMicros) g_relayStats.maxNotifyMicros = elapsed;
+  if (subscribers > g_relayStats.maxPhones) g_relayStats.maxPhones = subscribers;
+  LOG_DEBUG("[RELAY] Notified %lu phone(s) in %lu us", (unsigned long)subscribers, elapsed);
+}
+
+uint32_t relayServerSubscriberCount() {
+  return pRelayServer ? pRelayServer->getConnectedCount() : 0;
+}
+
+void relayServerPrint(Print &out) {
+  const RelayStats_t &st = g_relayStats;
+  out.printf("[RELAY] %lu phone(s) connected, command writes %lu\n",
+             (unsigned long)relayServerSubscriberCount(), (unsigned long)st.commandWrites);
+  if (st.notifications == 0) {
+    out.println("[RELAY] no notifications yet");
+    return;
+  }
+  out.printf("[RELAY] %lu notify() to %lu phone(s) (max %lu at once): avg %lu us, max %lu us, %lu us/phone\n",
+             (unsigned long)st.notifications, (unsigned long)st.phoneNotifications, (unsigned long)st.maxPhones,
+             (unsigned long)(st.notifyMicros / st.notifications), (unsigned long)st.maxNotifyMicros,
+             (unsigned long)(st.notifyMicros / st.phoneNotifications));
+}
+
+BLEServer* relayServerHandle() {
+  return pRelayServer;
+}
@@ -0,0 +1,118 @@
+/***************************************************************
+ * SD card logging (see sd_log.h)
+ ***************************************************************/
+
+#include <Arduino.h>
+#include <SD.h>
+#include <esp_system.h>
+
+#include "sd_log.h"
+#include "clock.h"
+#include "log.h"
+
+static SdSink_t g_sdSink;
+static File g_sdFile;
+static uint32_t g_sdFileNumber = 0;
+static volatile bool g_sdStarted = false;
+
+/** --------------------------------------------------
+ * Backend on the Arduino SD library. Seeking past the
+ * end and writing the last byte makes FatFs allocate the
+ * whole cluster chain now; block writes inside the file
+ * then never change the FAT or the directory entry.
+ * -------------------------------------------------- */
+static bool sdFileOpen(void* ctx, uint32_t bytes) {
+  if (g_sdFile) g_sdFile.close();
+  char path[32];
+  snprintf(path, sizeof(path), SD_LOG_DIR "/%05lu.sdl", (unsigned long)(g_sdFileNumber + 1));
+  g_sdFile = SD.open(path, FILE_WRITE);
+  if (!g_sdFile) {
+    LOG_ERROR("[SD] Cannot create %s", path);
+    return false;
+  }
+  if (!g_sdFile.seek(bytes - 1) || g_sdFile.write((uint8_t)0) != 1) {
+    LOG_ERROR("[SD] Cannot allocate %lu bytes for %s", (unsigned long)bytes, path);
+    g_sdFile.close();
+    return false;
+  }
+  g_sdFile.flush();
+  g_sdFileNumber++;
+  LOG_INFO("[SD] Logging to %s", path);
+  return true;
+}
+
+static bool sdFileWrite(void* ctx, uint32_t offset, const uint8_t* data, size_t len) {
+  return g_sdFile.seek(offset) && g_sdFile.write(data, len) == len;
+}
+
+static bool sdFileSync(void* ctx) {
+  g_sdFile.flush();
+  return true;
+}
+
+/** --------------------------------------------------
+ * Continues after the highest file number on the card.
+ * -------------------------------------------------- */
+static uint32_t lastFileNumber() {
+  uint32_t last = 0;
+  File dir = SD.open(SD_LOG_DIR);
+  if (!dir) return 0;
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+    const char* name = strrchr(f.name(), '/');
+    unsigned long n = strtoul(name ? name + 1 : f.name(), nullptr, 10);
+    if (n > last) last = (uint32_t)n;
+  }
+  return last;
+}
+
+bool sdLogBegin(uint8_t csPin) {
+  if (!SD.begin(csPin)) {
+    LOG_WARN("[SD] No card");
+    return false;
+  }
+  if (!SD.exists(SD_LOG_DIR)) SD.mkdir(SD_LOG_DIR);
+  g_sdFileNumber = lastFileNumber();
+
+  SdBackend_t backend = { nullptr, sdFileOpen, sdFileWrite, sdFileSync };
+  // A failed first open is retried from sdLogPoll()
+  bool opened = sdSinkBegin(g_sdSink, backend, SD_LOG_FILE_BYTES, SD_LOG_SYNC_INTERVAL_MS, esp_random());
+  g_sdStarted = true;
+  return opened;
+}
+
+void sdLogRecord(uint8_t kind, const uint8_t* data, size_t len) {
+  if (g_sdStarted) sdSinkAppend(g_sdSink, kind, data, len);
+}
+
+void sdLogPoll() {
+  if (!g_sdStarted) return;
+  uint32_t errors = g_sdSink.stats.writeErrors;
+  uint32_t openFailures = g_sdSink.stats.openFailures;
+  sdSinkPoll(g_sdSink);
+  if (g_sdSink.stats.writeErrors != errors) {
+    LOG_WARN("[SD] Write failed (%lu errors)", (unsigned long)g_sdSink.stats.writeErrors);
+  }
+  if (g_sdSink.stats.openFailures != openFailures) {
+    LOG_WARN("[SD] No file, retrying in %lu s", g_sdSink.openRetryMs / 1000);
+  }
+}
+
+void sdLogPrint(Print &out) {
+  if (!g_sdStarted) {
+    out.println("[SD] not started");
+    return;
+  }
+  SD_SINK_LOCK(g_sdSink);
+  SdSinkStats_t st = g_sdSink.stats;
+  SD_SINK_UNLOCK(g_sdSink);
+  uint32_t writes = st.blocksWritten + st.partialWrites;
+  out.printf("[SD] file %05lu, block %lu of %lu\n", (unsigned long)g_sdFileNumber,
+             (unsigned long)g_sdSink.nextBlock, (unsigned long)g_sdSink.fileBlocks);
+  out.printf("[SD] records %lu, dropped %lu, blocks %lu full + %lu padded, syncs %lu, files %lu (%lu failed opens)\n",
+             (unsigned long)st.records, (unsigned long)st.dropped,
+             (unsigned long)st.blocksWritten, (unsigned long)st.partialWrites,
+             (unsigned long)st.syncs, (unsigned long)st.files, (unsigned long)st.openFailures);
+  out.printf("[SD] block write avg %lu us, max %lu us, %lu errors\n",
+             (unsigned long)(writes ? st.writeMicrosSum / writes : 0),
+             (unsigned long)st.writeMicrosMax, (unsigned long)st.writeErrors);
+}
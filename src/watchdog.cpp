@@ -0,0 +1,217 @@
+/***************************************************************
+ * Watchdog and hang diagnosis (see watchdog.h)
+ ***************************************************************/
+
+#include <Arduino.h>
+#include <esp_task_wdt.h>
+#include <esp_system.h>
+#include <esp_idf_version.h>
+
+#include "watchdog.h"
+#include "conn_stats.h"
+#include "clock.h"
+#include "log.h"
+
+#define WATCHDOG_MAGIC 0x57444731      // "WDG1"
+#define WATCHDOG_NAME_LEN 20
+
+struct WatchdogTraceEntry_t {
+  uint32_t millis;
+  int32_t  arg;
+  char     event[WATCHDOG_NAME_LEN];
+};
+
+/** --------------------------------------------------
+ * Kept in RTC memory, which a watchdog reset does not
+ * clear, so the next boot can say what was going on.
+ * Names are copied rather than pointed to, so a record
+ * written by another firmware is still safe to print.
+ * -------------------------------------------------- */
+struct WatchdogRecord_t {
+  uint32_t magic;
+  uint8_t  traceHead;                  // next slot to write
+  uint8_t  traceCount;
+  WatchdogTraceEntry_t trace[WATCHDOG_TRACE_LEN];
+  char     call[WATCHDOG_NAME_LEN];    // blocking call in progress, "" if none
+  uint32_t callStartMillis;
+  uint8_t  state;                      // ConnState_t when the call started
+};
+
+static RTC_NOINIT_ATTR WatchdogRecord_t g_wdRecord;
+static portMUX_TYPE g_wdMux = portMUX_INITIALIZER_UNLOCKED;
+
+static WatchdogTeardownHandler g_wdTeardown = nullptr;
+
+// Guarded call, shared between loop() and the supervisor (under g_wdMux)
+static bool g_wdCallActive = false;
+static bool g_wdCallTripped = false;
+static unsigned long g_wdCallTimeoutMs = 0;
+
+// Recovery measurement (supervisor writes trips, loop() closes them)
+static volatile uint32_t g_wdTrips = 0;
+static volatile unsigned long g_wdTripMillis = 0;
+static volatile bool g_wdRecoveryPending = false;
+static uint32_t g_wdRecoveries = 0;
+static uint64_t g_wdRecoverySumMs = 0;
+static unsigned long g_wdRecoveryMaxMs = 0;
+static unsigned long g_wdBootToDataMs = 0;   // 0 until the first frame after boot
+
+static void traceLocked(const char* event, int32_t arg) {
+  WatchdogTraceEntry_t &e = g_wdRecord.trace[g_wdRecord.traceHead];
+  e.millis = (uint32_t)clockMillis();
+  e.arg = arg;
+  strncpy(e.event, event, WATCHDOG_NAME_LEN - 1);
+  e.event[WATCHDOG_NAME_LEN - 1] = '\0';
+  g_wdRecord.traceHead = (g_wdRecord.traceHead + 1) % WATCHDOG_TRACE_LEN;
+  if (g_wdRecord.traceCount < WATCHDOG_TRACE_LEN) g_wdRecord.traceCount++;
+}
+
+void watchdogTrace(const char* event, int32_t arg) {
+  portENTER_CRITICAL(&g_wdMux);
+  traceLocked(event, arg);
+  portEXIT_CRITICAL(&g_wdMux);
+}
+
+/** --------------------------------------------------
+ * Prints a record. 'record' is a copy, so no lock.
+ * -------------------------------------------------- */
+static void printRecord(Print &out, const WatchdogRecord_t &record, unsigned long now) {
+  if (record.call[0] != '\0') {
+    out.printf("[WDT]   call in progress: %s for %lu ms, state %s\n", record.call,
+               (unsigned long)(now - record.callStartMillis),
+               connStateName(record.state < CONN_STATE_COUNT ? (ConnState_t)record.state : CONN_DISCONNECTED));
+  }
+  out.printf("[WDT]   last %u events:\n", record.traceCount);
+  for (uint8_t i = 0; i < record.traceCount && i < WATCHDOG_TRACE_LEN; i++) {
+    uint8_t slot = (record.traceHead + WATCHDOG_TRACE_LEN - record.traceCount + i) % WATCHDOG_TRACE_LEN;
+    const WatchdogTraceEntry_t &e = record.trace[slot];
+    out.printf("[WDT]     %10lu ms  %-*.*s %ld\n", (unsigned long)e.millis,
+               WATCHDOG_NAME_LEN, WATCHDOG_NAME_LEN - 1, e.event, (long)e.arg);
+  }
+}
+
+/** --------------------------------------------------
+ * Supervisor: checks the guarded call's deadline.
+ * -------------------------------------------------- */
+static void supervisorTask(void* param) {
+  esp_task_wdt_add(nullptr);
+  for (;;) {
+    esp_task_wdt_reset();
+
+    unsigned long now = clockMillis();
+    bool trip = false;
+    WatchdogRecord_t snapshot;
+    portENTER_CRITICAL(&g_wdMux);
+    if (g_wdCallActive && !g_wdCallTripped && now - g_wdRecord.callStartMillis > g_wdCallTimeoutMs) {
+      g_wdCallTripped = true;
+      trip = true;
+      traceLocked("trip", (int32_t)(now - g_wdRecord.callStartMillis));
+      snapshot = g_wdRecord;
+    }
+    portEXIT_CRITICAL(&g_wdMux);
+
+    if (trip) {
+      g_wdTrips++;
+      g_wdTripMillis = now;
+      g_wdRecoveryPending = true;
+      LOG_ERROR("[WDT] %s overran its %lu ms timeout, tearing down the BLE client (trip #%lu)",
+                snapshot.call, g_wdCallTimeoutMs, (unsigned long)g_wdTrips);
+      if (LOG_ENABLED(LOG_LEVEL_ERROR)) printRecord(Serial, snapshot, now);
+      if (g_wdTeardown != nullptr) g_wdTeardown(snapshot.call);
+    }
+    vTaskDelay(pdMS_TO_TICKS(WATCHDOG_CHECK_MS));
+  }
+}
+
+void watchdogBegin(WatchdogTeardownHandler teardown) {
+  g_wdTeardown = teardown;
+
+  esp_reset_reason_t reason = esp_reset_reason();
+  if (g_wdRecord.magic == WATCHDOG_MAGIC &&
+      (reason == ESP_RST_TASK_WDT || reason == ESP_RST_INT_WDT || reason == ESP_RST_WDT)) {
+    LOG_ERROR("[WDT] Previous run ended in a watchdog reset:");
+    WatchdogRecord_t previous = g_wdRecord;
+    previous.call[WATCHDOG_NAME_LEN - 1] = '\0';
+    if (previous.traceCount > WATCHDOG_TRACE_LEN) previous.traceCount = WATCHDOG_TRACE_LEN;
+    previous.traceHead %= WATCHDOG_TRACE_LEN;
+    for (uint8_t i = 0; i < WATCHDOG_TRACE_LEN; i++) previous.trace[i].event[WATCHDOG_NAME_LEN - 1] = '\0';
+    // The last trace event is the latest time we know of
+    uint32_t last = previous.trace[(previous.traceHead + WATCHDOG_TRACE_LEN - 1) % WATCHDOG_TRACE_LEN].millis;
+    if (LOG_ENABLED(LOG_LEVEL_ERROR)) printRecord(Serial, previous, last);
+  }
+  memset(&g_wdRecord, 0, sizeof(g_wdRecord));
+  g_wdRecord.magic = WATCHDOG_MAGIC;
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+  // Arduino 3 already runs the task watchdog; only change its settings
+  esp_task_wdt_config_t config = {};
+  config.timeout_ms = WATCHDOG_TIMEOUT_S * 1000;
+  config.trigger_panic = true;
+  esp_task_wdt_reconfigure(&config);
+#else
+  esp_task_wdt_init(WATCHDOG_TIMEOUT_S, true);
+#endif
+  esp_task_wdt_add(nullptr);   // loop task
+
+  xTaskCreate(supervisorTask, "wdt_supervisor", 4096, nullptr, 2, nullptr);
+  LOG_INFO("[WDT] Task watchdog %d s, BLE call supervisor every %d ms",
+           WATCHDOG_TIMEOUT_S, WATCHDOG_CHECK_MS);
+}
+
+void watchdogFeed() {
+  esp_task_wdt_reset();
+}
+
+void watchdogCallBegin(const char* call, unsigned long timeoutMs) {
+  ConnState_t state = connStatsState();
+  portENTER_CRITICAL(&g_wdMux);
+  strncpy(g_wdRecord.call, call, WATCHDOG_NAME_LEN - 1);
+  g_wdRecord.call[WATCHDOG_NAME_LEN - 1] = '\0';
+  g_wdRecord.callStartMillis = (uint32_t)clockMillis();
+  g_wdRecord.state = (uint8_t)state;
+  g_wdCallTimeoutMs = timeoutMs;
+  g_wdCallTripped = false;
+  g_wdCallActive = true;
+  traceLocked(call, (int32_t)timeoutMs);
+  portEXIT_CRITICAL(&g_wdMux);
+}
+
+bool watchdogCallEnd() {
+  portENTER_CRITICAL(&g_wdMux);
+  bool tripped = g_wdCallTripped;
+  int32_t elapsed = (int32_t)(clockMillis() - g_wdRecord.callStartMillis);
+  g_wdCallActive = false;
+  g_wdCallTripped = false;
+  g_wdRecord.call[0] = '\0';
+  traceLocked(tripped ? "returned late" : "returned", elapsed);
+  portEXIT_CRITICAL(&g_wdMux);
+  return tripped;
+}
+
+void watchdogDataFlowing() {
+  unsigned long now = clockMillis();
+  if (g_wdBootToDataMs == 0) g_wdBootToDataMs = now;
+  if (!g_wdRecoveryPending) return;
+
+  g_wdRecoveryPending = false;
+  unsigned long ms = now - g_wdTripMillis;
+  g_wdRecoveries++;
+  g_wdRecoverySumMs += ms;
+  if (ms > g_wdRecoveryMaxMs) g_wdRecoveryMaxMs = ms;
+  LOG_INFO("[WDT] Recovered in %lu ms (reboot to first data took %lu ms)", ms, g_wdBootToDataMs);
+}
+
+void watchdogPrint(Print &out) {
+  out.printf("[WDT] trips %lu, recoveries %lu, recovery mean %lu ms, max %lu ms\n",
+             (unsigned long)g_wdTrips, (unsigned long)g_wdRecoveries,
+             (unsigned long)(g_wdRecoveries ? g_wdRecoverySumMs / g_wdRecoveries : 0),
+             g_wdRecoveryMaxMs);
+  // Boot ROM and bootloader time before setup() comes on top of this
+  out.printf("[WDT] full reboot for comparison: boot to first data %lu ms\n", g_wdBootToDataMs);
+
+  WatchdogRecord_t snapshot;
+  portENTER_CRITICAL(&g_wdMux);
+  snapshot = g_wdRecord;
+  portEXIT_CRITICAL(&g_wdMux);
+  printRecord(out, snapshot, clockMillis());
+}
@@ -0,0 +1,220 @@
+/***************************************************************
+ * HTTP / WebSocket server (see web_server.h)
+ *
+ * WebSocket frames are built by include/status_stream.h.
+ * A client that sees a gap in seq sends the text "snapshot"
+ * to get a fresh full snapshot.
+ *
+ * HTTP routes:
+ *   GET /             dashboard, gzip from flash with a strong ETag
+ *   GET /api/history  ?from=&to= (seconds since boot), binary
+ *                     HistoryHeader_t + records, streamed chunked
+ *   GET /metrics      connection lifecycle metrics, Prometheus text
+ ***************************************************************/
+
+#include <Arduino.h>
+#include <AsyncTCP.h>
+#include <ESPAsyncWebServer.h>
+#include <esp_heap_caps.h>
+#include <memory>
+
+#include "web_server.h"
+#include "status_stream.h"
+#include "history.h"
+#include "clock.h"
+#include "log.h"
+#include "conn_stats.h"
+#include "dashboard_html.h"
+
+static AsyncWebServer g_httpServer(WEB_SERVER_PORT);
+static AsyncWebSocket g_statusSocket("/ws");
+
+// Last published status, shared with the async_tcp task for snapshots
+static portMUX_TYPE g_webStatusMux = portMUX_INITIALIZER_UNLOCKED;
+static int32_t g_webFields[STATUS_FIELD_COUNT];
+static bool g_webHaveStatus = false;
+static uint32_t g_webSeq = 0;
+static unsigned long g_webPublishMillis = 0;
+static unsigned long g_webAgeAtPublish = 0;
+
+// Push cost, accumulated over all delta frames
+static StatusPushStats_t g_wsPushStats;
+
+static size_t statusSocketCount(void*) {
+  return g_statusSocket.count();
+}
+
+// One reference-counted buffer that every client's send queue points at
+static bool statusSocketSendAll(void*, const char* frame, size_t len) {
+  AsyncWebSocketMessageBuffer* shared = g_statusSocket.makeBuffer(len);
+  if (shared == nullptr) return false;
+  memcpy(shared->get(), frame, len);
+  g_statusSocket.textAll(shared);
+  return true;
+}
+
+static const StatusFanout_t g_statusFanout = { nullptr, statusSocketCount, statusSocketSendAll };
+
+/** --------------------------------------------------
+ * Sends the current snapshot to one client (async_tcp task).
+ * -------------------------------------------------- */
+static void sendSnapshot(AsyncWebSocketClient* client) {
+  int32_t fields[STATUS_FIELD_COUNT];
+  uint32_t seq;
+  unsigned long ageMs;
+
+  portENTER_CRITICAL(&g_webStatusMux);
+  bool have = g_webHaveStatus;
+  memcpy(fields, g_webFields, sizeof(fields));
+  seq = g_webSeq;
+  ageMs = g_webAgeAtPublish + (clockMillis() - g_webPublishMillis);
+  portEXIT_CRITICAL(&g_webStatusMux);
+
+  if (!have) {
+    client->text("{\"type\":\"snapshot\",\"seq\":0,\"status\":null}");
+    return;
+  }
+
+  char buf[STATUS_FRAME_MAX_LEN];
+  size_t len = statusSerializeFrame(buf, sizeof(buf), "snapshot", seq, ageMs, fields, nullptr);
+  if (len) client->text(buf, len);
+}
+
+static void onStatusSocketEvent(AsyncWebSocket* server, AsyncWebSocketClient* client,
+                                AwsEventType type, void* arg, uint8_t* data, size_t len) {
+  if (type == WS_EVT_CONNECT) {
+    LOG_INFO("[WS] Client #%lu subscribed (%u total)", (unsigned long)client->id(), (unsigned)server->count());
+    sendSnapshot(client);
+  } else if (type == WS_EVT_DATA && len == 8 && memcmp(data, "snapshot", 8) == 0) {
+    sendSnapshot(client);
+  }
+}
+
+/** --------------------------------------------------
+ * GET / : the dashboard. Served straight from flash as
+ * stored (gzip); a matching If-None-Match gets a 304.
+ * -------------------------------------------------- */
+static void handleDashboard(AsyncWebServerRequest* request) {
+  if (request->hasHeader("If-None-Match") &&
+      request->getHeader("If-None-Match")->value() == DASHBOARD_ETAG) {
+    AsyncWebServerResponse* response = request->beginResponse(304);
+    response->addHeader("ETag", DASHBOARD_ETAG);
+    request->send(response);
+    LOG_DEBUG("[WEB] GET / -> 304");
+    return;
+  }
+
+  // The body goes out after send() returns, so the low-water mark is
+  // read again when the request is done. If the lowest free heap since
+  // boot dropped, this response took it there; if not, it stayed above
+  // the old mark.
+  uint32_t heapBefore = ESP.getFreeHeap();
+  uint32_t lowestBefore = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+  request->onDisconnect([heapBefore, lowestBefore]() {
+    uint32_t lowest = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+    LOG_DEBUG("[WEB] GET / -> 200, %u bytes, heap peak %s%ld bytes",
+              (unsigned)DASHBOARD_HTML_GZ_LEN, lowest < lowestBefore ? "" : "under ",
+              (long)heapBefore - (long)(lowest < lowestBefore ? lowest : lowestBefore));
+  });
+
+  AsyncWebServerResponse* response =
+    request->beginResponse_P(200, "text/html", DASHBOARD_HTML_GZ, DASHBOARD_HTML_GZ_LEN);
+  response->addHeader("Content-Encoding", "gzip");
+  response->addHeader("ETag", DASHBOARD_ETAG);
+  // Always revalidate: a new firmware brings a new ETag, otherwise it's a 304
+  response->addHeader("Cache-Control", "no-cache");
+  request->send(response);
+}
+
+static uint32_t parseSecondsParam(AsyncWebServerRequest* request, const char* name, uint32_t fallback) {
+  if (!request->hasParam(name)) return fallback;
+  return (uint32_t)strtoul(request->getParam(name)->value().c_str(), nullptr, 10);
+}
+
+/** --------------------------------------------------
+ * GET /metrics
+ * -------------------------------------------------- */
+static void handleMetrics(AsyncWebServerRequest* request) {
+  AsyncResponseStream* response = request->beginResponseStream("text/plain; version=0.0.4");
+  connStatsWrite(*response);
+  request->send(response);
+}
+
+/** --------------------------------------------------
+ * GET /api/history?from=&to=
+ * Only the export state is allocated per request; records
+ * are copied from the ring straight into the TCP chunk
+ * buffer. A chunk too small for the next record is not
+ * the end: the server is asked to call again.
+ * -------------------------------------------------- */
+static void handleHistory(AsyncWebServerRequest* request) {
+  std::shared_ptr<HistoryExport_t> exp = std::make_shared<HistoryExport_t>();
+  historyExportBegin(*exp,
+                     parseSecondsParam(request, "from", 0),
+                     parseSecondsParam(request, "to", UINT32_MAX));
+  exp->heapAtStart = ESP.getFreeHeap();
+  exp->heapLowest = exp->heapAtStart;
+  exp->largestBlockLowest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+  // The callback runs while the response is in flight, so the heap is
+  // sampled there, once per chunk
+  AsyncWebServerResponse* response = request->beginChunkedResponse("application/octet-stream",
+    [exp](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+      size_t len = historyExportChunk(*exp, buffer, maxLen);
+
+      uint32_t heap = ESP.getFreeHeap();
+      uint32_t block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+      if (heap < exp->heapLowest) exp->heapLowest = heap;
+      if (block < exp->largestBlockLowest) exp->largestBlockLowest = block;
+
+      if (len == 0 && !exp->done) return RESPONSE_TRY_AGAIN;
+      if (len == 0) {
+        unsigned long ms = clockMillis() - exp->startMillis;
+        LOG_INFO("[WEB] GET /api/history -> %u bytes in %lu ms (%lu B/s), heap peak %ld bytes, "
+                 "largest free block %lu",
+                 (unsigned)exp->bytesSent, ms,
+                 (unsigned long)(exp->bytesSent * 1000UL / (ms ? ms : 1)),
+                 (long)exp->heapAtStart - (long)exp->heapLowest,
+                 (unsigned long)exp->largestBlockLowest);
+      }
+      return len;
+    });
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
+}
+
+void webServerBegin() {
+  g_httpServer.on("/", HTTP_GET, handleDashboard);
+  g_httpServer.on("/api/history", HTTP_GET, handleHistory);
+  g_httpServer.on("/metrics", HTTP_GET, handleMetrics);
+  g_statusSocket.onEvent(onStatusSocketEvent);
+  g_httpServer.addHandler(&g_statusSocket);
+  g_httpServer.begin();
+  LOG_INFO("[WEB] Server listening on port %d", WEB_SERVER_PORT);
+}
+
+void webServerPublish(const FridgeStatus_t &status, unsigned long ageMs) {
+  int32_t fields[STATUS_FIELD_COUNT];
+  bool changed[STATUS_FIELD_COUNT];
+  statusToFields(status, fields);
+
+  portENTER_CRITICAL(&g_webStatusMux);
+  size_t changedCount = statusDiff(g_webFields, g_webHaveStatus, fields, changed);
+  memcpy(g_webFields, fields, sizeof(fields));
+  g_webHaveStatus = true;
+  g_webPublishMillis = clockMillis();
+  g_webAgeAtPublish = ageMs;
+  uint32_t seq = changedCount ? ++g_webSeq : g_webSeq;
+  portEXIT_CRITICAL(&g_webStatusMux);
+
+  size_t len = statusPublishDelta(g_statusFanout, g_wsPushStats, seq, ageMs, fields, changed, changedCount);
+  if (len == 0) return;
+  LOG_DEBUG("[WS] Delta #%lu: %u fields, %u bytes to %u client(s), serialize %lu us, push %lu us (avg %lu us)",
+            (unsigned long)seq, (unsigned)changedCount, (unsigned)len, (unsigned)g_statusSocket.count(),
+            g_wsPushStats.lastSerializeMicros, g_wsPushStats.lastPushMicros,
+            (unsigned long)((g_wsPushStats.serializeMicros + g_wsPushStats.pushMicros) / g_wsPushStats.deltas));
+}
+
+void webServerLoop() {
+  g_statusSocket.cleanupClients();
+}
@@ -0,0 +1,268 @@
+/***************************************************************
+ * Unit tests: alarm dispatcher (include/alarm_dispatch.h)
+ *
+ * Runs on the virtual clock with in-memory targets and an
+ * in-memory store, polling every TICK_MS like loop().
+ ***************************************************************/
+
+#include <unity.h>
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "alarm_dispatch.h"
+#include "virtual_clock.h"
+
+#define TICK_MS 100
+
+static const AlarmConfig_t DEFAULT_CONFIG = ALARM_DEFAULT_CONFIG;
+
+struct Received_t {
+  std::string key;
+  uint8_t action;
+  uint8_t level;
+  uint32_t seq;
+};
+
+struct Target_t {
+  bool up = true;
+  int failRemaining = 0;
+  uint32_t attempts = 0;
+  std::vector<Received_t> got;
+};
+
+static VirtualClock_t g_vc;
+static AlarmDispatcher_t g_d;
+static Target_t g_webhook;
+static Target_t g_mqtt;
+static std::vector<uint8_t> g_nvs;
+
+static bool targetReady(void* ctx) {
+  return ((Target_t*)ctx)->up;
+}
+
+static bool targetSend(void* ctx, const AlarmEvent_t &event, const char*) {
+  Target_t &t = *(Target_t*)ctx;
+  t.attempts++;
+  if (t.failRemaining > 0) {
+    t.failRemaining--;
+    return false;
+  }
+  t.got.push_back({ event.key, event.action, event.level, event.seq });
+  return true;
+}
+
+static bool nvsLoad(void*, void* data, size_t len) {
+  if (g_nvs.size() != len) return false;
+  memcpy(data, g_nvs.data(), len);
+  return true;
+}
+
+static bool nvsSave(void*, const void* data, size_t len) {
+  g_nvs.assign((const uint8_t*)data, (const uint8_t*)data + len);
+  return true;
+}
+
+/** --------------------------------------------------
+ * (Re)boots the dispatcher from the stored image.
+ * -------------------------------------------------- */
+static void boot(const AlarmConfig_t &config) {
+  AlarmStore_t store = { nullptr, nvsLoad, nvsSave };
+  alarmDispatchBegin(g_d, config, store);
+  AlarmTarget_t webhook = { "webhook", &g_webhook, targetReady, targetSend };
+  AlarmTarget_t mqtt = { "mqtt", &g_mqtt, targetReady, targetSend };
+  alarmDispatchAddTarget(g_d, webhook);
+  alarmDispatchAddTarget(g_d, mqtt);
+}
+
+/** --------------------------------------------------
+ * One loop(): report, poll, wait for the next tick.
+ * -------------------------------------------------- */
+static void tick(const char* key, AlarmType_t type, bool active) {
+  if (key != nullptr) alarmReport(g_d, key, type, active, 0);
+  alarmDispatchPoll(g_d);
+  clockDelay(TICK_MS);
+}
+
+static void runFor(unsigned long ms, const char* key = nullptr, AlarmType_t type = ALARM_STALE, bool active = false) {
+  for (unsigned long t = 0; t < ms; t += TICK_MS) tick(key, type, active);
+}
+
+static bool inSeqOrder(const std::vector<Received_t> &got) {
+  for (size_t i = 1; i < got.size(); i++) {
+    if (got[i].seq <= got[i - 1].seq) return false;
+  }
+  return true;
+}
+
+void setUp(void) {
+  virtualClockInit(g_vc, 1);
+  g_vc.nowUs = 1000000000ULL;
+  virtualClockInstall(g_vc);
+  g_webhook = Target_t();
+  g_mqtt = Target_t();
+  g_nvs.clear();
+  boot(DEFAULT_CONFIG);
+}
+
+void tearDown(void) {
+  clockInstall(nullptr);
+}
+
+void test_raise_and_clear_reach_both_targets(void) {
+  tick("aa/temp_high", ALARM_TEMP_HIGH, true);
+  TEST_ASSERT_EQUAL(1, g_webhook.got.size());
+  TEST_ASSERT_EQUAL(ALARM_RAISE, g_webhook.got[0].action);
+  TEST_ASSERT_EQUAL(1, g_mqtt.got.size());
+  TEST_ASSERT_EQUAL_UINT8(1, alarmActiveCount(g_d));
+
+  runFor(DEFAULT_CONFIG.keyMinIntervalMs, "aa/temp_high", ALARM_TEMP_HIGH, false);
+  TEST_ASSERT_EQUAL(2, g_webhook.got.size());
+  TEST_ASSERT_EQUAL(ALARM_CLEAR, g_webhook.got[1].action);
+  TEST_ASSERT_EQUAL_UINT8(0, alarmActiveCount(g_d));
+}
+
+void test_condition_that_stays_true_is_one_raise(void) {
+  runFor(10 * 60000UL, "aa/stale", ALARM_STALE, true);
+  TEST_ASSERT_EQUAL(1, g_webhook.got.size());
+  TEST_ASSERT_EQUAL_UINT32(1, g_d.stats.changes);
+}
+
+void test_flapping_stays_within_the_per_key_limit(void) {
+  const unsigned long flapMs = 5 * DEFAULT_CONFIG.keyMinIntervalMs;
+  bool state = false;
+  for (unsigned long t = 0; t < flapMs; t += TICK_MS) {
+    state = !state;
+    tick("aa/temp_high", ALARM_TEMP_HIGH, state);
+  }
+  runFor(DEFAULT_CONFIG.keyMinIntervalMs + 2 * TICK_MS, "aa/temp_high", ALARM_TEMP_HIGH, state);
+  TEST_ASSERT_EQUAL_UINT8(0, g_d.image.count);
+  TEST_ASSERT_LESS_OR_EQUAL(flapMs / DEFAULT_CONFIG.keyMinIntervalMs + 2, g_webhook.got.size());
+  TEST_ASSERT_EQUAL(state ? ALARM_RAISE : ALARM_CLEAR, g_webhook.got.back().action);
+  TEST_ASSERT_EQUAL(g_webhook.got.size(), g_mqtt.got.size());
+  TEST_ASSERT_GREATER_THAN(0, g_d.stats.coalesced);
+}
+
+void test_flap_back_to_delivered_state_sends_nothing(void) {
+  tick("aa/temp_high", ALARM_TEMP_HIGH, true);
+  tick("aa/temp_high", ALARM_TEMP_HIGH, false);
+  runFor(DEFAULT_CONFIG.keyMinIntervalMs, "aa/temp_high", ALARM_TEMP_HIGH, true);
+  TEST_ASSERT_EQUAL(1, g_webhook.got.size());
+  TEST_ASSERT_EQUAL_UINT32(2, g_d.stats.coalesced);
+}
+
+void test_outage_and_reboot_deliver_once_in_order(void) {
+  g_webhook.up = g_mqtt.up = false;
+  alarmReport(g_d, "aa/stale", ALARM_STALE, true, 0);
+  alarmReport(g_d, "aa/battery_low", ALARM_BATTERY_LOW, true, 0);
+  runFor(3 * TICK_MS, "bb/temp_high", ALARM_TEMP_HIGH, true);
+  alarmReport(g_d, "aa/stale", ALARM_STALE, false, 0);
+  runFor(DEFAULT_CONFIG.keyMinIntervalMs + 2 * TICK_MS);
+  TEST_ASSERT_EQUAL_UINT8(4, g_d.image.count);
+
+  boot(DEFAULT_CONFIG);   // RAM lost, store kept
+  TEST_ASSERT_EQUAL_UINT32(4, g_d.stats.restored);
+  g_webhook.up = g_mqtt.up = true;
+  runFor(3 * TICK_MS);
+  TEST_ASSERT_EQUAL_UINT8(0, g_d.image.count);
+  TEST_ASSERT_EQUAL(4, g_webhook.got.size());
+  TEST_ASSERT_EQUAL(4, g_mqtt.got.size());
+  TEST_ASSERT_TRUE(inSeqOrder(g_webhook.got));
+  TEST_ASSERT_TRUE(inSeqOrder(g_mqtt.got));
+  TEST_ASSERT_EQUAL(ALARM_CLEAR, g_webhook.got.back().action);
+}
+
+void test_failed_send_retries_with_backoff(void) {
+  g_webhook.failRemaining = 4;
+  tick("aa/slo", ALARM_SLO, true);
+  TEST_ASSERT_EQUAL(1, g_mqtt.got.size());   // not held back by the webhook
+
+  // Backoff doubles from retryMs: the fourth retry is due after 1+2+4+8 periods
+  runFor(14 * DEFAULT_CONFIG.retryMs);
+  TEST_ASSERT_EQUAL(0, g_webhook.got.size());
+  runFor(2 * DEFAULT_CONFIG.retryMs);
+  TEST_ASSERT_EQUAL(1, g_webhook.got.size());
+  TEST_ASSERT_EQUAL_UINT32(5, g_webhook.attempts);
+  TEST_ASSERT_EQUAL_UINT32(4, g_d.targetStats[0].failures);
+}
+
+void test_escalation_stops_at_max_level(void) {
+  runFor((DEFAULT_CONFIG.maxLevel + 2) * DEFAULT_CONFIG.escalateAfterMs, "aa/temp_high", ALARM_TEMP_HIGH, true);
+  TEST_ASSERT_EQUAL(1u + DEFAULT_CONFIG.maxLevel, g_webhook.got.size());
+  for (size_t i = 0; i < g_webhook.got.size(); i++) {
+    TEST_ASSERT_EQUAL(i == 0 ? ALARM_RAISE : ALARM_ESCALATE, g_webhook.got[i].action);
+    TEST_ASSERT_EQUAL_UINT8(i, g_webhook.got[i].level);
+  }
+}
+
+void test_token_bucket_paces_a_burst(void) {
+  const unsigned count = 10;
+  for (unsigned i = 0; i < count; i++) {
+    char key[ALARM_KEY_LEN];
+    snprintf(key, sizeof(key), "%02x/temp_high", i);
+    alarmReport(g_d, key, ALARM_TEMP_HIGH, true, 0);
+  }
+  tick(nullptr, ALARM_STALE, false);
+  TEST_ASSERT_EQUAL(DEFAULT_CONFIG.burst, g_webhook.got.size());
+  TEST_ASSERT_EQUAL_UINT32(1, g_d.targetStats[0].throttled);
+
+  runFor(DEFAULT_CONFIG.refillMs);
+  TEST_ASSERT_EQUAL(DEFAULT_CONFIG.burst + 1, g_webhook.got.size());
+  runFor((count - DEFAULT_CONFIG.burst) * DEFAULT_CONFIG.refillMs);
+  TEST_ASSERT_EQUAL(count, g_webhook.got.size());
+  TEST_ASSERT_EQUAL_UINT32(count - DEFAULT_CONFIG.burst, g_d.targetStats[0].throttled);
+}
+
+void test_full_queue_drops_the_oldest(void) {
+  g_webhook.up = g_mqtt.up = false;
+  for (unsigned i = 0; i < ALARM_QUEUE_LEN + 2; i++) {
+    char key[ALARM_KEY_LEN];
+    snprintf(key, sizeof(key), "%02x/temp_high", i % ALARM_MAX_KEYS);
+    alarmReport(g_d, key, ALARM_TEMP_HIGH, i < ALARM_MAX_KEYS, 0);
+    runFor(DEFAULT_CONFIG.keyMinIntervalMs);
+  }
+  TEST_ASSERT_EQUAL_UINT8(ALARM_QUEUE_LEN, g_d.image.count);
+  TEST_ASSERT_EQUAL_UINT32(2, g_d.stats.dropped);
+  TEST_ASSERT_EQUAL_UINT32(3, alarmQueueAt(g_d, 0).seq);
+}
+
+void test_full_key_table_rejects_new_alarms(void) {
+  for (unsigned i = 0; i < ALARM_MAX_KEYS; i++) {
+    char key[ALARM_KEY_LEN];
+    snprintf(key, sizeof(key), "%02x/stale", i);
+    TEST_ASSERT_TRUE(alarmReport(g_d, key, ALARM_STALE, true, 0));
+  }
+  TEST_ASSERT_FALSE(alarmReport(g_d, "zz/stale", ALARM_STALE, true, 0));
+  TEST_ASSERT_TRUE(alarmReport(g_d, "zz/stale", ALARM_STALE, false, 0));
+}
+
+void test_json_rendering(void) {
+  AlarmEvent_t e = {};
+  strcpy(e.key, "aa:bb/battery_low");
+  e.type = ALARM_BATTERY_LOW;
+  e.action = ALARM_RAISE;
+  e.value = 12;
+  e.seq = 7;
+  e.eventMillis = 1000;
+  char json[ALARM_JSON_MAX_LEN];
+  alarmFormatJson(e, json, sizeof(json), 1250);
+  TEST_ASSERT_EQUAL_STRING("{\"key\":\"aa:bb/battery_low\",\"alarm\":\"battery_low\",\"state\":\"raise\","
+                           "\"level\":0,\"value\":12,\"seq\":7,\"age_ms\":250}", json);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_raise_and_clear_reach_both_targets);
+  RUN_TEST(test_condition_that_stays_true_is_one_raise);
+  RUN_TEST(test_flapping_stays_within_the_per_key_limit);
+  RUN_TEST(test_flap_back_to_delivered_state_sends_nothing);
+  RUN_TEST(test_outage_and_reboot_deliver_once_in_order);
+  RUN_TEST(test_failed_send_retries_with_backoff);
+  RUN_TEST(test_escalation_stops_at_max_level);
+  RUN_TEST(test_token_bucket_paces_a_burst);
+  RUN_TEST(test_full_queue_drops_the_oldest);
+  RUN_TEST(test_full_key_table_rejects_new_alarms);
+  RUN_TEST(test_json_rendering);
+  return UNITY_END();
+}
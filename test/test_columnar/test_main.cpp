@@ -0,0 +1,225 @@
+/***************************************************************
+ * Unit tests: columnar history export round trip
+ * (tools/fridgetool/columnar.cpp)
+ *
+ * The converter lives in the host tool, not in include/,
+ * so its translation unit is compiled in here.
+ ***************************************************************/
+
+#include <unity.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../tools/fridgetool/columnar.cpp"
+
+static char g_dir[] = "/tmp/test_columnar.XXXXXX";
+static std::string g_out, g_csv;
+
+static std::string path(const char* name) {
+  return std::string(g_dir) + "/" + name;
+}
+
+static bool exists(const std::string &file) {
+  return access(file.c_str(), F_OK) == 0;
+}
+
+static HistoryRecord_t makeRecord(uint32_t i, uint32_t device) {
+  HistoryRecord_t r;
+  r.time = device * 100000 + i * 60;
+  r.leftCurrent = (int8_t)(4 + (i / 7) % 5 - (int)device);
+  r.leftTarget = (int8_t)(i < 500 ? 4 : -18);
+  r.batPercent = (uint8_t)(100 - i % 100);
+  r.flags = HISTORY_FLAG_POWERED | (i % 300 < 5 ? HISTORY_FLAG_LOCKED : 0);
+  r.batMillivolts = (uint16_t)(12800 - i % 1000);
+  return r;
+}
+
+/** --------------------------------------------------
+ * Writes an export the way /api/history serves it, or
+ * (serial) the way the 'export' command does: frames of
+ * whole records between "[EXPORT] BEGIN" and "END", with
+ * log output from other tasks between some of them.
+ * Frame 'damage' (if >= 0) gets a flipped payload byte.
+ * -------------------------------------------------- */
+static void writeFrame(FILE* f, const uint8_t* payload, size_t len, bool damage) {
+  std::vector<uint8_t> frame = { HISTORY_FRAME_SYNC0, HISTORY_FRAME_SYNC1,
+                                 (uint8_t)(len & 0xFF), (uint8_t)(len >> 8) };
+  frame.insert(frame.end(), payload, payload + len);
+  uint16_t sum = historyFrameChecksum(payload, len);
+  frame.push_back((uint8_t)(sum & 0xFF));
+  frame.push_back((uint8_t)(sum >> 8));
+  if (damage) frame[4 + len / 2] ^= 0x40;
+  fwrite(frame.data(), 1, frame.size(), f);
+}
+
+static std::string writeExport(const char* name, const std::vector<HistoryRecord_t> &records, bool serial,
+                               int damage = -1) {
+  std::vector<uint8_t> payload(sizeof(HistoryHeader_t));
+  HistoryHeader_t h = { HISTORY_MAGIC, HISTORY_VERSION, (uint8_t)sizeof(HistoryRecord_t), 0 };
+  memcpy(payload.data(), &h, sizeof(h));
+  for (const HistoryRecord_t &r : records) {
+    payload.insert(payload.end(), (const uint8_t*)&r, (const uint8_t*)&r + sizeof(r));
+  }
+
+  std::string file = path(name);
+  FILE* f = fopen(file.c_str(), "wb");
+  if (!serial) {
+    fwrite(payload.data(), 1, payload.size(), f);
+  } else {
+    fputs("[WIFI] Connected\n> export\n[EXPORT] BEGIN\n", f);
+    // Header + 24 records, then 25 records per frame, as the firmware sends them
+    int index = 0;
+    for (size_t at = 0; at < payload.size(); index++) {
+      size_t len = std::min<size_t>(index == 0 ? 248 : 250, payload.size() - at);
+      writeFrame(f, &payload[at], len, index == damage);
+      at += len;
+      if (index % 3 == 0) fputs("[BLE] Notify 18 bytes\n", f);
+      // A log line that looks like the start of a frame
+      static const uint8_t fake[] = { 0xA5, 0x5A, 3, 0, 'a', 'b', 'c', 0, 0, '\n' };
+      if (index % 7 == 0) fwrite(fake, 1, sizeof(fake), f);
+    }
+    writeFrame(f, nullptr, 0, false);
+    fputs("[EXPORT] END\n", f);
+  }
+  fclose(f);
+  return file;
+}
+
+void setUp(void) {
+  strcpy(g_dir, "/tmp/test_columnar.XXXXXX");
+  TEST_ASSERT_NOT_NULL(mkdtemp(g_dir));
+  g_out = path("fleet.fcol");
+  g_csv = path("fleet.csv");
+}
+
+void tearDown(void) {
+  std::string cmd = std::string("rm -rf ") + g_dir;
+  TEST_ASSERT_EQUAL(0, system(cmd.c_str()));
+}
+
+void test_round_trip(void) {
+  // Device a spans two row groups; b comes from a serial capture
+  std::vector<HistoryRecord_t> a, b;
+  for (uint32_t i = 0; i < FCOL_ROWS_PER_GROUP + 1000; i++) a.push_back(makeRecord(i, 0));
+  for (uint32_t i = 0; i < 1440; i++) b.push_back(makeRecord(i, 1));
+  std::string inputs[2] = { writeExport("van1.bin", a, false), writeExport("van2.log", b, true) };
+  const char* argv[2] = { inputs[0].c_str(), inputs[1].c_str() };
+
+  TEST_ASSERT_EQUAL(0, columnarConvert(g_out.c_str(), g_csv.c_str(), argv, 2));
+  FcolTable_t table;
+  TEST_ASSERT_TRUE(columnarRead(g_out.c_str(), table));
+  TEST_ASSERT_EQUAL(2, table.devices.size());
+  TEST_ASSERT_EQUAL_STRING("van1.bin", table.devices[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("van2.log", table.devices[1].c_str());
+  TEST_ASSERT_EQUAL(a.size() + b.size(), table.columns[FCOL_COL_DEVICE].size());
+
+  for (size_t row = 0; row < a.size() + b.size(); row++) {
+    int32_t device = table.columns[FCOL_COL_DEVICE][row];
+    const HistoryRecord_t &r = row < a.size() ? a[row] : b[row - a.size()];
+    TEST_ASSERT_EQUAL_INT32(row < a.size() ? 0 : 1, device);
+    TEST_ASSERT_EQUAL_UINT32(r.time, (uint32_t)table.columns[FCOL_COL_TIME][row]);
+    TEST_ASSERT_EQUAL_INT32(r.leftCurrent, table.columns[FCOL_COL_CURRENT][row]);
+    TEST_ASSERT_EQUAL_INT32(r.leftTarget, table.columns[FCOL_COL_TARGET][row]);
+    TEST_ASSERT_EQUAL_INT32(r.batPercent, table.columns[FCOL_COL_BAT_PERCENT][row]);
+    TEST_ASSERT_EQUAL_INT32(r.flags, table.columns[FCOL_COL_FLAGS][row]);
+    TEST_ASSERT_EQUAL_INT32(r.batMillivolts, table.columns[FCOL_COL_BAT_MV][row]);
+  }
+
+  FILE* csv = fopen(g_csv.c_str(), "r");
+  size_t lines = 0;
+  for (int c; (c = fgetc(csv)) != EOF;) lines += c == '\n';
+  fclose(csv);
+  TEST_ASSERT_EQUAL(a.size() + b.size() + 1, lines);
+}
+
+void test_serial_export_skips_damaged_frames(void) {
+  std::vector<HistoryRecord_t> a;
+  for (uint32_t i = 0; i < 100; i++) a.push_back(makeRecord(i, 0));
+  // Frame 2 holds records 49..73
+  std::string input = writeExport("van1.log", a, true, 2);
+  const char* argv[1] = { input.c_str() };
+  TEST_ASSERT_EQUAL(0, columnarConvert(g_out.c_str(), nullptr, argv, 1));
+
+  FcolTable_t table;
+  TEST_ASSERT_TRUE(columnarRead(g_out.c_str(), table));
+  TEST_ASSERT_EQUAL(75, table.columns[FCOL_COL_TIME].size());
+  for (size_t row = 0; row < 75; row++) {
+    const HistoryRecord_t &r = a[row < 49 ? row : row + 25];
+    TEST_ASSERT_EQUAL_UINT32(r.time, (uint32_t)table.columns[FCOL_COL_TIME][row]);
+    TEST_ASSERT_EQUAL_INT32(r.batMillivolts, table.columns[FCOL_COL_BAT_MV][row]);
+  }
+}
+
+void test_extreme_values_survive_delta_encoding(void) {
+  std::vector<HistoryRecord_t> records;
+  const uint32_t times[] = { 0, 0xFFFFFFFF, 0, 0x80000000, 0x7FFFFFFF, 1 };
+  for (uint32_t t : times) {
+    HistoryRecord_t r = makeRecord(0, 0);
+    r.time = t;
+    r.leftCurrent = t & 1 ? -128 : 127;
+    records.push_back(r);
+  }
+  std::string input = writeExport("edge.bin", records, false);
+  const char* argv[1] = { input.c_str() };
+  TEST_ASSERT_EQUAL(0, columnarConvert(g_out.c_str(), nullptr, argv, 1));
+  FcolTable_t table;
+  TEST_ASSERT_TRUE(columnarRead(g_out.c_str(), table));
+  for (size_t i = 0; i < records.size(); i++) {
+    TEST_ASSERT_EQUAL_UINT32(records[i].time, (uint32_t)table.columns[FCOL_COL_TIME][i]);
+    TEST_ASSERT_EQUAL_INT32(records[i].leftCurrent, table.columns[FCOL_COL_CURRENT][i]);
+  }
+}
+
+void test_failed_conversion_leaves_no_output(void) {
+  std::vector<HistoryRecord_t> a(1, makeRecord(0, 0));
+  std::string good = writeExport("van1.bin", a, false);
+  std::string bad = path("notes.txt");
+  FILE* f = fopen(bad.c_str(), "w");
+  fputs("not a history export\n", f);
+  fclose(f);
+  std::string missing = path("missing.bin");
+
+  const char* badArgv[2] = { good.c_str(), bad.c_str() };
+  TEST_ASSERT_EQUAL(1, columnarConvert(g_out.c_str(), g_csv.c_str(), badArgv, 2));
+  TEST_ASSERT_FALSE(exists(g_out));
+  TEST_ASSERT_FALSE(exists(g_csv));
+
+  const char* missingArgv[2] = { good.c_str(), missing.c_str() };
+  TEST_ASSERT_EQUAL(1, columnarConvert(g_out.c_str(), g_csv.c_str(), missingArgv, 2));
+  TEST_ASSERT_FALSE(exists(g_out));
+  TEST_ASSERT_FALSE(exists(g_csv));
+}
+
+void test_corrupt_file_does_not_decode(void) {
+  std::vector<HistoryRecord_t> a;
+  for (uint32_t i = 0; i < 100; i++) a.push_back(makeRecord(i, 0));
+  std::string input = writeExport("van1.bin", a, false);
+  const char* argv[1] = { input.c_str() };
+  TEST_ASSERT_EQUAL(0, columnarConvert(g_out.c_str(), nullptr, argv, 1));
+
+  // Flip the first byte of the first column's data
+  FILE* f = fopen(g_out.c_str(), "r+b");
+  fseek(f, 8 + 4 + 14, SEEK_SET);
+  int c = fgetc(f);
+  fseek(f, 8 + 4 + 14, SEEK_SET);
+  fputc(c ^ 0x7F, f);
+  fclose(f);
+  FcolTable_t table;
+  TEST_ASSERT_FALSE(columnarRead(g_out.c_str(), table));
+
+  TEST_ASSERT_EQUAL(0, truncate(g_out.c_str(), 40));
+  TEST_ASSERT_FALSE(columnarRead(g_out.c_str(), table));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_serial_export_skips_damaged_frames);
+  RUN_TEST(test_extreme_values_survive_delta_encoding);
+  RUN_TEST(test_failed_conversion_leaves_no_output);
+  RUN_TEST(test_corrupt_file_does_not_decode);
+  return UNITY_END();
+}
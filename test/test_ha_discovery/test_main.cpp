@@ -0,0 +1,246 @@
+/***************************************************************
+ * Unit tests: Home Assistant commands and publisher
+ * (include/ha_discovery.h)
+ ***************************************************************/
+
+#include <unity.h>
+
+#include <map>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "ha_discovery.h"
+
+#define TEST_BASE "fridge/a1b2c3"
+
+/** --------------------------------------------------
+ * Stand-in broker: records every message and keeps the
+ * retained ones; can be taken down.
+ * -------------------------------------------------- */
+struct Broker_t {
+  std::vector<std::string> topics;
+  std::map<std::string, std::string> retained;
+  bool allRetained = true;
+  bool up = true;
+};
+
+static bool brokerPublish(void* ctx, const char* topic, const char* payload, bool retain) {
+  Broker_t &b = *(Broker_t*)ctx;
+  if (!b.up) return false;
+  b.topics.push_back(topic);
+  if (retain) b.retained[topic] = payload;
+  else b.allRetained = false;
+  return true;
+}
+
+static Broker_t g_broker;
+static HaPublisher_t g_ha;
+static FridgeStatus_t g_status;
+static std::vector<uint8_t> g_packet;
+static char g_error[HA_ERROR_LEN];
+
+static bool build(const char* cmd, FridgeStatus_t &settings) {
+  g_packet.clear();
+  return haBuildCommand(cmd, strlen(cmd), settings, g_packet, g_error, sizeof(g_error));
+}
+
+static bool build(const char* cmd) {
+  FridgeStatus_t settings = g_status;
+  return build(cmd, settings);
+}
+
+static bool checksumOk() {
+  size_t n = g_packet.size();
+  return n >= 6 && g_packet[2] == n - 3 &&
+         calculateChecksum(g_packet.data(), n - 2) == (uint16_t)((g_packet[n - 2] << 8) | g_packet[n - 1]);
+}
+
+void setUp(void) {
+  memset(&g_status, 0, sizeof(g_status));
+  g_status.poweredOn = true;
+  g_status.runMode = 1;
+  g_status.leftTarget = 4;
+  g_status.tempMax = 20;
+  g_status.tempMin = -20;
+  g_status.leftRetDiff = 2;
+  g_status.leftCurrent = 6;
+  g_status.batPercent = 80;
+  g_status.batVolInt = 12;
+  g_status.batVolDec = 6;
+  g_broker = Broker_t();
+  haBegin(g_ha, TEST_BASE, "test", brokerPublish, &g_broker);
+  haConnected(g_ha);
+}
+
+void tearDown(void) {}
+
+void test_target_builds_set_left_frame(void) {
+  TEST_ASSERT_TRUE(build("target=-3"));
+  TEST_ASSERT_EQUAL(7, g_packet.size());
+  TEST_ASSERT_EQUAL_UINT8(FRIDGE_CMD_SET_LEFT, g_packet[3]);
+  TEST_ASSERT_EQUAL_INT8(-3, (int8_t)g_packet[4]);
+  TEST_ASSERT_TRUE(checksumOk());
+}
+
+void test_target_outside_range_or_malformed_rejected(void) {
+  TEST_ASSERT_FALSE(build("target=99"));
+  TEST_ASSERT_FALSE(build("target=4x"));
+  TEST_ASSERT_FALSE(build("target="));
+}
+
+void test_mode_keeps_other_settings(void) {
+  TEST_ASSERT_TRUE(build("mode=MAX"));
+  TEST_ASSERT_EQUAL(20, g_packet.size());
+  TEST_ASSERT_EQUAL_UINT8(FRIDGE_CMD_SET_OTHER, g_packet[3]);
+  TEST_ASSERT_EQUAL_UINT8(0, g_packet[6]);
+  TEST_ASSERT_EQUAL_UINT8(g_status.locked, g_packet[4]);
+  TEST_ASSERT_EQUAL_UINT8(g_status.poweredOn, g_packet[5]);
+  TEST_ASSERT_EQUAL_INT8(g_status.leftTarget, (int8_t)g_packet[8]);
+  TEST_ASSERT_TRUE(checksumOk());
+}
+
+void test_lock_and_power_switches(void) {
+  TEST_ASSERT_TRUE(build("lock=ON"));
+  TEST_ASSERT_EQUAL_UINT8(1, g_packet[4]);
+  TEST_ASSERT_EQUAL_UINT8(g_status.runMode, g_packet[6]);
+  TEST_ASSERT_TRUE(checksumOk());
+  TEST_ASSERT_TRUE(build("power=OFF"));
+  TEST_ASSERT_EQUAL_UINT8(0, g_packet[5]);
+  TEST_ASSERT_TRUE(checksumOk());
+}
+
+void test_unknown_commands_rejected(void) {
+  FridgeStatus_t settings = g_status;
+  TEST_ASSERT_FALSE(build("mode=TURBO", settings));
+  TEST_ASSERT_FALSE(build("lock=1", settings));
+  TEST_ASSERT_FALSE(build("fan=ON", settings));
+  TEST_ASSERT_FALSE(build("target", settings));
+  // A rejected command leaves the settings alone
+  TEST_ASSERT_EQUAL_MEMORY(&g_status, &settings, sizeof(settings));
+}
+
+void test_queued_target_survives_next_set_other(void) {
+  FridgeStatus_t settings = g_status;
+  TEST_ASSERT_TRUE(build("target=-3", settings));
+  TEST_ASSERT_EQUAL_INT8(-3, settings.leftTarget);
+  // A lock toggle queued before the fridge answered must carry the new target
+  TEST_ASSERT_TRUE(build("lock=ON", settings));
+  TEST_ASSERT_EQUAL_INT8(-3, (int8_t)g_packet[8]);
+  TEST_ASSERT_EQUAL_UINT8(1, g_packet[4]);
+  TEST_ASSERT_TRUE(build("power=OFF", settings));
+  TEST_ASSERT_EQUAL_INT8(-3, (int8_t)g_packet[8]);
+  TEST_ASSERT_EQUAL_UINT8(1, g_packet[4]);
+  TEST_ASSERT_EQUAL_UINT8(0, g_packet[5]);
+}
+
+void test_frames_fit_the_command_queue(void) {
+  const char* commands[] = { "target=-3", "mode=MAX", "lock=ON", "power=OFF" };
+  for (const char* cmd : commands) {
+    TEST_ASSERT_TRUE(build(cmd));
+    TEST_ASSERT_LESS_OR_EQUAL(20, g_packet.size());
+  }
+}
+
+void test_no_discovery_before_first_reading(void) {
+  haUpdate(g_ha, nullptr, false, "WT-0001");
+  TEST_ASSERT_EQUAL(1, g_broker.topics.size());
+  TEST_ASSERT_EQUAL_STRING("offline", g_broker.retained[TEST_BASE "/ha/availability"].c_str());
+}
+
+void test_first_reading_publishes_everything(void) {
+  haUpdate(g_ha, &g_status, true, "WT-0001");
+  TEST_ASSERT_EQUAL_UINT32(HA_ENTITY_COUNT, g_ha.stats.discovery);
+  TEST_ASSERT_EQUAL_UINT32(HA_ENTITY_COUNT, g_ha.stats.states);
+  TEST_ASSERT_EQUAL(2 * HA_ENTITY_COUNT + 1, g_broker.topics.size());
+  TEST_ASSERT_EQUAL_STRING("online", g_broker.retained[TEST_BASE "/ha/availability"].c_str());
+  TEST_ASSERT_EQUAL_STRING("12.6", g_broker.retained[TEST_BASE "/ha/voltage"].c_str());
+  TEST_ASSERT_EQUAL_STRING("ECO", g_broker.retained[TEST_BASE "/ha/mode"].c_str());
+  TEST_ASSERT_TRUE(g_broker.allRetained);
+}
+
+void test_discovery_fits_its_buffer(void) {
+  char payload[HA_DISCOVERY_MAX_LEN];
+  for (uint8_t i = 0; i < HA_ENTITY_COUNT; i++) {
+    size_t len = haFormatDiscovery(g_ha, (HaEntityId_t)i, "a \"quoted\" fridge name", g_status,
+                                   payload, sizeof(payload));
+    TEST_ASSERT_GREATER_THAN(0, len);
+    TEST_ASSERT_NULL(strstr(payload, "\"quoted\""));
+  }
+}
+
+void test_unchanged_reading_sends_nothing(void) {
+  haUpdate(g_ha, &g_status, true, "WT-0001");
+  size_t before = g_broker.topics.size();
+  haUpdate(g_ha, &g_status, true, "WT-0001");
+  haUpdate(g_ha, &g_status, true, "WT-0001");
+  TEST_ASSERT_EQUAL(before, g_broker.topics.size());
+}
+
+void test_changed_entity_only(void) {
+  haUpdate(g_ha, &g_status, true, "WT-0001");
+  size_t before = g_broker.topics.size();
+  g_status.leftCurrent = 5;
+  g_status.batVolDec = 5;   // one 0.1 V step
+  haUpdate(g_ha, &g_status, true, "WT-0001");
+  TEST_ASSERT_EQUAL(before + 2, g_broker.topics.size());
+  TEST_ASSERT_EQUAL_STRING("5", g_broker.retained[TEST_BASE "/ha/temperature"].c_str());
+  TEST_ASSERT_EQUAL_STRING("12.5", g_broker.retained[TEST_BASE "/ha/voltage"].c_str());
+}
+
+void test_failed_publish_is_retried(void) {
+  haUpdate(g_ha, &g_status, true, "WT-0001");
+  g_broker.up = false;
+  g_status.leftTarget = 0;
+  haUpdate(g_ha, &g_status, true, "WT-0001");
+  g_broker.up = true;
+  size_t before = g_broker.topics.size();
+  haUpdate(g_ha, &g_status, true, "WT-0001");
+  TEST_ASSERT_EQUAL(before + 1, g_broker.topics.size());
+  TEST_ASSERT_EQUAL_STRING(TEST_BASE "/ha/target", g_broker.topics.back().c_str());
+}
+
+void test_reconnect_republishes(void) {
+  haUpdate(g_ha, &g_status, true, "WT-0001");
+  size_t before = g_broker.topics.size();
+  haConnected(g_ha);
+  haUpdate(g_ha, &g_status, true, "WT-0001");
+  TEST_ASSERT_EQUAL(before + 2 * HA_ENTITY_COUNT + 1, g_broker.topics.size());
+}
+
+void test_unit_change_resends_discovery(void) {
+  haUpdate(g_ha, &g_status, true, "WT-0001");
+  size_t before = g_broker.topics.size();
+  g_status.unit = 1;
+  haUpdate(g_ha, &g_status, true, "WT-0001");
+  TEST_ASSERT_EQUAL(before + HA_ENTITY_COUNT, g_broker.topics.size());
+  const std::string &config = g_broker.retained[HA_DISCOVERY_PREFIX "/sensor/fridge_a1b2c3/temperature/config"];
+  TEST_ASSERT_NOT_NULL(strstr(config.c_str(), "\xC2\xB0" "F"));
+}
+
+void test_stale_reading_goes_unavailable(void) {
+  haUpdate(g_ha, &g_status, true, "WT-0001");
+  haUpdate(g_ha, &g_status, false, "WT-0001");
+  TEST_ASSERT_EQUAL_STRING("offline", g_broker.retained[TEST_BASE "/ha/availability"].c_str());
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_target_builds_set_left_frame);
+  RUN_TEST(test_target_outside_range_or_malformed_rejected);
+  RUN_TEST(test_mode_keeps_other_settings);
+  RUN_TEST(test_lock_and_power_switches);
+  RUN_TEST(test_unknown_commands_rejected);
+  RUN_TEST(test_queued_target_survives_next_set_other);
+  RUN_TEST(test_frames_fit_the_command_queue);
+  RUN_TEST(test_no_discovery_before_first_reading);
+  RUN_TEST(test_first_reading_publishes_everything);
+  RUN_TEST(test_discovery_fits_its_buffer);
+  RUN_TEST(test_unchanged_reading_sends_nothing);
+  RUN_TEST(test_changed_entity_only);
+  RUN_TEST(test_failed_publish_is_retried);
+  RUN_TEST(test_reconnect_republishes);
+  RUN_TEST(test_unit_change_resends_discovery);
+  RUN_TEST(test_stale_reading_goes_unavailable);
+  return UNITY_END();
+}
@@ -0,0 +1,294 @@
+/***************************************************************
+ * Unit tests: BLE history download, per-phone transfers
+ * (include/history_transfer.h)
+ *
+ * A stand-in history ring and stand-in phones speak the
+ * protocol of ble_history_service.h. serviceLoop() does
+ * what bleHistoryServiceLoop() does, with the GATT send
+ * replaced by a delivery to the addressed phone.
+ ***************************************************************/
+
+#include <unity.h>
+
+#include <string.h>
+#include <vector>
+
+#include "history_transfer.h"
+
+#define RING_CAPACITY 100
+#define BURST 16
+
+static HistoryXferTable_t g_table;
+static uint32_t g_ringEnd;                    // sequence number of the next append
+static uint32_t g_busyConn;                   // send fails for this conn (0xFFFF = none)
+
+/** --------------------------------------------------
+ * Stand-in ring: record seq has time == seq.
+ * -------------------------------------------------- */
+static size_t copyRing(uint32_t &cursor, uint8_t* buf, size_t maxLen) {
+  uint32_t first = g_ringEnd > RING_CAPACITY ? g_ringEnd - RING_CAPACITY : 0;
+  if (cursor < first) cursor = first;
+  size_t written = 0;
+  while (cursor < g_ringEnd && written + sizeof(HistoryRecord_t) <= maxLen) {
+    HistoryRecord_t r = {};
+    r.time = cursor++;
+    memcpy(buf + written, &r, sizeof(r));
+    written += sizeof(r);
+  }
+  return written;
+}
+
+/** --------------------------------------------------
+ * A phone: what it received, checked packet by packet.
+ * -------------------------------------------------- */
+struct Phone_t {
+  uint16_t connId;
+  uint16_t mtu;
+  uint32_t nextSeq;            // next record expected
+  uint32_t packets;
+  uint32_t records;
+  uint32_t gaps;               // records skipped because they were overwritten
+  bool ended;
+  size_t largest;
+};
+
+static std::vector<Phone_t*> g_phones;
+
+static Phone_t makePhone(uint16_t connId, uint16_t mtu) {
+  Phone_t phone = {};
+  phone.connId = connId;
+  phone.mtu = mtu;
+  return phone;
+}
+
+static void deliver(uint16_t connId, const uint8_t* packet, size_t len) {
+  Phone_t* phone = nullptr;
+  for (Phone_t* p : g_phones) {
+    if (p->connId == connId) phone = p;
+  }
+  TEST_ASSERT_NOT_NULL_MESSAGE(phone, "notification to a phone that is not connected");
+  TEST_ASSERT_TRUE(len <= (size_t)phone->mtu - 3);
+  TEST_ASSERT_FALSE(phone->ended);
+  TEST_ASSERT_EQUAL(0, (len - 4) % sizeof(HistoryRecord_t));
+
+  uint32_t seq = historyXferLe32(packet);
+  phone->packets++;
+  if (len > phone->largest) phone->largest = len;
+  if (len == 4) {
+    phone->ended = true;
+    return;
+  }
+  TEST_ASSERT_TRUE(seq >= phone->nextSeq);
+  phone->gaps += seq - phone->nextSeq;
+  for (size_t at = 4; at < len; at += sizeof(HistoryRecord_t)) {
+    HistoryRecord_t r;
+    memcpy(&r, packet + at, sizeof(r));
+    TEST_ASSERT_EQUAL_UINT32(seq, r.time);
+    seq++;
+    phone->records++;
+  }
+  phone->nextSeq = seq;
+}
+
+static bool control(Phone_t &phone, const std::vector<uint8_t> &bytes) {
+  return historyXferControl(g_table, phone.connId, bytes.data(), bytes.size(), phone.mtu, 0);
+}
+
+static bool start(Phone_t &phone, uint32_t seq, uint16_t credits) {
+  phone.nextSeq = seq;
+  phone.ended = false;
+  return control(phone, { HISTORY_CTRL_START, (uint8_t)seq, (uint8_t)(seq >> 8), (uint8_t)(seq >> 16),
+                          (uint8_t)(seq >> 24), (uint8_t)credits, (uint8_t)(credits >> 8) });
+}
+
+static bool credit(Phone_t &phone, uint16_t credits) {
+  return control(phone, { HISTORY_CTRL_CREDIT, (uint8_t)credits, (uint8_t)(credits >> 8) });
+}
+
+/** --------------------------------------------------
+ * One loop() pass of the service. Returns packets sent.
+ * -------------------------------------------------- */
+static int serviceLoop() {
+  static uint8_t packet[HISTORY_XFER_MAX_PAYLOAD];
+  int sent = 0;
+  for (int burst = 0; burst < BURST; burst++) {
+    HistoryXfer_t xfer;
+    if (!historyXferPick(g_table, xfer)) break;
+    uint32_t cursor;
+    size_t len = historyXferBuildPacket(xfer, cursor, packet, copyRing);
+    if (xfer.connId == g_busyConn) break;
+    deliver(xfer.connId, packet, len);
+    sent++;
+    HistoryXfer_t done;
+    historyXferSent(g_table, xfer, cursor, len, done);
+  }
+  return sent;
+}
+
+static void runUntilIdle() {
+  for (int pass = 0; pass < 1000 && serviceLoop() > 0; pass++) {}
+}
+
+void setUp(void) {
+  memset(&g_table, 0, sizeof(g_table));
+  g_ringEnd = 60;
+  g_busyConn = 0xFFFF;
+  g_phones.clear();
+}
+
+void tearDown(void) {}
+
+void test_two_phones_get_their_own_streams(void) {
+  Phone_t a = makePhone(1, 23), b = makePhone(2, 247);
+  g_phones = { &a, &b };
+  TEST_ASSERT_TRUE(start(a, 0, 100));
+  TEST_ASSERT_TRUE(start(b, 30, 100));
+  runUntilIdle();
+
+  TEST_ASSERT_TRUE(a.ended);
+  TEST_ASSERT_TRUE(b.ended);
+  TEST_ASSERT_EQUAL_UINT32(60, a.records);
+  TEST_ASSERT_EQUAL_UINT32(30, b.records);
+  TEST_ASSERT_EQUAL_UINT32(0, a.gaps + b.gaps);
+  // Each at its own MTU: 1 record per packet for a, 24 for b
+  TEST_ASSERT_EQUAL(4 + 1 * sizeof(HistoryRecord_t), a.largest);
+  TEST_ASSERT_EQUAL(4 + 24 * sizeof(HistoryRecord_t), b.largest);
+  TEST_ASSERT_EQUAL_UINT32(61, a.packets);
+  TEST_ASSERT_EQUAL_UINT32(3, b.packets);
+}
+
+void test_credits_pace_each_phone(void) {
+  Phone_t a = makePhone(1, 23), b = makePhone(2, 23);
+  g_phones = { &a, &b };
+  start(a, 0, 3);
+  start(b, 0, 100);
+  runUntilIdle();
+  TEST_ASSERT_EQUAL_UINT32(3, a.packets);
+  TEST_ASSERT_TRUE(b.ended);
+
+  TEST_ASSERT_TRUE(credit(a, 100));
+  runUntilIdle();
+  TEST_ASSERT_TRUE(a.ended);
+  TEST_ASSERT_EQUAL_UINT32(60, a.records);
+}
+
+void test_phones_take_turns(void) {
+  Phone_t a = makePhone(1, 23), b = makePhone(2, 23);
+  g_phones = { &a, &b };
+  start(a, 0, 100);
+  start(b, 0, 100);
+  serviceLoop();
+  TEST_ASSERT_EQUAL_UINT32(BURST / 2, a.packets);
+  TEST_ASSERT_EQUAL_UINT32(BURST / 2, b.packets);
+}
+
+void test_congested_phone_does_not_block_others(void) {
+  Phone_t a = makePhone(1, 23), b = makePhone(2, 23);
+  g_phones = { &a, &b };
+  start(a, 0, 100);
+  start(b, 0, 100);
+  historyXferCongested(g_table, 1, true);
+  runUntilIdle();
+  TEST_ASSERT_EQUAL_UINT32(0, a.packets);
+  TEST_ASSERT_TRUE(b.ended);
+
+  historyXferCongested(g_table, 1, false);
+  runUntilIdle();
+  TEST_ASSERT_TRUE(a.ended);
+  TEST_ASSERT_EQUAL_UINT32(60, a.records);
+}
+
+void test_failed_send_is_retried_from_the_same_record(void) {
+  Phone_t a = makePhone(1, 23);
+  g_phones = { &a };
+  start(a, 0, 100);
+  serviceLoop();
+  g_busyConn = 1;
+  TEST_ASSERT_EQUAL(0, serviceLoop());
+  g_busyConn = 0xFFFF;
+  runUntilIdle();
+  TEST_ASSERT_EQUAL_UINT32(60, a.records);
+  TEST_ASSERT_EQUAL_UINT32(0, a.gaps);
+}
+
+void test_disconnect_frees_the_slot_and_resume_continues(void) {
+  Phone_t a = makePhone(1, 23);
+  g_phones = { &a };
+  start(a, 0, 10);
+  runUntilIdle();
+  TEST_ASSERT_EQUAL_UINT32(10, a.records);
+
+  historyXferDisconnected(g_table, 1);
+  TEST_ASSERT_NULL(historyXferFind(g_table, 1, false));
+  TEST_ASSERT_FALSE(credit(a, 10));
+
+  // Reconnected under another id, resuming where it stopped
+  a.connId = 7;
+  TEST_ASSERT_TRUE(start(a, a.nextSeq, 100));
+  runUntilIdle();
+  TEST_ASSERT_TRUE(a.ended);
+  TEST_ASSERT_EQUAL_UINT32(60, a.records);
+}
+
+void test_restart_wins_over_packet_in_flight(void) {
+  Phone_t a = makePhone(1, 23);
+  g_phones = { &a };
+  start(a, 0, 100);
+  HistoryXfer_t xfer;
+  TEST_ASSERT_TRUE(historyXferPick(g_table, xfer));
+  uint8_t packet[HISTORY_XFER_MAX_PAYLOAD];
+  uint32_t cursor;
+  size_t len = historyXferBuildPacket(xfer, cursor, packet, copyRing);
+
+  start(a, 40, 100);    // arrives while the packet is being sent
+  HistoryXfer_t done;
+  TEST_ASSERT_FALSE(historyXferSent(g_table, xfer, cursor, len, done));
+  TEST_ASSERT_EQUAL_UINT32(40, historyXferFind(g_table, 1, false)->cursor);
+  runUntilIdle();
+  TEST_ASSERT_EQUAL_UINT32(20, a.records);
+}
+
+void test_overwritten_cursor_jumps_to_oldest(void) {
+  Phone_t a = makePhone(1, 247);
+  g_phones = { &a };
+  g_ringEnd = 250;      // holds 150..249
+  start(a, 100, 100);
+  runUntilIdle();
+  TEST_ASSERT_EQUAL_UINT32(50, a.gaps);
+  TEST_ASSERT_EQUAL_UINT32(100, a.records);
+  TEST_ASSERT_TRUE(a.ended);
+}
+
+void test_table_full_refuses_start(void) {
+  Phone_t phones[HISTORY_XFER_MAX_CONN + 1];
+  for (int i = 0; i <= HISTORY_XFER_MAX_CONN; i++) {
+    phones[i] = makePhone((uint16_t)i, 23);
+    bool accepted = start(phones[i], 0, 1);
+    TEST_ASSERT_EQUAL(i < HISTORY_XFER_MAX_CONN, accepted);
+  }
+  historyXferDisconnected(g_table, 0);
+  TEST_ASSERT_TRUE(start(phones[HISTORY_XFER_MAX_CONN], 0, 1));
+}
+
+void test_malformed_control_is_ignored(void) {
+  Phone_t a = makePhone(1, 23);
+  TEST_ASSERT_FALSE(control(a, {}));
+  TEST_ASSERT_FALSE(control(a, { HISTORY_CTRL_START, 0, 0 }));
+  TEST_ASSERT_FALSE(control(a, { 0x7F }));
+  TEST_ASSERT_NULL(historyXferFind(g_table, 1, false));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_two_phones_get_their_own_streams);
+  RUN_TEST(test_credits_pace_each_phone);
+  RUN_TEST(test_phones_take_turns);
+  RUN_TEST(test_congested_phone_does_not_block_others);
+  RUN_TEST(test_failed_send_is_retried_from_the_same_record);
+  RUN_TEST(test_disconnect_frees_the_slot_and_resume_continues);
+  RUN_TEST(test_restart_wins_over_packet_in_flight);
+  RUN_TEST(test_overwritten_cursor_jumps_to_oldest);
+  RUN_TEST(test_table_full_refuses_start);
+  RUN_TEST(test_malformed_control_is_ignored);
+  return UNITY_END();
+}
@@ -0,0 +1,234 @@
+/***************************************************************
+ * Unit tests: query cadence, response timeouts, link score
+ * and freshness SLO (include/link_monitor.h)
+ ***************************************************************/
+
+#include <unity.h>
+
+#include <string.h>
+
+#include "link_monitor.h"
+
+static FridgeConfig_t g_config;
+
+void setUp(void) {
+  memset(&g_config, 0, sizeof(g_config));
+  linkDefaultConfig(g_config);
+}
+
+void tearDown(void) {}
+
+void test_first_query_due_on_connect(void) {
+  LinkQuality_t link = {};
+  linkConnected(link, 1000, g_config);
+  TEST_ASSERT_TRUE(linkQueryDue(link, 1000, g_config));
+  TEST_ASSERT_FALSE(linkQueryDue(link, 1000 + QUERY_INTERVAL_MS - 1, g_config));
+  TEST_ASSERT_TRUE(linkQueryDue(link, 1000 + QUERY_INTERVAL_MS, g_config));
+}
+
+void test_response_clears_misses_and_reports_rtt(void) {
+  LinkQuality_t link = {};
+  linkConnected(link, 0, g_config);
+  linkWriteFailed(link);
+  linkQuerySent(link, 5000);
+  unsigned long rtt = 0;
+  TEST_ASSERT_TRUE(linkResponse(link, 5120, rtt));
+  TEST_ASSERT_EQUAL_UINT32(120, rtt);
+  TEST_ASSERT_EQUAL_UINT8(0, link.consecutiveMisses);
+  TEST_ASSERT_FALSE(linkResponse(link, 6000, rtt));
+}
+
+void test_timeout_counts_one_miss(void) {
+  LinkQuality_t link = {};
+  linkConnected(link, 0, g_config);
+  linkQuerySent(link, 1000);
+  TEST_ASSERT_FALSE(linkCheckTimeout(link, 1000 + RESPONSE_TIMEOUT_MS, g_config));
+  TEST_ASSERT_TRUE(linkCheckTimeout(link, 1001 + RESPONSE_TIMEOUT_MS, g_config));
+  TEST_ASSERT_FALSE(linkCheckTimeout(link, 2000 + RESPONSE_TIMEOUT_MS, g_config));
+  TEST_ASSERT_EQUAL_UINT8(1, link.consecutiveMisses);
+  TEST_ASSERT_EQUAL_UINT32(1, link.responseTimeouts);
+}
+
+void test_good_rssi_never_reconnects(void) {
+  LinkQuality_t link = {};
+  linkConnected(link, 0, g_config);
+  for (int i = 0; i < 20; i++) TEST_ASSERT_EQUAL(LINK_GOOD, linkScoreSample(link, -60, i * 5000, g_config));
+  TEST_ASSERT_EQUAL_UINT8(77, link.score);
+}
+
+void test_reconnect_after_low_samples(void) {
+  LinkQuality_t link = {};
+  linkConnected(link, 0, g_config);
+  // -70 dBm alone is fine; two misses push it below the threshold
+  TEST_ASSERT_EQUAL(LINK_GOOD, linkScoreSample(link, -70, 0, g_config));
+  link.consecutiveMisses = 2;
+  for (uint8_t i = 1; i < LINK_LOW_SAMPLES; i++) {
+    TEST_ASSERT_EQUAL(LINK_LOW, linkScoreSample(link, -70, i * 5000, g_config));
+  }
+  TEST_ASSERT_EQUAL(LINK_RECONNECT, linkScoreSample(link, -70, 15000, g_config));
+  TEST_ASSERT_EQUAL_UINT32(1, link.proactiveReconnects);
+}
+
+void test_weak_steady_link_is_left_alone(void) {
+  LinkQuality_t link = {};
+  linkConnected(link, 0, g_config);
+  // -88 dBm scores 15, far below the threshold, but every query is
+  // answered and the signal does not fall
+  for (int i = 0; i < 1000; i++) {
+    int rssi = -88 + (i % 2 ? 3 : -3);
+    TEST_ASSERT_NOT_EQUAL(LINK_RECONNECT, linkScoreSample(link, rssi, i * 5000, g_config));
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, link.proactiveReconnects);
+  TEST_ASSERT_GREATER_THAN(0, link.reconnectsHeldOff);
+}
+
+void test_falling_rssi_reconnects_without_misses(void) {
+  LinkQuality_t link = {};
+  linkConnected(link, 0, g_config);
+  LinkVerdict_t verdict = LINK_GOOD;
+  int rssi = -65;
+  unsigned long now = 0;
+  // 2 dB per minute down, no misses
+  for (; verdict != LINK_RECONNECT && rssi > -100; now += 5000) {
+    if (now % 30000 == 0) rssi--;
+    verdict = linkScoreSample(link, rssi, now, g_config);
+  }
+  TEST_ASSERT_EQUAL(LINK_RECONNECT, verdict);
+  TEST_ASSERT_GREATER_THAN(-95, rssi);
+  TEST_ASSERT_TRUE(link.rssiAvg < link.rssiTrend - LINK_RSSI_FALL_DB);
+}
+
+// Up to LINK_LOW_SAMPLES low samples with a miss from 'now' on, stopping
+// at a reconnect like the firmware does
+static LinkVerdict_t lowStreak(LinkQuality_t &link, unsigned long now) {
+  link.consecutiveMisses = 1;
+  LinkVerdict_t verdict = LINK_LOW;
+  for (uint8_t i = 0; i < LINK_LOW_SAMPLES && verdict != LINK_RECONNECT; i++) {
+    verdict = linkScoreSample(link, -85, now + i * 5000, g_config);
+  }
+  return verdict;
+}
+
+void test_backoff_doubles_while_reconnects_do_not_help(void) {
+  LinkQuality_t link = {};
+  unsigned long now = 0;
+  linkConnected(link, now, g_config);
+  TEST_ASSERT_EQUAL(LINK_RECONNECT, lowStreak(link, now));
+  TEST_ASSERT_EQUAL_UINT32(LINK_RECONNECT_BACKOFF_MIN_MS, link.reconnectBackoffMs);
+
+  // The new link is just as bad: the reconnect did not help, so the
+  // next one has to wait twice as long
+  linkConnected(link, now + 20000, g_config);
+  TEST_ASSERT_EQUAL(LINK_HELD_OFF, lowStreak(link, now + 20000));
+  TEST_ASSERT_TRUE(link.reconnectsHeldOff > 0);
+  TEST_ASSERT_FALSE(link.lastReconnectHelped);
+  TEST_ASSERT_EQUAL_UINT32(2 * LINK_RECONNECT_BACKOFF_MIN_MS, link.reconnectBackoffMs);
+  unsigned long last = link.lastReconnectMillis;
+  TEST_ASSERT_EQUAL(LINK_HELD_OFF, linkScoreSample(link, -85, last + LINK_RECONNECT_BACKOFF_MIN_MS + 5000, g_config));
+  TEST_ASSERT_EQUAL(LINK_RECONNECT, linkScoreSample(link, -85, last + 2 * LINK_RECONNECT_BACKOFF_MIN_MS, g_config));
+
+  // Never longer than the maximum
+  for (int i = 0; i < 20; i++) {
+    now += LINK_RECONNECT_BACKOFF_MAX_MS;
+    linkConnected(link, now, g_config);
+    lowStreak(link, now);
+  }
+  TEST_ASSERT_EQUAL_UINT32(LINK_RECONNECT_BACKOFF_MAX_MS, link.reconnectBackoffMs);
+}
+
+void test_backoff_resets_when_a_reconnect_helped(void) {
+  LinkQuality_t link = {};
+  linkConnected(link, 0, g_config);
+  lowStreak(link, 0);
+  linkConnected(link, 20000, g_config);
+  lowStreak(link, 20000);
+  TEST_ASSERT_EQUAL_UINT32(2 * LINK_RECONNECT_BACKOFF_MIN_MS, link.reconnectBackoffMs);
+
+  TEST_ASSERT_EQUAL(LINK_RECONNECT, lowStreak(link, 200000));
+  linkConnected(link, 220000, g_config);
+  TEST_ASSERT_EQUAL(LINK_GOOD, linkScoreSample(link, -60, 220000, g_config));
+  TEST_ASSERT_TRUE(link.lastReconnectHelped);
+  TEST_ASSERT_EQUAL_UINT32(LINK_RECONNECT_BACKOFF_MIN_MS, link.reconnectBackoffMs);
+}
+
+void test_threshold_zero_turns_reconnects_off(void) {
+  LinkQuality_t link = {};
+  g_config.linkScoreReconnect = 0;
+  linkConnected(link, 0, g_config);
+  link.consecutiveMisses = 4;
+  for (int i = 0; i < 10; i++) TEST_ASSERT_EQUAL(LINK_GOOD, linkScoreSample(link, -99, i * 5000, g_config));
+}
+
+void test_rssi_sample_interval(void) {
+  LinkQuality_t link = {};
+  linkConnected(link, 0, g_config);
+  TEST_ASSERT_TRUE(linkRssiSampleDue(link, 100, g_config));
+  TEST_ASSERT_FALSE(linkRssiSampleDue(link, 100 + RSSI_SAMPLE_INTERVAL_MS - 1, g_config));
+  TEST_ASSERT_TRUE(linkRssiSampleDue(link, 100 + RSSI_SAMPLE_INTERVAL_MS, g_config));
+}
+
+// Runs the monitor every 100 ms from 'from' to 'to'. The first reading
+// arrives at 'firstAt' and is refreshed every 'periodMs' (0 = never).
+static uint8_t runSlo(FreshnessSlo_t &slo, unsigned long from, unsigned long to,
+                      unsigned long firstAt, unsigned long periodMs) {
+  uint8_t events = 0;
+  FreshnessReport_t report;
+  for (unsigned long now = from; now <= to; now += 100) {
+    bool have = now >= firstAt;
+    unsigned long age = 0;
+    if (have) age = periodMs ? (now - firstAt) % periodMs : now - firstAt;
+    freshnessSloUpdate(slo, now, have, age, FRESHNESS_BOUND_MS, report);
+    events |= report.events;
+  }
+  return events;
+}
+
+void test_slow_boot_does_not_alert(void) {
+  FreshnessSlo_t slo = {};
+  // Scan and connect take 30 s, then a reading every query interval
+  uint8_t events = runSlo(slo, 100, 630000, 30000, QUERY_INTERVAL_MS);
+  TEST_ASSERT_EQUAL(0, events & (SLO_WENT_STALE | SLO_ALERT));
+  TEST_ASSERT_FALSE(slo.alertActive);
+  TEST_ASSERT_LESS_OR_EQUAL(600100, slo.totalMs);   // from the tick of the first reading
+}
+
+void test_outage_after_first_reading_alerts(void) {
+  FreshnessSlo_t slo = {};
+  uint8_t events = runSlo(slo, 100, 10000, 1000, 0);
+  TEST_ASSERT_EQUAL(0, events & (SLO_WENT_STALE | SLO_ALERT));
+  // The reading from t=1 s is never refreshed
+  events = runSlo(slo, 10100, 1000 + FRESHNESS_BOUND_MS + 5000, 1000, 0);
+  TEST_ASSERT_TRUE(events & SLO_WENT_STALE);
+  TEST_ASSERT_TRUE(events & SLO_ALERT);
+  TEST_ASSERT_TRUE(slo.alertActive);
+  TEST_ASSERT_EQUAL_UINT32(1, slo.staleEvents);
+}
+
+void test_window_end_resets(void) {
+  FreshnessSlo_t slo = {};
+  FreshnessReport_t report;
+  freshnessSloUpdate(slo, 100, true, 0, FRESHNESS_BOUND_MS, report);
+  freshnessSloUpdate(slo, 100 + FRESHNESS_WINDOW_MS, true, 0, FRESHNESS_BOUND_MS, report);
+  TEST_ASSERT_TRUE(report.events & SLO_WINDOW_END);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 100.0f, report.percent);
+  TEST_ASSERT_EQUAL_UINT32(0, slo.totalMs);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_query_due_on_connect);
+  RUN_TEST(test_response_clears_misses_and_reports_rtt);
+  RUN_TEST(test_timeout_counts_one_miss);
+  RUN_TEST(test_good_rssi_never_reconnects);
+  RUN_TEST(test_reconnect_after_low_samples);
+  RUN_TEST(test_weak_steady_link_is_left_alone);
+  RUN_TEST(test_falling_rssi_reconnects_without_misses);
+  RUN_TEST(test_backoff_doubles_while_reconnects_do_not_help);
+  RUN_TEST(test_backoff_resets_when_a_reconnect_helped);
+  RUN_TEST(test_threshold_zero_turns_reconnects_off);
+  RUN_TEST(test_rssi_sample_interval);
+  RUN_TEST(test_slow_boot_does_not_alert);
+  RUN_TEST(test_outage_after_first_reading_alerts);
+  RUN_TEST(test_window_end_resets);
+  return UNITY_END();
+}
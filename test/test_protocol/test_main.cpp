@@ -0,0 +1,159 @@
+/***************************************************************
+ * Unit tests: frame checksum, query decoder and command
+ * builders (include/fridge_protocol.h)
+ ***************************************************************/
+
+#include <unity.h>
+
+#include <string.h>
+#include <vector>
+
+#include "fridge_protocol.h"
+
+/** --------------------------------------------------
+ * A query response as the fridge sends it: unlocked, on,
+ * ECO, target 4, box at 6 degrees, 12.6 V.
+ * -------------------------------------------------- */
+static void buildResponse(std::vector<uint8_t> &frame) {
+  frame.assign({ 0xFE, 0xFE, 0x15, 0x01,
+                 0x00, 0x01, 0x01, 0x02, 0x04, 0x14, 0xEC, 0x02, 0x00, 0x00,
+                 0x00, 0x00, 0x00, 0x00, 0x06, 0x55, 0x0C, 0x06 });
+  uint16_t sum = calculateChecksum(frame.data(), frame.size());
+  frame.push_back((uint8_t)(sum >> 8));
+  frame.push_back((uint8_t)(sum & 0xFF));
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_checksum_is_byte_sum(void) {
+  const uint8_t bytes[] = { 0xFE, 0xFE, 0x03, 0x01, 0x02, 0x00 };
+  TEST_ASSERT_EQUAL_UINT16(0x0202, calculateChecksum(bytes, sizeof(bytes)));
+  TEST_ASSERT_EQUAL_UINT16(0, calculateChecksum(bytes, 0));
+}
+
+void test_decode_valid_response(void) {
+  std::vector<uint8_t> frame;
+  buildResponse(frame);
+  FridgeStatus_t st;
+  TEST_ASSERT_EQUAL(DECODE_OK, decodeFridgeQuery(frame.data(), frame.size(), st));
+  TEST_ASSERT_FALSE(st.locked);
+  TEST_ASSERT_TRUE(st.poweredOn);
+  TEST_ASSERT_EQUAL_UINT8(1, st.runMode);
+  TEST_ASSERT_EQUAL_INT8(4, st.leftTarget);
+  TEST_ASSERT_EQUAL_INT8(20, st.tempMax);
+  TEST_ASSERT_EQUAL_INT8(-20, st.tempMin);
+  TEST_ASSERT_EQUAL_INT8(6, st.leftCurrent);
+  TEST_ASSERT_EQUAL_UINT8(85, st.batPercent);
+  TEST_ASSERT_EQUAL_UINT8(12, st.batVolInt);
+  TEST_ASSERT_EQUAL_UINT8(6, st.batVolDec);
+  TEST_ASSERT_TRUE(decodeFridgeQuerySingleZone(frame.data(), frame.size(), st));
+}
+
+void test_decode_too_short(void) {
+  std::vector<uint8_t> frame;
+  buildResponse(frame);
+  FridgeStatus_t st;
+  TEST_ASSERT_EQUAL(DECODE_TOO_SHORT, decodeFridgeQuery(frame.data(), 23, st));
+  TEST_ASSERT_EQUAL(DECODE_TOO_SHORT, decodeFridgeQuery(frame.data(), 0, st));
+}
+
+void test_decode_bad_header(void) {
+  std::vector<uint8_t> frame;
+  buildResponse(frame);
+  frame[1] = 0xFD;
+  FridgeStatus_t st;
+  TEST_ASSERT_EQUAL(DECODE_BAD_HEADER, decodeFridgeQuery(frame.data(), frame.size(), st));
+}
+
+void test_decode_bad_checksum(void) {
+  std::vector<uint8_t> frame;
+  buildResponse(frame);
+  frame[10] ^= 0x10;
+  FridgeStatus_t st;
+  TEST_ASSERT_EQUAL(DECODE_BAD_CHECKSUM, decodeFridgeQuery(frame.data(), frame.size(), st));
+}
+
+void test_decode_corrupted_opcode_is_bad_checksum(void) {
+  std::vector<uint8_t> frame;
+  buildResponse(frame);
+  frame[3] ^= 0x04;
+  FridgeStatus_t st;
+  TEST_ASSERT_EQUAL(DECODE_BAD_CHECKSUM, decodeFridgeQuery(frame.data(), frame.size(), st));
+}
+
+void test_decode_other_opcode_with_valid_checksum(void) {
+  std::vector<uint8_t> frame;
+  buildResponse(frame);
+  frame.resize(frame.size() - 2);
+  frame[3] = FRIDGE_CMD_SET_OTHER;
+  uint16_t sum = calculateChecksum(frame.data(), frame.size());
+  frame.push_back((uint8_t)(sum >> 8));
+  frame.push_back((uint8_t)(sum & 0xFF));
+  FridgeStatus_t st;
+  TEST_ASSERT_EQUAL(DECODE_WRONG_OPCODE, decodeFridgeQuery(frame.data(), frame.size(), st));
+}
+
+void test_decode_leaves_status_alone_on_error(void) {
+  std::vector<uint8_t> frame;
+  buildResponse(frame);
+  frame.back() ^= 0x01;
+  FridgeStatus_t st;
+  memset(&st, 0x5A, sizeof(st));
+  FridgeStatus_t before = st;
+  TEST_ASSERT_NOT_EQUAL(DECODE_OK, decodeFridgeQuery(frame.data(), frame.size(), st));
+  TEST_ASSERT_EQUAL_MEMORY(&before, &st, sizeof(st));
+}
+
+void test_query_and_bind_commands(void) {
+  std::vector<uint8_t> packet;
+  const uint8_t query[] = { 0xFE, 0xFE, 0x03, 0x01, 0x02, 0x00 };
+  const uint8_t bind[] = { 0xFE, 0xFE, 0x03, 0x01, 0x02, 0x00, 0xFF };
+  buildQueryCommand(packet);
+  TEST_ASSERT_EQUAL(sizeof(query), packet.size());
+  TEST_ASSERT_EQUAL_MEMORY(query, packet.data(), sizeof(query));
+  buildBindCommand(packet);
+  TEST_ASSERT_EQUAL(sizeof(bind), packet.size());
+  TEST_ASSERT_EQUAL_MEMORY(bind, packet.data(), sizeof(bind));
+}
+
+void test_set_target_command(void) {
+  std::vector<uint8_t> packet;
+  buildSetTargetCommand(packet, -3);
+  const uint8_t expected[] = { 0xFE, 0xFE, 0x04, FRIDGE_CMD_SET_LEFT, 0xFD, 0x03, 0x02 };
+  TEST_ASSERT_EQUAL(sizeof(expected), packet.size());
+  TEST_ASSERT_EQUAL_MEMORY(expected, packet.data(), sizeof(expected));
+}
+
+void test_set_other_command_round_trips_settings(void) {
+  std::vector<uint8_t> frame;
+  buildResponse(frame);
+  FridgeStatus_t st;
+  TEST_ASSERT_EQUAL(DECODE_OK, decodeFridgeQuery(frame.data(), frame.size(), st));
+
+  std::vector<uint8_t> packet;
+  buildSetOtherCommand(packet, st);
+  TEST_ASSERT_EQUAL(20, packet.size());
+  TEST_ASSERT_EQUAL_UINT8(FRIDGE_CMD_SET_OTHER, packet[3]);
+  TEST_ASSERT_EQUAL_UINT8(packet.size() - 3, packet[2]);
+  // Settings are the query payload up to leftTCHalt
+  TEST_ASSERT_EQUAL_MEMORY(&frame[4], &packet[4], 14);
+  uint16_t sum = calculateChecksum(packet.data(), packet.size() - 2);
+  TEST_ASSERT_EQUAL_UINT16(sum, (uint16_t)((packet[18] << 8) | packet[19]));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_checksum_is_byte_sum);
+  RUN_TEST(test_decode_valid_response);
+  RUN_TEST(test_decode_too_short);
+  RUN_TEST(test_decode_bad_header);
+  RUN_TEST(test_decode_bad_checksum);
+  RUN_TEST(test_decode_corrupted_opcode_is_bad_checksum);
+  RUN_TEST(test_decode_other_opcode_with_valid_checksum);
+  RUN_TEST(test_decode_leaves_status_alone_on_error);
+  RUN_TEST(test_query_and_bind_commands);
+  RUN_TEST(test_set_target_command);
+  RUN_TEST(test_set_other_command_round_trips_settings);
+  return UNITY_END();
+}
@@ -0,0 +1,177 @@
+/***************************************************************
+ * Unit tests: remote configuration patches, validation and
+ * rendering (include/remote_config.h)
+ ***************************************************************/
+
+#include <unity.h>
+
+#include <string.h>
+
+#include "alarm_dispatch.h"
+#include "link_monitor.h"
+#include "remote_config.h"
+
+static FridgeConfig_t g_config;
+static FridgeConfig_t g_out;
+static ConfigResult_t g_result;
+
+/** --------------------------------------------------
+ * Same shape as defaultConfig() in src/main.cpp.
+ * -------------------------------------------------- */
+void setUp(void) {
+  memset(&g_config, 0, sizeof(g_config));
+  g_config.magic = CONFIG_MAGIC;
+  g_config.rev = 7;
+  strcpy(g_config.deviceName, "WT-0001");
+  strcpy(g_config.serviceUuid, "00001234-0000-1000-8000-00805f9b34fb");
+  strcpy(g_config.writeUuid, "1235");
+  strcpy(g_config.notifyUuid, "1236");
+  linkDefaultConfig(g_config);
+  g_config.alarmTempMargin = 5;
+  g_config.alarmBatteryLowPercent = 20;
+  const AlarmConfig_t alarm = ALARM_DEFAULT_CONFIG;
+  g_config.alarmBurst = alarm.burst;
+  g_config.alarmMinIntervalMs = alarm.keyMinIntervalMs;
+  g_config.alarmEscalateAfterMs = alarm.escalateAfterMs;
+  g_config.alarmRefillMs = alarm.refillMs;
+  g_config.mqttAlarms = true;
+  g_config.sdHistory = true;
+}
+
+void tearDown(void) {}
+
+static bool apply(const char* patch) {
+  return configApply(g_config, patch, strlen(patch), false, g_out, g_result);
+}
+
+static uint32_t bitOf(const char* name) {
+  return 1UL << (configFindField(name) - CONFIG_FIELDS);
+}
+
+static void assertRejectedUnchanged(const char* patch) {
+  TEST_ASSERT_FALSE_MESSAGE(apply(patch), patch);
+  TEST_ASSERT_NOT_EQUAL(0, strlen(g_result.error));
+  TEST_ASSERT_EQUAL_MEMORY(&g_config, &g_out, sizeof(g_config));
+}
+
+void test_defaults_are_valid(void) {
+  char error[CONFIG_ERROR_LEN];
+  TEST_ASSERT_TRUE(configValidate(g_config, error, sizeof(error)));
+}
+
+void test_patch_changes_fields_and_bumps_rev(void) {
+  TEST_ASSERT_TRUE(apply("{\"base_rev\":7, \"query_interval_ms\":30000, \"mqtt_alarms\":false}"));
+  TEST_ASSERT_EQUAL_UINT32(8, g_out.rev);
+  TEST_ASSERT_EQUAL_UINT32(30000, g_out.queryIntervalMs);
+  TEST_ASSERT_FALSE(g_out.mqttAlarms);
+  TEST_ASSERT_EQUAL_HEX32(bitOf("query_interval_ms") | bitOf("mqtt_alarms"), g_result.changedMask);
+  TEST_ASSERT_EQUAL_HEX32(0, g_result.changedMask & configReconnectMask());
+}
+
+void test_patch_that_changes_nothing_keeps_rev(void) {
+  TEST_ASSERT_TRUE(apply("{\"device_name\":\"WT-0001\"}"));
+  TEST_ASSERT_EQUAL_HEX32(0, g_result.changedMask);
+  TEST_ASSERT_EQUAL_UINT32(7, g_out.rev);
+  TEST_ASSERT_TRUE(apply("{}"));
+}
+
+void test_name_and_uuids_apply_on_reconnect(void) {
+  TEST_ASSERT_TRUE(apply("{\"device_name\":\"WT-0002\",\"notify_uuid\":\"0000ABCD\"}"));
+  TEST_ASSERT_EQUAL_HEX32(g_result.changedMask, g_result.changedMask & configReconnectMask());
+  char names[64];
+  configFormatFieldNames(g_result.changedMask, names, sizeof(names));
+  TEST_ASSERT_EQUAL_STRING("device_name,notify_uuid", names);
+}
+
+void test_stale_base_rev_is_a_conflict(void) {
+  assertRejectedUnchanged("{\"base_rev\":6,\"query_interval_ms\":30000}");
+  TEST_ASSERT_NOT_NULL(strstr(g_result.error, "conflict"));
+}
+
+void test_patch_applies_all_or_nothing(void) {
+  // The first member is valid, the second out of range
+  assertRejectedUnchanged("{\"alarm_burst\":10,\"link_score_reconnect\":101}");
+  assertRejectedUnchanged("{\"alarm_burst\":10,\"query_interval_ms\":1000}");
+  assertRejectedUnchanged("{\"alarm_burst\":10,\"nope\":1}");
+}
+
+void test_cross_field_rules(void) {
+  assertRejectedUnchanged("{\"freshness_bound_ms\":60000}");
+  assertRejectedUnchanged("{\"response_timeout_ms\":60000}");
+  TEST_ASSERT_TRUE(apply("{\"query_interval_ms\":120000,\"freshness_bound_ms\":250000}"));
+}
+
+void test_value_types(void) {
+  assertRejectedUnchanged("{\"query_interval_ms\":\"30000\"}");
+  assertRejectedUnchanged("{\"query_interval_ms\":30000.5}");
+  assertRejectedUnchanged("{\"query_interval_ms\":3e4}");
+  assertRejectedUnchanged("{\"query_interval_ms\":-30000}");
+  assertRejectedUnchanged("{\"query_interval_ms\":99999999999999999999}");
+  assertRejectedUnchanged("{\"alarm_burst\":300}");
+  assertRejectedUnchanged("{\"mqtt_alarms\":1}");
+  assertRejectedUnchanged("{\"device_name\":null}");
+  assertRejectedUnchanged("{\"device_name\":{\"a\":1}}");
+  assertRejectedUnchanged("{\"device_name\":[\"a\"]}");
+}
+
+void test_syntax_errors(void) {
+  assertRejectedUnchanged("");
+  assertRejectedUnchanged("[]");
+  assertRejectedUnchanged("{\"alarm_burst\":10");
+  assertRejectedUnchanged("{\"alarm_burst\" 10}");
+  assertRejectedUnchanged("{\"alarm_burst\":10,}");
+  assertRejectedUnchanged("{\"alarm_burst\":10} x");
+  assertRejectedUnchanged("{\"device_name\":\"a\\nb\"}");
+}
+
+void test_strings(void) {
+  assertRejectedUnchanged("{\"device_name\":\"\"}");
+  assertRejectedUnchanged("{\"device_name\":\"a name much longer than the field\"}");
+  assertRejectedUnchanged("{\"service_uuid\":\"12345\"}");
+  assertRejectedUnchanged("{\"write_uuid\":\"12g4\"}");
+  assertRejectedUnchanged("{\"webhook_url\":\"ftp://example.com\"}");
+  TEST_ASSERT_TRUE(apply("{\"device_name\":\"a \\\"b\\\" \\\\ c\\/d\",\"webhook_url\":\"https://example.com/x\"}"));
+  TEST_ASSERT_EQUAL_STRING("a \"b\" \\ c/d", g_out.deviceName);
+  TEST_ASSERT_EQUAL_STRING("https://example.com/x", g_out.webhookUrl);
+}
+
+void test_document_round_trip(void) {
+  strcpy(g_config.deviceName, "quote\" back\\");
+  char json[CONFIG_JSON_MAX_LEN];
+  size_t len = configFormatJson(g_config, json, sizeof(json));
+  TEST_ASSERT_GREATER_THAN(0, len);
+  TEST_ASSERT_EQUAL(strlen(json), len);
+
+  // A state document is applied to all zeros: every field must be there
+  FridgeConfig_t empty;
+  memset(&empty, 0, sizeof(empty));
+  TEST_ASSERT_TRUE(configApply(empty, json, len, true, g_out, g_result));
+  TEST_ASSERT_EQUAL_MEMORY(&g_config, &g_out, sizeof(g_config));
+
+  const char* partial = "{\"rev\":3,\"device_name\":\"WT-0001\"}";
+  TEST_ASSERT_FALSE(configApply(empty, partial, strlen(partial), true, g_out, g_result));
+}
+
+void test_format_reports_a_small_buffer(void) {
+  char json[CONFIG_JSON_MAX_LEN];
+  size_t len = configFormatJson(g_config, json, sizeof(json));
+  TEST_ASSERT_EQUAL(0, configFormatJson(g_config, json, len));
+  TEST_ASSERT_EQUAL(len, configFormatJson(g_config, json, len + 1));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_defaults_are_valid);
+  RUN_TEST(test_patch_changes_fields_and_bumps_rev);
+  RUN_TEST(test_patch_that_changes_nothing_keeps_rev);
+  RUN_TEST(test_name_and_uuids_apply_on_reconnect);
+  RUN_TEST(test_stale_base_rev_is_a_conflict);
+  RUN_TEST(test_patch_applies_all_or_nothing);
+  RUN_TEST(test_cross_field_rules);
+  RUN_TEST(test_value_types);
+  RUN_TEST(test_syntax_errors);
+  RUN_TEST(test_strings);
+  RUN_TEST(test_document_round_trip);
+  RUN_TEST(test_format_reports_a_small_buffer);
+  return UNITY_END();
+}
@@ -0,0 +1,237 @@
+/***************************************************************
+ * Unit tests: block-aligned SD sink (include/sd_sink.h)
+ *
+ * The card is in memory and only keeps what was synced;
+ * new files start full of stale blocks from an "older
+ * file", as reused clusters would.
+ ***************************************************************/
+
+#include <unity.h>
+
+#include <memory>
+#include <string.h>
+#include <vector>
+
+#include "sd_sink.h"
+#include "virtual_clock.h"
+
+#define FILE_BYTES (16 * SD_BLOCK_SIZE)
+#define SYNC_MS 5000
+
+struct MemCard_t {
+  std::vector<std::vector<uint8_t>> written;
+  std::vector<std::vector<uint8_t>> durable;
+  int failOpens = 0;
+  uint32_t opens = 0;
+};
+
+static VirtualClock_t g_vc;
+static MemCard_t g_card;
+static std::unique_ptr<SdSink_t> g_sink;
+
+static bool memCardOpen(void* ctx, uint32_t bytes) {
+  MemCard_t* card = (MemCard_t*)ctx;
+  card->opens++;
+  if (card->failOpens > 0) {
+    card->failOpens--;
+    return false;
+  }
+  std::vector<uint8_t> stale(bytes);
+  for (uint32_t b = 0; b + SD_BLOCK_SIZE <= bytes; b += SD_BLOCK_SIZE) {
+    SdBlockHeader_t h = { SD_BLOCK_MAGIC, 16, 0xDEADBEEF, b / SD_BLOCK_SIZE };
+    memcpy(&stale[b], &h, sizeof(h));
+  }
+  card->written.push_back(stale);
+  card->durable.push_back(stale);
+  return true;
+}
+
+static bool memCardWrite(void* ctx, uint32_t offset, const uint8_t* data, size_t len) {
+  std::vector<uint8_t> &file = ((MemCard_t*)ctx)->written.back();
+  if (offset % SD_BLOCK_SIZE != 0 || len % SD_BLOCK_SIZE != 0 || offset + len > file.size()) return false;
+  memcpy(&file[offset], data, len);
+  return true;
+}
+
+static bool memCardSync(void* ctx) {
+  MemCard_t* card = (MemCard_t*)ctx;
+  card->durable = card->written;
+  return true;
+}
+
+static const SdBackend_t MEM_BACKEND = { &g_card, memCardOpen, memCardWrite, memCardSync };
+
+/** --------------------------------------------------
+ * Record i: 12..28 bytes whose contents depend only on i.
+ * -------------------------------------------------- */
+static size_t makeRecord(uint32_t i, uint8_t* bytes) {
+  size_t len = 12 + i % 17;
+  for (size_t b = 0; b < len; b++) bytes[b] = (uint8_t)(i * 31 + b);
+  return len;
+}
+
+static void append(uint32_t i) {
+  uint8_t rec[64];
+  size_t len = makeRecord(i, rec);
+  sdSinkAppend(*g_sink, SD_RECORD_LOG, rec, len);
+}
+
+/** --------------------------------------------------
+ * Reads the files back in order; returns how many records
+ * matched the stream from the start, -1 on a mismatch.
+ * -------------------------------------------------- */
+static int readBack(const std::vector<std::vector<uint8_t>> &files) {
+  uint32_t next = 0;
+  bool mismatch = false;
+  for (const std::vector<uint8_t> &file : files) {
+    sdSinkReadFile(file.data(), file.size(), [&](uint8_t kind, const uint8_t* data, size_t len) {
+      uint8_t expected[64];
+      size_t expectedLen = makeRecord(next++, expected);
+      if (kind != SD_RECORD_LOG || len != expectedLen || memcmp(data, expected, len) != 0) mismatch = true;
+    });
+  }
+  return mismatch ? -1 : (int)next;
+}
+
+void setUp(void) {
+  virtualClockInit(g_vc, 1);
+  virtualClockInstall(g_vc);
+  g_card = MemCard_t();
+  g_sink.reset(new SdSink_t());
+}
+
+void tearDown(void) {
+  clockInstall(nullptr);
+}
+
+void test_records_read_back_across_files(void) {
+  TEST_ASSERT_TRUE(sdSinkBegin(*g_sink, MEM_BACKEND, FILE_BYTES, SYNC_MS, 1));
+  const uint32_t count = 2000;
+  for (uint32_t i = 0; i < count; i++) {
+    append(i);
+    TEST_ASSERT_TRUE(sdSinkPoll(*g_sink));
+  }
+  TEST_ASSERT_TRUE(sdSinkPoll(*g_sink, true));
+  TEST_ASSERT_GREATER_THAN(1, g_sink->stats.files);
+  TEST_ASSERT_EQUAL_UINT32(0, g_sink->stats.dropped);
+  TEST_ASSERT_EQUAL(count, readBack(g_card.durable));
+}
+
+void test_sync_only_on_the_interval(void) {
+  sdSinkBegin(*g_sink, MEM_BACKEND, FILE_BYTES, SYNC_MS, 1);
+  append(0);
+  sdSinkPoll(*g_sink);
+  TEST_ASSERT_EQUAL_UINT32(0, g_sink->stats.syncs);
+  TEST_ASSERT_EQUAL(0, readBack(g_card.durable));
+
+  clockDelay(SYNC_MS);
+  sdSinkPoll(*g_sink);
+  TEST_ASSERT_EQUAL_UINT32(1, g_sink->stats.syncs);
+  TEST_ASSERT_EQUAL_UINT32(1, g_sink->stats.partialWrites);
+  TEST_ASSERT_EQUAL(1, readBack(g_card.durable));
+
+  // Nothing appended since: no write, no sync
+  clockDelay(SYNC_MS);
+  sdSinkPoll(*g_sink);
+  TEST_ASSERT_EQUAL_UINT32(1, g_sink->stats.syncs);
+}
+
+void test_power_loss_keeps_everything_synced(void) {
+  sdSinkBegin(*g_sink, MEM_BACKEND, FILE_BYTES, SYNC_MS, 7);
+  uint32_t synced = 0;
+  for (uint32_t i = 0; i < 1537; i++) {
+    append(i);
+    uint32_t syncs = g_sink->stats.syncs;
+    sdSinkPoll(*g_sink, i % 100 == 99);
+    if (g_sink->stats.syncs != syncs) synced = i + 1;
+  }
+  // Power cut: only g_card.durable survives; the stale blocks of the
+  // older file must not be read as records
+  int recovered = readBack(g_card.durable);
+  TEST_ASSERT_GREATER_OR_EQUAL((int)synced, recovered);
+  TEST_ASSERT_LESS_THAN(1537, recovered);
+}
+
+void test_failed_open_is_retried_with_backoff(void) {
+  g_card.failOpens = 3;
+  TEST_ASSERT_FALSE(sdSinkBegin(*g_sink, MEM_BACKEND, FILE_BYTES, SYNC_MS, 1));
+  append(0);
+  append(1);
+
+  sdSinkPoll(*g_sink, true);
+  TEST_ASSERT_EQUAL_UINT32(1, g_card.opens);   // still backing off
+  clockDelay(SD_SINK_RETRY_MS);
+  sdSinkPoll(*g_sink, true);
+  TEST_ASSERT_EQUAL_UINT32(2, g_card.opens);
+  clockDelay(SD_SINK_RETRY_MS);
+  sdSinkPoll(*g_sink, true);
+  TEST_ASSERT_EQUAL_UINT32(2, g_card.opens);   // now waits 2 s
+  clockDelay(SD_SINK_RETRY_MS);
+  sdSinkPoll(*g_sink, true);
+  TEST_ASSERT_EQUAL_UINT32(3, g_card.opens);
+  clockDelay(4 * SD_SINK_RETRY_MS);
+  TEST_ASSERT_TRUE(sdSinkPoll(*g_sink, true));
+  TEST_ASSERT_EQUAL_UINT32(4, g_card.opens);
+  TEST_ASSERT_EQUAL_UINT32(3, g_sink->stats.openFailures);
+  TEST_ASSERT_EQUAL_UINT32(0, g_sink->openRetryMs);
+
+  // What was collected meanwhile reaches the card
+  TEST_ASSERT_EQUAL(2, readBack(g_card.durable));
+}
+
+void test_backoff_is_capped(void) {
+  g_card.failOpens = 1000;
+  sdSinkBegin(*g_sink, MEM_BACKEND, FILE_BYTES, SYNC_MS, 1);
+  for (int i = 0; i < 100; i++) {
+    clockDelay(SD_SINK_RETRY_MAX_MS);
+    sdSinkPoll(*g_sink);
+  }
+  TEST_ASSERT_EQUAL_UINT32(SD_SINK_RETRY_MAX_MS, g_sink->openRetryMs);
+  TEST_ASSERT_GREATER_THAN(90, g_card.opens);
+}
+
+void test_ring_full_drops_new_records_without_a_file(void) {
+  g_card.failOpens = 1000;
+  sdSinkBegin(*g_sink, MEM_BACKEND, FILE_BYTES, SYNC_MS, 1);
+  for (uint32_t i = 0; i < 200; i++) {
+    append(i);
+    sdSinkPoll(*g_sink);
+  }
+  TEST_ASSERT_GREATER_THAN(0, g_sink->stats.dropped);
+  TEST_ASSERT_EQUAL_UINT32(200, g_sink->stats.records + g_sink->stats.dropped);
+
+  // Once a file opens, every record kept in RAM reaches the card
+  g_card.failOpens = 0;
+  clockDelay(SD_SINK_RETRY_MAX_MS);
+  sdSinkPoll(*g_sink, true);
+  const std::vector<uint8_t> &file = g_card.durable.back();
+  TEST_ASSERT_EQUAL_UINT32(g_sink->stats.records, sdSinkReadFile(file.data(), file.size(),
+                                                                 [](uint8_t, const uint8_t*, size_t) {}));
+}
+
+void test_unsynced_new_file_reads_empty(void) {
+  sdSinkBegin(*g_sink, MEM_BACKEND, FILE_BYTES, SYNC_MS, 1);
+  TEST_ASSERT_EQUAL(1, g_card.durable.size());
+  TEST_ASSERT_EQUAL(0, readBack(g_card.durable));
+}
+
+void test_oversize_record_is_rejected(void) {
+  sdSinkBegin(*g_sink, MEM_BACKEND, FILE_BYTES, SYNC_MS, 1);
+  uint8_t big[SD_BLOCK_PAYLOAD] = {};
+  TEST_ASSERT_FALSE(sdSinkAppend(*g_sink, SD_RECORD_LOG, big, 256));
+  TEST_ASSERT_FALSE(sdSinkAppend(*g_sink, SD_RECORD_LOG, big, SD_BLOCK_PAYLOAD - 1));
+  TEST_ASSERT_TRUE(sdSinkAppend(*g_sink, SD_RECORD_LOG, big, 255));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_records_read_back_across_files);
+  RUN_TEST(test_sync_only_on_the_interval);
+  RUN_TEST(test_power_loss_keeps_everything_synced);
+  RUN_TEST(test_failed_open_is_retried_with_backoff);
+  RUN_TEST(test_backoff_is_capped);
+  RUN_TEST(test_ring_full_drops_new_records_without_a_file);
+  RUN_TEST(test_unsynced_new_file_reads_empty);
+  RUN_TEST(test_oversize_record_is_rejected);
+  return UNITY_END();
+}
@@ -0,0 +1,353 @@
+/***************************************************************
+ * Unit tests: WebSocket status frames and the fan-out to
+ * hundreds of subscribers (include/status_stream.h)
+ *
+ * Hub_t stands in for AsyncWebSocket behind the same
+ * statusPublishDelta() the firmware calls: the frame goes
+ * into one shared buffer that every client's bounded send
+ * queue references, and a full queue drops the frame like
+ * the real server does.
+ ***************************************************************/
+
+#include <unity.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "status_stream.h"
+
+#define SUBSCRIBERS 500
+#define QUEUE_MAX 8      // per-client send queue, like WS_MAX_QUEUED_MESSAGES
+#define PUBLISHES 400
+#define TIMED_PUBLISHES 2000
+
+typedef std::shared_ptr<const std::string> Frame_t;
+
+/** --------------------------------------------------
+ * A subscriber: its send queue and the state it rebuilt
+ * from the frames it received.
+ * -------------------------------------------------- */
+struct Client_t {
+  std::deque<Frame_t> queue;
+  int32_t fields[STATUS_FIELD_COUNT];
+  bool haveSnapshot;
+  uint32_t seq;
+  uint32_t dropped;
+  uint32_t resyncs;
+};
+
+struct Hub_t {
+  std::vector<Client_t> clients;
+  int32_t last[STATUS_FIELD_COUNT];
+  bool haveLast;
+  uint32_t seq;
+  StatusPushStats_t stats;
+};
+
+static Hub_t g_hub;
+
+static void hubSend(Client_t &c, const Frame_t &frame) {
+  if (c.queue.size() >= QUEUE_MAX) {
+    c.dropped++;
+    return;
+  }
+  c.queue.push_back(frame);
+}
+
+static void hubSendSnapshot(Client_t &c) {
+  char buf[STATUS_FRAME_MAX_LEN];
+  size_t len = statusSerializeFrame(buf, sizeof(buf), "snapshot", g_hub.seq, 0, g_hub.last, nullptr);
+  TEST_ASSERT_NOT_EQUAL(0, len);
+  hubSend(c, std::make_shared<const std::string>(buf, len));
+}
+
+static size_t hubCount(void*) {
+  return g_hub.clients.size();
+}
+
+static bool hubSendAll(void*, const char* frame, size_t len) {
+  Frame_t shared = std::make_shared<const std::string>(frame, len);
+  for (Client_t &c : g_hub.clients) hubSend(c, shared);
+  return true;
+}
+
+static const StatusFanout_t g_hubFanout = { nullptr, hubCount, hubSendAll };
+
+/** --------------------------------------------------
+ * Same steps as webServerPublish(): diff and bump seq,
+ * then the shared serialize-and-fan-out.
+ * -------------------------------------------------- */
+static void hubPublish(const int32_t fields[STATUS_FIELD_COUNT]) {
+  bool changed[STATUS_FIELD_COUNT];
+  size_t count = statusDiff(g_hub.last, g_hub.haveLast, fields, changed);
+  memcpy(g_hub.last, fields, sizeof(g_hub.last));
+  g_hub.haveLast = true;
+  if (count == 0) return;
+  g_hub.seq++;
+  TEST_ASSERT_NOT_EQUAL(0, statusPublishDelta(g_hubFanout, g_hub.stats, g_hub.seq, 40, fields, changed, count));
+}
+
+/** --------------------------------------------------
+ * Minimal reader for our own frames: "type", "seq" and
+ * the name:value pairs of the status/changes object.
+ * Returns false if a field name is unknown.
+ * -------------------------------------------------- */
+static bool parseFrame(const std::string &frame, bool &snapshot, uint32_t &seq,
+                       int32_t fields[STATUS_FIELD_COUNT], bool present[STATUS_FIELD_COUNT]) {
+  const char* s = frame.c_str();
+  snapshot = strncmp(s, "{\"type\":\"snapshot\"", 18) == 0;
+  const char* p = strstr(s, "\"seq\":");
+  if (p == nullptr) return false;
+  seq = (uint32_t)strtoul(p + 6, nullptr, 10);
+
+  memset(present, 0, sizeof(bool) * STATUS_FIELD_COUNT);
+  p = strstr(s, snapshot ? "\"status\":{" : "\"changes\":{");
+  if (p == nullptr) return false;
+  p = strchr(p, '{') + 1;
+  while (*p == '"') {
+    const char* end = strchr(p + 1, '"');
+    size_t i = 0;
+    while (i < STATUS_FIELD_COUNT &&
+           (strlen(STATUS_FIELD_NAMES[i]) != (size_t)(end - p - 1) ||
+            strncmp(STATUS_FIELD_NAMES[i], p + 1, end - p - 1) != 0)) i++;
+    if (i == STATUS_FIELD_COUNT) return false;
+    char* next;
+    fields[i] = (int32_t)strtol(end + 2, &next, 10);
+    present[i] = true;
+    p = (*next == ',') ? next + 1 : next;
+  }
+  return strcmp(p, "}}") == 0;
+}
+
+/** --------------------------------------------------
+ * The client side of the dashboard: apply snapshots and
+ * deltas in order, ask for a snapshot on a seq gap.
+ * -------------------------------------------------- */
+static void clientDrain(Client_t &c) {
+  while (!c.queue.empty()) {
+    Frame_t frame = c.queue.front();
+    c.queue.pop_front();
+
+    bool snapshot;
+    uint32_t seq;
+    int32_t fields[STATUS_FIELD_COUNT];
+    bool present[STATUS_FIELD_COUNT];
+    TEST_ASSERT_TRUE_MESSAGE(parseFrame(*frame, snapshot, seq, fields, present), frame->c_str());
+
+    if (snapshot) {
+      memcpy(c.fields, fields, sizeof(c.fields));
+      c.haveSnapshot = true;
+      c.seq = seq;
+    } else if (c.haveSnapshot && seq == c.seq + 1) {
+      for (size_t i = 0; i < STATUS_FIELD_COUNT; i++) {
+        if (present[i]) c.fields[i] = fields[i];
+      }
+      c.seq = seq;
+    } else if (c.haveSnapshot && seq > c.seq + 1) {
+      c.haveSnapshot = false;
+      c.resyncs++;
+      hubSendSnapshot(c);
+    }
+  }
+}
+
+static uint32_t g_rand;
+
+static uint32_t nextRand() {
+  g_rand = g_rand * 1664525u + 1013904223u;
+  return g_rand >> 8;
+}
+
+static void randomStep(int32_t fields[STATUS_FIELD_COUNT]) {
+  // Mostly the current and the battery move, sometimes a setting
+  fields[14] = (int32_t)(nextRand() % 60) - 20;
+  if (nextRand() % 4 == 0) fields[15] = nextRand() % 101;
+  if (nextRand() % 10 == 0) fields[nextRand() % STATUS_FIELD_COUNT] = (int32_t)(nextRand() % 256) - 128;
+}
+
+void setUp(void) {
+  g_hub = Hub_t();
+  g_hub.clients.resize(SUBSCRIBERS);
+  for (Client_t &c : g_hub.clients) {
+    memset(c.fields, 0, sizeof(c.fields));
+    c.haveSnapshot = false;
+    c.seq = 0;
+    c.dropped = 0;
+    c.resyncs = 0;
+  }
+  g_rand = 12345;
+}
+
+void tearDown(void) {}
+
+void test_snapshot_has_every_field(void) {
+  FridgeStatus_t st = {};
+  st.leftTarget = -18;
+  st.batPercent = 87;
+  int32_t fields[STATUS_FIELD_COUNT];
+  statusToFields(st, fields);
+
+  char buf[STATUS_FRAME_MAX_LEN];
+  size_t len = statusSerializeFrame(buf, sizeof(buf), "snapshot", 3, 1200, fields, nullptr);
+  TEST_ASSERT_EQUAL(strlen(buf), len);
+
+  bool snapshot;
+  uint32_t seq;
+  int32_t parsed[STATUS_FIELD_COUNT];
+  bool present[STATUS_FIELD_COUNT];
+  TEST_ASSERT_TRUE(parseFrame(std::string(buf, len), snapshot, seq, parsed, present));
+  TEST_ASSERT_TRUE(snapshot);
+  TEST_ASSERT_EQUAL_UINT32(3, seq);
+  for (size_t i = 0; i < STATUS_FIELD_COUNT; i++) TEST_ASSERT_TRUE(present[i]);
+  TEST_ASSERT_EQUAL_MEMORY(fields, parsed, sizeof(fields));
+}
+
+void test_delta_has_only_changed_fields(void) {
+  int32_t last[STATUS_FIELD_COUNT] = {};
+  int32_t fields[STATUS_FIELD_COUNT] = {};
+  fields[14] = 3;
+  bool changed[STATUS_FIELD_COUNT];
+  TEST_ASSERT_EQUAL(1, statusDiff(last, true, fields, changed));
+
+  char buf[STATUS_FRAME_MAX_LEN];
+  size_t len = statusSerializeFrame(buf, sizeof(buf), "delta", 8, 40, fields, changed);
+  TEST_ASSERT_EQUAL_STRING("{\"type\":\"delta\",\"seq\":8,\"age\":40,\"changes\":{\"leftCurrent\":3}}", buf);
+  TEST_ASSERT_EQUAL(strlen(buf), len);
+}
+
+void test_first_publish_changes_everything(void) {
+  int32_t last[STATUS_FIELD_COUNT] = {};
+  int32_t fields[STATUS_FIELD_COUNT] = {};
+  bool changed[STATUS_FIELD_COUNT];
+  TEST_ASSERT_EQUAL(STATUS_FIELD_COUNT, statusDiff(last, false, fields, changed));
+  TEST_ASSERT_EQUAL(0, statusDiff(last, true, fields, changed));
+}
+
+void test_small_buffer_fails_cleanly(void) {
+  int32_t fields[STATUS_FIELD_COUNT] = {};
+  char buf[32];
+  TEST_ASSERT_EQUAL(0, statusSerializeFrame(buf, sizeof(buf), "snapshot", 1, 0, fields, nullptr));
+}
+
+void test_worst_case_frame_fits(void) {
+  int32_t fields[STATUS_FIELD_COUNT];
+  for (size_t i = 0; i < STATUS_FIELD_COUNT; i++) fields[i] = -128;
+  char buf[STATUS_FRAME_MAX_LEN];
+  TEST_ASSERT_NOT_EQUAL(0, statusSerializeFrame(buf, sizeof(buf), "snapshot", 0xFFFFFFFFu,
+                                                0xFFFFFFFFul, fields, nullptr));
+}
+
+void test_unchanged_reading_sends_nothing(void) {
+  int32_t fields[STATUS_FIELD_COUNT] = {};
+  hubPublish(fields);
+  hubPublish(fields);
+  TEST_ASSERT_EQUAL_UINT32(1, g_hub.stats.deltas);
+  TEST_ASSERT_EQUAL(1, g_hub.clients[0].queue.size());
+}
+
+void test_fanout_serializes_once_and_shares_the_buffer(void) {
+  int32_t fields[STATUS_FIELD_COUNT] = {};
+  hubPublish(fields);
+  TEST_ASSERT_EQUAL_UINT32(1, g_hub.stats.deltas);
+  // One buffer, referenced by every queue (and nothing else)
+  const Frame_t &first = g_hub.clients[0].queue.front();
+  TEST_ASSERT_EQUAL(SUBSCRIBERS, first.use_count());
+  for (const Client_t &c : g_hub.clients) TEST_ASSERT_TRUE(c.queue.front() == first);
+}
+
+void test_fanout_all_subscribers_converge(void) {
+  for (Client_t &c : g_hub.clients) hubSendSnapshot(c);
+
+  int32_t fields[STATUS_FIELD_COUNT] = {};
+  for (int n = 1; n <= PUBLISHES; n++) {
+    randomStep(fields);
+    hubPublish(fields);
+    // Every 10th subscriber is slow: it drains its queue every 20
+    // publishes, so frames overflow and it has to resync
+    for (size_t i = 0; i < g_hub.clients.size(); i++) {
+      if (i % 10 != 0 || n % 20 == 0) clientDrain(g_hub.clients[i]);
+    }
+  }
+  for (int round = 0; round < 2; round++) {
+    for (Client_t &c : g_hub.clients) clientDrain(c);
+  }
+
+  TEST_ASSERT_LESS_OR_EQUAL(PUBLISHES, g_hub.stats.deltas);
+  TEST_ASSERT_GREATER_THAN(PUBLISHES / 2, g_hub.stats.deltas);
+  for (size_t i = 0; i < g_hub.clients.size(); i++) {
+    const Client_t &c = g_hub.clients[i];
+    TEST_ASSERT_TRUE(c.haveSnapshot);
+    TEST_ASSERT_EQUAL_UINT32(g_hub.seq, c.seq);
+    TEST_ASSERT_EQUAL_MEMORY(g_hub.last, c.fields, sizeof(c.fields));
+    if (i % 10 == 0) {
+      TEST_ASSERT_GREATER_THAN(0, c.resyncs);
+    } else {
+      TEST_ASSERT_EQUAL_UINT32(0, c.dropped);
+      TEST_ASSERT_EQUAL_UINT32(0, c.resyncs);
+    }
+  }
+}
+
+static uint64_t nowNs(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void test_fanout_push_cost(void) {
+  for (Client_t &c : g_hub.clients) hubSendSnapshot(c);
+  for (Client_t &c : g_hub.clients) clientDrain(c);
+
+  // Each publish is timed from the reading to the frame sitting in the
+  // last subscriber's queue; the clients drain outside the timed part
+  std::vector<uint64_t> wallNs;
+  uint64_t cpuNs = 0;
+  int32_t fields[STATUS_FIELD_COUNT] = {};
+  for (int n = 0; n < TIMED_PUBLISHES; n++) {
+    fields[14] = n;    // always a change, so every publish pushes
+    uint64_t c0 = nowNs(CLOCK_THREAD_CPUTIME_ID);
+    uint64_t w0 = nowNs(CLOCK_MONOTONIC);
+    hubPublish(fields);
+    uint64_t w1 = nowNs(CLOCK_MONOTONIC);
+    cpuNs += nowNs(CLOCK_THREAD_CPUTIME_ID) - c0;
+    wallNs.push_back(w1 - w0);
+    for (Client_t &c : g_hub.clients) clientDrain(c);
+  }
+  TEST_ASSERT_EQUAL_UINT32(TIMED_PUBLISHES, g_hub.stats.deltas);
+  for (const Client_t &c : g_hub.clients) TEST_ASSERT_EQUAL_UINT32(g_hub.seq, c.seq);
+
+  std::sort(wallNs.begin(), wallNs.end());
+  uint64_t sum = 0;
+  for (uint64_t ns : wallNs) sum += ns;
+  char line[200];
+  snprintf(line, sizeof(line), "push latency per update: mean %llu ns, p50 %llu ns, p99 %llu ns (%d subscribers)",
+           (unsigned long long)(sum / TIMED_PUBLISHES), (unsigned long long)wallNs[TIMED_PUBLISHES / 2],
+           (unsigned long long)wallNs[TIMED_PUBLISHES * 99 / 100], SUBSCRIBERS);
+  TEST_MESSAGE(line);
+  snprintf(line, sizeof(line), "CPU per update: %llu ns, %llu ns per subscriber; serialize %llu us, push %llu us in total",
+           (unsigned long long)(cpuNs / TIMED_PUBLISHES),
+           (unsigned long long)(cpuNs / TIMED_PUBLISHES / SUBSCRIBERS),
+           (unsigned long long)g_hub.stats.serializeMicros, (unsigned long long)g_hub.stats.pushMicros);
+  TEST_MESSAGE(line);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_snapshot_has_every_field);
+  RUN_TEST(test_delta_has_only_changed_fields);
+  RUN_TEST(test_first_publish_changes_everything);
+  RUN_TEST(test_small_buffer_fails_cleanly);
+  RUN_TEST(test_worst_case_frame_fits);
+  RUN_TEST(test_unchanged_reading_sends_nothing);
+  RUN_TEST(test_fanout_serializes_once_and_shares_the_buffer);
+  RUN_TEST(test_fanout_all_subscribers_converge);
+  RUN_TEST(test_fanout_push_cost);
+  return UNITY_END();
+}
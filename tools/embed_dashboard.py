@@ -0,0 +1,59 @@
+"""
+Compresses data/dashboard.html with gzip and writes it as a
+flash-resident byte array to include/dashboard_html.h, together
+with a strong ETag derived from the compressed bytes.
+
+Runs automatically before every PlatformIO build (extra_scripts)
+and can also be run by hand: python tools/embed_dashboard.py
+"""
+
+import gzip
+import hashlib
+import os
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    ROOT = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+
+SOURCE = os.path.join(ROOT, "data", "dashboard.html")
+TARGET = os.path.join(ROOT, "include", "dashboard_html.h")
+
+
+def main():
+    with open(SOURCE, "rb") as f:
+        html = f.read()
+    # mtime=0 keeps the output (and so the ETag) reproducible
+    gz = gzip.compress(html, compresslevel=9, mtime=0)
+    etag = hashlib.sha1(gz).hexdigest()[:16]
+
+    lines = [
+        "// Generated by tools/embed_dashboard.py from data/dashboard.html - do not edit",
+        "",
+        "#pragma once",
+        "",
+        "#include <stdint.h>",
+        "#include <stddef.h>",
+        "",
+        '#define DASHBOARD_ETAG "\\"%s\\""' % etag,
+        "",
+        "// %d bytes of HTML, %d bytes gzip" % (len(html), len(gz)),
+        "static const size_t DASHBOARD_HTML_GZ_LEN = %d;" % len(gz),
+        "static const uint8_t DASHBOARD_HTML_GZ[] PROGMEM = {",
+    ]
+    for i in range(0, len(gz), 16):
+        lines.append("  " + ", ".join("0x%02x" % b for b in gz[i:i + 16]) + ",")
+    lines.append("};")
+    text = "\n".join(lines) + "\n"
+
+    old = None
+    if os.path.exists(TARGET):
+        with open(TARGET) as f:
+            old = f.read()
+    if old != text:
+        with open(TARGET, "w") as f:
+            f.write(text)
+
+
+main()
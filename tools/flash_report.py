@@ -0,0 +1,205 @@
+"""
+Reports flash and RAM use per module from the linker map file
+and checks it against tools/flash_budget.json.
+
+A module is one of our own objects (src/main.cpp, ...) or a
+library archive (libAsyncTCP.a, libbt.a, ...). Sizes come from
+the input sections of the map, grouped by output section:
+
+  flash  everything stored in the app image: .flash.text,
+         .flash.rodata, IRAM code and initialized DRAM data
+  iram   .iram0.* (also counted in flash)
+  dram   .dram0.data + .dram0.bss
+
+The DRAM limit is read from the map's memory configuration,
+the flash limit (the app partition) from the budget file.
+Exits with 1 if the image, DRAM or any budgeted module is
+over its budget.
+
+PlatformIO: listed in extra_scripts, it adds -Map to the link
+and a 'flash_report' target:
+    pio run -e wemos_d1_mini32 -t flash_report
+By hand:
+    python tools/flash_report.py .pio/build/wemos_d1_mini32/firmware.map [--top 25]
+"""
+
+import json
+import os
+import re
+import sys
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    HERE = os.path.join(env["PROJECT_DIR"], "tools")  # noqa: F821
+except NameError:
+    env = None
+    HERE = os.path.dirname(os.path.abspath(__file__))
+
+BUDGET = os.path.join(HERE, "flash_budget.json")
+
+# Input section lines: " .text.foo  0xADDR  0xSIZE  file", or the
+# name alone when it is too long and the rest on the next line
+ENTRY = re.compile(r"^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+NAME_ONLY = re.compile(r"^ (\S+)$")
+CONTINUATION = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+OUTPUT_SECTION = re.compile(r"^(\.\S+|/DISCARD/)(\s|$)")
+MEMORY = re.compile(r"^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)")
+
+
+def classify(section):
+    """Which totals an output section counts towards."""
+    if section.startswith(".flash."):
+        return ("flash",)
+    if section.startswith(".iram0."):
+        return ("flash", "iram")
+    if section == ".dram0.data":
+        return ("flash", "dram")
+    if section == ".dram0.bss":
+        return ("dram",)
+    if section in (".rtc.text", ".rtc.data"):
+        return ("flash",)
+    return ()
+
+
+def module_name(path):
+    path = path.strip()
+    m = re.match(r"^(.*)\((.*)\)$", path)
+    if m:
+        return os.path.basename(m.group(1))
+    path = path.replace("\\", "/")
+    if "/src/" in path:
+        name = path[path.rindex("/src/") + 1:]
+    else:
+        name = os.path.basename(path)
+    return name[:-2] if name.endswith(".o") else name
+
+
+def parse_map(text):
+    """Returns ({module: {flash, iram, dram}}, {memory region: length})."""
+    modules = {}
+    memory = {}
+    lines = text.splitlines()
+
+    i = 0
+    while i < len(lines) and not lines[i].startswith("Memory Configuration"):
+        i += 1
+    while i < len(lines) and not lines[i].startswith("Linker script and memory map"):
+        m = MEMORY.match(lines[i])
+        if m:
+            memory[m.group(1)] = int(m.group(3), 16)
+        i += 1
+
+    section = None
+    pending = None
+    for line in lines[i:]:
+        m = OUTPUT_SECTION.match(line)
+        if m:
+            section = m.group(1)
+            pending = None
+            continue
+
+        entry = None
+        m = ENTRY.match(line)
+        if m:
+            entry = (m.group(1), int(m.group(3), 16), m.group(4))
+            pending = None
+        elif pending is not None:
+            m = CONTINUATION.match(line)
+            if m:
+                entry = (pending, int(m.group(2), 16), m.group(3))
+            pending = None
+        else:
+            m = NAME_ONLY.match(line)
+            if m and not m.group(1).startswith("*"):
+                pending = m.group(1)
+
+        if entry is None or section is None:
+            continue
+        name, size, path = entry
+        kinds = classify(section)
+        if size == 0 or not kinds or name == "*fill*":
+            continue
+        totals = modules.setdefault(module_name(path), {"flash": 0, "iram": 0, "dram": 0})
+        for kind in kinds:
+            totals[kind] += size
+    return modules, memory
+
+
+def check(label, used, limit, failures):
+    status = "OK" if used <= limit else "OVER"
+    print("  %-36s %9d / %9d  %5.1f%%  %s" % (label, used, limit, 100.0 * used / limit if limit else 0, status))
+    if status != "OK":
+        failures.append(label)
+
+
+def report(map_path, top):
+    with open(map_path) as f:
+        modules, memory = parse_map(f.read())
+    with open(BUDGET) as f:
+        budget = json.load(f)
+    if not modules:
+        print("flash_report: no sections found in %s" % map_path)
+        return 1
+
+    total = {"flash": 0, "iram": 0, "dram": 0}
+    for sizes in modules.values():
+        for kind in total:
+            total[kind] += sizes[kind]
+
+    ranked = sorted(modules.items(), key=lambda kv: kv[1]["flash"] + kv[1]["dram"], reverse=True)
+    print("%-32s %9s %9s %9s" % ("module", "flash", "iram", "dram"))
+    for name, sizes in ranked[:top]:
+        print("%-32s %9d %9d %9d" % (name, sizes["flash"], sizes["iram"], sizes["dram"]))
+    if len(ranked) > top:
+        rest = {kind: sum(s[kind] for _, s in ranked[top:]) for kind in total}
+        print("%-32s %9d %9d %9d" % ("(%d more)" % (len(ranked) - top), rest["flash"], rest["iram"], rest["dram"]))
+    print("%-32s %9d %9d %9d" % ("total", total["flash"], total["iram"], total["dram"]))
+
+    print("\nBudget (%s):" % os.path.relpath(BUDGET))
+    failures = []
+    headroom = budget.get("headroom_percent", 0)
+    scale = 1.0 - headroom / 100.0
+    check("image (%d%% headroom)" % headroom, total["flash"], int(budget["app_partition_bytes"] * scale), failures)
+    dram_limit = budget.get("dram_bytes") or memory.get("dram0_0_seg")
+    if dram_limit:
+        check("static DRAM (%d%% headroom)" % headroom, total["dram"], int(dram_limit * scale), failures)
+    for name, limits in sorted(budget.get("modules", {}).items()):
+        sizes = modules.get(name, {"flash": 0, "iram": 0, "dram": 0})
+        for kind in ("flash", "iram", "dram"):
+            if kind in limits:
+                check("%s %s" % (name, kind), sizes[kind], limits[kind], failures)
+
+    if failures:
+        print("\nOver budget: %s" % ", ".join(failures))
+        return 1
+    return 0
+
+
+def main(argv):
+    top = 25
+    args = []
+    i = 0
+    while i < len(argv):
+        if argv[i] == "--top" and i + 1 < len(argv):
+            top = int(argv[i + 1])
+            i += 2
+            continue
+        args.append(argv[i])
+        i += 1
+    if len(args) != 1:
+        print(__doc__)
+        return 2
+    return report(args[0], top)
+
+
+if env is not None:
+    env.Append(LINKFLAGS=["-Wl,-Map,${BUILD_DIR}/firmware.map"])
+    env.AddCustomTarget(
+        name="flash_report",
+        dependencies="$BUILD_DIR/${PROGNAME}.elf",
+        actions='"$PYTHONEXE" "%s" "$BUILD_DIR/firmware.map"' % os.path.join(HERE, "flash_report.py"),
+        title="Flash report",
+        description="Flash / RAM use per module against tools/flash_budget.json",
+    )
+elif __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,306 @@
+/***************************************************************
+ * Alarm delivery latency (see alarmbench.h)
+ ***************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "alarmbench.h"
+#include "alarm_dispatch.h"
+#include "clock.h"
+
+#define ALARMBENCH_DEFAULT_TICK_MS 100     // firmware loop() period
+#define ALARMBENCH_DEFAULT_ROUNDS 20
+#define ALARMBENCH_HTTP_TIMEOUT_MS 3000    // ALARM_WEBHOOK_TIMEOUT_MS
+#define ALARMBENCH_WAIT_MS 5000            // longest wait for one delivery
+
+// No hold-back and no bucket: the latency run measures the pipeline itself
+static const AlarmConfig_t LATENCY_CONFIG = { 0, 3600000, 0, 255, 0, 80, 1000 };
+
+/** --------------------------------------------------
+ * One event as a target received it.
+ * -------------------------------------------------- */
+struct Arrival_t {
+  uint64_t us;
+  std::string key;
+  std::string state;
+  uint32_t seq;
+  unsigned level;
+};
+
+static std::string jsonField(const std::string &body, const char* name) {
+  std::string tag = std::string("\"") + name + "\":";
+  size_t p = body.find(tag);
+  if (p == std::string::npos) return "";
+  p += tag.size();
+  if (body[p] == '"') {
+    size_t end = body.find('"', p + 1);
+    return body.substr(p + 1, end == std::string::npos ? std::string::npos : end - p - 1);
+  }
+  size_t end = body.find_first_of(",}", p);
+  return body.substr(p, end == std::string::npos ? std::string::npos : end - p);
+}
+
+static Arrival_t parseArrival(const std::string &body, uint64_t us) {
+  Arrival_t a;
+  a.us = us;
+  a.key = jsonField(body, "key");
+  a.state = jsonField(body, "state");
+  a.seq = (uint32_t)strtoul(jsonField(body, "seq").c_str(), nullptr, 10);
+  a.level = (unsigned)strtoul(jsonField(body, "level").c_str(), nullptr, 10);
+  return a;
+}
+
+/** --------------------------------------------------
+ * Stand-in webhook server: one request per connection,
+ * answers 200.
+ * -------------------------------------------------- */
+struct WebhookServer_t {
+  int fd = -1;
+  uint16_t port = 0;
+  std::thread thread;
+  std::atomic<bool> stop{false};
+  std::mutex lock;
+  std::vector<Arrival_t> arrivals;
+};
+
+static void serveRequest(WebhookServer_t &server, int conn) {
+  std::string request;
+  char buf[1024];
+  size_t headerEnd = std::string::npos;
+  size_t contentLength = 0;
+  while (true) {
+    ssize_t n = recv(conn, buf, sizeof(buf), 0);
+    if (n <= 0) return;
+    request.append(buf, (size_t)n);
+    if (headerEnd == std::string::npos) {
+      headerEnd = request.find("\r\n\r\n");
+      if (headerEnd == std::string::npos) continue;
+      size_t p = request.find("Content-Length:");
+      if (p != std::string::npos && p < headerEnd) contentLength = strtoul(request.c_str() + p + 15, nullptr, 10);
+    }
+    if (request.size() >= headerEnd + 4 + contentLength) break;
+  }
+  uint64_t us = clockSteadyMicros();
+
+  const char* reply = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+  {
+    std::lock_guard<std::mutex> guard(server.lock);
+    server.arrivals.push_back(parseArrival(request.substr(headerEnd + 4, contentLength), us));
+  }
+  send(conn, reply, strlen(reply), MSG_NOSIGNAL);
+}
+
+static void serverThread(WebhookServer_t* server) {
+  while (!server->stop) {
+    struct pollfd p = { server->fd, POLLIN, 0 };
+    if (poll(&p, 1, 50) <= 0) continue;
+    int conn = accept(server->fd, nullptr, nullptr);
+    if (conn < 0) continue;
+    serveRequest(*server, conn);
+    close(conn);
+  }
+}
+
+static bool serverStart(WebhookServer_t &server) {
+  server.fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  if (server.fd < 0 || bind(server.fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+      listen(server.fd, 8) != 0 || getsockname(server.fd, (struct sockaddr*)&addr, &len) != 0) {
+    return false;
+  }
+  server.port = ntohs(addr.sin_port);
+  server.thread = std::thread(serverThread, &server);
+  return true;
+}
+
+static void serverStop(WebhookServer_t &server) {
+  server.stop = true;
+  if (server.thread.joinable()) server.thread.join();
+  if (server.fd >= 0) close(server.fd);
+}
+
+/** --------------------------------------------------
+ * The board side: conditions reported every tick, the
+ * webhook and an in-memory MQTT target, no store.
+ * -------------------------------------------------- */
+struct Condition_t {
+  std::string key;
+  AlarmType_t type;
+  bool active;
+};
+
+struct Board_t {
+  AlarmDispatcher_t d;
+  WebhookServer_t* server;
+  unsigned tickMs;
+  std::vector<Condition_t> conditions;
+  std::vector<Arrival_t> mqtt;            // in-memory broker
+};
+
+static bool targetReady(void*) {
+  return true;
+}
+
+static bool webhookSend(void* ctx, const AlarmEvent_t &, const char* json) {
+  Board_t* board = (Board_t*)ctx;
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return false;
+  struct timeval tv = { ALARMBENCH_HTTP_TIMEOUT_MS / 1000, (ALARMBENCH_HTTP_TIMEOUT_MS % 1000) * 1000 };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(board->server->port);
+
+  char header[192];
+  size_t bodyLen = strlen(json);
+  int headerLen = snprintf(header, sizeof(header),
+                           "POST /alarm HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Type: application/json\r\n"
+                           "Content-Length: %zu\r\nConnection: close\r\n\r\n", bodyLen);
+  char status[64] = {};
+  bool ok = connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0 &&
+            send(fd, header, (size_t)headerLen, MSG_NOSIGNAL) == headerLen &&
+            send(fd, json, bodyLen, MSG_NOSIGNAL) == (ssize_t)bodyLen &&
+            recv(fd, status, sizeof(status) - 1, 0) > 12;
+  close(fd);
+  int code = ok ? atoi(status + 9) : 0;
+  return code >= 200 && code < 300;
+}
+
+static bool mqttSend(void* ctx, const AlarmEvent_t &, const char* json) {
+  ((Board_t*)ctx)->mqtt.push_back(parseArrival(json, clockSteadyMicros()));
+  return true;
+}
+
+/** --------------------------------------------------
+ * Starts the dispatcher with both targets.
+ * -------------------------------------------------- */
+static void boardBoot(Board_t &board, const AlarmConfig_t &config) {
+  AlarmStore_t store = { nullptr, nullptr, nullptr };
+  alarmDispatchBegin(board.d, config, store);
+  AlarmTarget_t webhook = { "webhook", &board, targetReady, webhookSend };
+  AlarmTarget_t mqtt = { "mqtt", &board, targetReady, mqttSend };
+  alarmDispatchAddTarget(board.d, webhook);
+  alarmDispatchAddTarget(board.d, mqtt);
+}
+
+static void boardSet(Board_t &board, const std::string &key, AlarmType_t type, bool active) {
+  for (Condition_t &c : board.conditions) {
+    if (c.key == key) {
+      c.active = active;
+      return;
+    }
+  }
+  board.conditions.push_back({ key, type, active });
+}
+
+/** --------------------------------------------------
+ * One firmware loop(): report every condition, poll,
+ * sleep until the next tick.
+ * -------------------------------------------------- */
+static void boardTick(Board_t &board) {
+  for (const Condition_t &c : board.conditions) {
+    alarmReport(board.d, c.key.c_str(), c.type, c.active, 0);
+  }
+  alarmDispatchPoll(board.d);
+  std::this_thread::sleep_for(std::chrono::milliseconds(board.tickMs));
+}
+
+static size_t webhookCount(Board_t &board) {
+  std::lock_guard<std::mutex> guard(board.server->lock);
+  return board.server->arrivals.size();
+}
+
+static std::vector<Arrival_t> webhookTake(Board_t &board) {
+  std::lock_guard<std::mutex> guard(board.server->lock);
+  std::vector<Arrival_t> out;
+  out.swap(board.server->arrivals);
+  return out;
+}
+
+static double percentileMs(std::vector<double> v, double p) {
+  if (v.empty()) return 0;
+  size_t k = (size_t)((v.size() - 1) * p);
+  std::nth_element(v.begin(), v.begin() + k, v.end());
+  return v[k];
+}
+
+/** --------------------------------------------------
+ * latency: each condition change happens at a random
+ * point inside a tick, as a fridge reading would; it is
+ * seen at the next tick and timed to the server.
+ * -------------------------------------------------- */
+static void scenarioLatency(Board_t &board, unsigned rounds, std::mt19937 &rng) {
+  boardBoot(board, LATENCY_CONFIG);
+  std::vector<double> ms;
+  for (unsigned r = 0; r < rounds * 2; r++) {
+    size_t before = webhookCount(board);
+    uint64_t tickStart = clockSteadyMicros();
+    std::this_thread::sleep_for(std::chrono::microseconds(rng() % (board.tickMs * 1000)));
+    uint64_t changed = clockSteadyMicros();
+    boardSet(board, "aa:bb:cc:dd:ee:01/temp_high", ALARM_TEMP_HIGH, r % 2 == 0);
+    uint64_t nextTick = tickStart + board.tickMs * 1000ULL;
+    if (nextTick > clockSteadyMicros()) std::this_thread::sleep_for(std::chrono::microseconds(nextTick - clockSteadyMicros()));
+    uint64_t end = clockSteadyMicros() + ALARMBENCH_WAIT_MS * 1000ULL;
+    while (webhookCount(board) == before && clockSteadyMicros() < end) boardTick(board);
+    std::vector<Arrival_t> got = webhookTake(board);
+    if (!got.empty()) ms.push_back((got[0].us - changed) / 1000.0);
+  }
+  const AlarmTargetStats_t &ts = board.d.targetStats[0];
+  printf("latency:     %zu changes, change -> webhook p50 %.1f ms, p99 %.1f ms, max %.1f ms "
+         "(report -> acknowledged avg %.2f ms)\n",
+         ms.size(), percentileMs(ms, 0.5), percentileMs(ms, 0.99), percentileMs(ms, 1.0),
+         ts.sent ? (double)ts.latencyMsSum / ts.sent : 0.0);
+}
+
+int alarmbenchMain(int argc, char** argv) {
+  unsigned tickMs = ALARMBENCH_DEFAULT_TICK_MS;
+  unsigned rounds = ALARMBENCH_DEFAULT_ROUNDS;
+  unsigned seed = 1;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--tick") == 0 && i + 1 < argc) tickMs = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) rounds = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (unsigned)atol(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s alarmbench [--tick MS] [--rounds N] [--seed S]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  WebhookServer_t server;
+  if (!serverStart(server)) {
+    fprintf(stderr, "alarmbench: cannot listen on 127.0.0.1\n");
+    return 1;
+  }
+  printf("webhook stand-in on 127.0.0.1:%u, tick %u ms\n", server.port, tickMs);
+
+  std::mt19937 rng(seed);
+  Board_t board;
+  board.server = &server;
+  board.tickMs = tickMs;
+  scenarioLatency(board, rounds, rng);
+
+  serverStop(server);
+  return 0;
+}
@@ -0,0 +1,24 @@
+/***************************************************************
+ * Alarm delivery latency
+ *
+ * Runs the firmware's alarm dispatcher
+ * (include/alarm_dispatch.h) on the real clock against a
+ * local stand-in webhook server: a thread on 127.0.0.1 that
+ * answers HTTP POSTs and timestamps every body it receives.
+ * A second, in-memory target stands in for the MQTT broker.
+ * The loop polls every --tick ms like the firmware's
+ * loop(). Alarms are raised and cleared at random points in
+ * a tick; the time from the condition change to the body at
+ * the server is reported as p50 / p99 / max.
+ *
+ * Hold-back, escalation, retries, rate limiting and the
+ * restore after a reboot are covered by
+ * test/test_alarm_dispatch.
+ ***************************************************************/
+
+#pragma once
+
+/** --------------------------------------------------
+ * fridgetool alarmbench [--tick MS] [--rounds N] [--seed S]
+ * -------------------------------------------------- */
+int alarmbenchMain(int argc, char** argv);
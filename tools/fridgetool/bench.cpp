@@ -0,0 +1,456 @@
+/***************************************************************
+ * Benchmark baselines and regression comparison (see bench.h)
+ ***************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "capture.h"
+
+#define BENCH_DEFAULT_REPS 15
+#define BENCH_OPS_PER_REP 200000
+#define BENCH_LATENCY_BATCH 32
+#define BENCH_PARSE_LINES 100000
+#define COMPARE_DEFAULT_THRESHOLD 5.0   // percent
+#define COMPARE_DEFAULT_ALPHA 0.01
+#define COMPARE_MIN_SAMPLES 5           // below this only the threshold applies
+
+/** --------------------------------------------------
+ * Heap allocation counter: every operator new in the
+ * process goes through here, but only counts while
+ * g_countAllocations is set (one untimed pass of the
+ * parse benchmark), so other subcommands and the timed
+ * passes do not share a contended counter.
+ * -------------------------------------------------- */
+static std::atomic<bool> g_countAllocations(false);
+static std::atomic<uint64_t> g_allocations(0);
+
+void* operator new(size_t size) {
+  if (g_countAllocations.load(std::memory_order_relaxed)) g_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = malloc(size ? size : 1);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+// GCC cannot see that the new above is malloc-backed
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept {
+  free(p);
+}
+#pragma GCC diagnostic pop
+
+void operator delete(void* p, size_t) noexcept {
+  operator delete(p);
+}
+
+static volatile uint32_t g_sink;
+
+struct BenchMetric_t {
+  std::string name;
+  std::string metric;
+  bool lowerIsBetter;
+  std::vector<double> samples;
+};
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double nsSince(BenchClock::time_point t0) {
+  return std::chrono::duration<double, std::nano>(BenchClock::now() - t0).count();
+}
+
+static void buildSampleFrame(uint8_t frame[24]) {
+  static const uint8_t payload[18] = { 0, 1, 1, 2, 4, 20, 0xEC, 1, 0, 0, 0, 0, 0, 0, 5, 80, 12, 6 };
+  frame[0] = 0xFE;
+  frame[1] = 0xFE;
+  frame[2] = 21;
+  frame[3] = 0x01;
+  memcpy(&frame[4], payload, sizeof(payload));
+  uint16_t sum = calculateChecksum(frame, 22);
+  frame[22] = sum >> 8;
+  frame[23] = sum & 0xFF;
+}
+
+/** --------------------------------------------------
+ * Deterministic synthetic serial log for the parser.
+ * -------------------------------------------------- */
+static std::string buildSampleLog(const uint8_t frame[24]) {
+  std::string log;
+  char hex[4];
+  for (int i = 0; i < BENCH_PARSE_LINES; i++) {
+    if (i % 10 == 0) log += "[QUERY] Sending command  (query)...\n";
+    log += (i % 2) ? "[DECODE] Raw bytes: " : "";
+    for (int b = 0; b < 24; b++) {
+      snprintf(hex, sizeof(hex), (i % 2) ? "%02X " : "%02X", frame[b]);
+      log += hex;
+    }
+    log += '\n';
+  }
+  return log;
+}
+
+static double percentile(std::vector<double> v, double p) {
+  std::sort(v.begin(), v.end());
+  return v[(size_t)((v.size() - 1) * p)];
+}
+
+static void writeResults(FILE* f, const char* fw, const std::vector<BenchMetric_t> &metrics) {
+  fprintf(f, "{\"schema\":\"%s\",\"fw\":\"%s\",\"results\":[\n", BENCH_SCHEMA, fw);
+  for (size_t i = 0; i < metrics.size(); i++) {
+    const BenchMetric_t &m = metrics[i];
+    fprintf(f, "  {\"name\":\"%s\",\"metric\":\"%s\",\"better\":\"%s\",\"samples\":[",
+            m.name.c_str(), m.metric.c_str(), m.lowerIsBetter ? "lower" : "higher");
+    for (size_t s = 0; s < m.samples.size(); s++) {
+      fprintf(f, "%s%.9g", s ? "," : "", m.samples[s]);
+    }
+    fprintf(f, "]}%s\n", i + 1 < metrics.size() ? "," : "");
+  }
+  fprintf(f, "]}\n");
+}
+
+int benchMain(int argc, char** argv) {
+  const char* output = nullptr;
+  const char* fw = "dev";
+  int reps = BENCH_DEFAULT_REPS;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+    else if (strcmp(argv[i], "--fw") == 0 && i + 1 < argc) fw = argv[++i];
+    else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) reps = std::max(1, atoi(argv[++i]));
+    else {
+      fprintf(stderr, "usage: %s bench [-o FILE] [--fw VERSION] [--reps N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  uint8_t frame[24];
+  buildSampleFrame(frame);
+  initHexTable();
+  std::string log = buildSampleLog(frame);
+  double logMb = log.size() / 1e6;
+
+  BenchMetric_t checksumNs = { "checksum", "ns_per_op", true, {} };
+  BenchMetric_t decodeNs = { "decode", "ns_per_op", true, {} };
+  BenchMetric_t decodeP50 = { "decode", "p50_ns", true, {} };
+  BenchMetric_t decodeP99 = { "decode", "p99_ns", true, {} };
+  BenchMetric_t parseMbs = { "parse", "mb_per_s", false, {} };
+  BenchMetric_t parseAllocs = { "parse", "allocs_per_mb", true, {} };
+
+  std::vector<double> batches;
+  batches.reserve(BENCH_OPS_PER_REP / BENCH_LATENCY_BATCH);
+
+  for (int r = 0; r < reps; r++) {
+    BenchClock::time_point t0 = BenchClock::now();
+    for (int i = 0; i < BENCH_OPS_PER_REP; i++) {
+      frame[5] = (uint8_t)i;  // defeat hoisting out of the loop
+      g_sink += calculateChecksum(frame, 22);
+    }
+    checksumNs.samples.push_back(nsSince(t0) / BENCH_OPS_PER_REP);
+    buildSampleFrame(frame);
+
+    // Throughput over the whole rep, latency over small batches
+    batches.clear();
+    FridgeStatus_t st;
+    BenchClock::time_point start = BenchClock::now();
+    for (int b = 0; b < BENCH_OPS_PER_REP / BENCH_LATENCY_BATCH; b++) {
+      BenchClock::time_point tb = BenchClock::now();
+      for (int i = 0; i < BENCH_LATENCY_BATCH; i++) {
+        g_sink += decodeFridgeQuerySingleZone(frame, 24, st) + st.leftCurrent;
+      }
+      batches.push_back(nsSince(tb) / BENCH_LATENCY_BATCH);
+    }
+    decodeNs.samples.push_back(nsSince(start) / BENCH_OPS_PER_REP);
+    decodeP50.samples.push_back(percentile(batches, 0.50));
+    decodeP99.samples.push_back(percentile(batches, 0.99));
+
+    BenchClock::time_point tp = BenchClock::now();
+    std::vector<Chunk_t> chunks;
+    splitIntoChunks(log.data(), log.size(), CHUNKS_PER_THREAD, chunks);
+    for (Chunk_t &chunk : chunks) decodeChunk(chunk);
+    double seconds = nsSince(tp) / 1e9;
+    parseMbs.samples.push_back(logMb / seconds);
+    g_sink += (uint32_t)chunks.size();
+
+    // Same work again, untimed, counting allocations
+    chunks.clear();
+    g_allocations = 0;
+    g_countAllocations = true;
+    splitIntoChunks(log.data(), log.size(), CHUNKS_PER_THREAD, chunks);
+    for (Chunk_t &chunk : chunks) decodeChunk(chunk);
+    g_countAllocations = false;
+    parseAllocs.samples.push_back(g_allocations / logMb);
+  }
+
+  std::vector<BenchMetric_t> metrics = { checksumNs, decodeNs, decodeP50, decodeP99, parseMbs, parseAllocs };
+  for (const BenchMetric_t &m : metrics) {
+    fprintf(stderr, "%-10s %-14s median %10.3f\n", m.name.c_str(), m.metric.c_str(), percentile(m.samples, 0.5));
+  }
+
+  FILE* f = output ? fopen(output, "w") : stdout;
+  if (f == nullptr) {
+    fprintf(stderr, "fridgetool: cannot create %s\n", output);
+    return 1;
+  }
+  writeResults(f, fw, metrics);
+  if (output) fclose(f);
+  return 0;
+}
+
+/** --------------------------------------------------
+ * Minimal JSON reader: just enough for our own schema
+ * and the device's benchmark lines.
+ * -------------------------------------------------- */
+struct JsonValue {
+  enum Type { NUL, NUMBER, STRING, ARRAY, OBJECT } type = NUL;
+  double number = 0;
+  std::string str;
+  std::vector<JsonValue> items;
+  std::vector<std::pair<std::string, JsonValue>> members;
+
+  const JsonValue* get(const char* key) const {
+    for (const auto &m : members) if (m.first == key) return &m.second;
+    return nullptr;
+  }
+};
+
+class JsonParser {
+public:
+  explicit JsonParser(const char* text) : p(text) {}
+
+  bool parse(JsonValue &out) {
+    skipSpace();
+    if (*p == '{') return parseObject(out);
+    if (*p == '[') return parseArray(out);
+    if (*p == '"') {
+      out.type = JsonValue::STRING;
+      return parseString(out.str);
+    }
+    if (strncmp(p, "null", 4) == 0 || strncmp(p, "true", 4) == 0) {
+      out.type = JsonValue::NUL;
+      p += 4;
+      return true;
+    }
+    if (strncmp(p, "false", 5) == 0) {
+      out.type = JsonValue::NUL;
+      p += 5;
+      return true;
+    }
+    char* end;
+    out.number = strtod(p, &end);
+    if (end == p) return false;
+    out.type = JsonValue::NUMBER;
+    p = end;
+    return true;
+  }
+
+  const char* position() const { return p; }
+
+private:
+  const char* p;
+
+  void skipSpace() {
+    while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t') p++;
+  }
+
+  bool parseString(std::string &out) {
+    p++;
+    while (*p && *p != '"') {
+      if (*p == '\\' && p[1]) p++;
+      out += *p++;
+    }
+    if (*p != '"') return false;
+    p++;
+    return true;
+  }
+
+  bool parseArray(JsonValue &out) {
+    out.type = JsonValue::ARRAY;
+    p++;
+    skipSpace();
+    if (*p == ']') {
+      p++;
+      return true;
+    }
+    for (;;) {
+      JsonValue item;
+      if (!parse(item)) return false;
+      out.items.push_back(std::move(item));
+      skipSpace();
+      if (*p == ',') {
+        p++;
+        continue;
+      }
+      if (*p != ']') return false;
+      p++;
+      return true;
+    }
+  }
+
+  bool parseObject(JsonValue &out) {
+    out.type = JsonValue::OBJECT;
+    p++;
+    skipSpace();
+    if (*p == '}') {
+      p++;
+      return true;
+    }
+    for (;;) {
+      std::string key;
+      skipSpace();
+      if (*p != '"' || !parseString(key)) return false;
+      skipSpace();
+      if (*p++ != ':') return false;
+      JsonValue value;
+      if (!parse(value)) return false;
+      out.members.emplace_back(std::move(key), std::move(value));
+      skipSpace();
+      if (*p == ',') {
+        p++;
+        continue;
+      }
+      if (*p != '}') return false;
+      p++;
+      return true;
+    }
+  }
+};
+
+/** --------------------------------------------------
+ * Loads a result set: our schema, or device JSON lines.
+ * -------------------------------------------------- */
+static bool loadResults(const char* path, std::vector<BenchMetric_t> &out) {
+  FILE* f = fopen(path, "rb");
+  if (f == nullptr) return false;
+  std::string text;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+  fclose(f);
+
+  JsonParser parser(text.c_str());
+  JsonValue doc;
+  if (parser.parse(doc) && doc.type == JsonValue::OBJECT && doc.get("schema") &&
+      doc.get("schema")->str == BENCH_SCHEMA) {
+    const JsonValue* results = doc.get("results");
+    if (results == nullptr) return false;
+    for (const JsonValue &r : results->items) {
+      const JsonValue *name = r.get("name"), *metric = r.get("metric"), *better = r.get("better"),
+                      *samples = r.get("samples");
+      if (!name || !metric || !samples) continue;
+      BenchMetric_t m = { name->str, metric->str, !better || better->str != "higher", {} };
+      for (const JsonValue &s : samples->items) m.samples.push_back(s.number);
+      if (!m.samples.empty()) out.push_back(m);
+    }
+    return true;
+  }
+
+  // Device output: one {"bench":...} object per line, other lines ignored
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t eol = text.find('\n', pos);
+    if (eol == std::string::npos) eol = text.size();
+    std::string line = text.substr(pos, eol - pos);
+    pos = eol + 1;
+    size_t brace = line.find("{\"bench\"");
+    if (brace == std::string::npos) continue;
+
+    JsonParser lineParser(line.c_str() + brace);
+    JsonValue obj;
+    if (!lineParser.parse(obj) || !obj.get("bench") || obj.get("error")) continue;
+    static const char* const FIELDS[] = { "min", "median", "p99" };
+    for (const char* field : FIELDS) {
+      const JsonValue* v = obj.get(field);
+      if (v) out.push_back({ obj.get("bench")->str, std::string(field) + "_cycles", true, { v->number } });
+    }
+  }
+  return !out.empty();
+}
+
+/** --------------------------------------------------
+ * Two-sided Mann-Whitney U test, normal approximation.
+ * -------------------------------------------------- */
+static double mannWhitneyP(const std::vector<double> &a, const std::vector<double> &b) {
+  std::vector<std::pair<double, int>> all;
+  for (double v : a) all.push_back({ v, 0 });
+  for (double v : b) all.push_back({ v, 1 });
+  std::sort(all.begin(), all.end());
+
+  // Average ranks over ties
+  double rankSumA = 0;
+  for (size_t i = 0; i < all.size();) {
+    size_t j = i;
+    while (j < all.size() && all[j].first == all[i].first) j++;
+    double rank = (i + j + 1) / 2.0;
+    for (size_t k = i; k < j; k++) if (all[k].second == 0) rankSumA += rank;
+    i = j;
+  }
+
+  double na = (double)a.size(), nb = (double)b.size();
+  double u = rankSumA - na * (na + 1) / 2;
+  double mean = na * nb / 2;
+  double sd = std::sqrt(na * nb * (na + nb + 1) / 12);
+  if (sd == 0) return 1.0;
+  double z = (std::fabs(u - mean) - 0.5) / sd;
+  return std::erfc(std::max(z, 0.0) / std::sqrt(2.0));
+}
+
+int compareMain(int argc, char** argv) {
+  const char* paths[2] = { nullptr, nullptr };
+  double threshold = COMPARE_DEFAULT_THRESHOLD;
+  double alpha = COMPARE_DEFAULT_ALPHA;
+  int count = 0;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) threshold = atof(argv[++i]);
+    else if (strcmp(argv[i], "--alpha") == 0 && i + 1 < argc) alpha = atof(argv[++i]);
+    else if (count < 2) paths[count++] = argv[i];
+  }
+  if (count != 2) {
+    fprintf(stderr, "usage: %s compare BASE NEW [--threshold PCT] [--alpha P]\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<BenchMetric_t> base, next;
+  for (int i = 0; i < 2; i++) {
+    if (!loadResults(paths[i], i == 0 ? base : next)) {
+      fprintf(stderr, "fridgetool: cannot read benchmark results from %s\n", paths[i]);
+      return 2;
+    }
+  }
+
+  int regressions = 0;
+  printf("%-16s %-14s %12s %12s %9s %8s  %s\n", "name", "metric", "base", "new", "change", "p", "verdict");
+  for (const BenchMetric_t &b : base) {
+    const BenchMetric_t* n = nullptr;
+    for (const BenchMetric_t &c : next) {
+      if (c.name == b.name && c.metric == b.metric) n = &c;
+    }
+    if (n == nullptr) continue;
+
+    double mb = percentile(b.samples, 0.5), mn = percentile(n->samples, 0.5);
+    double change = mb != 0 ? 100.0 * (mn - mb) / std::fabs(mb) : 0.0;
+    double worse = b.lowerIsBetter ? change : -change;
+    bool tested = b.samples.size() >= COMPARE_MIN_SAMPLES && n->samples.size() >= COMPARE_MIN_SAMPLES;
+    double p = tested ? mannWhitneyP(b.samples, n->samples) : NAN;
+
+    const char* verdict = "ok";
+    if (worse > threshold && (!tested || p < alpha)) {
+      verdict = tested ? "REGRESSION" : "REGRESSION (threshold only)";
+      regressions++;
+    } else if (worse < -threshold && (!tested || p < alpha)) {
+      verdict = "improved";
+    }
+    printf("%-16s %-14s %12.3f %12.3f %+8.1f%% %8.4f  %s\n",
+           b.name.c_str(), b.metric.c_str(), mb, mn, change, p, verdict);
+  }
+
+  fprintf(stderr, "%d regression(s)\n", regressions);
+  return regressions ? 1 : 0;
+}
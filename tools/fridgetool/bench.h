@@ -0,0 +1,33 @@
+/***************************************************************
+ * Benchmark baselines and regression comparison
+ *
+ * 'fridgetool bench' runs the protocol kernels and the
+ * capture parser natively and writes the raw samples in a
+ * stable JSON schema:
+ *
+ *   {"schema":"fridge-bench/1","fw":"1.2.0","results":[
+ *     {"name":"decode","metric":"ns_per_op","better":"lower",
+ *      "samples":[12.1,12.0,...]}, ...]}
+ *
+ * 'fridgetool compare BASE NEW' loads two result sets and
+ * flags metrics that got worse by more than a threshold
+ * with a Mann-Whitney U test p-value below alpha. It also
+ * reads the JSON lines printed by the on-device 'bench'
+ * command; those carry no samples, so only the threshold
+ * applies to them.
+ ***************************************************************/
+
+#pragma once
+
+#define BENCH_SCHEMA "fridge-bench/1"
+
+/** --------------------------------------------------
+ * fridgetool bench [-o FILE] [--fw VERSION] [--reps N]
+ * -------------------------------------------------- */
+int benchMain(int argc, char** argv);
+
+/** --------------------------------------------------
+ * fridgetool compare BASE NEW [--threshold PCT] [--alpha P]
+ * Exit code 1 if any regression was found.
+ * -------------------------------------------------- */
+int compareMain(int argc, char** argv);
@@ -0,0 +1,109 @@
+/***************************************************************
+ * Capture parsing for fridgetool (see capture.h)
+ ***************************************************************/
+
+#include <algorithm>
+#include <cstring>
+
+#include "capture.h"
+
+const char* const FRAME_RESULT_NAMES[FRAME_RESULT_COUNT] = {
+  "ok", "short", "bad-header", "other-opcode", "bad-checksum"
+};
+
+static int8_t g_hexValue[256];
+
+void initHexTable() {
+  memset(g_hexValue, -1, sizeof(g_hexValue));
+  for (int i = 0; i < 10; i++) g_hexValue['0' + i] = (int8_t)i;
+  for (int i = 0; i < 6; i++) {
+    g_hexValue['a' + i] = (int8_t)(10 + i);
+    g_hexValue['A' + i] = (int8_t)(10 + i);
+  }
+}
+
+/** --------------------------------------------------
+ * Parses hex bytes starting at p ("FE FE 03", "FEFE03" or
+ * "fe:fe:03"), stopping at the first non-hex token.
+ * -------------------------------------------------- */
+static size_t parseHexFrame(const char* p, const char* end, uint8_t* out) {
+  size_t n = 0;
+  while (p + 1 < end && n < MAX_FRAME_LEN) {
+    int hi = g_hexValue[(uint8_t)p[0]];
+    int lo = g_hexValue[(uint8_t)p[1]];
+    if (hi < 0 || lo < 0) break;
+    out[n++] = (uint8_t)((hi << 4) | lo);
+    p += 2;
+    if (p < end && (*p == ' ' || *p == ':' || *p == '-')) p++;
+  }
+  return n;
+}
+
+/** --------------------------------------------------
+ * Finds the start of a "FE FE" / "FEFE" frame in a line.
+ * -------------------------------------------------- */
+static const char* findFrameStart(const char* line, const char* end) {
+  for (const char* p = line; p + 3 < end; p++) {
+    if ((p[0] | 0x20) != 'f' || (p[1] | 0x20) != 'e') continue;
+    const char* q = p + 2;
+    if (q < end && (*q == ' ' || *q == ':' || *q == '-')) q++;
+    if (q + 1 < end && (q[0] | 0x20) == 'f' && (q[1] | 0x20) == 'e') {
+      // Don't start in the middle of a longer hex word
+      if (p > line && p[-1] != ' ' && g_hexValue[(uint8_t)p[-1]] >= 0) continue;
+      return p;
+    }
+  }
+  return nullptr;
+}
+
+/** --------------------------------------------------
+ * Worker: decodes every frame in a chunk. Line numbers
+ * are relative to the chunk until the merge.
+ * -------------------------------------------------- */
+void decodeChunk(Chunk_t &chunk) {
+  uint8_t frame[MAX_FRAME_LEN];
+  uint64_t line = 0;
+  const char* p = chunk.begin;
+
+  while (p < chunk.end) {
+    const char* eol = (const char*)memchr(p, '\n', chunk.end - p);
+    if (eol == nullptr) eol = chunk.end;
+    line++;
+
+    const char* start = findFrameStart(p, eol);
+    if (start != nullptr) {
+      FrameRow_t row;
+      memset(&row, 0, sizeof(row));
+      size_t len = parseHexFrame(start, eol, frame);
+      row.line = line;
+      row.length = (uint8_t)len;
+      row.opcode = len > 3 ? frame[3] : 0;
+      row.result = (uint8_t)decodeFridgeQuery(frame, len, row.status);
+      chunk.rows.push_back(row);
+    }
+    p = eol + 1;
+  }
+  chunk.lineCount = line;
+}
+
+/** --------------------------------------------------
+ * Splits a mapped file into line-aligned chunks.
+ * -------------------------------------------------- */
+void splitIntoChunks(const char* data, size_t size, size_t count, std::vector<Chunk_t> &out) {
+  size_t target = std::max<size_t>(size / std::max<size_t>(count, 1), 1);
+  const char* p = data;
+  const char* end = data + size;
+  while (p < end) {
+    const char* cut = std::min(p + target, end);
+    if (cut < end) {
+      const char* nl = (const char*)memchr(cut, '\n', end - cut);
+      cut = nl ? nl + 1 : end;
+    }
+    Chunk_t chunk;
+    chunk.begin = p;
+    chunk.end = cut;
+    chunk.lineCount = 0;
+    out.push_back(std::move(chunk));
+    p = cut;
+  }
+}
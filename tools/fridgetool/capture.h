@@ -0,0 +1,73 @@
+/***************************************************************
+ * Capture parsing for fridgetool
+ *
+ * Finds "FE FE ..." frames in text (one per line or inside
+ * log lines) and decodes them with the firmware's protocol
+ * code. Input is handled as line-aligned chunks so that
+ * chunks can be decoded in parallel.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "fridge_protocol.h"
+
+// Longest frame we try to parse out of a line
+#define MAX_FRAME_LEN 64
+// Chunks per worker, so uneven lines still balance across threads
+#define CHUNKS_PER_THREAD 8
+
+/** --------------------------------------------------
+ * Why a frame could not be decoded: the firmware's
+ * FridgeDecodeResult_t reasons.
+ * -------------------------------------------------- */
+enum FrameResult_t {
+  FRAME_OK           = DECODE_OK,
+  FRAME_SHORT        = DECODE_TOO_SHORT,
+  FRAME_BAD_HEADER   = DECODE_BAD_HEADER,
+  FRAME_OTHER_OPCODE = DECODE_WRONG_OPCODE,
+  FRAME_BAD_CHECKSUM = DECODE_BAD_CHECKSUM,
+  FRAME_RESULT_COUNT = DECODE_RESULT_COUNT
+};
+
+extern const char* const FRAME_RESULT_NAMES[FRAME_RESULT_COUNT];
+
+/** --------------------------------------------------
+ * One frame found in the input.
+ * -------------------------------------------------- */
+struct FrameRow_t {
+  uint64_t line;           // 1-based line number in its file
+  uint8_t result;          // FrameResult_t
+  uint8_t opcode;
+  uint8_t length;
+  FridgeStatus_t status;   // valid if result == FRAME_OK
+};
+
+/** --------------------------------------------------
+ * Work unit: a line-aligned slice of one mapped file.
+ * -------------------------------------------------- */
+struct Chunk_t {
+  const char* begin;
+  const char* end;
+  uint64_t lineCount;
+  std::vector<FrameRow_t> rows;
+};
+
+/** --------------------------------------------------
+ * Must be called once before decodeChunk().
+ * -------------------------------------------------- */
+void initHexTable();
+
+/** --------------------------------------------------
+ * Decodes every frame in a chunk into chunk.rows. Line
+ * numbers are relative to the chunk.
+ * -------------------------------------------------- */
+void decodeChunk(Chunk_t &chunk);
+
+/** --------------------------------------------------
+ * Splits a buffer into about 'count' line-aligned chunks.
+ * -------------------------------------------------- */
+void splitIntoChunks(const char* data, size_t size, size_t count, std::vector<Chunk_t> &out);
@@ -0,0 +1,480 @@
+/***************************************************************
+ * Columnar fleet history export (see columnar.h)
+ *
+ * Streaming pipeline: each input is read through stdio one
+ * record at a time into the current row group; a full group
+ * is encoded and written out before the next one starts.
+ * Memory use is one row group, whatever the input size.
+ ***************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "columnar.h"
+#include "history.h"
+
+static const char* const FCOL_COLUMN_NAMES[FCOL_COLUMN_COUNT] = {
+  "device", "time", "current", "target", "bat_percent", "flags", "bat_mv"
+};
+
+/** --------------------------------------------------
+ * Little-endian and varint helpers.
+ * -------------------------------------------------- */
+static void putLe(FILE* f, uint64_t v, int bytes) {
+  for (int i = 0; i < bytes; i++) fputc((int)((v >> (8 * i)) & 0xFF), f);
+}
+
+static bool getLe(FILE* f, uint64_t &v, int bytes) {
+  v = 0;
+  for (int i = 0; i < bytes; i++) {
+    int c = fgetc(f);
+    if (c == EOF) return false;
+    v |= (uint64_t)c << (8 * i);
+  }
+  return true;
+}
+
+static void putVarint(std::vector<uint8_t> &out, int32_t value) {
+  uint32_t z = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+  while (z >= 0x80) {
+    out.push_back((uint8_t)(z | 0x80));
+    z >>= 7;
+  }
+  out.push_back((uint8_t)z);
+}
+
+static bool getVarint(const uint8_t* &p, const uint8_t* end, int32_t &value) {
+  uint32_t z = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (p == end) return false;
+    uint8_t b = *p++;
+    z |= (uint32_t)(b & 0x7F) << shift;
+    if ((b & 0x80) == 0) {
+      value = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+/** --------------------------------------------------
+ * Reads the history payload of one input file, either a
+ * raw /api/history body or a serial log containing an
+ * "[EXPORT] BEGIN" block of frames (see history.h). Log
+ * output between frames and frames with a bad checksum
+ * are skipped by scanning for the next sync bytes.
+ * -------------------------------------------------- */
+class HistorySource {
+public:
+  explicit HistorySource(FILE* f) : file(f) {}
+
+  bool open() {
+    int a = fgetc(file), b = fgetc(file);
+    if (a == (HISTORY_MAGIC & 0xFF) && b == (HISTORY_MAGIC >> 8)) {
+      pending[0] = (uint8_t)a;
+      pending[1] = (uint8_t)b;
+      pendingLen = 2;
+      return true;
+    }
+
+    // Serial capture: skip log text up to the export marker line
+    rewind(file);
+    char line[256];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+      if (strncmp(line, "[EXPORT] BEGIN", 14) == 0) {
+        framed = true;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool read(uint8_t* out, size_t n) {
+    while (n > 0) {
+      if (pendingLen > 0) {
+        *out++ = pending[2 - pendingLen];
+        pendingLen--;
+        n--;
+        continue;
+      }
+      if (!framed) {
+        size_t got = fread(out, 1, n, file);
+        if (got == 0) return false;
+        out += got;
+        n -= got;
+        continue;
+      }
+      if (frameAt == frame.size() && !nextFrame()) return false;
+      size_t take = std::min(n, frame.size() - frameAt);
+      memcpy(out, &frame[frameAt], take);
+      frameAt += take;
+      out += take;
+      n -= take;
+    }
+    return true;
+  }
+
+  uint32_t badFrames = 0;
+
+private:
+  /** --------------------------------------------------
+   * Loads the next valid frame. False at the end frame
+   * or the end of the file.
+   * -------------------------------------------------- */
+  bool nextFrame() {
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+      if (c != HISTORY_FRAME_SYNC0) continue;
+      long resume = ftell(file);
+      uint64_t len, sum;
+      if (fgetc(file) != HISTORY_FRAME_SYNC1 || !getLe(file, len, 2) || len > HISTORY_FRAME_MAX_LEN) {
+        fseek(file, resume, SEEK_SET);
+        continue;
+      }
+      frame.resize((size_t)len);
+      frameAt = 0;
+      if (fread(frame.data(), 1, frame.size(), file) != frame.size() || !getLe(file, sum, 2) ||
+          sum != historyFrameChecksum(frame.data(), frame.size())) {
+        badFrames++;
+        frame.clear();
+        fseek(file, resume, SEEK_SET);
+        continue;
+      }
+      return len > 0;
+    }
+    return false;
+  }
+
+  FILE* file;
+  bool framed = false;
+  std::vector<uint8_t> frame;
+  size_t frameAt = 0;
+  uint8_t pending[2];
+  int pendingLen = 0;
+};
+
+/** --------------------------------------------------
+ * Row group under construction, one vector per column.
+ * -------------------------------------------------- */
+struct RowGroup_t {
+  std::vector<int32_t> columns[FCOL_COLUMN_COUNT];
+  size_t rows = 0;
+};
+
+static void encodeDelta(const std::vector<int32_t> &values, std::vector<uint8_t> &out) {
+  int32_t prev = 0;
+  for (int32_t v : values) {
+    putVarint(out, (int32_t)((uint32_t)v - (uint32_t)prev));   // wraps, as the decoder does
+    prev = v;
+  }
+}
+
+static void encodeRle(const std::vector<int32_t> &values, std::vector<uint8_t> &out) {
+  for (size_t i = 0; i < values.size();) {
+    size_t run = 1;
+    while (i + run < values.size() && values[i + run] == values[i]) run++;
+    putVarint(out, values[i]);
+    putVarint(out, (int32_t)run);
+    i += run;
+  }
+}
+
+/** --------------------------------------------------
+ * Encodes and writes one row group; returns bytes written.
+ * -------------------------------------------------- */
+static uint64_t writeRowGroup(FILE* f, RowGroup_t &group, std::vector<uint64_t> &offsets) {
+  static std::vector<uint8_t> delta, rle;
+  long start = ftell(f);
+  offsets.push_back((uint64_t)start);
+  putLe(f, group.rows, 4);
+
+  for (int c = 0; c < FCOL_COLUMN_COUNT; c++) {
+    const std::vector<int32_t> &values = group.columns[c];
+    int32_t lo = values[0], hi = values[0];
+    for (int32_t v : values) {
+      if (v < lo) lo = v;
+      if (v > hi) hi = v;
+    }
+
+    delta.clear();
+    rle.clear();
+    encodeDelta(values, delta);
+    encodeRle(values, rle);
+    bool useRle = rle.size() < delta.size();
+    const std::vector<uint8_t> &data = useRle ? rle : delta;
+
+    putLe(f, (uint64_t)c, 1);
+    putLe(f, useRle ? FCOL_ENC_RLE : FCOL_ENC_DELTA, 1);
+    putLe(f, (uint32_t)lo, 4);
+    putLe(f, (uint32_t)hi, 4);
+    putLe(f, data.size(), 4);
+    fwrite(data.data(), 1, data.size(), f);
+  }
+
+  for (int c = 0; c < FCOL_COLUMN_COUNT; c++) group.columns[c].clear();
+  group.rows = 0;
+  return (uint64_t)(ftell(f) - start);
+}
+
+static std::string baseName(const char* path) {
+  const char* slash = strrchr(path, '/');
+  return slash ? slash + 1 : path;
+}
+
+/** --------------------------------------------------
+ * Closes and deletes half-written outputs.
+ * -------------------------------------------------- */
+static int abandonOutputs(FILE* out, const char* output, FILE* csv, const char* csvOutput) {
+  fclose(out);
+  remove(output);
+  if (csv) {
+    fclose(csv);
+    remove(csvOutput);
+  }
+  return 1;
+}
+
+int columnarConvert(const char* output, const char* csvOutput, const char* const* inputs, size_t inputCount) {
+  auto t0 = std::chrono::steady_clock::now();
+
+  FILE* out = fopen(output, "wb");
+  if (out == nullptr) {
+    fprintf(stderr, "fridgetool: cannot create %s\n", output);
+    return 1;
+  }
+  FILE* csv = nullptr;
+  if (csvOutput != nullptr && (csv = fopen(csvOutput, "w")) == nullptr) {
+    fprintf(stderr, "fridgetool: cannot create %s\n", csvOutput);
+    return abandonOutputs(out, output, nullptr, nullptr);
+  }
+
+  fwrite("FCOL", 1, 4, out);
+  putLe(out, FCOL_VERSION, 4);
+
+  static const char CSV_HEADER[] = "device,time,current,target,bat_percent,flags,bat_mv\n";
+  uint64_t csvBytes = sizeof(CSV_HEADER) - 1;
+  if (csv) fputs(CSV_HEADER, csv);
+
+  RowGroup_t group;
+  for (int c = 0; c < FCOL_COLUMN_COUNT; c++) group.columns[c].reserve(FCOL_ROWS_PER_GROUP);
+  std::vector<uint64_t> offsets;
+  std::vector<std::string> devices;
+  uint64_t inputBytes = 0, totalRows = 0;
+
+  for (size_t i = 0; i < inputCount; i++) {
+    FILE* in = fopen(inputs[i], "rb");
+    if (in == nullptr) {
+      fprintf(stderr, "fridgetool: cannot open %s\n", inputs[i]);
+      return abandonOutputs(out, output, csv, csvOutput);
+    }
+    HistorySource source(in);
+    HistoryHeader_t header;
+    if (!source.open() || !source.read((uint8_t*)&header, sizeof(header)) ||
+        header.magic != HISTORY_MAGIC || header.recordSize < sizeof(HistoryRecord_t)) {
+      fprintf(stderr, "fridgetool: %s is not a history export\n", inputs[i]);
+      fclose(in);
+      return abandonOutputs(out, output, csv, csvOutput);
+    }
+
+    int32_t device = (int32_t)devices.size();
+    devices.push_back(baseName(inputs[i]));
+
+    // recordSize is a u8, so any record fits; newer fields past ours are skipped
+    uint8_t raw[256];
+    HistoryRecord_t r;
+    while (source.read(raw, header.recordSize)) {
+      memcpy(&r, raw, sizeof(r));
+      const int32_t row[FCOL_COLUMN_COUNT] = {
+        device, (int32_t)r.time, r.leftCurrent, r.leftTarget, r.batPercent, r.flags, r.batMillivolts
+      };
+      for (int c = 0; c < FCOL_COLUMN_COUNT; c++) group.columns[c].push_back(row[c]);
+      group.rows++;
+      totalRows++;
+
+      char line[96];
+      int n = snprintf(line, sizeof(line), "%s,%lu,%d,%d,%u,%u,%u\n", devices.back().c_str(),
+                       (unsigned long)r.time, r.leftCurrent, r.leftTarget, r.batPercent, r.flags,
+                       r.batMillivolts);
+      csvBytes += (uint64_t)n;
+      if (csv) fwrite(line, 1, (size_t)n, csv);
+
+      if (group.rows == FCOL_ROWS_PER_GROUP) writeRowGroup(out, group, offsets);
+    }
+    if (source.badFrames > 0) {
+      fprintf(stderr, "fridgetool: %s: skipped %lu frame(s) with a bad checksum\n", inputs[i],
+              (unsigned long)source.badFrames);
+    }
+    inputBytes += (uint64_t)ftell(in);
+    fclose(in);
+  }
+  if (group.rows > 0) writeRowGroup(out, group, offsets);
+
+  uint64_t footerOffset = (uint64_t)ftell(out);
+  putLe(out, devices.size(), 4);
+  for (const std::string &name : devices) {
+    putLe(out, name.size(), 2);
+    fwrite(name.data(), 1, name.size(), out);
+  }
+  putLe(out, offsets.size(), 4);
+  for (uint64_t offset : offsets) putLe(out, offset, 8);
+  putLe(out, footerOffset, 8);
+  fwrite("FCOL", 1, 4, out);
+
+  uint64_t outBytes = (uint64_t)ftell(out);
+  if (ferror(out) || (csv && ferror(csv))) {
+    fprintf(stderr, "fridgetool: write error\n");
+    return abandonOutputs(out, output, csv, csvOutput);
+  }
+  bool closed = fclose(out) == 0;
+  closed = (csv == nullptr || fclose(csv) == 0) && closed;
+  if (!closed) {
+    fprintf(stderr, "fridgetool: write error\n");
+    remove(output);
+    if (csv) remove(csvOutput);
+    return 1;
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  fprintf(stderr, "devices:    %zu\n", devices.size());
+  fprintf(stderr, "rows:       %llu in %zu row group(s)\n", (unsigned long long)totalRows, offsets.size());
+  fprintf(stderr, "input:      %llu bytes\n", (unsigned long long)inputBytes);
+  fprintf(stderr, "columnar:   %llu bytes (%.1f%% of CSV)\n", (unsigned long long)outBytes,
+          csvBytes ? 100.0 * outBytes / csvBytes : 0.0);
+  fprintf(stderr, "csv:        %llu bytes\n", (unsigned long long)csvBytes);
+  fprintf(stderr, "time:       %.3f s, %.1f MB/s, %.1f M rows/s\n", seconds,
+          seconds > 0 ? inputBytes / seconds / 1e6 : 0.0,
+          seconds > 0 ? totalRows / seconds / 1e6 : 0.0);
+  return 0;
+}
+
+/** --------------------------------------------------
+ * Decodes one column of a row group into 'out'.
+ * -------------------------------------------------- */
+static bool decodeColumn(const std::vector<uint8_t> &data, uint64_t encoding, uint64_t rows, int32_t lo,
+                         int32_t hi, std::vector<int32_t> &out) {
+  const uint8_t* p = data.data();
+  const uint8_t* end = p + data.size();
+  size_t first = out.size();
+  int32_t value = 0, delta, run;
+  while (p < end) {
+    if (encoding == FCOL_ENC_DELTA) {
+      if (!getVarint(p, end, delta)) return false;
+      value = (int32_t)((uint32_t)value + (uint32_t)delta);
+      out.push_back(value);
+    } else if (encoding == FCOL_ENC_RLE) {
+      if (!getVarint(p, end, value) || !getVarint(p, end, run) || run <= 0 ||
+          (uint64_t)run > rows - (out.size() - first)) {
+        return false;
+      }
+      out.insert(out.end(), (size_t)run, value);
+    } else {
+      return false;
+    }
+    if (out.back() < lo || out.back() > hi || out.size() - first > rows) return false;
+  }
+  return out.size() - first == rows;
+}
+
+bool columnarRead(const char* path, FcolTable_t &table) {
+  table = FcolTable_t();
+  FILE* f = fopen(path, "rb");
+  char magic[4];
+  uint64_t footerOffset, count;
+  bool ok = f != nullptr && fread(magic, 1, 4, f) == 4 && memcmp(magic, "FCOL", 4) == 0 &&
+            fseek(f, -12, SEEK_END) == 0 && getLe(f, footerOffset, 8) && fread(magic, 1, 4, f) == 4 &&
+            memcmp(magic, "FCOL", 4) == 0 && fseek(f, (long)footerOffset, SEEK_SET) == 0 && getLe(f, count, 4);
+  for (uint64_t i = 0; ok && i < count; i++) {
+    uint64_t len;
+    ok = getLe(f, len, 2);
+    std::string name(ok ? len : 0, '\0');
+    ok = ok && fread(&name[0], 1, name.size(), f) == name.size();
+    table.devices.push_back(name);
+  }
+  std::vector<uint64_t> offsets;
+  ok = ok && getLe(f, count, 4) && count <= footerOffset;
+  for (uint64_t i = 0; ok && i < count; i++) {
+    offsets.push_back(0);
+    ok = getLe(f, offsets.back(), 8) && offsets.back() < footerOffset;
+  }
+
+  std::vector<uint8_t> data;
+  for (size_t g = 0; ok && g < offsets.size(); g++) {
+    uint64_t rows;
+    ok = fseek(f, (long)offsets[g], SEEK_SET) == 0 && getLe(f, rows, 4);
+    for (int c = 0; ok && c < FCOL_COLUMN_COUNT; c++) {
+      uint64_t id, encoding, lo, hi, len;
+      ok = getLe(f, id, 1) && id == (uint64_t)c && getLe(f, encoding, 1) && getLe(f, lo, 4) &&
+           getLe(f, hi, 4) && getLe(f, len, 4) && len <= footerOffset;
+      if (!ok) break;
+      data.resize(len);
+      ok = fread(data.data(), 1, len, f) == len &&
+           decodeColumn(data, encoding, rows, (int32_t)lo, (int32_t)hi, table.columns[c]);
+    }
+  }
+  for (int32_t device : table.columns[FCOL_COL_DEVICE]) {
+    ok = ok && device >= 0 && (size_t)device < table.devices.size();
+  }
+  if (f) fclose(f);
+  return ok;
+}
+
+int columnarInfo(const char* path) {
+  FILE* f = fopen(path, "rb");
+  char magic[4];
+  uint64_t footerOffset, v;
+  if (f == nullptr || fread(magic, 1, 4, f) != 4 || memcmp(magic, "FCOL", 4) != 0 ||
+      fseek(f, -12, SEEK_END) != 0 || !getLe(f, footerOffset, 8) ||
+      fseek(f, (long)footerOffset, SEEK_SET) != 0) {
+    fprintf(stderr, "fridgetool: %s is not a columnar history file\n", path);
+    if (f) fclose(f);
+    return 1;
+  }
+
+  getLe(f, v, 4);
+  printf("devices:");
+  for (uint64_t i = 0, n = v; i < n; i++) {
+    uint64_t len;
+    getLe(f, len, 2);
+    std::string name(len, '\0');
+    if (fread(&name[0], 1, len, f) != len) break;
+    printf(" %s", name.c_str());
+  }
+  printf("\n");
+
+  getLe(f, v, 4);
+  std::vector<uint64_t> offsets(v);
+  for (uint64_t &offset : offsets) getLe(f, offset, 8);
+
+  for (size_t g = 0; g < offsets.size(); g++) {
+    uint64_t rows;
+    fseek(f, (long)offsets[g], SEEK_SET);
+    getLe(f, rows, 4);
+    printf("row group %zu: %llu rows\n", g, (unsigned long long)rows);
+    for (int c = 0; c < FCOL_COLUMN_COUNT; c++) {
+      uint64_t id, enc, lo, hi, len;
+      getLe(f, id, 1);
+      getLe(f, enc, 1);
+      getLe(f, lo, 4);
+      getLe(f, hi, 4);
+      getLe(f, len, 4);
+      printf("  %-12s %-5s min %-8d max %-8d %llu bytes\n",
+             id < FCOL_COLUMN_COUNT ? FCOL_COLUMN_NAMES[id] : "?",
+             enc == FCOL_ENC_RLE ? "rle" : "delta", (int32_t)lo, (int32_t)hi,
+             (unsigned long long)len);
+      fseek(f, (long)len, SEEK_CUR);
+    }
+  }
+  fclose(f);
+
+  FcolTable_t table;
+  if (!columnarRead(path, table)) {
+    fprintf(stderr, "fridgetool: %s does not decode\n", path);
+    return 1;
+  }
+  printf("decoded:  %zu rows\n", table.columns[FCOL_COL_DEVICE].size());
+  return 0;
+}
@@ -0,0 +1,83 @@
+/***************************************************************
+ * Columnar fleet history export
+ *
+ * Converts on-device binary history (the HistoryHeader_t +
+ * HistoryRecord_t stream served by /api/history or the
+ * serial 'export' command, one file per fridge) into a
+ * single columnar file for analytics.
+ *
+ * File layout (all integers little endian):
+ *
+ *   "FCOL" u32 version
+ *   row group *
+ *     u32 rowCount
+ *     column * FCOL_COLUMN_COUNT
+ *       u8 columnId, u8 encoding, i32 min, i32 max,
+ *       u32 byteLength, byteLength bytes of data
+ *   footer
+ *     u32 deviceCount, { u16 nameLength, name } *
+ *     u32 rowGroupCount, { u64 fileOffset } *
+ *   u64 footerOffset, "FCOL"
+ *
+ * Column data is a sequence of zigzag varints, either
+ * FCOL_ENC_DELTA (first value, then differences) or
+ * FCOL_ENC_RLE ({value, run length} pairs); each column of
+ * each row group uses whichever is smaller.
+ ***************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#define FCOL_VERSION 1
+#define FCOL_ROWS_PER_GROUP 65536
+
+enum FcolColumn_t {
+  FCOL_COL_DEVICE = 0,     // index into the footer's device names
+  FCOL_COL_TIME,           // seconds since boot of that device
+  FCOL_COL_CURRENT,
+  FCOL_COL_TARGET,
+  FCOL_COL_BAT_PERCENT,
+  FCOL_COL_FLAGS,          // HISTORY_FLAG_*
+  FCOL_COL_BAT_MV,
+  FCOL_COLUMN_COUNT
+};
+
+enum FcolEncoding_t {
+  FCOL_ENC_DELTA = 1,
+  FCOL_ENC_RLE   = 2
+};
+
+/** --------------------------------------------------
+ * A decoded file: the device names and every row, one
+ * vector per column.
+ * -------------------------------------------------- */
+struct FcolTable_t {
+  std::vector<std::string> devices;
+  std::vector<int32_t> columns[FCOL_COLUMN_COUNT];
+};
+
+/** --------------------------------------------------
+ * Converts the input files into 'output'. If csvOutput is
+ * not null the same rows are also written as CSV there.
+ * On failure neither output is left behind. Returns a
+ * process exit code.
+ * -------------------------------------------------- */
+int columnarConvert(const char* output, const char* csvOutput, const char* const* inputs, size_t inputCount);
+
+/** --------------------------------------------------
+ * Decodes a whole file. Returns false if it is malformed
+ * (bad framing, unknown encoding, a column whose row count
+ * or values disagree with its header).
+ * -------------------------------------------------- */
+bool columnarRead(const char* path, FcolTable_t &table);
+
+/** --------------------------------------------------
+ * Prints the row groups and column statistics of a file,
+ * then decodes it.
+ * Returns a process exit code.
+ * -------------------------------------------------- */
+int columnarInfo(const char* path);
@@ -0,0 +1,101 @@
+/***************************************************************
+ * Remote configuration dry run (see configtool.h)
+ ***************************************************************/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "configtool.h"
+#include "remote_config.h"
+
+static bool readFile(const char* path, std::string &out) {
+  FILE* f = fopen(path, "rb");
+  if (f == nullptr) return false;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+  fclose(f);
+  return true;
+}
+
+/** --------------------------------------------------
+ * Mean time of one configApply() over 'reps' runs, in
+ * microseconds. The device adds the NVS write on top.
+ * -------------------------------------------------- */
+static double timeApply(const FridgeConfig_t &current, const std::string &patch, int reps) {
+  FridgeConfig_t out;
+  ConfigResult_t result;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < reps; i++) {
+    configApply(current, patch.data(), patch.size(), false, out, result);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(t1 - t0).count() / reps;
+}
+
+int configMain(int argc, char** argv) {
+  int reps = 1000;
+  std::vector<const char*> files;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) reps = atoi(argv[++i]);
+    else files.push_back(argv[i]);
+  }
+  if (files.empty() || reps < 1) {
+    fprintf(stderr, "usage: fridgetool config [--reps N] STATE.json [PATCH.json...]\n");
+    return 2;
+  }
+
+  std::string text;
+  if (!readFile(files[0], text)) {
+    fprintf(stderr, "cannot read %s\n", files[0]);
+    return 1;
+  }
+  // The state must be a complete document: start from all zeros, so
+  // a missing field fails validation instead of being made up
+  FridgeConfig_t empty, config;
+  memset(&empty, 0, sizeof(empty));
+  ConfigResult_t result;
+  if (!configApply(empty, text.data(), text.size(), true, config, result)) {
+    fprintf(stderr, "%s: %s\n", files[0], result.error);
+    return 1;
+  }
+  printf("state: rev %lu from %s\n", (unsigned long)config.rev, files[0]);
+
+  int rejected = 0;
+  for (size_t i = 1; i < files.size(); i++) {
+    std::string patch;
+    if (!readFile(files[i], patch)) {
+      fprintf(stderr, "cannot read %s\n", files[i]);
+      return 1;
+    }
+    double us = timeApply(config, patch, reps);
+    FridgeConfig_t next;
+    bool ok = configApply(config, patch.data(), patch.size(), false, next, result);
+    char changed[256];
+    configFormatFieldNames(result.changedMask, changed, sizeof(changed));
+    if (!ok) {
+      rejected++;
+      printf("%s: rejected (%s), %.2f us\n", files[i], result.error, us);
+    } else if (result.changedMask == 0) {
+      printf("%s: ok, nothing changed (no NVS write), %.2f us\n", files[i], us);
+    } else {
+      bool reconnect = (result.changedMask & configReconnectMask()) != 0;
+      printf("%s: ok, rev %lu, changed %s%s, %.2f us\n", files[i], (unsigned long)next.rev, changed,
+             reconnect ? " (next connection)" : "", us);
+    }
+    config = next;
+  }
+
+  char json[CONFIG_JSON_MAX_LEN];
+  if (configFormatJson(config, json, sizeof(json)) == 0) {
+    fprintf(stderr, "document does not fit in %d bytes\n", CONFIG_JSON_MAX_LEN);
+    return 1;
+  }
+  printf("%s\n", json);
+  printf("%zu bytes, NVS blob %zu bytes\n", strlen(json), sizeof(FridgeConfig_t));
+  return rejected ? 1 : 0;
+}
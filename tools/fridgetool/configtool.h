@@ -0,0 +1,19 @@
+/***************************************************************
+ * Remote configuration dry run
+ *
+ * Applies config/set patches to a configuration document
+ * with the firmware's own code (include/remote_config.h),
+ * so a patch can be checked before it is published. The
+ * state is a config/state document as the fridge publishes
+ * it; every PATCH is applied in turn, as the fridge would,
+ * and the outcome, the changed fields and the apply time
+ * are printed for each, then the resulting document.
+ ***************************************************************/
+
+#pragma once
+
+/** --------------------------------------------------
+ * fridgetool config [--reps N] STATE.json [PATCH.json...]
+ * Exit code 1 if the state or a patch was rejected.
+ * -------------------------------------------------- */
+int configMain(int argc, char** argv);
@@ -0,0 +1,264 @@
+/***************************************************************
+ * fridgetool - host-side analysis of captures and serial logs
+ *
+ * Finds every "FE FE ..." frame in one or more text files
+ * (serial monitor logs, hex captures, one frame per line or
+ * embedded in log lines), decodes them with the same protocol
+ * code the firmware uses (include/fridge_protocol.h) and
+ * prints a status table, statistics and anomalies.
+ *
+ * Files are memory-mapped and split at line boundaries into
+ * chunks that are decoded in parallel, one worker per core.
+ *
+ * Usage: fridgetool [-j threads] [--table] [--no-stats]
+ *                   [--no-anomalies] FILE...
+ *        fridgetool columnar -o OUT.fcol [--csv OUT.csv] HISTORY...
+ *        fridgetool columnar --info FILE.fcol
+ *        fridgetool bench [-o FILE] [--fw VERSION] [--reps N]
+ *        fridgetool compare BASE NEW [--threshold PCT] [--alpha P]
+ *        fridgetool simulate [--days N] [--seed S] [--drop PCT] [--mtbf MINUTES] [--rssi DBM]
+ *                            [--fade MINUTES] [--degrade MINUTES] [--no-proactive | --compare]
+ *        fridgetool stress [--frames N] [--disconnect-every N]
+ *        fridgetool logdecode --dict FILE [--stats] CAPTURE...
+ *        fridgetool sdbench [--records N] [--dir DIR] [--sync-ms MS]
+ *        fridgetool alarmbench [--tick MS] [--rounds N] [--seed S]
+ *        fridgetool config [--reps N] STATE.json [PATCH.json...]
+ *        fridgetool hatest [--hours N] [--query-s S] [--seed S] [CAPTURE...]
+ *
+ * The columnar subcommand converts binary history exports
+ * (see columnar.h); bench / compare record and compare
+ * benchmark baselines (see bench.h); simulate runs the link
+ * cadence in virtual time (see simulate.h); stress races the
+ * notify callback against loop() (see stress.h); logdecode
+ * renders binary firmware logs (see logdecode.h); sdbench
+ * measures the SD card sink (see sdbench.h); alarmbench
+ * times alarm delivery end to end (see alarmbench.h); config
+ * dry-runs remote configuration patches (see configtool.h);
+ * hatest measures the Home Assistant message rate (see
+ * hatest.h).
+ ***************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "capture.h"
+#include "columnar.h"
+#include "bench.h"
+#include "simulate.h"
+#include "stress.h"
+#include "logdecode.h"
+#include "sdbench.h"
+#include "alarmbench.h"
+#include "configtool.h"
+#include "hatest.h"
+
+// Anomaly thresholds
+#define ANOMALY_TEMP_JUMP 5        // degrees between consecutive readings
+#define ANOMALY_LOW_VOLTAGE_DV 110 // battery below 11.0 V
+
+/** --------------------------------------------------
+ * Running statistics over all decoded readings.
+ * -------------------------------------------------- */
+struct Stats_t {
+  uint64_t lines = 0;
+  uint64_t frames = 0;
+  uint64_t results[FRAME_RESULT_COUNT] = {};
+  int minCurrent = 127, maxCurrent = -128;
+  int64_t sumCurrent = 0;
+  int minVoltageDv = 1000, maxVoltageDv = 0;
+  uint64_t anomalies = 0;
+};
+
+static void printTableHeader() {
+  printf("file\tline\tresult\topcode\tlocked\tpower\tmode\ttarget\tcurrent\tunit\tbat%%\tbatV\n");
+}
+
+static void printTableRow(const char* file, const FrameRow_t &r) {
+  if (r.result != FRAME_OK) {
+    printf("%s\t%llu\t%s\t%02X\n", file, (unsigned long long)r.line,
+           FRAME_RESULT_NAMES[r.result], r.opcode);
+    return;
+  }
+  const FridgeStatus_t &s = r.status;
+  printf("%s\t%llu\tok\t%02X\t%d\t%d\t%s\t%d\t%d\t%s\t%u\t%u.%u\n",
+         file, (unsigned long long)r.line, r.opcode, s.locked, s.poweredOn,
+         s.runMode == 0 ? "MAX" : s.runMode == 1 ? "ECO" : "?",
+         s.leftTarget, s.leftCurrent, s.unit == 0 ? "C" : "F",
+         s.batPercent, s.batVolInt, s.batVolDec);
+}
+
+/** --------------------------------------------------
+ * fridgetool columnar ...
+ * -------------------------------------------------- */
+static int columnarMain(int argc, char** argv) {
+  const char* output = nullptr;
+  const char* csvOutput = nullptr;
+  std::vector<const char*> inputs;
+
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--info") == 0 && i + 1 < argc) return columnarInfo(argv[i + 1]);
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+    else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) csvOutput = argv[++i];
+    else inputs.push_back(argv[i]);
+  }
+  if (output == nullptr || inputs.empty()) {
+    fprintf(stderr, "usage: %s columnar -o OUT.fcol [--csv OUT.csv] HISTORY...\n"
+                    "       %s columnar --info FILE.fcol\n", argv[0], argv[0]);
+    return 2;
+  }
+  return columnarConvert(output, csvOutput, inputs.data(), inputs.size());
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "columnar") == 0) return columnarMain(argc, argv);
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) return benchMain(argc, argv);
+  if (argc > 1 && strcmp(argv[1], "compare") == 0) return compareMain(argc, argv);
+  if (argc > 1 && strcmp(argv[1], "simulate") == 0) return simulateMain(argc, argv);
+  if (argc > 1 && strcmp(argv[1], "stress") == 0) return stressMain(argc, argv);
+  if (argc > 1 && strcmp(argv[1], "logdecode") == 0) return logdecodeMain(argc, argv);
+  if (argc > 1 && strcmp(argv[1], "sdbench") == 0) return sdbenchMain(argc, argv);
+  if (argc > 1 && strcmp(argv[1], "alarmbench") == 0) return alarmbenchMain(argc, argv);
+  if (argc > 1 && strcmp(argv[1], "config") == 0) return configMain(argc, argv);
+  if (argc > 1 && strcmp(argv[1], "hatest") == 0) return hatestMain(argc, argv);
+
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  bool showTable = false, showStats = true, showAnomalies = true;
+  std::vector<const char*> files;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--table") == 0) showTable = true;
+    else if (strcmp(argv[i], "--no-stats") == 0) showStats = false;
+    else if (strcmp(argv[i], "--no-anomalies") == 0) showAnomalies = false;
+    else if (argv[i][0] == '-') {
+      fprintf(stderr, "usage: %s [-j threads] [--table] [--no-stats] [--no-anomalies] FILE...\n", argv[0]);
+      return 2;
+    } else files.push_back(argv[i]);
+  }
+  if (files.empty()) {
+    fprintf(stderr, "usage: %s [-j threads] [--table] [--no-stats] [--no-anomalies] FILE...\n", argv[0]);
+    return 2;
+  }
+
+  initHexTable();
+  auto t0 = std::chrono::steady_clock::now();
+
+  Stats_t stats;
+  uint64_t totalBytes = 0;
+  if (showTable) printTableHeader();
+
+  for (const char* file : files) {
+    int fd = open(file, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+      fprintf(stderr, "fridgetool: cannot open %s\n", file);
+      if (fd >= 0) close(fd);
+      return 1;
+    }
+    size_t size = (size_t)st.st_size;
+    totalBytes += size;
+    if (size == 0) {
+      close(fd);
+      continue;
+    }
+    const char* data = (const char*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      fprintf(stderr, "fridgetool: cannot map %s\n", file);
+      return 1;
+    }
+    madvise((void*)data, size, MADV_SEQUENTIAL);
+
+    // Parallel pass: workers pull chunks from a shared index
+    std::vector<Chunk_t> chunks;
+    splitIntoChunks(data, size, threads * CHUNKS_PER_THREAD, chunks);
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < std::min<size_t>(threads, chunks.size()); t++) {
+      workers.emplace_back([&]() {
+        for (size_t i = next++; i < chunks.size(); i = next++) decodeChunk(chunks[i]);
+      });
+    }
+    for (std::thread &w : workers) w.join();
+
+    // Sequential merge in file order: line numbers, table, stats, anomalies
+    uint64_t lineBase = 0;
+    bool havePrev = false;
+    FridgeStatus_t prev = {};
+    for (Chunk_t &chunk : chunks) {
+      for (FrameRow_t &row : chunk.rows) {
+        row.line += lineBase;
+        stats.frames++;
+        stats.results[row.result]++;
+        if (showTable) printTableRow(file, row);
+
+        if (row.result != FRAME_OK) {
+          if (showAnomalies && row.result != FRAME_OTHER_OPCODE) {
+            printf("ANOMALY %s:%llu %s frame (%u bytes)\n", file,
+                   (unsigned long long)row.line, FRAME_RESULT_NAMES[row.result], row.length);
+            stats.anomalies++;
+          }
+          continue;
+        }
+
+        const FridgeStatus_t &s = row.status;
+        int voltageDv = s.batVolInt * 10 + s.batVolDec;
+        stats.minCurrent = std::min<int>(stats.minCurrent, s.leftCurrent);
+        stats.maxCurrent = std::max<int>(stats.maxCurrent, s.leftCurrent);
+        stats.sumCurrent += s.leftCurrent;
+        stats.minVoltageDv = std::min(stats.minVoltageDv, voltageDv);
+        stats.maxVoltageDv = std::max(stats.maxVoltageDv, voltageDv);
+
+        if (showAnomalies && havePrev && abs(s.leftCurrent - prev.leftCurrent) >= ANOMALY_TEMP_JUMP) {
+          printf("ANOMALY %s:%llu temperature jump %d -> %d\n", file,
+                 (unsigned long long)row.line, prev.leftCurrent, s.leftCurrent);
+          stats.anomalies++;
+        }
+        if (showAnomalies && voltageDv < ANOMALY_LOW_VOLTAGE_DV &&
+            (!havePrev || prev.batVolInt * 10 + prev.batVolDec >= ANOMALY_LOW_VOLTAGE_DV)) {
+          printf("ANOMALY %s:%llu battery low %u.%u V\n", file,
+                 (unsigned long long)row.line, s.batVolInt, s.batVolDec);
+          stats.anomalies++;
+        }
+        prev = s;
+        havePrev = true;
+      }
+      lineBase += chunk.lineCount;
+    }
+    stats.lines += lineBase;
+    munmap((void*)data, size);
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  if (showStats) {
+    fprintf(stderr, "files:      %zu (%llu bytes, %llu lines)\n", files.size(),
+            (unsigned long long)totalBytes, (unsigned long long)stats.lines);
+    fprintf(stderr, "frames:     %llu\n", (unsigned long long)stats.frames);
+    for (int r = 0; r < FRAME_RESULT_COUNT; r++) {
+      fprintf(stderr, "  %-13s %llu\n", FRAME_RESULT_NAMES[r], (unsigned long long)stats.results[r]);
+    }
+    if (stats.results[FRAME_OK]) {
+      fprintf(stderr, "current:    min %d, max %d, avg %.2f\n", stats.minCurrent, stats.maxCurrent,
+              (double)stats.sumCurrent / stats.results[FRAME_OK]);
+      fprintf(stderr, "battery:    %d.%d .. %d.%d V\n", stats.minVoltageDv / 10, stats.minVoltageDv % 10,
+              stats.maxVoltageDv / 10, stats.maxVoltageDv % 10);
+    }
+    fprintf(stderr, "anomalies:  %llu\n", (unsigned long long)stats.anomalies);
+    fprintf(stderr, "time:       %.3f s, %.1f MB/s, %u threads\n", seconds,
+            seconds > 0 ? totalBytes / seconds / 1e6 : 0.0, threads);
+  }
+  return 0;
+}
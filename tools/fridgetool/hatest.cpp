@@ -0,0 +1,194 @@
+/***************************************************************
+ * Home Assistant message rate (see hatest.h)
+ ***************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "hatest.h"
+#include "capture.h"
+#include "ha_discovery.h"
+
+#define HATEST_BASE "fridge/a1b2c3"
+
+struct Message_t {
+  std::string topic;
+  std::string payload;
+  bool retain;
+};
+
+struct Broker_t {
+  std::vector<Message_t> log;
+};
+
+static bool brokerPublish(void* ctx, const char* topic, const char* payload, bool retain) {
+  Broker_t &b = *(Broker_t*)ctx;
+  b.log.push_back({ topic, payload, retain });
+  return true;
+}
+
+/** --------------------------------------------------
+ * Simulated fridge: the compressor pulls the box 1 degree
+ * every 1-2 minutes down to the target, then it warms 1
+ * degree every 4-8 minutes up to target + return
+ * difference. The battery drains faster while the
+ * compressor runs; the reported voltage has +-0.1 V of
+ * noise, the percentage follows the smooth value.
+ * -------------------------------------------------- */
+struct SimFridge_t {
+  FridgeStatus_t st;
+  bool cooling = false;
+  double nextStepS = 0;
+  double voltage = 12.9;
+  std::mt19937 rng;
+};
+
+static void simBegin(SimFridge_t &f, uint32_t seed) {
+  memset(&f.st, 0, sizeof(f.st));
+  f.st.poweredOn = true;
+  f.st.runMode = 1;
+  f.st.leftTarget = 4;
+  f.st.tempMax = 20;
+  f.st.tempMin = -20;
+  f.st.leftRetDiff = 2;
+  f.st.leftCurrent = 5;
+  f.rng.seed(seed);
+}
+
+static const FridgeStatus_t &simStep(SimFridge_t &f, double nowS, double dtS) {
+  FridgeStatus_t &st = f.st;
+  while (nowS >= f.nextStepS) {
+    if (f.cooling) {
+      if (--st.leftCurrent <= st.leftTarget) f.cooling = false;
+      f.nextStepS += std::uniform_real_distribution<double>(60, 120)(f.rng);
+    } else {
+      if (++st.leftCurrent >= st.leftTarget + st.leftRetDiff) f.cooling = true;
+      f.nextStepS += std::uniform_real_distribution<double>(240, 480)(f.rng);
+    }
+  }
+  f.voltage -= dtS / 3600.0 * (f.cooling ? 0.06 : 0.01);
+  f.voltage = std::max(f.voltage, 11.0);
+  int dv = (int)(f.voltage * 10 + 0.5) + std::uniform_int_distribution<int>(-1, 1)(f.rng);
+  st.batVolInt = (uint8_t)(dv / 10);
+  st.batVolDec = (uint8_t)(dv % 10);
+  st.batPercent = (uint8_t)std::min(100.0, std::max(0.0, (f.voltage - 11.0) / 2.0 * 100.0));
+  return st;
+}
+
+static bool readFile(const char* path, std::string &out) {
+  FILE* f = fopen(path, "rb");
+  if (f == nullptr) return false;
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+  fclose(f);
+  return true;
+}
+
+static bool loadCaptures(const std::vector<const char*> &files, std::vector<FridgeStatus_t> &out) {
+  initHexTable();
+  for (const char* path : files) {
+    std::string text;
+    if (!readFile(path, text)) {
+      fprintf(stderr, "cannot read %s\n", path);
+      return false;
+    }
+    Chunk_t chunk;
+    chunk.begin = text.data();
+    chunk.end = text.data() + text.size();
+    chunk.lineCount = 0;
+    decodeChunk(chunk);
+    for (const FrameRow_t &r : chunk.rows) {
+      if (r.result == FRAME_OK) out.push_back(r.status);
+    }
+  }
+  return true;
+}
+
+int hatestMain(int argc, char** argv) {
+  double hours = 24;
+  double queryS = 60;
+  uint32_t seed = 1;
+  std::vector<const char*> captures;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--hours") == 0 && i + 1 < argc) hours = atof(argv[++i]);
+    else if (strcmp(argv[i], "--query-s") == 0 && i + 1 < argc) queryS = atof(argv[++i]);
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (uint32_t)strtoul(argv[++i], nullptr, 0);
+    else if (argv[i][0] != '-') captures.push_back(argv[i]);
+    else {
+      fprintf(stderr, "usage: %s hatest [--hours N] [--query-s S] [--seed S] [CAPTURE...]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (hours <= 0 || queryS <= 0) return 2;
+
+  std::vector<FridgeStatus_t> readings;
+  if (!captures.empty()) {
+    if (!loadCaptures(captures, readings)) return 1;
+    if (readings.empty()) {
+      fprintf(stderr, "no decodable frames in the captures\n");
+      return 1;
+    }
+    hours = readings.size() * queryS / 3600.0;
+    printf("readings:    %zu from captures, one per %.0f s = %.2f h\n", readings.size(), queryS, hours);
+  } else {
+    SimFridge_t fridge;
+    simBegin(fridge, seed);
+    size_t count = (size_t)(hours * 3600 / queryS);
+    for (size_t i = 0; i < count; i++) readings.push_back(simStep(fridge, i * queryS, queryS));
+    printf("readings:    %zu simulated, one per %.0f s = %.2f h (seed %u)\n", readings.size(), queryS, hours, seed);
+  }
+
+  Broker_t broker;
+  HaPublisher_t p;
+  haBegin(p, HATEST_BASE, "hatest", brokerPublish, &broker);
+  haConnected(p);
+
+  // First reading: discovery, every state, availability
+  haUpdate(p, &readings[0], true, "WT-0001");
+  size_t discoveryBytes = 0, largest = 0;
+  for (const Message_t &m : broker.log) {
+    if (m.topic.compare(0, strlen(HA_DISCOVERY_PREFIX), HA_DISCOVERY_PREFIX) != 0) continue;
+    discoveryBytes += m.topic.size() + m.payload.size();
+    largest = std::max(largest, m.payload.size());
+  }
+  printf("discovery:   %u config messages, %zu bytes, largest %zu (limit %d)\n", (unsigned)p.stats.discovery,
+         discoveryBytes, largest, HA_DISCOVERY_MAX_LEN);
+
+  // Steady state: once per loop would be the same, an unchanged
+  // reading sends nothing
+  size_t steadyFrom = broker.log.size();
+  uint64_t steadyBytes = p.stats.bytes;
+  uint32_t statesBefore[HA_ENTITY_COUNT];
+  memcpy(statesBefore, p.stats.perEntity, sizeof(statesBefore));
+  uint64_t naiveBytes = 0;
+  char payload[16];
+  for (size_t i = 1; i < readings.size(); i++) {
+    haUpdate(p, &readings[i], true, "WT-0001");
+    haUpdate(p, &readings[i], true, "WT-0001");
+    for (uint8_t e = 0; e < HA_ENTITY_COUNT; e++) {
+      haFormatState((HaEntityId_t)e, haEntityValue((HaEntityId_t)e, readings[i]), payload, sizeof(payload));
+      naiveBytes += strlen(HATEST_BASE "/ha/") + strlen(HA_ENTITIES[e].object) + strlen(payload);
+    }
+  }
+  size_t steady = broker.log.size() - steadyFrom;
+  double steadyHours = (readings.size() - 1) * queryS / 3600.0;
+  if (steadyHours > 0) {
+    double naive = (readings.size() - 1) * HA_ENTITY_COUNT / steadyHours;
+    printf("steady:      %.1f msg/h, %.0f B/h; every entity every reading: %.1f msg/h, %.0f B/h (%.1fx)\n",
+           steady / steadyHours, (p.stats.bytes - steadyBytes) / steadyHours, naive, naiveBytes / steadyHours,
+           steady ? naive / (steady / steadyHours) : 0.0);
+    printf("per entity:  ");
+    for (uint8_t e = 0; e < HA_ENTITY_COUNT; e++) {
+      printf("%s %.1f/h%s", HA_ENTITIES[e].object, (p.stats.perEntity[e] - statesBefore[e]) / steadyHours,
+             e + 1 < HA_ENTITY_COUNT ? ", " : "\n");
+    }
+  }
+
+  return 0;
+}
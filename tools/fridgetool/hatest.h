@@ -0,0 +1,24 @@
+/***************************************************************
+ * Home Assistant message rate
+ *
+ * Feeds a day of readings through the firmware's Home
+ * Assistant publisher (include/ha_discovery.h) and counts
+ * what it would send: discovery, change-only state updates
+ * and availability, per hour and per entity, next to
+ * publishing every entity on every reading. Readings come
+ * from a simulated fridge (compressor cycling around the
+ * target, battery draining with a flickering last voltage
+ * digit) or from captures, one per query interval.
+ *
+ * What the publisher must do (discovery, retries,
+ * reconnects, unit changes, commands) is covered by
+ * test/test_ha_discovery.
+ ***************************************************************/
+
+#pragma once
+
+/** --------------------------------------------------
+ * fridgetool hatest [--hours N] [--query-s S] [--seed S]
+ *                   [CAPTURE...]
+ * -------------------------------------------------- */
+int hatestMain(int argc, char** argv);
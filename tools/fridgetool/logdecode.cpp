@@ -0,0 +1,257 @@
+/***************************************************************
+ * Binary log renderer (see logdecode.h)
+ ***************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "logdecode.h"
+#include "binlog.h"
+
+struct LogFormat_t {
+  std::string level;
+  std::string where;
+  std::string format;
+};
+
+struct LogStats_t {
+  uint64_t records = 0;
+  uint64_t unknown = 0;
+  uint64_t recordBytes = 0;   // on the wire
+  uint64_t textBytes = 0;     // the same lines as Serial.printf() output
+  uint64_t otherBytes = 0;    // console output passed through
+};
+
+static bool readFile(const char* path, std::string &out) {
+  FILE* f = fopen(path, "rb");
+  if (f == nullptr) return false;
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+  fclose(f);
+  return true;
+}
+
+static std::string unescapeField(const std::string &s) {
+  std::string out;
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] == '\\' && i + 1 < s.size()) {
+      char c = s[++i];
+      out += c == 'n' ? '\n' : c == 'r' ? '\r' : c == 't' ? '\t' : c;
+    } else {
+      out += s[i];
+    }
+  }
+  return out;
+}
+
+/** --------------------------------------------------
+ * Loads tools/log_dictionary.py output.
+ * -------------------------------------------------- */
+static bool loadDictionary(const char* path, std::map<uint16_t, LogFormat_t> &dict) {
+  std::string text;
+  if (!readFile(path, text) || text.compare(0, 17, "# fridge-logdict/") != 0) return false;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t end = text.find('\n', pos);
+    if (end == std::string::npos) end = text.size();
+    std::string line = text.substr(pos, end - pos);
+    pos = end + 1;
+    if (line.empty() || line[0] == '#') continue;
+
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (int i = 0; i < 3; i++) {
+      size_t tab = line.find('\t', start);
+      if (tab == std::string::npos) break;
+      fields.push_back(line.substr(start, tab - start));
+      start = tab + 1;
+    }
+    if (fields.size() != 3) continue;
+    uint16_t id = (uint16_t)strtoul(fields[0].c_str(), nullptr, 16);
+    dict[id] = { fields[1], fields[2], unescapeField(line.substr(start)) };
+  }
+  return true;
+}
+
+/** --------------------------------------------------
+ * printf() over the record's arguments. Each conversion
+ * takes the next argument in the encoding its type letter
+ * implies; missing or short arguments print as '?'.
+ * -------------------------------------------------- */
+static std::string renderFormat(const std::string &format, const uint8_t* p, const uint8_t* end) {
+  std::string out;
+  char buf[512];
+  for (size_t i = 0; i < format.size(); i++) {
+    if (format[i] != '%') {
+      out += format[i];
+      continue;
+    }
+    if (i + 1 < format.size() && format[i + 1] == '%') {
+      out += '%';
+      i++;
+      continue;
+    }
+
+    // %[flags][width][.precision][length]conversion
+    std::string spec = "%";
+    size_t j = i + 1;
+    bool missing = false;
+    while (j < format.size() && strchr("-+ #0", format[j])) spec += format[j++];
+    for (int part = 0; part < 2; part++) {
+      if (part == 1) {
+        if (j >= format.size() || format[j] != '.') break;
+        spec += format[j++];
+      }
+      if (j < format.size() && format[j] == '*') {
+        int64_t v = 0;
+        if (!binlogGetInt(p, end, v)) missing = true;
+        spec += std::to_string(v);
+        j++;
+      }
+      while (j < format.size() && format[j] >= '0' && format[j] <= '9') spec += format[j++];
+    }
+    bool longLong = false;
+    while (j < format.size() && strchr("hlLqjzt", format[j])) {
+      if (format[j] == 'l' && j + 1 < format.size() && format[j + 1] == 'l') longLong = true;
+      j++;
+    }
+    if (j >= format.size()) break;
+    char conv = format[j];
+    i = j;
+
+    buf[0] = '\0';
+    if (strchr("diuxXoc", conv)) {
+      int64_t v;
+      if (missing || !binlogGetInt(p, end, v)) {
+        out += '?';
+        continue;
+      }
+      if (conv == 'd' || conv == 'i') {
+        snprintf(buf, sizeof(buf), (spec + "lld").c_str(), (long long)v);
+      } else if (conv == 'c') {
+        snprintf(buf, sizeof(buf), (spec + "c").c_str(), (int)v);
+      } else {
+        // The device's unsigned long is 32 bits wide
+        uint64_t u = longLong ? (uint64_t)v : (uint64_t)(uint32_t)v;
+        snprintf(buf, sizeof(buf), (spec + "ll" + conv).c_str(), (unsigned long long)u);
+      }
+    } else if (strchr("fFeEgGaA", conv)) {
+      float f;
+      if (missing || !binlogGetFloat(p, end, f)) {
+        out += '?';
+        continue;
+      }
+      snprintf(buf, sizeof(buf), (spec + conv).c_str(), (double)f);
+    } else if (conv == 's') {
+      uint64_t n;
+      if (missing || !binlogGetVarint(p, end, n) || (uint64_t)(end - p) < n) {
+        out += '?';
+        continue;
+      }
+      std::string s((const char*)p, (size_t)n);
+      p += n;
+      snprintf(buf, sizeof(buf), (spec + "s").c_str(), s.c_str());
+    } else {
+      out += '?';
+      continue;
+    }
+    out += buf;
+  }
+  return out;
+}
+
+static bool decodeCapture(const char* path, const std::map<uint16_t, LogFormat_t> &dict, LogStats_t &stats) {
+  std::string data;
+  if (!readFile(path, data)) {
+    fprintf(stderr, "fridgetool: cannot read %s\n", path);
+    return false;
+  }
+  const uint8_t* bytes = (const uint8_t*)data.data();
+  size_t size = data.size();
+  std::string text;   // console output since the last record
+
+  for (size_t i = 0; i < size; i++) {
+    size_t len = i + 1 < size ? bytes[i + 1] : 0;
+    if (bytes[i] != BINLOG_SYNC || len < 3 || i + 2 + len >= size ||
+        binlogCrc8(&bytes[i + 2], len) != bytes[i + 2 + len]) {
+      text += (char)bytes[i];
+      continue;
+    }
+
+    if (!text.empty()) {
+      fwrite(text.data(), 1, text.size(), stdout);
+      if (text.back() != '\n') putchar('\n');
+      stats.otherBytes += text.size();
+      text.clear();
+    }
+
+    const uint8_t* p = &bytes[i + 2];
+    const uint8_t* end = p + len;
+    uint16_t id = (uint16_t)(p[0] | (p[1] << 8));
+    p += 2;
+    uint64_t millis = 0;
+    binlogGetVarint(p, end, millis);
+
+    auto it = dict.find(id);
+    if (it == dict.end()) {
+      printf("[%7llu.%03llu] ?     <unknown format %04x, %u bytes>\n",
+             (unsigned long long)(millis / 1000), (unsigned long long)(millis % 1000), id, (unsigned)len);
+      stats.unknown++;
+    } else {
+      std::string line = renderFormat(it->second.format, p, end);
+      printf("[%7llu.%03llu] %-5s %s\n", (unsigned long long)(millis / 1000),
+             (unsigned long long)(millis % 1000), it->second.level.c_str(), line.c_str());
+      stats.textBytes += line.size() + 1;
+    }
+    stats.records++;
+    stats.recordBytes += len + 3;
+    i += len + 2;
+  }
+  fwrite(text.data(), 1, text.size(), stdout);
+  stats.otherBytes += text.size();
+  return true;
+}
+
+int logdecodeMain(int argc, char** argv) {
+  const char* dictPath = nullptr;
+  bool showStats = false;
+  bool usage = false;
+  std::vector<const char*> files;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--dict") == 0 && i + 1 < argc) dictPath = argv[++i];
+    else if (strcmp(argv[i], "--stats") == 0) showStats = true;
+    else if (argv[i][0] == '-') usage = true;
+    else files.push_back(argv[i]);
+  }
+  if (usage || dictPath == nullptr || files.empty()) {
+    fprintf(stderr, "usage: %s logdecode --dict log_dictionary.tsv [--stats] CAPTURE...\n", argv[0]);
+    return 2;
+  }
+
+  std::map<uint16_t, LogFormat_t> dict;
+  if (!loadDictionary(dictPath, dict)) {
+    fprintf(stderr, "fridgetool: %s is not a log dictionary\n", dictPath);
+    return 2;
+  }
+
+  LogStats_t stats;
+  for (const char* file : files) {
+    if (!decodeCapture(file, dict, stats)) return 2;
+  }
+
+  if (showStats) {
+    fprintf(stderr, "records:      %llu (%llu unknown format)\n",
+            (unsigned long long)stats.records, (unsigned long long)stats.unknown);
+    fprintf(stderr, "binary:       %llu bytes, %.1f per record\n", (unsigned long long)stats.recordBytes,
+            stats.records ? (double)stats.recordBytes / stats.records : 0.0);
+    fprintf(stderr, "as text:      %llu bytes (%.1fx)\n", (unsigned long long)stats.textBytes,
+            stats.recordBytes ? (double)stats.textBytes / stats.recordBytes : 0.0);
+    fprintf(stderr, "console text: %llu bytes\n", (unsigned long long)stats.otherBytes);
+  }
+  return stats.unknown ? 1 : 0;
+}
@@ -0,0 +1,21 @@
+/***************************************************************
+ * Renderer for binary deferred-format logs
+ *
+ * Reads raw serial captures of a -DLOG_BINARY firmware,
+ * finds the binlog records (include/binlog.h), looks their
+ * format ID up in the dictionary written by
+ * tools/log_dictionary.py and prints them as text lines with
+ * the device time and level. Anything that is not a valid
+ * record (console command output) is copied through.
+ *
+ * --stats compares the bytes on the wire with the text the
+ * same lines would have cost as Serial.printf() output.
+ ***************************************************************/
+
+#pragma once
+
+/** --------------------------------------------------
+ * fridgetool logdecode --dict FILE [--stats] CAPTURE...
+ * Exit code 1 if a record had an unknown format ID.
+ * -------------------------------------------------- */
+int logdecodeMain(int argc, char** argv);
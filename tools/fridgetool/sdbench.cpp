@@ -0,0 +1,246 @@
+/***************************************************************
+ * SD sink benchmark (see sdbench.h)
+ ***************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sdbench.h"
+#include "sd_sink.h"
+#include "clock.h"
+
+#define SDBENCH_DEFAULT_RECORDS 200000
+#define SDBENCH_FILE_BYTES (4UL * 1024 * 1024)      // same as the firmware
+#define SDBENCH_DEFAULT_SYNC_MS 5000
+
+/** --------------------------------------------------
+ * Record i of the test stream: every tenth a 10-byte
+ * history record, the rest 12..28-byte log records.
+ * Contents depend only on i, so a reader can check them.
+ * -------------------------------------------------- */
+static size_t makeRecord(uint32_t i, uint8_t &kind, uint8_t* bytes) {
+  uint64_t x = (uint64_t)i * 0x9E3779B97F4A7C15ULL + 1;
+  kind = i % 10 == 0 ? SD_RECORD_HISTORY : SD_RECORD_LOG;
+  size_t len = kind == SD_RECORD_HISTORY ? 10 : 12 + (size_t)(x % 17);
+  for (size_t b = 0; b < len; b++) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    bytes[b] = (uint8_t)x;
+  }
+  return len;
+}
+
+static uint32_t percentile(std::vector<uint32_t> &v, double p) {
+  if (v.empty()) return 0;
+  size_t k = (size_t)((v.size() - 1) * p);
+  std::nth_element(v.begin(), v.begin() + k, v.end());
+  return v[k];
+}
+
+static void printLatency(const char* name, std::vector<uint32_t> &us, double seconds, uint64_t bytes) {
+  uint32_t max = us.empty() ? 0 : *std::max_element(us.begin(), us.end());
+  uint32_t p50 = percentile(us, 0.50), p99 = percentile(us, 0.99), p999 = percentile(us, 0.999);
+  printf("%-22s %8.2f MB/s  per record p50 %5u us  p99 %6u us  p99.9 %6u us  max %7u us\n",
+         name, seconds > 0 ? bytes / seconds / 1e6 : 0.0, p50, p99, p999, max);
+}
+
+/** --------------------------------------------------
+ * File-backed card: one preallocated file per sink file.
+ * -------------------------------------------------- */
+struct FileCard_t {
+  std::string dir;
+  int fd = -1;
+  uint32_t files = 0;
+};
+
+static std::string cardPath(const FileCard_t &card, uint32_t file) {
+  char name[32];
+  snprintf(name, sizeof(name), "/%05u.sdl", file);
+  return card.dir + name;
+}
+
+static bool fileCardOpen(void* ctx, uint32_t bytes) {
+  FileCard_t* card = (FileCard_t*)ctx;
+  if (card->fd >= 0) close(card->fd);
+  card->fd = open(cardPath(*card, ++card->files).c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  return card->fd >= 0 && posix_fallocate(card->fd, 0, bytes) == 0;
+}
+
+static bool fileCardWrite(void* ctx, uint32_t offset, const uint8_t* data, size_t len) {
+  FileCard_t* card = (FileCard_t*)ctx;
+  return pwrite(card->fd, data, len, offset) == (ssize_t)len;
+}
+
+static bool fileCardSync(void* ctx) {
+  return fdatasync(((FileCard_t*)ctx)->fd) == 0;
+}
+
+/** --------------------------------------------------
+ * Reads sink files back in order; returns how many
+ * records matched the stream from the start.
+ * -------------------------------------------------- */
+static uint32_t verifyFiles(const std::vector<std::vector<uint8_t>> &files, uint32_t &mismatches) {
+  uint32_t next = 0;
+  mismatches = 0;
+  for (const std::vector<uint8_t> &file : files) {
+    sdSinkReadFile(file.data(), file.size(), [&](uint8_t kind, const uint8_t* data, size_t len) {
+      uint8_t expectedKind;
+      uint8_t expected[64];
+      size_t expectedLen = makeRecord(next, expectedKind, expected);
+      if (kind != expectedKind || len != expectedLen || memcmp(data, expected, len) != 0) mismatches++;
+      next++;
+    });
+  }
+  return next;
+}
+
+/** --------------------------------------------------
+ * Appends the stream to one file, a write per record,
+ * with an fdatasync after every record (syncMs 0) or
+ * every syncMs and at the end. Latency is per record,
+ * syncs included.
+ * -------------------------------------------------- */
+static bool runNaive(const std::string &path, uint32_t records, unsigned long syncMs,
+                     std::vector<uint32_t> &us, double &seconds, uint32_t &syncs) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (fd < 0) return false;
+  uint8_t kind;
+  uint8_t rec[2 + 64];
+  us.reserve(records);
+  unsigned long lastSync = clockMillis();
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < records; i++) {
+    size_t len = makeRecord(i, kind, rec + 2);
+    rec[0] = kind;
+    rec[1] = (uint8_t)len;
+    unsigned long start = clockMicros();
+    if (write(fd, rec, len + 2) != (ssize_t)(len + 2)) break;
+    if (syncMs == 0 || clockMillis() - lastSync >= syncMs) {
+      if (fdatasync(fd) != 0) break;
+      lastSync = clockMillis();
+      syncs++;
+    }
+    us.push_back((uint32_t)(clockMicros() - start));
+  }
+  bool ok = us.size() == records;
+  if (ok && syncMs != 0) {
+    ok = fdatasync(fd) == 0;   // the tail, as the sink's forced poll
+    syncs++;
+  }
+  seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  close(fd);
+  return ok;
+}
+
+static bool readFile(const std::string &path, std::vector<uint8_t> &out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (f == nullptr) return false;
+  uint8_t buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+int sdbenchMain(int argc, char** argv) {
+  uint32_t records = SDBENCH_DEFAULT_RECORDS;
+  unsigned long syncMs = SDBENCH_DEFAULT_SYNC_MS;
+  std::string dir;
+  bool ownDir = false;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--records") == 0 && i + 1 < argc) records = (uint32_t)atol(argv[++i]);
+    else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) dir = argv[++i];
+    else if (strcmp(argv[i], "--sync-ms") == 0 && i + 1 < argc) syncMs = (unsigned long)atol(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s sdbench [--records N] [--dir DIR] [--sync-ms MS]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (dir.empty()) {
+    char tmpl[] = "/tmp/sdbench.XXXXXX";
+    if (mkdtemp(tmpl) == nullptr) {
+      perror("mkdtemp");
+      return 2;
+    }
+    dir = tmpl;
+    ownDir = true;
+  }
+  using Clock = std::chrono::steady_clock;
+  uint8_t kind;
+  uint8_t rec[2 + 64];
+  uint64_t streamBytes = 0;
+
+  // Naive: append each record, flush after every one and, for a
+  // like-for-like comparison, only every syncMs like the sink
+  std::vector<uint32_t> naiveUs, batchedUs;
+  double naiveSeconds = 0, batchedSeconds = 0;
+  uint32_t naiveSyncs = 0, batchedSyncs = 0;
+  if (!runNaive(dir + "/naive.log", records, 0, naiveUs, naiveSeconds, naiveSyncs) ||
+      !runNaive(dir + "/batched.log", records, syncMs, batchedUs, batchedSeconds, batchedSyncs)) {
+    perror(dir.c_str());
+    return 2;
+  }
+  for (uint32_t i = 0; i < records; i++) streamBytes += makeRecord(i, kind, rec) + 2;
+
+  // Block-aligned sink, polled after every record as loop() would
+  FileCard_t card;
+  card.dir = dir;
+  std::unique_ptr<SdSink_t> sink(new SdSink_t());
+  SdBackend_t fileBackend = { &card, fileCardOpen, fileCardWrite, fileCardSync };
+  if (!sdSinkBegin(*sink, fileBackend, SDBENCH_FILE_BYTES, syncMs, 1)) {
+    fprintf(stderr, "fridgetool: cannot create sink files in %s\n", dir.c_str());
+    return 2;
+  }
+  std::vector<uint32_t> sinkUs;
+  sinkUs.reserve(records);
+  auto t0 = Clock::now();
+  for (uint32_t i = 0; i < records; i++) {
+    size_t len = makeRecord(i, kind, rec);
+    unsigned long us = clockMicros();
+    sdSinkAppend(*sink, kind, rec, len);
+    sdSinkPoll(*sink);
+    sinkUs.push_back((uint32_t)(clockMicros() - us));
+  }
+  sdSinkPoll(*sink, true);
+  double sinkSeconds = std::chrono::duration<double>(Clock::now() - t0).count();
+  close(card.fd);
+
+  const SdSinkStats_t &st = sink->stats;
+  printf("%u records, %.2f MB\n", records, streamBytes / 1e6);
+  printLatency("naive, sync each", naiveUs, naiveSeconds, streamBytes);
+  printLatency("naive, sync interval", batchedUs, batchedSeconds, streamBytes);
+  printLatency("block sink", sinkUs, sinkSeconds, streamBytes);
+  printf("syncs: naive %u, naive with interval %u, block sink %u (every %lu ms)\n", naiveSyncs, batchedSyncs,
+         st.syncs, syncMs);
+  printf("block sink: %u full blocks, %u padded, %u files, block write avg %llu us max %u us, "
+         "%u dropped, %u errors\n",
+         st.blocksWritten, st.partialWrites, st.files,
+         (unsigned long long)(st.blocksWritten + st.partialWrites
+                                  ? st.writeMicrosSum / (st.blocksWritten + st.partialWrites) : 0),
+         st.writeMicrosMax, st.dropped, st.writeErrors);
+
+  std::vector<std::vector<uint8_t>> files(card.files);
+  for (uint32_t f = 0; f < card.files; f++) readFile(cardPath(card, f + 1), files[f]);
+  uint32_t mismatches;
+  uint32_t readBack = verifyFiles(files, mismatches);
+  printf("read back: %u of %u records, %u mismatched\n", readBack, records, mismatches);
+  if (ownDir) {
+    for (uint32_t f = 0; f < card.files; f++) unlink(cardPath(card, f + 1).c_str());
+    unlink((dir + "/naive.log").c_str());
+    unlink((dir + "/batched.log").c_str());
+    rmdir(dir.c_str());
+  }
+
+  return 0;
+}
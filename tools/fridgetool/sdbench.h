@@ -0,0 +1,23 @@
+/***************************************************************
+ * SD sink benchmark
+ *
+ * Runs the firmware's block-aligned SD sink
+ * (include/sd_sink.h) against a file-backed stand-in for the
+ * card: preallocated with posix_fallocate(), written with
+ * pwrite(), synced with fdatasync(). The same record stream
+ * (history records mixed with binary log records) is also
+ * written the naive way, one append per record, synced
+ * after every record and, like the sink, every --sync-ms.
+ * Prints sustained throughput, per-record latency and sync
+ * counts for all three, then reads the sink's files back.
+ *
+ * Power loss, stale blocks and the retry of a failed open
+ * are covered by test/test_sd_sink.
+ ***************************************************************/
+
+#pragma once
+
+/** --------------------------------------------------
+ * fridgetool sdbench [--records N] [--dir DIR] [--sync-ms MS]
+ * -------------------------------------------------- */
+int sdbenchMain(int argc, char** argv);
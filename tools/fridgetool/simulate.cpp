@@ -0,0 +1,399 @@
+/***************************************************************
+ * Virtual-time simulation of the firmware's link cadence
+ * (see simulate.h)
+ ***************************************************************/
+
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "simulate.h"
+#include "link_monitor.h"
+#include "virtual_clock.h"
+
+// Loop period and blocking calls of src/main.cpp
+#define SIM_LOOP_DELAY_MS 100
+#define SIM_SCAN_MS 5000
+#define SIM_CONNECT_MS 1500          // connect, discovery and bind
+#define SIM_SUPERVISION_MS 4000      // a dead link is noticed this much later
+
+// Simulated fridge
+#define SIM_LATENCY_MIN_MS 40
+#define SIM_LATENCY_MAX_MS 400
+#define SIM_CONNECT_SUCCESS_PERCENT 90
+
+// Simulated radio. The environment (drift around --rssi and fades) is
+// the same for every connection; a connection can also degrade on its
+// own (e.g. a bad channel map), which only a new connection clears.
+#define SIM_RSSI_NOISE_DB 8          // per sample, +-
+#define SIM_ENV_TICK_MS 1000
+#define SIM_DRIFT_DB 3.0             // standard deviation of the slow drift
+#define SIM_DRIFT_TAU_MS 1800000.0   // and its time constant
+#define SIM_FADE_DB 12.0
+#define SIM_FADE_MEAN_MS 900000.0    // mean fade duration
+#define SIM_DEGRADE_DB_PER_MIN 2.0
+#define SIM_DEGRADE_MAX_DB 25.0
+// Below the sensitivity the link is lost within seconds; the chance
+// falls off by e every SIM_LOSS_SLOPE_DB above it. Responses start to
+// go missing SIM_DROP_MARGIN_DB above the sensitivity.
+#define SIM_SENSITIVITY_DBM -97.0
+#define SIM_LOSS_SLOPE_DB 2.0
+#define SIM_LOSS_PER_S_AT_SENSITIVITY 0.1
+#define SIM_DROP_MARGIN_DB 4.0
+
+enum SimEvent_t {
+  SIM_EV_CONNECT = 1,
+  SIM_EV_CONNECT_FAIL,
+  SIM_EV_QUERY,
+  SIM_EV_RESPONSE,
+  SIM_EV_TIMEOUT,
+  SIM_EV_LINK_LOST,
+  SIM_EV_PROACTIVE_RECONNECT,
+  SIM_EV_SLO_BREACH,
+  SIM_EV_SLO_ALERT
+};
+
+struct SimParams_t {
+  double days;
+  uint64_t seed;
+  uint32_t dropPercent;
+  double mtbfMinutes;
+  int rssiDbm;
+  double fadeMinutes;                // mean time between fades (0 = none)
+  double degradeMinutes;             // mean time until a connection degrades (0 = never)
+  bool proactive;
+};
+
+struct Simulation_t {
+  VirtualClock_t vc;
+  SimParams_t params;
+
+  // Firmware-side state, driven by the firmware's own code (link_monitor.h)
+  FridgeConfig_t config;
+  LinkQuality_t link = {};
+  FreshnessSlo_t slo = {};
+  bool connected = false;
+  bool knownAddress = false;         // reconnect without a scan (doConnect)
+  unsigned long lastReadingMillis = 0;
+  bool haveReading = false;
+
+  // Environment, on its own random stream so that runs with and
+  // without proactive reconnects see the same drift and fades
+  uint64_t envRng = 0;
+  double driftDb = 0;
+  bool fading = false;
+  uint64_t fadeEndUs = 0;
+
+  // Fridge-side state
+  bool responseInFlight = false;
+  bool responseReady = false;
+  bool linkDead = false;             // lost, not noticed yet
+  uint64_t linkLossAtUs = 0;         // when it will be noticed
+  bool degrading = false;            // this connection degrades
+  double impairmentDb = 0;
+  unsigned long radioMillis = 0;     // last radioStep()
+
+  // Results
+  uint64_t queries = 0, responses = 0, timeouts = 0, linkLosses = 0;
+  uint64_t connects = 0, connectFailures = 0;
+  unsigned long maxReadingAgeMs = 0;
+  uint64_t freshMs = 0, totalMs = 0;
+  uint64_t windows = 0, windowsBelowSlo = 0, sloAlerts = 0;
+  uint64_t sumRttMs = 0;
+  uint64_t gapMs = 0, lateReadings = 0;
+  uint64_t trace = 1469598103934665603ULL;
+};
+
+static void traceEvent(Simulation_t &sim, SimEvent_t ev) {
+  uint64_t values[2] = { sim.vc.nowUs, (uint64_t)ev };
+  const uint8_t* p = (const uint8_t*)values;
+  for (size_t i = 0; i < sizeof(values); i++) {
+    sim.trace ^= p[i];
+    sim.trace *= 1099511628211ULL;
+  }
+}
+
+// (0, 1], from the link's random stream
+static double linkUniform(Simulation_t &sim) {
+  return (virtualClockRandom(sim.vc, 1u << 24) + 1) / (double)(1u << 24);
+}
+
+// (0, 1], from the environment's random stream (xorshift64*)
+static double envUniform(Simulation_t &sim) {
+  sim.envRng ^= sim.envRng >> 12;
+  sim.envRng ^= sim.envRng << 25;
+  sim.envRng ^= sim.envRng >> 27;
+  return (((sim.envRng * 0x2545F4914F6CDD1DULL) >> 40) + 1) / (double)(1u << 24);
+}
+
+// 1 far below the threshold, 0 far above it
+static double belowSensitivity(double rssi, double thresholdDbm) {
+  return 1.0 / (1.0 + std::exp((rssi - thresholdDbm) / SIM_LOSS_SLOPE_DB));
+}
+
+// What the radio of the current connection really sees, without noise
+static double trueRssi(const Simulation_t &sim) {
+  return sim.params.rssiDbm + sim.driftDb - (sim.fading ? SIM_FADE_DB : 0.0) - sim.impairmentDb;
+}
+
+/** --------------------------------------------------
+ * Environment: drift (Ornstein-Uhlenbeck around --rssi)
+ * and fades, on a fixed tick whatever the firmware does.
+ * -------------------------------------------------- */
+static void environmentTick(void* arg) {
+  Simulation_t &sim = *(Simulation_t*)arg;
+  double dt = SIM_ENV_TICK_MS / SIM_DRIFT_TAU_MS;
+  double gauss = std::sqrt(-2.0 * std::log(envUniform(sim))) * std::cos(2.0 * M_PI * envUniform(sim));
+  sim.driftDb += -sim.driftDb * dt + SIM_DRIFT_DB * std::sqrt(2.0 * dt) * gauss;
+
+  double u = envUniform(sim);
+  if (sim.fading && sim.vc.nowUs >= sim.fadeEndUs) {
+    sim.fading = false;
+  } else if (!sim.fading && sim.params.fadeMinutes > 0 && u < SIM_ENV_TICK_MS / (sim.params.fadeMinutes * 60000.0)) {
+    sim.fading = true;
+    sim.fadeEndUs = sim.vc.nowUs + (uint64_t)(-std::log(envUniform(sim)) * SIM_FADE_MEAN_MS * 1000);
+  }
+  virtualClockSchedule(sim.vc, SIM_ENV_TICK_MS, environmentTick, &sim);
+}
+
+/** --------------------------------------------------
+ * Fridge model events
+ * -------------------------------------------------- */
+static void responseArrives(void* arg) {
+  Simulation_t &sim = *(Simulation_t*)arg;
+  if (!sim.responseInFlight || !sim.connected) return;
+  sim.responseInFlight = false;
+  sim.responseReady = true;
+}
+
+static void linkLost(void* arg) {
+  Simulation_t &sim = *(Simulation_t*)arg;
+  if (!sim.connected || sim.vc.nowUs != sim.linkLossAtUs) return;  // superseded
+  sim.connected = false;
+  sim.knownAddress = false;
+  sim.linkDead = false;
+  sim.linkLosses++;
+  traceEvent(sim, SIM_EV_LINK_LOST);
+}
+
+static void disconnect(Simulation_t &sim) {
+  sim.connected = false;
+  sim.responseInFlight = false;
+  sim.linkDead = false;
+  sim.linkLossAtUs = 0;
+}
+
+/** --------------------------------------------------
+ * The connection's own degradation and the chance that
+ * the link dies, for the time since the last call. The
+ * firmware only notices SIM_SUPERVISION_MS later.
+ * -------------------------------------------------- */
+static void radioStep(Simulation_t &sim, unsigned long now) {
+  double dtMs = (double)(now - sim.radioMillis);
+  sim.radioMillis = now;
+  if (!sim.connected || sim.linkDead) return;
+
+  if (sim.degrading) {
+    sim.impairmentDb = std::fmin(SIM_DEGRADE_MAX_DB, sim.impairmentDb + SIM_DEGRADE_DB_PER_MIN * dtMs / 60000.0);
+  } else if (sim.params.degradeMinutes > 0 && linkUniform(sim) <= dtMs / (sim.params.degradeMinutes * 60000.0)) {
+    sim.degrading = true;
+  }
+
+  double perMs = 1.0 / (sim.params.mtbfMinutes * 60000.0) +
+                 SIM_LOSS_PER_S_AT_SENSITIVITY / 1000.0 * belowSensitivity(trueRssi(sim), SIM_SENSITIVITY_DBM);
+  if (linkUniform(sim) <= 1.0 - std::exp(-perMs * dtMs)) {
+    sim.linkDead = true;
+    sim.responseInFlight = false;
+    sim.linkLossAtUs = sim.vc.nowUs + (uint64_t)SIM_SUPERVISION_MS * 1000;
+    virtualClockSchedule(sim.vc, SIM_SUPERVISION_MS, linkLost, &sim);
+  }
+}
+
+/** --------------------------------------------------
+ * One pass of the firmware loop, in the order of loop()
+ * in src/main.cpp.
+ * -------------------------------------------------- */
+static void loopOnce(Simulation_t &sim) {
+  // 1-2) Scan (unless the address is known) and connect
+  if (!sim.connected) {
+    if (!sim.knownAddress) clockDelay(SIM_SCAN_MS);
+    clockDelay(SIM_CONNECT_MS);
+    sim.degrading = false;
+    sim.impairmentDb = 0;
+    double success = SIM_CONNECT_SUCCESS_PERCENT / 100.0 * (1.0 - belowSensitivity(trueRssi(sim), SIM_SENSITIVITY_DBM));
+    if (linkUniform(sim) <= success) {
+      sim.connected = true;
+      sim.knownAddress = true;
+      sim.connects++;
+      sim.radioMillis = clockMillis();
+      linkConnected(sim.link, clockMillis(), sim.config);
+      traceEvent(sim, SIM_EV_CONNECT);
+    } else {
+      sim.knownAddress = false;
+      sim.connectFailures++;
+      traceEvent(sim, SIM_EV_CONNECT_FAIL);
+    }
+  }
+
+  unsigned long now = clockMillis();
+  radioStep(sim, now);
+
+  // 3) Query cadence; a weak or dead link loses responses
+  if (sim.connected && linkQueryDue(sim.link, now, sim.config)) {
+    linkQuerySent(sim.link, now);
+    sim.queries++;
+    traceEvent(sim, SIM_EV_QUERY);
+    double drop = sim.params.dropPercent / 100.0 +
+                  belowSensitivity(trueRssi(sim), SIM_SENSITIVITY_DBM + SIM_DROP_MARGIN_DB);
+    if (!sim.linkDead && linkUniform(sim) > drop) {
+      uint32_t latency = SIM_LATENCY_MIN_MS + virtualClockRandom(sim.vc, SIM_LATENCY_MAX_MS - SIM_LATENCY_MIN_MS);
+      sim.responseInFlight = true;
+      virtualClockSchedule(sim.vc, latency, responseArrives, &sim);
+    }
+  }
+
+  // 4) Notification; a reading later than the query interval is a gap
+  if (sim.responseReady) {
+    sim.responseReady = false;
+    unsigned long rttMs;
+    if (linkResponse(sim.link, now, rttMs)) sim.sumRttMs += rttMs;
+    if (sim.haveReading && now - sim.lastReadingMillis > sim.config.queryIntervalMs) {
+      sim.gapMs += now - sim.lastReadingMillis - sim.config.queryIntervalMs;
+      if (now - sim.lastReadingMillis > sim.config.queryIntervalMs + sim.config.responseTimeoutMs) {
+        sim.lateReadings++;
+      }
+    }
+    sim.lastReadingMillis = now;
+    sim.haveReading = true;
+    sim.responses++;
+    traceEvent(sim, SIM_EV_RESPONSE);
+  }
+
+  // 6) Response timeouts and link score; a degrading link is reconnected
+  if (sim.connected) {
+    if (linkCheckTimeout(sim.link, now, sim.config)) {
+      sim.timeouts++;
+      traceEvent(sim, SIM_EV_TIMEOUT);
+    }
+    if (linkRssiSampleDue(sim.link, now, sim.config)) {
+      int rssi = (int)std::lround(trueRssi(sim)) - SIM_RSSI_NOISE_DB +
+                 (int)virtualClockRandom(sim.vc, 2 * SIM_RSSI_NOISE_DB + 1);
+      if (linkScoreSample(sim.link, rssi, now, sim.config) == LINK_RECONNECT) {
+        traceEvent(sim, SIM_EV_PROACTIVE_RECONNECT);
+        disconnect(sim);
+      }
+    }
+  }
+
+  // 7) Freshness SLO
+  unsigned long age = sim.haveReading ? now - sim.lastReadingMillis : ULONG_MAX;
+  unsigned long dt = now - sim.slo.lastUpdateMillis;
+  FreshnessReport_t report;
+  freshnessSloUpdate(sim.slo, now, sim.haveReading, age, sim.config.freshnessBoundMs, report);
+  if (sim.haveReading) {
+    if (age > sim.maxReadingAgeMs) sim.maxReadingAgeMs = age;
+    sim.totalMs += dt;
+    if (age <= sim.config.freshnessBoundMs) sim.freshMs += dt;
+  }
+  if (report.events & SLO_ALERT) {
+    sim.sloAlerts++;
+    traceEvent(sim, SIM_EV_SLO_ALERT);
+  }
+  if (report.events & SLO_WINDOW_END) {
+    sim.windows++;
+    if (report.percent < FRESHNESS_SLO_PERCENT) {
+      sim.windowsBelowSlo++;
+      traceEvent(sim, SIM_EV_SLO_BREACH);
+    }
+  }
+
+  clockDelay(SIM_LOOP_DELAY_MS);
+}
+
+/** --------------------------------------------------
+ * One run; the caller deletes the result.
+ * -------------------------------------------------- */
+static Simulation_t* runSimulation(const SimParams_t &params, double &seconds) {
+  Simulation_t* sim = new Simulation_t();
+  virtualClockInit(sim->vc, params.seed);
+  virtualClockInstall(sim->vc);
+  sim->params = params;
+  sim->envRng = (params.seed ^ 0xD1B54A32D192ED03ULL) | 1;
+  memset(&sim->config, 0, sizeof(sim->config));
+  linkDefaultConfig(sim->config);
+  // The firmware's own off switch (remote config link_score_reconnect = 0)
+  if (!params.proactive) sim->config.linkScoreReconnect = 0;
+  virtualClockSchedule(sim->vc, SIM_ENV_TICK_MS, environmentTick, sim);
+
+  auto t0 = std::chrono::steady_clock::now();
+  uint64_t endUs = (uint64_t)(params.days * 86400e6);
+  while (sim->vc.nowUs < endUs) loopOnce(*sim);
+  seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  clockInstall(nullptr);
+  return sim;
+}
+
+static void printReport(const Simulation_t &sim, double seconds) {
+  double days = sim.vc.nowUs / 86400e6;
+  printf("simulated:   %.2f days (seed %llu, proactive reconnect %s) in %.3f s wall\n", days,
+         (unsigned long long)sim.params.seed, sim.params.proactive ? "on" : "off", seconds);
+  printf("connects:    %llu (%llu failed attempts)\n", (unsigned long long)sim.connects,
+         (unsigned long long)sim.connectFailures);
+  printf("link losses: %llu, proactive reconnects: %llu (%llu low samples held off)\n",
+         (unsigned long long)sim.linkLosses, (unsigned long long)sim.link.proactiveReconnects,
+         (unsigned long long)sim.link.reconnectsHeldOff);
+  printf("queries:     %llu, responses: %llu, timeouts: %llu, avg rtt %.0f ms\n",
+         (unsigned long long)sim.queries, (unsigned long long)sim.responses,
+         (unsigned long long)sim.timeouts, sim.responses ? (double)sim.sumRttMs / sim.responses : 0.0);
+  printf("data gaps:   %.0f s beyond the query interval (%.0f s/day), %llu late readings\n",
+         sim.gapMs / 1000.0, days > 0 ? sim.gapMs / 1000.0 / days : 0.0, (unsigned long long)sim.lateReadings);
+  printf("freshness:   %.3f%% fresh, max age %lu ms, %llu/%llu windows below %.0f%%, %llu alerts\n",
+         sim.totalMs ? 100.0 * sim.freshMs / sim.totalMs : 0.0, sim.maxReadingAgeMs,
+         (unsigned long long)sim.windowsBelowSlo, (unsigned long long)sim.windows,
+         (double)FRESHNESS_SLO_PERCENT, (unsigned long long)sim.sloAlerts);
+  printf("trace:       %016llx\n", (unsigned long long)sim.trace);
+}
+
+int simulateMain(int argc, char** argv) {
+  SimParams_t params = { 7, 1, 2, 180, -70, 240, 120, true };
+  bool compare = false;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--days") == 0 && i + 1 < argc) params.days = atof(argv[++i]);
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) params.seed = strtoull(argv[++i], nullptr, 0);
+    else if (strcmp(argv[i], "--drop") == 0 && i + 1 < argc) params.dropPercent = (uint32_t)atoi(argv[++i]);
+    else if (strcmp(argv[i], "--mtbf") == 0 && i + 1 < argc) params.mtbfMinutes = atof(argv[++i]);
+    else if (strcmp(argv[i], "--rssi") == 0 && i + 1 < argc) params.rssiDbm = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--fade") == 0 && i + 1 < argc) params.fadeMinutes = atof(argv[++i]);
+    else if (strcmp(argv[i], "--degrade") == 0 && i + 1 < argc) params.degradeMinutes = atof(argv[++i]);
+    else if (strcmp(argv[i], "--no-proactive") == 0) params.proactive = false;
+    else if (strcmp(argv[i], "--compare") == 0) compare = true;
+    else {
+      fprintf(stderr, "usage: %s simulate [--days N] [--seed S] [--drop PCT] [--mtbf MINUTES] [--rssi DBM]\n"
+                      "          [--fade MINUTES] [--degrade MINUTES] [--no-proactive | --compare]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (compare) params.proactive = true;
+
+  double seconds;
+  Simulation_t* sim = runSimulation(params, seconds);
+  printReport(*sim, seconds);
+  if (compare) {
+    SimParams_t off = params;
+    off.proactive = false;
+    Simulation_t* without = runSimulation(off, seconds);
+    printf("\n");
+    printReport(*without, seconds);
+    printf("\ncompare:     gap time %.0f s with proactive reconnect, %.0f s without (%+.1f%%); "
+           "link losses %llu vs %llu\n",
+           sim->gapMs / 1000.0, without->gapMs / 1000.0,
+           without->gapMs ? 100.0 * ((double)sim->gapMs - (double)without->gapMs) / without->gapMs : 0.0,
+           (unsigned long long)sim->linkLosses, (unsigned long long)without->linkLosses);
+    delete without;
+  }
+  delete sim;
+  return 0;
+}
@@ -0,0 +1,31 @@
+/***************************************************************
+ * Virtual-time simulation of the firmware's link cadence
+ *
+ * Runs the firmware's link logic (include/link_monitor.h:
+ * query cadence, response timeouts, the RSSI link score
+ * with its proactive reconnect, the freshness SLO) in the
+ * order of the main loop, 100 ms per pass, against a
+ * simulated fridge with random response latency and
+ * dropped responses. The radio model degrades the link:
+ * RSSI drifts around --rssi and fades now and then (the
+ * same for every connection), and a connection can also
+ * degrade on its own until a new one replaces it. The
+ * weaker the RSSI, the more responses go missing and the
+ * likelier the link is lost, on top of the --mtbf losses.
+ * --compare runs the same seed again with proactive
+ * reconnects off and compares the data gaps. All timing
+ * goes through clockMillis() / clockDelay() on a
+ * VirtualClock_t (include/virtual_clock.h), so days of
+ * operation run in milliseconds and the same seed always
+ * gives the same trace hash.
+ ***************************************************************/
+
+#pragma once
+
+/** --------------------------------------------------
+ * fridgetool simulate [--days N] [--seed S] [--drop PCT]
+ *                     [--mtbf MINUTES] [--rssi DBM]
+ *                     [--fade MINUTES] [--degrade MINUTES]
+ *                     [--no-proactive | --compare]
+ * -------------------------------------------------- */
+int simulateMain(int argc, char** argv);
@@ -0,0 +1,119 @@
+/***************************************************************
+ * Concurrency stress test (see stress.h)
+ ***************************************************************/
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "stress.h"
+#include "fridge_protocol.h"
+#include "notify_mailbox.h"
+
+#define STRESS_DEFAULT_FRAMES 2000000
+#define STRESS_DEFAULT_DISCONNECT_EVERY 5000
+
+// Shared state, same types and contract as src/main.cpp
+static NotifyMailbox_t g_notifyMailbox;
+static std::atomic<bool> connected(false);
+static std::atomic<bool> doConnect(false);
+static std::atomic<bool> g_stressDone(false);
+
+/** --------------------------------------------------
+ * A valid query response carrying a 24-bit counter twice,
+ * so a frame mixed from two posts is always detected.
+ * -------------------------------------------------- */
+static void buildCountedFrame(uint8_t frame[24], uint32_t counter) {
+  memset(frame, 0, 24);
+  frame[0] = 0xFE;
+  frame[1] = 0xFE;
+  frame[2] = 21;
+  frame[3] = 0x01;
+  for (int i = 0; i < 3; i++) {
+    frame[16 + i] = (uint8_t)(counter >> (8 * i));
+    frame[19 + i] = (uint8_t)(counter >> (8 * i));
+  }
+  uint16_t sum = calculateChecksum(frame, 22);
+  frame[22] = sum >> 8;
+  frame[23] = sum & 0xFF;
+}
+
+/** --------------------------------------------------
+ * BLE task: notifies, plus a disconnect and a scan result
+ * every so often, racing with loop().
+ * -------------------------------------------------- */
+static void bleTask(uint32_t frames, uint32_t disconnectEvery) {
+  uint8_t frame[24];
+  for (uint32_t i = 1; i <= frames; i++) {
+    buildCountedFrame(frame, i & 0xFFFFFF);
+    notifyMailboxPost(g_notifyMailbox, frame, sizeof(frame), i);
+    std::this_thread::yield();                      // next connection event
+
+    if (i % disconnectEvery == 0) {
+      connected = false;                            // onDisconnect()
+    } else if (i % disconnectEvery == disconnectEvery / 2 && !connected && !doConnect) {
+      doConnect = true;                             // onResult()
+    }
+  }
+  g_stressDone = true;
+}
+
+int stressMain(int argc, char** argv) {
+  uint32_t frames = STRESS_DEFAULT_FRAMES;
+  uint32_t disconnectEvery = STRESS_DEFAULT_DISCONNECT_EVERY;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = (uint32_t)atol(argv[++i]);
+    else if (strcmp(argv[i], "--disconnect-every") == 0 && i + 1 < argc) {
+      disconnectEvery = (uint32_t)atol(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s stress [--frames N] [--disconnect-every N]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (frames > 0xFFFFFF) frames = 0xFFFFFF;
+  if (disconnectEvery < 2) disconnectEvery = 2;
+
+  connected = true;
+  std::thread ble(bleTask, frames, disconnectEvery);
+
+  // loop()
+  uint8_t frame[NOTIFY_MAILBOX_MAX_LEN];
+  size_t frameLen = 0;
+  unsigned long frameMillis = 0;
+  uint64_t taken = 0, torn = 0, outOfOrder = 0, reconnects = 0;
+  uint32_t lastCounter = 0;
+  for (;;) {
+    bool done = g_stressDone;
+    if (doConnect) {
+      connected = true;                             // connectToServer()
+      notifyMailboxClear(g_notifyMailbox);
+      doConnect = false;
+      reconnects++;
+    }
+    while (notifyMailboxTake(g_notifyMailbox, frame, frameLen, frameMillis)) {
+      taken++;
+      FridgeStatus_t st;
+      uint32_t a = frame[16] | (frame[17] << 8) | (frame[18] << 16);
+      uint32_t b = frame[19] | (frame[20] << 8) | (frame[21] << 16);
+      if (frameLen != 24 || !decodeFridgeQuerySingleZone(frame, frameLen, st) || a != b || a != frameMillis) {
+        torn++;
+        continue;
+      }
+      if (a <= lastCounter) outOfOrder++;
+      lastCounter = a;
+    }
+    if (done) break;
+    std::this_thread::yield();
+  }
+  ble.join();
+
+  printf("posted:      %u\n", g_notifyMailbox.posted);
+  printf("taken:       %llu (%u overwritten before loop() got them)\n",
+         (unsigned long long)taken, g_notifyMailbox.overwritten);
+  printf("reconnects:  %llu\n", (unsigned long long)reconnects);
+  printf("torn:        %llu\n", (unsigned long long)torn);
+  printf("out of order: %llu\n", (unsigned long long)outOfOrder);
+  return (torn || outOfOrder) ? 1 : 0;
+}
@@ -0,0 +1,20 @@
+/***************************************************************
+ * Concurrency stress test for the callback / loop hand-off
+ *
+ * Runs the firmware's notification mailbox
+ * (include/notify_mailbox.h) and its connected / doConnect
+ * flags with the device threading model: one thread plays
+ * the BLE task (rapid notifies, disconnects, scan results
+ * asking to reconnect) and another plays loop(). Every
+ * frame loop() takes must be whole and newer than the last
+ * one. Build with 'make tsan' to run it under
+ * ThreadSanitizer.
+ ***************************************************************/
+
+#pragma once
+
+/** --------------------------------------------------
+ * fridgetool stress [--frames N] [--disconnect-every N]
+ * Exit code 1 if a torn or out-of-order frame was seen.
+ * -------------------------------------------------- */
+int stressMain(int argc, char** argv);
@@ -0,0 +1,118 @@
+"""
+Extracts every LOG_ERROR / LOG_WARN / LOG_INFO / LOG_DEBUG format
+string from src/ and include/ and writes the dictionary that
+'fridgetool logdecode' uses to render -DLOG_BINARY logs.
+
+Each line is  id <TAB> level <TAB> file:line <TAB> format,  with the
+ID computed exactly as binlogFormatId() in include/binlog.h and
+backslash, tab, CR and LF escaped in the format. Two different
+lines that hash to the same ID fail the run; reword one of them.
+
+Runs before every PlatformIO build (extra_scripts) and writes
+$BUILD_DIR/log_dictionary.tsv; keep that file with the firmware
+image it belongs to. By hand:
+    python tools/log_dictionary.py [-o log_dictionary.tsv]
+"""
+
+import os
+import re
+import sys
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    ROOT = env["PROJECT_DIR"]  # noqa: F821
+    OUTPUT = os.path.join(env.subst("$BUILD_DIR"), "log_dictionary.tsv")  # noqa: F821
+except NameError:
+    env = None
+    ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+    OUTPUT = None
+
+LEVELS = {"ERROR": 1, "WARN": 2, "INFO": 3, "DEBUG": 4}
+CALL = re.compile(r'\bLOG_(ERROR|WARN|INFO|DEBUG)\(\s*((?:"(?:[^"\\]|\\.)*"\s*)+)')
+LITERAL = re.compile(r'"((?:[^"\\]|\\.)*)"')
+ESCAPES = {"n": "\n", "r": "\r", "t": "\t", "\\": "\\", '"': '"', "'": "'", "0": "\0"}
+
+
+def unescape(body):
+    """C string literal body -> bytes (UTF-8 source)."""
+    out = bytearray()
+    i = 0
+    while i < len(body):
+        c = body[i]
+        if c == "\\" and i + 1 < len(body):
+            n = body[i + 1]
+            if n == "x":
+                m = re.match(r"[0-9a-fA-F]+", body[i + 2:])
+                out.append(int(m.group(0), 16) & 0xFF)
+                i += 2 + len(m.group(0))
+                continue
+            out += ESCAPES.get(n, n).encode()
+            i += 2
+            continue
+        out += c.encode("utf-8")
+        i += 1
+    return bytes(out)
+
+
+def format_id(level, fmt):
+    h = ((2166136261 ^ level) * 16777619) & 0xFFFFFFFF
+    for b in fmt:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return ((h >> 16) ^ (h & 0xFFFF)) & 0xFFFF
+
+
+def escape(fmt):
+    text = fmt.decode("utf-8", "replace")
+    return text.replace("\\", "\\\\").replace("\t", "\\t").replace("\r", "\\r").replace("\n", "\\n")
+
+
+def collect():
+    entries = {}
+    collisions = []
+    for folder in ("src", "include"):
+        base = os.path.join(ROOT, folder)
+        for name in sorted(os.listdir(base)):
+            if not name.endswith((".cpp", ".h")) or name == "log.h":
+                continue
+            with open(os.path.join(base, name), encoding="utf-8") as f:
+                source = f.read()
+            for m in CALL.finditer(source):
+                level = LEVELS[m.group(1)]
+                fmt = b"".join(unescape(lit) for lit in LITERAL.findall(m.group(2)))
+                ident = format_id(level, fmt)
+                where = "%s/%s:%d" % (folder, name, source.count("\n", 0, m.start()) + 1)
+                previous = entries.get(ident)
+                if previous is not None and (previous[0], previous[2]) != (level, fmt):
+                    collisions.append("%04x: %s and %s" % (ident, previous[1], where))
+                elif previous is None:
+                    entries[ident] = (level, where, fmt)
+    return entries, collisions
+
+
+def main(output):
+    entries, collisions = collect()
+    if collisions:
+        for c in collisions:
+            sys.stderr.write("log_dictionary: format ID collision %s\n" % c)
+        return 1
+    names = {v: k for k, v in LEVELS.items()}
+    lines = ["# fridge-logdict/1"]
+    for ident in sorted(entries):
+        level, where, fmt = entries[ident]
+        lines.append("%04x\t%s\t%s\t%s" % (ident, names[level], where, escape(fmt)))
+    text = "\n".join(lines) + "\n"
+    if output is None:
+        sys.stdout.write(text)
+    else:
+        os.makedirs(os.path.dirname(os.path.abspath(output)), exist_ok=True)
+        with open(output, "w", encoding="utf-8") as f:
+            f.write(text)
+    return 0
+
+
+if env is not None:
+    if main(OUTPUT) != 0:
+        env.Exit(1)  # noqa: F821
+elif __name__ == "__main__":
+    args = sys.argv[1:]
+    sys.exit(main(args[1] if len(args) == 2 and args[0] == "-o" else None))